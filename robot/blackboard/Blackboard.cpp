@@ -136,9 +136,11 @@ void BehaviourBlackboard::readOptions(const program_options::variables_map& conf
 void LocalisationBlackboard::readOptions(const program_options::variables_map& config) {
    if (config["debug.set_initial_pose"].as<bool>()) {
       setInitialPose = true;
-      robotPos.vec[0] = config["debug.initial_x"].as<int>();
-      robotPos.vec[1] = config["debug.initial_y"].as<int>();
-      robotPos.vec[2] = M_PI * config["debug.initial_theta"].as<int>() / 180.0;
+      AbsCoord initialPos = robotPos.read();
+      initialPos.vec[0] = config["debug.initial_x"].as<int>();
+      initialPos.vec[1] = config["debug.initial_y"].as<int>();
+      initialPos.vec[2] = M_PI * config["debug.initial_theta"].as<int>() / 180.0;
+      robotPos.write(initialPos);
    }
    else {
       setInitialPose = false;
@@ -175,7 +177,6 @@ VisionBlackboard::VisionBlackboard()
    llog(INFO) << "Initialising blackboard: vision" << endl;
    landmarks.reserve(MAX_LANDMARKS);
    feet_boxes.reserve(MAX_FEET);
-   balls.reserve(MAX_BALLS);
    posts.reserve(MAX_POSTS);
    robots.reserve(MAX_ROBOTS);
    fieldBoundaries.reserve(MAX_FIELD_BOUNDARIES);
@@ -188,6 +189,7 @@ VisionBlackboard::VisionBlackboard()
    homeMapSize = 0;
    awayMapSize = 0;
 
+   frameSequence = 0;
    saliency = NULL;
    currentFrame = NULL;
    topFrame = NULL;
@@ -198,12 +200,18 @@ VisionBlackboard::VisionBlackboard()
    lastSecond = LastSecondInfo();
 }
 
+std::vector<BallInfo> VisionBlackboard::behaviourBalls() const {
+   std::vector<BallInfo> filtered = filteredBalls.read();
+   return filtered.empty() ? balls.read() : filtered;
+}
+
 PerceptionBlackboard::PerceptionBlackboard() {
    kinematics = 0;
    localisation = 0;
    vision = 0;
    behaviour = 0;
    total = 33;
+   frameAge = 0;
 }
 
 MotionBlackboard::MotionBlackboard() {
@@ -80,9 +80,11 @@ Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #include "types/TeamBallInfo.hpp"
 #include "types/CameraSettings.hpp"
 #include "types/LastSecondInfo.hpp"
+#include "types/ProfileZoneStats.hpp"
 
 #include "perception/vision/Region.hpp"
 #include "soccer.hpp"
+#include "blackboard/VersionedBuffer.hpp"
 
 #include "simulation/SimVisionAdapter.hpp"
 
@@ -99,6 +101,20 @@ namespace VisionTest
 #define readFrom(module, component) \
    blackboard->read(&(blackboard->module.component))
 
+/**
+ * Macro to wrap conditional reads of versioned components.
+ * Copies the component into dest only if it has been written since
+ * lastVersion was recorded, and updates lastVersion.
+ * @param module which module's blackboard to read
+ * @param component the VersionedBuffer component to read
+ * @param dest where to copy the component to
+ * @param lastVersion the version the caller last read
+ * @return whether dest was updated
+ */
+#define readFromIfChanged(module, component, dest, lastVersion) \
+   blackboard->readIfChanged(&(blackboard->module.component), \
+                             &(dest), &(lastVersion))
+
 /**
  * Macro to wrap array reads from module's blackboard.
  * Performs a memcpy on the provided arguments.
@@ -162,7 +178,8 @@ struct KinematicsBlackboard {
    std::vector< std::vector <int> > sonarFiltered;
    bool isCalibrating;
    Parameters<float> parameters;
-   SensorValues sensorsLagged;
+   // Written by Motion and read by vision on its own stage when pipelined
+   VersionedBuffer<SensorValues> sensorsLagged;
 };
 
 /* Data Behaviour module will be sharing with others */
@@ -186,7 +203,7 @@ struct LocalisationBlackboard {
    void readOptions(const boost::program_options::variables_map& config);
 
    // Global robot position
-   AbsCoord robotPos;
+   VersionedBuffer<AbsCoord> robotPos;
    std::vector< AbsCoord > allrobotPos;
 
    // Number of frames since the ball has been seen.
@@ -240,8 +257,13 @@ struct LocalisationBlackboard {
 struct VisionBlackboard {
 
    explicit VisionBlackboard();
+   /* The balls behaviour sees: filteredBalls when there are any, else balls */
+   std::vector<BallInfo> behaviourBalls() const;
+
    /* Time the frame was captured */
    int64_t timestamp;
+   /* The top camera driver's counter for the frame, 0 if it has none */
+   uint32_t frameSequence;
 
    /* Info from the previous second's frames */
    LastSecondInfo lastSecond;
@@ -249,7 +271,10 @@ struct VisionBlackboard {
    /* Detected features */
    std::vector<Ipoint>              landmarks;
    std::vector<FootInfo>            feet_boxes;
-   std::vector<BallInfo>            balls;
+   VersionedBuffer<std::vector<BallInfo> > balls;
+   /* Balls localisation's ball filter makes of robot detections, written
+    * only by localisation so vision stays the only writer of balls */
+   VersionedBuffer<std::vector<BallInfo> > filteredBalls;
    std::vector<BallInfo>            uncertain_balls;
    BallHint                         ballHint;
    std::vector<PostInfo>            posts;
@@ -298,6 +323,10 @@ struct PerceptionBlackboard {
    uint32_t vision;
    uint32_t behaviour;
    uint32_t total;
+   /* Time from camera dequeue to the end of behaviour for the last frame */
+   uint32_t frameAge;
+   /* Profiler zone timings over the last profiling window, all threads */
+   std::vector<ProfileZoneStats> profile;
 };
 
 struct GameControllerBlackboard {
@@ -316,7 +345,7 @@ struct GameControllerBlackboard {
 
 struct MotionBlackboard {
    explicit MotionBlackboard();
-   SensorValues sensors;
+   VersionedBuffer<SensorValues> sensors;
    // A rolling list of recent observations of range (m) readings to potentially multiple obstacles
    std::vector < std::vector <int> > sonarWindow;
    float uptime;
@@ -420,6 +449,19 @@ class Blackboard {
       /* Write a component to the Blackboard */
       template<class T> void write(T *component, const T& value);
 
+      /* Read a copy of a lock-free versioned component */
+      template<class T, int SLOTS>
+      T read(const VersionedBuffer<T, SLOTS> *component);
+
+      /* Publish a new value of a lock-free versioned component */
+      template<class T, int SLOTS>
+      void write(VersionedBuffer<T, SLOTS> *component, const T& value);
+
+      /* Read a versioned component only if it changed since lastVersion */
+      template<class T, int SLOTS>
+      bool readIfChanged(const VersionedBuffer<T, SLOTS> *component,
+                         T *dest, uint32_t *lastVersion);
+
       /**
        * helper for serialization
        */
@@ -4,6 +4,7 @@
 #include <boost/serialization/utility.hpp>
 #include <boost/serialization/vector.hpp>
 
+#include "perception/vision/ColourRuns.hpp"
 #include "soccer.hpp"
 
 template<class T>
@@ -16,6 +17,22 @@ void Blackboard::write(T *component, const T& value) {
    *component = value;
 }
 
+template<class T, int SLOTS>
+T Blackboard::read(const VersionedBuffer<T, SLOTS> *component) {
+   return component->read();
+}
+
+template<class T, int SLOTS>
+void Blackboard::write(VersionedBuffer<T, SLOTS> *component, const T& value) {
+   component->write(value);
+}
+
+template<class T, int SLOTS>
+bool Blackboard::readIfChanged(const VersionedBuffer<T, SLOTS> *component,
+                               T *dest, uint32_t *lastVersion) {
+   return component->readIfChanged(*dest, *lastVersion);
+}
+
 /* ============================================================================
  *                     BACKWARDS-COMPATIBLE SERIALISATION
  * ============================================================================
@@ -80,7 +97,7 @@ void Blackboard::write(T *component, const T& value) {
  *
  * For more info, see the Wiki page titled 'Serialization'.
  */
-BOOST_CLASS_VERSION(Blackboard, 19);
+BOOST_CLASS_VERSION(Blackboard, 22);
 
 template<class Archive>
 void Blackboard::shallowSerialize(Archive & ar,
@@ -104,6 +121,12 @@ void Blackboard::shallowSerialize(Archive & ar,
    ar & perception.localisation;
    ar & perception.total;
    ar & perception.vision;
+   if (version >= 20) {
+      ar & perception.frameAge;
+   }
+   if (version >= 21) {
+      ar & perception.profile;
+   }
 
    // This request was updated for version 19 but not sure if more is required
    ar & behaviour.request;
@@ -188,6 +211,29 @@ void Blackboard::shallowSerialize(Archive & ar,
    ar & localisation.havePendingIncomingSharedBundle;
 }
 
+/* Saliency is sent and dumped as packed colour runs, see ColourRuns */
+template<class Archive>
+static void saveSaliency(Archive &ar, const char *name, const Colour *saliency,
+                         int cols, int rows) {
+   ColourRuns runs;
+   runs.encode(saliency, cols, rows);
+   std::vector<uint8_t> packed;
+   runs.pack(packed);
+   ar & boost::serialization::make_nvp(name, packed);
+}
+
+template<class Archive>
+static void loadSaliency(Archive &ar, Colour *saliency, int cols, int rows) {
+   std::vector<uint8_t> packed;
+   ar & packed;
+   ColourRuns runs;
+   if (packed.empty() ||
+       !runs.unpack(&packed[0], packed.size(), cols, rows)) {
+      throw std::runtime_error("Saliency runs do not make a whole image");
+   }
+   runs.decode(saliency);
+}
+
 template<class Archive>
 void Blackboard::save(Archive & ar, const unsigned int version) const {
    // note, version is always the latest when saving
@@ -201,32 +247,18 @@ void Blackboard::save(Archive & ar, const unsigned int version) const {
    if ((mask & BLACKBOARD_MASK) && (mask & SALIENCY_MASK)) {
       locks.serialization->lock();
       ((Blackboard*)this)->shallowSerialize(ar, version);
-      // TODO(jayen): RLE
-      ar & boost::serialization::
-      make_nvp("TopSaliency",
-               boost::serialization::
-               make_binary_object(vision.topSaliency,
-                                  sizeof(Colour[IMAGE_COLS / TOP_SALIENCY_DENSITY][IMAGE_ROWS / TOP_SALIENCY_DENSITY])));
-      ar & boost::serialization::
-      make_nvp("BotSaliency",
-               boost::serialization::
-               make_binary_object(vision.botSaliency,
-                                  sizeof(Colour[IMAGE_COLS / BOT_SALIENCY_DENSITY][IMAGE_ROWS / BOT_SALIENCY_DENSITY])));
+      saveSaliency(ar, "TopSaliency", vision.topSaliency,
+                   TOP_SALIENCY_COLS, TOP_SALIENCY_ROWS);
+      saveSaliency(ar, "BotSaliency", vision.botSaliency,
+                   BOT_SALIENCY_COLS, BOT_SALIENCY_ROWS);
       locks.serialization->unlock();
    } else if (mask & BLACKBOARD_MASK) {
       ((Blackboard*)this)->shallowSerialize(ar, version);
    } else if (mask & SALIENCY_MASK) {
-      // TODO(jayen): RLE
-      ar & boost::serialization::
-      make_nvp("TopSaliency",
-               boost::serialization::
-               make_binary_object(vision.topSaliency,
-                                  sizeof(Colour[IMAGE_COLS / TOP_SALIENCY_DENSITY][IMAGE_ROWS / TOP_SALIENCY_DENSITY])));
-      ar & boost::serialization::
-      make_nvp("BotSaliency",
-               boost::serialization::
-               make_binary_object(vision.botSaliency,
-                                  sizeof(Colour[IMAGE_COLS / BOT_SALIENCY_DENSITY][IMAGE_ROWS / BOT_SALIENCY_DENSITY])));
+      saveSaliency(ar, "TopSaliency", vision.topSaliency,
+                   TOP_SALIENCY_COLS, TOP_SALIENCY_ROWS);
+      saveSaliency(ar, "BotSaliency", vision.botSaliency,
+                   BOT_SALIENCY_COLS, BOT_SALIENCY_ROWS);
    }
    if (mask & RAW_IMAGE_MASK) {
       // TODO(jayen): zlib
@@ -252,16 +284,20 @@ void Blackboard::load(Archive & ar, const unsigned int version) {
       vision.topSaliency = (Colour*) new
                   Colour[IMAGE_COLS / TOP_SALIENCY_DENSITY]
                         [IMAGE_ROWS / TOP_SALIENCY_DENSITY];
-      // TODO(jayen): RLE
-      ar & boost::serialization::make_binary_object(vision.topSaliency,
-                                                    sizeof(Colour[IMAGE_COLS / TOP_SALIENCY_DENSITY][IMAGE_ROWS / TOP_SALIENCY_DENSITY]));
-
       vision.botSaliency = (Colour*) new
                   Colour[IMAGE_COLS / BOT_SALIENCY_DENSITY]
                         [IMAGE_ROWS / BOT_SALIENCY_DENSITY];
-      // TODO(jayen): RLE
-      ar & boost::serialization::make_binary_object(vision.botSaliency,
-                                                    sizeof(Colour[IMAGE_COLS / BOT_SALIENCY_DENSITY][IMAGE_ROWS / BOT_SALIENCY_DENSITY]));
+      if (version >= 22) {
+         loadSaliency(ar, vision.topSaliency,
+                      TOP_SALIENCY_COLS, TOP_SALIENCY_ROWS);
+         loadSaliency(ar, vision.botSaliency,
+                      BOT_SALIENCY_COLS, BOT_SALIENCY_ROWS);
+      } else {
+         ar & boost::serialization::make_binary_object(vision.topSaliency,
+                                                       sizeof(Colour[IMAGE_COLS / TOP_SALIENCY_DENSITY][IMAGE_ROWS / TOP_SALIENCY_DENSITY]));
+         ar & boost::serialization::make_binary_object(vision.botSaliency,
+                                                       sizeof(Colour[IMAGE_COLS / BOT_SALIENCY_DENSITY][IMAGE_ROWS / BOT_SALIENCY_DENSITY]));
+      }
    }
    if (mask & RAW_IMAGE_MASK) {
       vision.topFrame = new uint8_t[IMAGE_ROWS * IMAGE_COLS * 2];
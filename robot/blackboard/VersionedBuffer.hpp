@@ -0,0 +1,106 @@
+#pragma once
+
+#include <stdint.h>
+#include <boost/serialization/level.hpp>
+#include <boost/serialization/tracking.hpp>
+#include <boost/serialization/split_free.hpp>
+
+/* Number of slots in a VersionedBuffer. A writer always needs one slot that
+ * is neither the latest value nor being copied by a reader, so this must be
+ * at least (concurrent readers + 2). Motion, Perception and the three
+ * transmitters can all read the same component at once. */
+#define VERSIONED_BUFFER_SLOTS 6
+
+/* A lock-free, single-writer, multi-reader buffer for a Blackboard component
+ *
+ * The writer copies each new value into a slot no reader is using and then
+ * publishes it, so readers always see a complete value and the writer never
+ * waits on a reader. Each published value carries a monotonically increasing
+ * version so readers can skip work when nothing has changed.
+ *
+ * Values are returned by copy; a reader only pins a slot for the duration of
+ * that copy. If every other slot is pinned the write is dropped and counted
+ * rather than blocking the writer (e.g. the 100Hz real-time Motion thread). */
+template <class T, int SLOTS = VERSIONED_BUFFER_SLOTS>
+class VersionedBuffer {
+   public:
+      VersionedBuffer();
+      explicit VersionedBuffer(const T &value);
+
+      /* Copying is not atomic with respect to the destination, it is only
+       * intended for copying whole Blackboards (e.g. dump readers) */
+      VersionedBuffer(const VersionedBuffer &other);
+      VersionedBuffer &operator=(const VersionedBuffer &other);
+
+      /* @return a copy of the most recently published value */
+      T read() const;
+
+      /* Copy the most recently published value into dest if its version is
+       * different to lastVersion, updating lastVersion
+       * @return whether dest was updated */
+      bool readIfChanged(T &dest, uint32_t &lastVersion) const;
+
+      /* Publish a new value. Must only be called from one thread. */
+      void write(const T &value);
+
+      /* @return the version of the most recently published value */
+      uint32_t version() const;
+
+      /* @return the number of writes dropped because all slots were busy */
+      uint32_t dropped() const;
+
+   private:
+      /* Pin the latest slot so the writer won't reuse it
+       * @return the pinned slot */
+      int pin() const;
+      void unpin(int slot) const;
+
+      T slots[SLOTS];
+      uint32_t versions[SLOTS];
+      mutable volatile int readers[SLOTS];
+      volatile int latest;
+      volatile uint32_t numDropped;
+};
+
+namespace boost {
+   namespace serialization {
+      /* Serialise only the wrapped value so dumps are unchanged by wrapping
+       * a Blackboard component in a VersionedBuffer */
+      template <class T, int SLOTS>
+      struct implementation_level<VersionedBuffer<T, SLOTS> > {
+         typedef mpl::integral_c_tag tag;
+         typedef mpl::int_<object_serializable> type;
+         BOOST_STATIC_CONSTANT(int, value = object_serializable);
+      };
+
+      template <class T, int SLOTS>
+      struct tracking_level<VersionedBuffer<T, SLOTS> > {
+         typedef mpl::integral_c_tag tag;
+         typedef mpl::int_<track_never> type;
+         BOOST_STATIC_CONSTANT(int, value = track_never);
+      };
+
+      template <class Archive, class T, int SLOTS>
+      void save(Archive &ar, const VersionedBuffer<T, SLOTS> &buffer,
+                const unsigned int version) {
+         const T value = buffer.read();
+         ar & value;
+      }
+
+      template <class Archive, class T, int SLOTS>
+      void load(Archive &ar, VersionedBuffer<T, SLOTS> &buffer,
+                const unsigned int version) {
+         T value;
+         ar & value;
+         buffer.write(value);
+      }
+
+      template <class Archive, class T, int SLOTS>
+      void serialize(Archive &ar, VersionedBuffer<T, SLOTS> &buffer,
+                     const unsigned int version) {
+         split_free(ar, buffer, version);
+      }
+   }
+}
+
+#include "blackboard/VersionedBuffer.tcc"
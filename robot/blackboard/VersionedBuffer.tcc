@@ -0,0 +1,117 @@
+template <class T, int SLOTS>
+VersionedBuffer<T, SLOTS>::VersionedBuffer()
+   : latest(0), numDropped(0) {
+   for (int i = 0; i < SLOTS; ++i) {
+      versions[i] = 0;
+      readers[i] = 0;
+   }
+}
+
+template <class T, int SLOTS>
+VersionedBuffer<T, SLOTS>::VersionedBuffer(const T &value)
+   : latest(0), numDropped(0) {
+   for (int i = 0; i < SLOTS; ++i) {
+      versions[i] = 0;
+      readers[i] = 0;
+   }
+   slots[0] = value;
+}
+
+template <class T, int SLOTS>
+VersionedBuffer<T, SLOTS>::VersionedBuffer(const VersionedBuffer &other)
+   : latest(0), numDropped(0) {
+   for (int i = 0; i < SLOTS; ++i) {
+      versions[i] = 0;
+      readers[i] = 0;
+   }
+   int slot = other.pin();
+   slots[0] = other.slots[slot];
+   versions[0] = other.versions[slot];
+   other.unpin(slot);
+}
+
+template <class T, int SLOTS>
+VersionedBuffer<T, SLOTS> &VersionedBuffer<T, SLOTS>::operator=(
+      const VersionedBuffer &other) {
+   if (this != &other) {
+      int slot = other.pin();
+      write(other.slots[slot]);
+      other.unpin(slot);
+   }
+   return *this;
+}
+
+template <class T, int SLOTS>
+int VersionedBuffer<T, SLOTS>::pin() const {
+   while (true) {
+      int slot = latest;
+      __sync_fetch_and_add(&readers[slot], 1);
+      // the writer only reuses slots that aren't latest, so if this slot is
+      // still latest after pinning it, the writer can't have started on it
+      if (slot == latest) {
+         return slot;
+      }
+      __sync_fetch_and_sub(&readers[slot], 1);
+   }
+}
+
+template <class T, int SLOTS>
+void VersionedBuffer<T, SLOTS>::unpin(int slot) const {
+   __sync_fetch_and_sub(&readers[slot], 1);
+}
+
+template <class T, int SLOTS>
+T VersionedBuffer<T, SLOTS>::read() const {
+   int slot = pin();
+   T value = slots[slot];
+   unpin(slot);
+   return value;
+}
+
+template <class T, int SLOTS>
+bool VersionedBuffer<T, SLOTS>::readIfChanged(T &dest,
+                                              uint32_t &lastVersion) const {
+   if (version() == lastVersion) {
+      return false;
+   }
+   int slot = pin();
+   dest = slots[slot];
+   lastVersion = versions[slot];
+   unpin(slot);
+   return true;
+}
+
+template <class T, int SLOTS>
+void VersionedBuffer<T, SLOTS>::write(const T &value) {
+   int current = latest;
+   int slot = -1;
+   for (int i = 0; i < SLOTS; ++i) {
+      if (i != current && __sync_fetch_and_add(&readers[i], 0) == 0) {
+         slot = i;
+         break;
+      }
+   }
+   if (slot < 0) {
+      __sync_fetch_and_add(&numDropped, 1);
+      return;
+   }
+
+   slots[slot] = value;
+   versions[slot] = versions[current] + 1;
+
+   // make sure the value is visible before it is published
+   __sync_synchronize();
+   latest = slot;
+   __sync_synchronize();
+}
+
+template <class T, int SLOTS>
+uint32_t VersionedBuffer<T, SLOTS>::version() const {
+   __sync_synchronize();
+   return versions[latest];
+}
+
+template <class T, int SLOTS>
+uint32_t VersionedBuffer<T, SLOTS>::dropped() const {
+   return numDropped;
+}
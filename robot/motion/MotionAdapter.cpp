@@ -49,7 +49,7 @@ Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #include "types/ActionCommand.hpp"
 #include "types/JointValues.hpp"
 #include "types/SensorValues.hpp"
-#include "utils/Timer.hpp"
+#include "utils/Profiler.hpp"
 
 #include "gamecontroller/RoboCupGameControlData.hpp"
 
@@ -75,7 +75,7 @@ void construct(Effector** effector, std::string name, int team, int player_numbe
  * Motion thread constructor
  *---------------------------------------------------------------------------*/
 MotionAdapter::MotionAdapter(Blackboard *bb)
-   : Adapter(bb), uptime(0) {
+   : Adapter(bb), uptime(0), robotPoseVersion(-1) {
    llog(INFO) << "Constructing MotionAdapter" << endl;
 
    sensorBuffer.clear();
@@ -165,7 +165,7 @@ void MotionAdapter::readOptions(const boost::program_options::variables_map& con
  * Motion thread tick function
  *---------------------------------------------------------------------------*/
 void MotionAdapter::tick() {
-   Timer t;
+   PROFILE_ZONE(sensorsZone, "motion.sensors");
 
    // Get the motion request from behaviours
    int behaviourReadBuf = readFrom(behaviour, readBuf);
@@ -204,9 +204,9 @@ void MotionAdapter::tick() {
 
    bool standing = touch->getStanding();
    ButtonPresses buttons = touch->getButtons();
-   llog(VERBOSE) << "touch->getSensors took "
-                 << t.elapsed_ms() << "ms" << std::endl;
-   t.restart();
+   sensorsZone.stop();
+
+   PROFILE_ZONE(blackboardZone, "motion.blackboard");
 
    // Keep a running time for standing
    if (standing) {
@@ -235,9 +235,9 @@ void MotionAdapter::tick() {
    buttons |= readFrom(motion, buttons);
    writeTo(motion, buttons, buttons);
 
-   llog(VERBOSE) << "writeTo / readFrom took "
-                 << t.elapsed_ms() << "ms" << std::endl;
-   t.restart();
+   blackboardZone.stop();
+
+   PROFILE_ZONE(generatorZone, "motion.generator");
 
    if (standing) {
       generator->reset();
@@ -247,7 +247,7 @@ void MotionAdapter::tick() {
 
    // Get the position of the ball in robot relative cartesian coordinates
    
-   AbsCoord robotPose = readFrom(localisation, robotPos);
+   readFromIfChanged(localisation, robotPos, robotPose, robotPoseVersion);
    AbsCoord ballAbs = readFrom(localisation, ballPos);
    AbsCoord ball = ballAbs.convertToRobotRelativeCartesian(robotPose);
 
@@ -265,15 +265,10 @@ void MotionAdapter::tick() {
 
    // Odometry is lagged by walk's estimations, and it also correctly synchronises with vision
    writeTo(motion, odometry, Odometry(odometry));
-   
-   llog(VERBOSE) << "generator->makeJoints took "
-                 << t.elapsed_ms() << "ms" << std::endl;
-
-   t.restart();
+   generatorZone.stop();
 
    // Actuate joints as requested.
+   PROFILE_ZONE(effectorZone, "motion.effector");
    effector->actuate(joints, request.leds, request.sonar, request.stiffen);
-   llog(VERBOSE) << "effector->actuate took "
-                 << t.elapsed_ms() << "ms" << std::endl;
 }
 
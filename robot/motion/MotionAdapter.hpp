@@ -33,6 +33,7 @@ Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 
 #include <string>
 #include <map>
+#include <stdint.h>
 #include "motion/effector/Effector.hpp"
 #include "motion/generator/Generator.hpp"
 #include "motion/touch/FilteredTouch.hpp"
@@ -40,6 +41,7 @@ Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #include "motion/generator/BodyModel.hpp"
 #include "perception/kinematics/Kinematics.hpp"
 #include "motion/SonarRecorder.hpp"
+#include "types/AbsCoord.hpp"
 
 /**
  * MotionAdapter - interfaces between Motion & rest of system via Blackboard
@@ -83,4 +85,9 @@ class MotionAdapter : Adapter {
       Effector* effector;
       BodyModel bodyModel;
       Kinematics kinematics;
+      /* Localisation's pose, only copied when it has been updated as
+       * localisation runs at a third of motion's rate. The version starts
+       * at one that is never published so the first tick copies it. */
+      AbsCoord robotPose;
+      uint32_t robotPoseVersion;
 };
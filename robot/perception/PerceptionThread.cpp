@@ -32,7 +32,9 @@ Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #include "perception/PerceptionThread.hpp"
 
 #include <pthread.h>
+#include <sys/time.h>
 #include <ctime>
+#include <stdexcept>
 #include <utility>
 #include <boost/algorithm/string.hpp>
 #include <boost/algorithm/string/classification.hpp>
@@ -42,7 +44,9 @@ Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #include "soccer.hpp"
 #include "blackboard/Blackboard.hpp"
 #include "utils/Logger.hpp"
+#include "utils/Profiler.hpp"
 #include "thread/Thread.hpp"
+#include "thread/ThreadManager.hpp"
 #include "boost/lexical_cast.hpp"
 #include <boost/bind.hpp>
 #include <boost/thread/thread.hpp>
@@ -50,8 +54,17 @@ Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 using namespace std;
 using namespace boost;
 
+PerceptionStage *PerceptionThread::stage = NULL;
+
+static int64_t timestamp_us() {
+   struct timeval tv;
+   gettimeofday(&tv, 0);
+   return tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
 PerceptionThread::PerceptionThread(Blackboard *bb)
    : Adapter(bb), 
+     pipelined(false),
      kinematicsAdapter(bb),
 #ifndef SIMULATION
      visionAdapter(bb),
@@ -63,17 +76,22 @@ PerceptionThread::PerceptionThread(Blackboard *bb)
    dumper = NULL;
 
    releaseLock(serialization);
-   //uint8_t const* currentFrame = readFrom(vision, currentFrame);
-   uint8_t const* topFrame = readFrom(vision, topFrame);
-   uint8_t const* botFrame = readFrom(vision, botFrame);
+   // The cameras outlive a crashed PerceptionThread, so their current
+   // frames are the ones it was processing
+   Camera *topCamera = CombinedCamera::getCameraTop();
+   Camera *botCamera = CombinedCamera::getCameraBot();
+   FrameHandle topFrame = topCamera != NULL ? topCamera->currentFrame()
+                                            : FrameHandle();
+   FrameHandle botFrame = botCamera != NULL ? botCamera->currentFrame()
+                                            : FrameHandle();
    size_t ret;
 
-   if (topFrame != NULL && botFrame != NULL) {
+   if (topFrame.valid() && botFrame.valid()) {
       string file = "/home/nao/crashframe-" +
                     boost::lexical_cast<string>(time(NULL)) + ".yuv";
       FILE *errorFrameFile = fopen(file.c_str(), "w");
-      ret = fwrite(topFrame, 640 * 480 * 2, 1, errorFrameFile);
-      ret = fwrite(botFrame, 640 * 480 * 2, 1, errorFrameFile);
+      ret = fwrite(topFrame.data(), topFrame.length(), 1, errorFrameFile);
+      ret = fwrite(botFrame.data(), botFrame.length(), 1, errorFrameFile);
       fclose(errorFrameFile);
       file = "/usr/bin/tail -n 200 /var/volatile/runswift/*/Perception > "
              + file + ".log";
@@ -85,68 +103,121 @@ PerceptionThread::PerceptionThread(Blackboard *bb)
    writeTo(thread, configCallbacks[Thread::name],
            boost::function<void(const boost::program_options::variables_map &)>
            (boost::bind(&PerceptionThread::readOptions, this, _1)));
+
+#ifndef SIMULATION
+   // Only read at startup since the vision stage owns the adapters it uses
+   pipelined = bb->config["debug.perception_pipelined"].as<bool>();
+   if (pipelined) {
+      llog(INFO) << "Running vision in a pipelined stage" << endl;
+      stage = new PerceptionStage();
+      stage->thread = new boost::thread(
+         boost::bind(&PerceptionThread::runVisionStage, this, stage));
+   }
+#endif
 }
 
 PerceptionThread::~PerceptionThread() {
    llog(INFO) << __PRETTY_FUNCTION__ << endl;
+   stopStage();
    writeTo(thread, configCallbacks[Thread::name], boost::function<void(const boost::program_options::variables_map &)>());
 }
 
-void PerceptionThread::tick() {
-   llog_open(VERBOSE) << "Perception Thread" << endl;
-
-   Timer timer_thread;
-   Timer timer_tick;
-
+void PerceptionThread::tickVisionStage(PerceptionFrame *frame) {
    /*
-    * Kinematics Tick
+    * Vision Tick
     */
-   llog_open(VERBOSE) << "Kinematics Tick" << endl;
-   timer_tick.restart();
-   kinematicsAdapter.tick();
+   PROFILE_ZONE(visionZone, "perception.vision");
+#ifndef SIMULATION
+   visionAdapter.tickCamera();
+   visionAdapter.tickCompute(&frame->vision);
+   frame->captured = frame->vision.timestamp;
+#else
+   frame->captured = timestamp_us();
+#endif
+   frame->vision_time = visionZone.stop();
+}
 
-   uint32_t kinematics_time = timer_tick.elapsed_us();
-   if (kinematics_time > TICK_MAX_TIME_KINEMATICS) {
-      llog_close(VERBOSE) << "Kinematics Tick: OK " << kinematics_time << " us" << endl;
+void PerceptionThread::runVisionStage(PerceptionStage *stage) {
+   Thread::name = "PerceptionVision";
+   pthread_t threadID = pthread_self();
+
+   // we don't care if this leaks, see ThreadManager::safelyRun
+   jumpPoints[threadID] = reinterpret_cast<jmp_buf*>(malloc(sizeof(jmp_buf)));
+   if (!jumpPoints[threadID]) {
+      llog(FATAL) << "malloc failed for vision stage\n";
+   } else if (!setjmp(*jumpPoints[threadID])) {
+      try {
+         while (stage->running && !attemptingShutdown) {
+            PerceptionFrame frame;
+            tickVisionStage(&frame);
+            if (!stage->frames.push(frame)) {
+               break;
+            }
+         }
+      } catch(const std::exception &e) {
+         llog(ERROR) << "Vision stage caught exception: " << e.what() << endl;
+      }
    } else {
-      llog_close(ERROR) << "Kinematics Tick: TOO LONG " << kinematics_time << " us" << endl;
+      llog(ERROR) << "Vision stage crashed" << endl;
    }
 
+   // wake up the localisation/behaviour stage so Perception restarts
+   stage->frames.close();
+}
+
+void PerceptionThread::stopStage() {
+   if (stage) {
+      stage->running = false;
+      stage->frames.close();
+      stage->thread->join();
+      delete stage->thread;
+      delete stage;
+      stage = NULL;
+   }
+}
+
+void PerceptionThread::tick() {
+   PROFILE_ZONE(perceptionZone, "perception.total");
+
    /*
-    * Vision Tick
+    * Kinematics Tick, on this thread as localisation reads the sonar it
+    * filters. The vision stage reads kinematics.sensorsLagged, which Motion
+    * publishes through a VersionedBuffer so any thread sees whole values.
     */
-   llog_open(VERBOSE) << "Vision Tick" << endl;
-   timer_tick.restart();
-#ifndef SIMULATION
-   visionAdapter.tick();
-#endif
+   PROFILE_ZONE(kinematicsZone, "perception.kinematics");
+   kinematicsAdapter.tick();
+   uint32_t kinematics_time = kinematicsZone.stop();
 
-   uint32_t vision_time = timer_tick.elapsed_us();
-   if (vision_time > TICK_MAX_TIME_VISION) {
-      llog_close(VERBOSE) << "Vision Tick: OK " << vision_time << endl;
+   /*
+    * Vision, either run now or taken from the vision stage
+    */
+   PerceptionFrame frame;
+   if (pipelined) {
+      if (!stage->frames.pop(frame)) {
+         throw std::runtime_error("Perception vision stage stopped");
+      }
    } else {
-      llog_close(ERROR) << "Vision Tick: TOO LONG " << vision_time << endl;
+      tickVisionStage(&frame);
    }
+#ifndef SIMULATION
+   PROFILE_ZONE(publishZone, "perception.visionPublish");
+   visionAdapter.tickPublish(frame.vision);
+   frame.vision_time += publishZone.stop();
+#endif
+
+   uint32_t vision_time = frame.vision_time;
 
    /*
     * Localisation Tick
     */
-   llog_open(VERBOSE) << "Localisation Tick" << endl;
-   timer_tick.restart();
+   PROFILE_ZONE(localisationZone, "perception.localisation");
    localisationAdapter.tick();
-
-   uint32_t localisation_time = timer_tick.elapsed_us();
-   if (localisation_time > TICK_MAX_TIME_LOCALISATION) {
-      llog_close(VERBOSE) << "Localisation Tick: OK " << localisation_time << endl;
-   } else {
-      llog_close(ERROR) << "Localisation Tick: TOO LONG " << localisation_time << endl;
-   }
+   uint32_t localisation_time = localisationZone.stop();
 
    /*
     * Behaviour Tick
     */
-   llog_open(VERBOSE) << "Behaviour Tick" << endl;
-   timer_tick.restart();
+   PROFILE_ZONE(behaviourZone, "perception.behaviour");
    pthread_yield();
    
    if (time(NULL) - readFrom(remoteControl, time_received) < 60) {
@@ -157,13 +228,7 @@ void PerceptionThread::tick() {
    } else {
       behaviourAdapter.tick();
    }
-
-   uint32_t behaviour_time = timer_tick.elapsed_us();
-   if (behaviour_time > TICK_MAX_TIME_BEHAVIOUR) {
-      llog_close(VERBOSE) << "Behaviour Tick (and perception yield): OK " << behaviour_time << endl;
-   } else {
-      llog_close(ERROR) << "Behaviour Tick (and perception yield): TOO LONG " << behaviour_time << endl;
-   }
+   uint32_t behaviour_time = behaviourZone.stop();
 
 #ifdef SIMULATION
    // Introduce delay to componsate for vision processing
@@ -174,11 +239,14 @@ void PerceptionThread::tick() {
    /*
     * Finishing Perception
     */
-   uint32_t perception_time = timer_thread.elapsed_us();
-   if (perception_time > THREAD_MAX_TIME) {
-      llog_close(VERBOSE) << "Perception Thread: OK " << perception_time << endl;
-   } else {
-      llog_close(ERROR) << "Perception Thread: TOO LONG " << perception_time << endl;
+   uint32_t perception_time = perceptionZone.stop();
+
+   // Perception collects every thread's profiler samples, often enough
+   // that Motion's ring can't fill between ticks
+   Profiler::collect();
+   if (profile_timer.elapsed_us() > PROFILE_WINDOW_US) {
+      profile_timer.restart();
+      writeTo(perception, profile, Profiler::stats(true));
    }
 
    writeTo(perception, kinematics, kinematics_time);
@@ -186,6 +254,7 @@ void PerceptionThread::tick() {
    writeTo(perception, localisation, localisation_time);
    writeTo(perception, behaviour, behaviour_time);
    writeTo(perception, total, perception_time);
+   writeTo(perception, frameAge, (uint32_t)(timestamp_us() - frame.captured));
 
    if (dumper) {
       if (dump_timer.elapsed_us() > dump_rate) {
@@ -33,6 +33,7 @@ Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 
 #include <Python.h>
 #include <string>
+#include <boost/thread/thread.hpp>
 #include "perception/vision/VisionAdapter.hpp"
 #include "perception/localisation/LocalisationAdapter.hpp"
 #include "perception/behaviour/BehaviourAdapter.hpp"
@@ -40,13 +41,31 @@ Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #include "perception/dumper/PerceptionDumper.hpp"
 #include "perception/vision/camera/CombinedCamera.hpp"
 #include "blackboard/Adapter.hpp"
+#include "utils/BoundedQueue.hpp"
 
-#define THREAD_MAX_TIME 33666
+/* How long each window of profiler timings published to offnao covers */
+#define PROFILE_WINDOW_US 5000000
 
-#define TICK_MAX_TIME_VISION 30000
-#define TICK_MAX_TIME_KINEMATICS 30000
-#define TICK_MAX_TIME_LOCALISATION 30000
-#define TICK_MAX_TIME_BEHAVIOUR 30000
+/* Number of processed frames the vision stage may run ahead by */
+#define PIPELINE_DEPTH 1
+
+/* A frame handed from the vision stage to the localisation/behaviour stage */
+struct PerceptionFrame {
+   uint32_t vision_time;
+   /* Time the frame was captured by the camera (us since epoch) */
+   int64_t captured;
+#ifndef SIMULATION
+   VisionFrameResult vision;
+#endif
+};
+
+/* The vision stage of a pipelined PerceptionThread and its output queue */
+struct PerceptionStage {
+   PerceptionStage() : frames(PIPELINE_DEPTH), running(true), thread(NULL) {}
+   BoundedQueue<PerceptionFrame> frames;
+   volatile bool running;
+   boost::thread *thread;
+};
 
 
 /* Wrapper class for vision, localisation and behaviour threads */
@@ -64,6 +83,25 @@ class PerceptionThread : Adapter {
       void tick();
 
    private:
+      /* Stops any vision stage left running by a PerceptionThread that
+       * crashed. This must be the first member so it runs before the
+       * adapters that stage is still using are reconstructed. */
+      struct StageGuard {
+         StageGuard() { PerceptionThread::stopStage(); }
+      } stageGuard;
+
+      /* Camera and vision for one frame */
+      void tickVisionStage(PerceptionFrame *frame);
+      /* Body of the vision stage thread when pipelined */
+      void runVisionStage(PerceptionStage *stage);
+      /* Stop and join the running vision stage, if any */
+      static void stopStage();
+      /* The vision stage currently running, shared across restarts */
+      static PerceptionStage *stage;
+
+      /* Whether vision runs ahead on its own thread */
+      bool pipelined;
+
       KinematicsAdapter kinematicsAdapter;
 #ifndef SIMULATION 
       VisionAdapter visionAdapter;
@@ -77,5 +115,8 @@ class PerceptionThread : Adapter {
       PerceptionDumper *dumper;
       Timer dump_timer;
       unsigned int dump_rate;
+
+      /* Time since the profiler timings were last published */
+      Timer profile_timer;
 };
 
@@ -36,6 +36,19 @@ typedef const float (AbsCoord::*abs_get_v_const_type)() const;
 
 void py_say(const std::string &text) { SAY(text); }
 
+/* Versioned Blackboard components are exposed to python as plain copies */
+SensorValues py_motion_sensors(const MotionBlackboard &motion) {
+   return motion.sensors.read();
+}
+
+AbsCoord py_localisation_robotPos(const LocalisationBlackboard &localisation) {
+   return localisation.robotPos.read();
+}
+
+std::vector<BallInfo> py_vision_balls(const VisionBlackboard &vision) {
+   return vision.behaviourBalls();
+}
+
 BOOST_PYTHON_MODULE(robot)
 {
    register_python_converters();
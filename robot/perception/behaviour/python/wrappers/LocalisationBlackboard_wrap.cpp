@@ -1,5 +1,5 @@
 class_<LocalisationBlackboard>("LocalisationBlackboard")
-   .def_readonly("robotPos", &LocalisationBlackboard::robotPos)
+   .add_property("robotPos", &py_localisation_robotPos)
    .def_readonly("allrobotPos", &LocalisationBlackboard::allrobotPos)
    .def_readonly("ballLostCount", &LocalisationBlackboard::ballLostCount)
    .def_readonly("ballSeenCount", &LocalisationBlackboard::ballSeenCount)
@@ -1,3 +1,3 @@
 class_<MotionBlackboard>("MotionBlackboard")
-   .add_property("sensors", &MotionBlackboard::sensors) 
+   .add_property("sensors", &py_motion_sensors)
    .add_property("active", &MotionBlackboard::active);
@@ -1,5 +1,5 @@
 class_<VisionBlackboard>("VisionBlackboard")
-   .add_property("balls"    , &VisionBlackboard::balls    )
+   .add_property("balls"    , &py_vision_balls        )
    .add_property("uncertain_balls"    , &VisionBlackboard::uncertain_balls    )
    .add_property("posts"    , &VisionBlackboard::posts    )
    .add_property("timestamp", &VisionBlackboard::timestamp)
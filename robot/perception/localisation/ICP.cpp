@@ -4,6 +4,8 @@
 #include <float.h>
 #include <limits>
 
+#include <boost/thread/once.hpp>
+
 #include "utils/Logger.hpp"
 #include "utils/speech.hpp"
 #include "utils/Timer.hpp"
@@ -57,49 +59,7 @@ static const LocalisationConstantsProvider& constantsProvider(
 #define NO_MATCH -1
 
 
-// VARIABLES
-
-// Observations 
-static std::vector<PostInfo> postObs;
-
-static std::vector<ParallelLinesInfo> parallelLines; // by convention line1 is the goal line, if it is known,
-static std::vector<unsigned int> parallelLineTypes;  // and the points are in clockwise order l1.p1, l1.p2, l2.p1, l2.p2
-
-static std::vector<RRCoord> corners;
-static std::vector<unsigned int> cornerTypes;
-
-static std::vector<RRCoord> TJunctions;
-static std::vector<unsigned int> TJunctionTypes;
-
-static std::vector<RRCoord> centreCircles;
-
-static std::vector<LineInfo> fieldLines;
-
-static std::vector<float> lineLengths; // line lengths squared
-static std::vector<float> linePostDist; // perp distance squared from line to nearest goal post
-static std::vector<float> lineEdgeDist; // perp distance squared to field edge
-
-static std::vector<LineInfo> fieldEdgeObs;
-
-static int iteration;                   
-static int minIterations;  
-static bool nonLineFeature;
-static bool x_known;
-static bool y_known;   
-static RRCoord singleFeature;              // used when we want to know the range when using 1 feature
-
-static float maxDist;                      // max dist between two points in a pair
-static float mse;                          // mean squared distance error
-static int N;                              // number of points used on this iteration
-static int totalN;                         // total N, including features that may not be used this iteration                    
-static std::vector<Point> source;          // updated source points rebuilt after each iteration
-static std::vector<Point> target;          // absolute, according to our field map
-static std::vector<TargetType> targetType; // point, vertical line or horizontal line  
-static std::vector<float> distances;       // distances between each point pair
-static std::vector<float> weights;         // weights to put on each point pair
-
-
-// Known features on the field
+// Known features on the field, built once by initLandmarks and only read after
 static std::vector<AbsCoord> allCircles;
 static std::vector<AbsCoord> allCorners;
 static std::vector<unsigned int> allCornerTypes;
@@ -130,51 +90,14 @@ static std::vector<std::pair<float, float> > parallelFieldLengths; // line lengt
 static std::vector<LineInfo> allEdgeLines; // by convention stored with the left point in p1, when you
                                            // are on the field looking at the field edge
 
-// robot best estimate position after combining all feature observations
-static AbsCoord combinedObs;
-static bool haveInitialisedLandmarks = false;
+static boost::once_flag initLandmarksOnce = BOOST_ONCE_INIT;
 
 // Builds the vectors of known features on the field
 static void initLandmarks();
 
-// Sort out the different types of features
-static void preprocessFeatures(   const std::vector<FieldFeatureInfo> &fieldFeatures,
-                           const std::vector<PostInfo> &posts, 
-                           const std::vector<FieldBoundaryInfo> & fieldBoundaries);
-
-// High level function to associate features to closest feature on field and build points
-// Always call it with association=1 first, if it return true you can call it again and increment the iteration
-// It will then generate additional goal post matching scenarios (in the situation that the goal post type is unknown)
-static void associateFeatures(int iteration);
-
-// Solves to find robot position that best transforms source points to target points
-static void solve();
-
-// does one step of solving, with different weights applied to the importance of each point
-static void iterate();
-
 // applies a rotation and translation to a 2d poiFeatureTypent
 static Point transform(const Point &point, float tx, float ty, float theta);
 
-// finds the mean squared distance (MSE) and distances vector between source and target points
-static void calcMSE();
-
-/* Matches an RR observation with the "closest" landmark, and if matching adds to point cloud 
-   The return value is the feature type that it was matched to*/
-static int matchObs(const RRCoord rr, std::vector<AbsCoord> &landmarks, float weight, 
-      unsigned int type = NO_TYPE, std::vector<unsigned int> landmarkTypes = std::vector<unsigned int>());
-
- /* Matches an RR line observation with the "closest" line */
-static bool matchLine(const LineInfo line, float len2, float postDist2, float edgeDist, bool constrainOrientation = false);
-
- /* Matches an RR edge observation with the "closest" edge */
-static bool matchEdge(const LineInfo line);
-
-/* Matches an RR parallel line observation with the "closest" parallel lines, order known means we know for 
-   sure the first line in the pair is the goal line, firstMatch means do a rough matching process that is 
-   robust to the orientation being wrong */
-static bool matchParallelLine(const LineInfo line1, const LineInfo line2, bool orderKnown = false, bool firstMatch = false);
-
 /* Calculates difference between an absolute observation and a landmark */
 static float obsLmkDiff(const AbsCoord obs, const AbsCoord lmk);
 
@@ -182,43 +105,59 @@ static float obsLmkDiff(const AbsCoord obs, const AbsCoord lmk);
 // else positive distance indicates edge is on left of line vector from p1 to p2, negative dist is opposite
 static float distLineToBoundary(const LineInfo line, const FieldBoundaryInfo boundary); 
 
-// Calculates squared distance from a point to a line segment, and returns the matching point on the line seg
-static float dist2ToLineSeg(const LineInfo line, const Point src, Point &tgt);
-
 // As above, but distances is to an infinitely long line, not a line segment
 static float dist2ToLine(const LineInfo line, const Point src, Point &tgt ); 
 
-// Adds points to point cloud and checks if points are identical (multiple identical point pairs can cause
-// numerical problems and freeze the main thread, so always use this overloaded function
-static void addToPointCloud(Point p1, Point p2, float dist, float weight, TargetType type = POINT);
+ICPSolver::ICPSolver() :
+      iteration(0), minIterations(0), nonLineFeature(false), x_known(false), y_known(false),
+      maxDist(0.f), mse(0.f), N(0), totalN(0) {
+   boost::call_once(initLandmarks, initLandmarksOnce);
+
+   // Enough for every feature vision reports in a frame, so solving does not allocate
+   source.reserve(64);
+   target.reserve(64);
+   targetType.reserve(64);
+   distances.reserve(64);
+   weights.reserve(64);
+}
 
-// Translates a pair of AbsCoords to one point pair, (or two point pairs if has both AbsCoords
-// have orientation) and pushes them onto the points vectors
-static void addToPointCloud(const AbsCoord obs1, const AbsCoord obs2, float weight);
+AbsCoord ICPSolver::getCombinedObs(void) const {
+   return combinedObs;
+}
 
+const std::vector<LineInfo> &ICPSolver::getAllFieldLines(void) {
+   boost::call_once(initLandmarks, initLandmarksOnce);
+   return allFieldLines;
+}
 
-static void reset(void) {
-   iteration = 0;
-   maxDist = 0.f;
-	mse = 0.f;              
-   N = 0;       
+// The solver behind the static interface
+static ICPSolver &sharedSolver(void) {
+   static ICPSolver solver;
+   return solver;
+}
 
-   if (!haveInitialisedLandmarks) {
-      initLandmarks();
-      haveInitialisedLandmarks = true;
-   }
+int ICP::localise(  const AbsCoord &robotPos,
+                    const std::vector<FieldFeatureInfo> &fieldFeatures,
+                    const std::vector<PostInfo> &posts,
+                    const float awayGoalProb,
+                    const float headYaw,
+                    const std::vector<FieldBoundaryInfo> &fieldBoundaries,
+                    const AbsCoord &ballRRC, bool isLost,
+                    const AbsCoord &teamBall ){
+   return sharedSolver().localise(robotPos, fieldFeatures, posts, awayGoalProb, headYaw,
+         fieldBoundaries, ballRRC, isLost, teamBall);
 }
 
 AbsCoord ICP::getCombinedObs(void){
-   return combinedObs;
+   return sharedSolver().getCombinedObs();
 }
 
-std::vector<LineInfo> ICP::getAllFieldLines(void) {
-   return allFieldLines;
+const std::vector<LineInfo> &ICP::getAllFieldLines(void) {
+   return ICPSolver::getAllFieldLines();
 }
 
 // Entry function from localisationAdapter
-int ICP::localise(  const AbsCoord &robotPos,
+int ICPSolver::localise(  const AbsCoord &robotPos,
                     const std::vector<FieldFeatureInfo> &fieldFeatures,
                     const std::vector<PostInfo> &posts,
                     const float awayGoalProb,
@@ -227,14 +166,49 @@ int ICP::localise(  const AbsCoord &robotPos,
                     const AbsCoord &ballRRC, bool isLost,
                     const AbsCoord &teamBall ){
 
-   reset();
-   
    Timer timer;
    timer.restart();
 
    llog(DEBUG1) << "\nICP called\n";
    
    preprocessFeatures(fieldFeatures, posts, fieldBoundaries);
+   int result = localiseFrom(robotPos, isLost);
+
+   llog(DEBUG1) << "ICP localisation took "  << timer.elapsed_us() << " us" << std::endl;
+   if (timer.elapsed_us() > 30000) {
+      llog(ERROR) << "ICP took " << timer.elapsed_us() << " us" << std::endl;
+   }   
+
+   return result;
+}
+
+void ICPSolver::localiseBatch(  const std::vector<AbsCoord> &robotPoses,
+                                const std::vector<FieldFeatureInfo> &fieldFeatures,
+                                const std::vector<PostInfo> &posts,
+                                const float awayGoalProb,
+                                const float headYaw,
+                                const std::vector<FieldBoundaryInfo> &fieldBoundaries,
+                                const AbsCoord &ballRRC, bool isLost,
+                                std::vector<int> &results,
+                                std::vector<AbsCoord> &combinedObs,
+                                const AbsCoord &teamBall ){
+
+   preprocessFeatures(fieldFeatures, posts, fieldBoundaries);
+
+   results.resize(robotPoses.size());
+   combinedObs.resize(robotPoses.size());
+   for (unsigned i = 0; i < robotPoses.size(); i++) {
+      results[i] = localiseFrom(robotPoses[i], isLost);
+      combinedObs[i] = this->combinedObs;
+   }
+}
+
+int ICPSolver::localiseFrom(const AbsCoord &robotPos, bool isLost) {
+
+   iteration = 0;
+   maxDist = 0.f;
+   mse = 0.f;
+   N = 0;
 
    if ( totalN==0 ) return ICP_NO_OBS;
 
@@ -290,18 +264,13 @@ int ICP::localise(  const AbsCoord &robotPos,
       llog(DEBUG1) << "ICP couldn't localise or not on field, MSE=" << sqrt(mse) << std::endl;
    }
 
-   llog(DEBUG1) << "ICP localisation took "  << timer.elapsed_us() << " us" << std::endl;
-   if (timer.elapsed_us() > 30000) {
-      llog(ERROR) << "ICP took " << timer.elapsed_us() << " us" << std::endl;
-   }   
-
    return result;
 }
 
 
 
 
-void preprocessFeatures( const std::vector<FieldFeatureInfo> &fieldFeatures,
+void ICPSolver::preprocessFeatures( const std::vector<FieldFeatureInfo> &fieldFeatures,
                               const std::vector<PostInfo> &posts, 
                               const std::vector<FieldBoundaryInfo> &fieldBoundaries){
 
@@ -636,7 +605,7 @@ float distLineToBoundary(const LineInfo line, const FieldBoundaryInfo boundary){
 }
 
 
-void associateFeatures(int association){
+void ICPSolver::associateFeatures(int association){
 
 /* Matching priority as follows:
    Priority 1: Two posts
@@ -816,7 +785,7 @@ void associateFeatures(int association){
 
 
 /* Matches an RR line observation with the "closest" line */
-bool matchParallelLine(const LineInfo line1, const LineInfo line2, bool orderKnown, bool firstMatch){
+bool ICPSolver::matchParallelLine(const LineInfo line1, const LineInfo line2, bool orderKnown, bool firstMatch){
 
    bool result = false;
 
@@ -912,7 +881,7 @@ bool matchParallelLine(const LineInfo line1, const LineInfo line2, bool orderKno
 
 
 /* Matches an RR line observation with the "closest" line */
-bool matchLine(const LineInfo line, float len2, float postDist2, float edgeDist, bool constrainOrientation){
+bool ICPSolver::matchLine(const LineInfo line, float len2, float postDist2, float edgeDist, bool constrainOrientation){
 
    bool result = false;
 
@@ -937,7 +906,7 @@ bool matchLine(const LineInfo line, float len2, float postDist2, float edgeDist,
 
    for(int lmk = 0; lmk < (int)allFieldLines.size(); lmk++){
 
-      LineInfo fieldLine = allFieldLines[lmk];
+      const LineInfo &fieldLine = allFieldLines[lmk];
 
       // check line length is within limit         
       if (allLineLengths[lmk] < len2) {        
@@ -1029,7 +998,7 @@ bool matchLine(const LineInfo line, float len2, float postDist2, float edgeDist,
 
 
 /* Matches an RR edge observation with the "closest" edge */
-bool matchEdge(const LineInfo line){
+bool ICPSolver::matchEdge(const LineInfo line){
 
    bool result = false;
 
@@ -1048,7 +1017,7 @@ bool matchEdge(const LineInfo line){
 
    for(int lmk = 0; lmk < (int)allEdgeLines.size(); lmk++){
 
-      LineInfo edgeLine = allEdgeLines[lmk];
+      const LineInfo &edgeLine = allEdgeLines[lmk];
 
       // All lines are stored with larger value in line.p1
       diff = dist2ToLineSeg(edgeLine, absline.p1, tgt1);
@@ -1116,7 +1085,7 @@ float dist2ToLine(const LineInfo line, const Point src, Point &tgt){
 
 
 // Calculates squared distance from a point to a line segment, and returns the matching point on the line seg
-float dist2ToLineSeg(const LineInfo line, const Point src, Point &tgt){
+float ICPSolver::dist2ToLineSeg(const LineInfo &line, const Point &src, Point &tgt){
    
    const float l2 = DISTANCE_SQR(line.p1.x(), line.p1.y(), line.p2.x(), line.p2.y());
    if (l2 == 0.0f) { // line is really a point
@@ -1146,12 +1115,12 @@ float dist2ToLineSeg(const LineInfo line, const Point src, Point &tgt){
 
 
 /* Matches an RR observation with the "closest" landmark, and if matching adds to point cloud */
-int matchObs(const RRCoord rr, std::vector<AbsCoord> &landmarks, float weight, 
-               unsigned int type, std::vector<unsigned int> landmarkTypes) {
+int ICPSolver::matchObs(const RRCoord rr, const std::vector<AbsCoord> &landmarks, float weight, 
+               unsigned int type, const std::vector<unsigned int> &landmarkTypes) {
 
    AbsCoord obsAbs = rrToAbs(rr, combinedObs);   
    // circles have different orientation to Ts and corners
-   if( landmarks == allCircles){
+   if( &landmarks == &allCircles){
       obsAbs.theta() = NORMALISE(obsAbs.theta() - M_PI); 
    }   
 
@@ -1231,7 +1200,7 @@ float obsLmkDiff(const AbsCoord obs, const AbsCoord lmk) {
    return posDiff + RADIAN2MM_SCALING*thetaDiff;
 }
 
-void addToPointCloud(Point p1, Point p2, float dist, float weight, TargetType type){
+void ICPSolver::addToPointCloud(Point p1, Point p2, float dist, float weight, TargetType type){
 
    /* check if the source and target points are already perfectly matched,
       if so add a little noise (1mm) since this is numerical dangerous
@@ -1270,7 +1239,7 @@ void addToPointCloud(Point p1, Point p2, float dist, float weight, TargetType ty
 
 // Translates a pair of AbsCoords to one point pair, or two point pairs if has both AbsCoords
 // have orientation, and pushes them onto the points vectors
-void addToPointCloud(const AbsCoord obs1, const AbsCoord obs2, float weight){
+void ICPSolver::addToPointCloud(const AbsCoord obs1, const AbsCoord obs2, float weight){
    Point centre1 = Point( obs1.x(), obs1.y() );
    Point centre2 = Point( obs2.x(), obs2.y() );
 
@@ -1307,7 +1276,7 @@ void addToPointCloud(const AbsCoord obs1, const AbsCoord obs2, float weight){
 
 
 // Solves to find the tx, ty, theta that best transforms source points to target points
-void solve(){
+void ICPSolver::solve(){
 
    calcMSE();
 	llog(DEBUG1) << "Starting Mean Error: "<< sqrt(mse) << " mm\n";
@@ -1368,7 +1337,7 @@ void solve(){
 
 
 // Does on iteration of Iterative Closest Point and returns tx, ty, theta in result
-void iterate(){
+void ICPSolver::iterate(){
 
    // Can get N==0 when the first association doesn't work
    if (N==0) return;
@@ -1413,8 +1382,8 @@ void iterate(){
 	// wrt tx, ty and theta to zero. Therefore 3 unknowns and 3*num_of_points equations.
 	const int m = N*3;
 
-	Eigen::MatrixXf A(m,3);
-	Eigen::MatrixXf b(m,1);
+	A.resize(m,3);
+	b.resize(m,1);
    Eigen::Vector3f result;
 
 	int Ar = 0;
@@ -1530,7 +1499,7 @@ Point transform(const Point &point, float tx, float ty, float theta){
 }
 
 // Finds the MSE and builds a vector of distances between points, doesn't verify source and target lengths
-void calcMSE(){
+void ICPSolver::calcMSE(){
 	
    // find maxDist
    maxDist = 0.f;
@@ -35,7 +35,145 @@ enum FeatureType {   NO_TYPE = 0x10,
 
 
 
-// Iterative Closest Point
+// Iterative Closest Point. A solver holds all of its working state, reusing its point clouds from
+// one solve to the next, so each thread can have its own and solve at the same time as others.
+// The known features of the field are built once and shared by every solver.
+class ICPSolver {
+public:
+   ICPSolver();
+
+   // Returns success or fail, if success the result indicates how many points were used in the
+   // observation (greater number is more reliable, 2 points means only a single field line or
+   // field feature was used. If isLost, it will not return an observation based on single field
+   // line. The observation is then getCombinedObs().
+   int localise(  const AbsCoord &robotPos,
+                  const std::vector<FieldFeatureInfo> &fieldFeatures,
+                  const std::vector<PostInfo> &posts,
+                  const float awayGoalProb,
+                  const float headYaw,
+                  const std::vector<FieldBoundaryInfo> &fieldBoundary,
+                  const AbsCoord &ballRRC, bool isLost,
+                  const AbsCoord &teamBall = AbsCoord(NAN,NAN,NAN) );
+
+   // As localise, starting from each of robotPoses in turn with the same observations, which are
+   // only sorted into feature types once. results[i] and combinedObs[i] are what localise and
+   // getCombinedObs would give starting from robotPoses[i].
+   void localiseBatch(  const std::vector<AbsCoord> &robotPoses,
+                        const std::vector<FieldFeatureInfo> &fieldFeatures,
+                        const std::vector<PostInfo> &posts,
+                        const float awayGoalProb,
+                        const float headYaw,
+                        const std::vector<FieldBoundaryInfo> &fieldBoundary,
+                        const AbsCoord &ballRRC, bool isLost,
+                        std::vector<int> &results,
+                        std::vector<AbsCoord> &combinedObs,
+                        const AbsCoord &teamBall = AbsCoord(NAN,NAN,NAN) );
+
+   // The robot's best estimate position after the last localise
+   AbsCoord getCombinedObs(void) const;
+
+   static const std::vector<LineInfo> &getAllFieldLines(void);
+
+private:
+   // Localises from robotPos with the observations preprocessFeatures last sorted
+   int localiseFrom(const AbsCoord &robotPos, bool isLost);
+
+   // Sort out the different types of features
+   void preprocessFeatures(   const std::vector<FieldFeatureInfo> &fieldFeatures,
+                              const std::vector<PostInfo> &posts,
+                              const std::vector<FieldBoundaryInfo> & fieldBoundaries);
+
+   // High level function to associate features to closest feature on field and build points
+   // Always call it with association=1 first, if it return true you can call it again and increment the iteration
+   // It will then generate additional goal post matching scenarios (in the situation that the goal post type is unknown)
+   void associateFeatures(int iteration);
+
+   // Solves to find robot position that best transforms source points to target points
+   void solve();
+
+   // does one step of solving, with different weights applied to the importance of each point
+   void iterate();
+
+   // finds the mean squared distance (MSE) and distances vector between source and target points
+   void calcMSE();
+
+   /* Matches an RR observation with the "closest" landmark, and if matching adds to point cloud
+      The return value is the feature type that it was matched to*/
+   int matchObs(const RRCoord rr, const std::vector<AbsCoord> &landmarks, float weight,
+         unsigned int type = NO_TYPE,
+         const std::vector<unsigned int> &landmarkTypes = std::vector<unsigned int>());
+
+    /* Matches an RR line observation with the "closest" line */
+   bool matchLine(const LineInfo line, float len2, float postDist2, float edgeDist, bool constrainOrientation = false);
+
+    /* Matches an RR edge observation with the "closest" edge */
+   bool matchEdge(const LineInfo line);
+
+   /* Matches an RR parallel line observation with the "closest" parallel lines, order known means we know for
+      sure the first line in the pair is the goal line, firstMatch means do a rough matching process that is
+      robust to the orientation being wrong */
+   bool matchParallelLine(const LineInfo line1, const LineInfo line2, bool orderKnown = false, bool firstMatch = false);
+
+   // Calculates squared distance from a point to a line segment, and returns the matching point on the line seg
+   float dist2ToLineSeg(const LineInfo &line, const Point &src, Point &tgt);
+
+   // Adds points to point cloud and checks if points are identical (multiple identical point pairs can cause
+   // numerical problems and freeze the main thread, so always use this overloaded function
+   void addToPointCloud(Point p1, Point p2, float dist, float weight, TargetType type = POINT);
+
+   // Translates a pair of AbsCoords to one point pair, (or two point pairs if has both AbsCoords
+   // have orientation) and pushes them onto the points vectors
+   void addToPointCloud(const AbsCoord obs1, const AbsCoord obs2, float weight);
+
+   // Observations
+   std::vector<PostInfo> postObs;
+
+   std::vector<ParallelLinesInfo> parallelLines; // by convention line1 is the goal line, if it is known,
+   std::vector<unsigned int> parallelLineTypes;  // and the points are in clockwise order l1.p1, l1.p2, l2.p1, l2.p2
+
+   std::vector<RRCoord> corners;
+   std::vector<unsigned int> cornerTypes;
+
+   std::vector<RRCoord> TJunctions;
+   std::vector<unsigned int> TJunctionTypes;
+
+   std::vector<RRCoord> centreCircles;
+
+   std::vector<LineInfo> fieldLines;
+
+   std::vector<float> lineLengths; // line lengths squared
+   std::vector<float> linePostDist; // perp distance squared from line to nearest goal post
+   std::vector<float> lineEdgeDist; // perp distance squared to field edge
+
+   std::vector<LineInfo> fieldEdgeObs;
+
+   int iteration;
+   int minIterations;
+   bool nonLineFeature;
+   bool x_known;
+   bool y_known;
+   RRCoord singleFeature;              // used when we want to know the range when using 1 feature
+
+   float maxDist;                      // max dist between two points in a pair
+   float mse;                          // mean squared distance error
+   int N;                              // number of points used on this iteration
+   int totalN;                         // total N, including features that may not be used this iteration
+   std::vector<Point> source;          // updated source points rebuilt after each iteration
+   std::vector<Point> target;          // absolute, according to our field map
+   std::vector<TargetType> targetType; // point, vertical line or horizontal line
+   std::vector<float> distances;       // distances between each point pair
+   std::vector<float> weights;         // weights to put on each point pair
+
+   // iterate's least squares system, kept to reuse while the number of points stays the same
+   Eigen::MatrixXf A;
+   Eigen::MatrixXf b;
+
+   // robot best estimate position after combining all feature observations
+   AbsCoord combinedObs;
+};
+
+// The original interface to ICP, solving with one shared ICPSolver. Only one thread may use it at a
+// time; give each thread its own ICPSolver to localise concurrently.
 class ICP {
 public:
    ICP();
@@ -55,7 +193,7 @@ public:
 
    static AbsCoord getCombinedObs(void);
    
-   static std::vector<LineInfo> getAllFieldLines(void);
+   static const std::vector<LineInfo> &getAllFieldLines(void);
 
 };
 
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <Eigen/Eigen>
+
+#include "LocalisationDefs.hpp"
+
+// The first dimensions of the state, the robot pose and ball position, which are all a vision
+// measurement can observe. Vision jacobians are zero beyond these columns.
+#define KALMAN_SPARSE_DIM 5
+
+/**
+ * Matrices of a measurement's rows, sized at run time but held in place rather than on the heap,
+ * so a Kalman update never allocates.
+ */
+typedef Eigen::Matrix<double, Eigen::Dynamic, 1, Eigen::ColMajor | Eigen::AutoAlign,
+      MAX_MEASUREMENT_DIM, 1> MeasurementVector;
+typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::ColMajor | Eigen::AutoAlign,
+      MAX_MEASUREMENT_DIM, MAX_MEASUREMENT_DIM> MeasurementCovariance;
+
+/**
+ * The Kalman filter update of a DIM dimensional state by the first observationDim rows of a
+ * measurement, as SimpleGaussian does it for its main (MAIN_DIM) and shared (SHARED_DIM)
+ * distributions. Working on fixed size matrices lets the compiler unroll the state side of every
+ * product, and nothing is allocated.
+ *
+ * The innovation covariance is LDL^T factorised rather than inverted, and the covariance is
+ * updated in Joseph form, so it stays symmetric and positive definite. mean (DIM x 1) and
+ * covariance (DIM x DIM) are updated in place. The mean is left for the caller to clip and
+ * normalise; the covariance update does not depend on it.
+ *
+ * @param jacobian at least observationDim x DIM
+ * @param sparse the jacobian is zero beyond its first KALMAN_SPARSE_DIM columns, so only those
+ *        are multiplied through
+ * @return the innovation's squared Mahalanobis distance, for weighting the update
+ */
+template <int DIM>
+double kalmanUpdate(
+      Eigen::MatrixXd &mean,
+      Eigen::MatrixXd &covariance,
+      const int observationDim,
+      const Eigen::MatrixXd &innovation,
+      const Eigen::MatrixXd &jacobian,
+      const Eigen::MatrixXd &observationVariance,
+      const bool sparse);
+
+#include "KalmanUpdate.tcc"
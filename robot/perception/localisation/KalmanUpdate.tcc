@@ -0,0 +1,158 @@
+#include <cassert>
+#include <cstddef>
+
+#include "Eigen/LU"
+
+/**
+ * Factorises the symmetric positive definite matrix in the lower triangle of ld in place as
+ * L D L^T, with L unit lower triangular below the diagonal and D on it.
+ *
+ * @return false if a pivot is not positive, leaving ld part factorised
+ */
+inline bool ldltFactorise(MeasurementCovariance &ld) {
+   const int n = ld.rows();
+   for (int j = 0; j < n; j++) {
+      double d = ld(j, j);
+      for (int k = 0; k < j; k++) {
+         d -= ld(j, k) * ld(j, k) * ld(k, k);
+      }
+      if (!(d > 0.0)) {
+         return false;
+      }
+      ld(j, j) = d;
+      for (int i = j + 1; i < n; i++) {
+         double l = ld(i, j);
+         for (int k = 0; k < j; k++) {
+            l -= ld(i, k) * ld(j, k) * ld(k, k);
+         }
+         ld(i, j) = l / d;
+      }
+   }
+   return true;
+}
+
+/**
+ * Solves L D L^T x = b in place for each column of b, given ldltFactorise's ld.
+ *
+ * @param squaredNorms if not NULL, set to b^T (L D L^T)^-1 b for each column of b, from the
+ *        forward substitution, so never negative
+ */
+template <typename Rhs>
+inline void ldltSolveInPlace(const MeasurementCovariance &ld, Rhs &b, double *squaredNorms) {
+   const int n = ld.rows();
+   for (int c = 0; c < b.cols(); c++) {
+      for (int i = 0; i < n; i++) {
+         for (int k = 0; k < i; k++) {
+            b(i, c) -= ld(i, k) * b(k, c);
+         }
+      }
+      if (squaredNorms != NULL) {
+         squaredNorms[c] = 0.0;
+         for (int i = 0; i < n; i++) {
+            squaredNorms[c] += b(i, c) * b(i, c) / ld(i, i);
+         }
+      }
+      for (int i = 0; i < n; i++) {
+         b(i, c) /= ld(i, i);
+      }
+      for (int i = n - 1; i >= 0; i--) {
+         for (int k = i + 1; k < n; k++) {
+            b(i, c) -= ld(k, i) * b(k, c);
+         }
+      }
+   }
+}
+
+template <int DIM>
+double kalmanUpdate(
+      Eigen::MatrixXd &mean,
+      Eigen::MatrixXd &covariance,
+      const int observationDim,
+      const Eigen::MatrixXd &innovation,
+      const Eigen::MatrixXd &jacobian,
+      const Eigen::MatrixXd &observationVariance,
+      const bool sparse) {
+   typedef Eigen::Matrix<double, DIM, 1> State;
+   typedef Eigen::Matrix<double, DIM, DIM> StateCovariance;
+   typedef Eigen::Matrix<double, Eigen::Dynamic, DIM, Eigen::ColMajor | Eigen::AutoAlign,
+         MAX_MEASUREMENT_DIM, DIM> Jacobian;
+   typedef Eigen::Matrix<double, DIM, Eigen::Dynamic, Eigen::ColMajor | Eigen::AutoAlign,
+         DIM, MAX_MEASUREMENT_DIM> Gain;
+
+   assert(mean.rows() == DIM && mean.cols() == 1);
+   assert(covariance.rows() == DIM && covariance.cols() == DIM);
+   assert(observationDim > 0 && observationDim <= MAX_MEASUREMENT_DIM);
+   assert(jacobian.cols() >= DIM);
+
+   const int m = observationDim;
+   Eigen::Map<State> x(mean.data());
+   Eigen::Map<StateCovariance> P(covariance.data());
+
+   const Jacobian H = jacobian.block(0, 0, m, DIM);
+   const MeasurementVector y = innovation.block(0, 0, m, 1);
+
+   // P H^T, and the innovation covariance H P H^T + R. When sparse these sum over the observable
+   // dimensions only, in the order sparseMultiplication does.
+   Gain cjt(DIM, m);
+   MeasurementCovariance combinedCovariance(m, m);
+   if (sparse) {
+      cjt.setZero();
+      for (int i = 0; i < DIM; i++) {
+         for (int j = 0; j < KALMAN_SPARSE_DIM; j++) {
+            for (int k = 0; k < m; k++) {
+               cjt(i, k) += P(i, j) * H(k, j);
+            }
+         }
+      }
+      combinedCovariance.setZero();
+      for (int i = 0; i < m; i++) {
+         for (int j = 0; j < KALMAN_SPARSE_DIM; j++) {
+            for (int k = 0; k < m; k++) {
+               combinedCovariance(i, k) += H(i, j) * cjt(j, k);
+            }
+         }
+      }
+      combinedCovariance += observationVariance.block(0, 0, m, m);
+   } else {
+      cjt = P * H.transpose();
+      combinedCovariance = H * cjt + observationVariance.block(0, 0, m, m);
+   }
+
+   // The gain P H^T S^-1 and the weight's y^T S^-1 y both come from one factorisation of S.
+   // Solving S K^T = H P uses that S and P are symmetric.
+   Gain kalman(DIM, m);
+   double mahalanobisDistance;
+   MeasurementCovariance ld = combinedCovariance;
+   if (ldltFactorise(ld)) {
+      Jacobian kalmanT = cjt.transpose();
+      ldltSolveInPlace(ld, kalmanT, NULL);
+      kalman = kalmanT.transpose();
+      MeasurementVector z = y;
+      ldltSolveInPlace(ld, z, &mahalanobisDistance);
+   } else {
+      // S has lost positive definiteness to rounding, so fall back on inverting it.
+      const MeasurementCovariance combinedCovarianceInv = combinedCovariance.inverse();
+      kalman = cjt * combinedCovarianceInv;
+      mahalanobisDistance = (y.transpose() * combinedCovarianceInv * y)(0, 0);
+   }
+
+   x += kalman * y;
+
+   // The Joseph form (I - KH) P (I - KH)^T + K R K^T, expanded as P - C K^T - K C^T + K S K^T
+   // with C = P H^T, which is only as sparse as H already made C. Errors in the gain then only
+   // enter the covariance to second order, and each element depends on only its own element of
+   // P, so only the upper triangle is computed, in place, and mirrored to keep P symmetric.
+   const Gain ks = kalman * combinedCovariance;
+   for (int i = 0; i < DIM; i++) {
+      for (int j = i; j < DIM; j++) {
+         double sum = P(i, j);
+         for (int k = 0; k < m; k++) {
+            sum += (ks(i, k) - cjt(i, k)) * kalman(j, k) - kalman(i, k) * cjt(j, k);
+         }
+         P(i, j) = sum;
+         P(j, i) = sum;
+      }
+   }
+
+   return mahalanobisDistance;
+}
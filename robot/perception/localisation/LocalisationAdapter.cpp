@@ -69,11 +69,14 @@ LocalisationAdapter::LocalisationAdapter(Blackboard *bb) : Adapter(bb) {
    //If setFallen is set to true, we start the robot in getting up state
    isGettingUp = readFrom(localisation, setFallen);
 
+   int modeThreads = (blackboard->config)["localisation.mode_threads"].as<int>();
+
    if (readFrom(localisation, setInitialPose)) {
-      L = new Localiser(playerNumber, teamNumber, &readFrom(localisation, robotPos));
+      AbsCoord initialPose = readFrom(localisation, robotPos);
+      L = new Localiser(playerNumber, teamNumber, &initialPose, modeThreads);
    }
    else {
-      L = new Localiser(playerNumber, teamNumber);
+      L = new Localiser(playerNumber, teamNumber, NULL, modeThreads);
    }
    robotFilter = new RobotFilter();
    ballFilter = new BallFilter();
@@ -180,9 +183,11 @@ void LocalisationAdapter::tick() {
       balls.push_back(robotObstacleToBall(*it, conv_rr));
    }
 
-   if(balls.size() > 0)
-   {
-      writeTo(vision, balls, balls);
+   // Vision is the only writer of vision.balls, so the filtered balls are
+   // published separately, and used in place of vision's when there are any
+   writeTo(vision, filteredBalls, balls);
+   if (balls.empty()) {
+      balls = readFrom(vision, balls);
    }
 
    SensorValues values = readFrom(kinematics, sensorsLagged);
@@ -195,7 +200,7 @@ void LocalisationAdapter::tick() {
          readFrom(gameController, team_red),
          readFrom(vision, awayGoalProb),
          values.joints.angles[Joints::HeadYaw],
-         readFrom(vision, balls),
+         balls,
          !amTurningHead(active),
          !amWalking(active));
 
@@ -68,6 +68,12 @@ typedef enum {
 // Number of dimensions in the shared distribution. Includes the robot pose, ball pos, ball vel.
 #define SHARED_DIM 7
 
+// The max measurement dimension. This corresponds to seeing two goal posts, a ball, and the centre
+// circle, with each contributing a heading and a distance.
+// Doubled for use with the increased feature count of high resolution.
+// Kalman update measurements are kept in matrices of at most this size.
+#define MAX_MEASUREMENT_DIM 25
+
 /* Returns the minimum heading between 2 angles given in radians */
 /* TODO(yanjinz) refactorme! */
 static inline float minHeadingDiff(float thetaA, float thetaB) {
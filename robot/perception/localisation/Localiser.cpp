@@ -37,12 +37,14 @@ Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #include "utils/incapacitated.hpp"
 #include "utils/speech.hpp"
 
-Localiser::Localiser(int playerNumber, int teamNumber, const AbsCoord* initialPose) {
+Localiser::Localiser(int playerNumber, int teamNumber, const AbsCoord* initialPose,
+      int modeThreads) {
    this->myPlayerNumber = playerNumber;
    this->myTeamNumber = teamNumber;
    ballLostCount = 0;
    ballSeenCount = 0;
-   worldDistribution = new MultiGaussianDistribution(MAX_GAUSSIANS, playerNumber, initialPose);
+   worldDistribution = new MultiGaussianDistribution(MAX_GAUSSIANS, playerNumber, initialPose,
+         modeThreads);
    sharedDistribution = new SharedDistribution();
    getup_lost_count = 0;
 }
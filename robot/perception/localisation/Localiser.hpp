@@ -81,7 +81,12 @@ struct LocaliserBundle {
 
 class Localiser {
    public:
-      Localiser(int playerNumber, int teamNumber, const AbsCoord* initialPose = NULL);
+      /**
+       * @param modeThreads threads updating the distribution's modes with vision, 0 for one
+       *        per core
+       */
+      Localiser(int playerNumber, int teamNumber, const AbsCoord* initialPose = NULL,
+            int modeThreads = 1);
       ~Localiser();
 
       /**
@@ -36,12 +36,15 @@ Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #include "types/Odometry.hpp"
 #include "LocalisationUtils.hpp"
 #include "utils/Logger.hpp"
+#include "utils/Profiler.hpp"
 #include "utils/speech.hpp"
 
 #include <cassert>
 #include <vector>
 #include <algorithm>
 
+#include <boost/bind.hpp>
+
 #include "Eigen/Geometry"
 #include "Eigen/LU"
 
@@ -59,11 +62,20 @@ struct GuassianSortFunction {
    }
 };
 
-MultiGaussianDistribution::MultiGaussianDistribution(unsigned maxGaussians, int playerNumber, const AbsCoord* initialPose) :
+MultiGaussianDistribution::MultiGaussianDistribution(unsigned maxGaussians, int playerNumber,
+      const AbsCoord* initialPose, int modeThreads) :
       maxGaussians(maxGaussians), playerNumber(playerNumber),
-      teamBallTracker(playerNumber) {
+      teamBallTracker(playerNumber), pool(NULL) {
    MY_ASSERT(maxGaussians > 0, "invalid number of maxGaussians");
 
+   if (modeThreads != 1) {
+      pool = new WorkerPool(std::max(modeThreads, 0));
+      if (pool->size() == 1) {
+         delete pool;
+         pool = NULL;
+      }
+   }
+
    if (initialPose == NULL) {
       resetDistributionToPenalisedPose();
    }
@@ -82,6 +94,7 @@ MultiGaussianDistribution::~MultiGaussianDistribution() {
    for (unsigned i = 0; i < modes.size(); i++) {
       delete modes[i];
    }
+   delete pool;
 }
 
 void MultiGaussianDistribution::setInitialPose(AbsCoord initialPose) {
@@ -426,9 +439,19 @@ void MultiGaussianDistribution::visionUpdate(const VisionUpdateBundle &visionBun
 
    lastObservationLikelyhood = -1.0;
 
+   std::vector<std::vector<SimpleGaussian*> > modesNewModes(modes.size());
+   if (pool != NULL && modes.size() > 1) {
+      pool->run(modes.size(), boost::bind(&MultiGaussianDistribution::modeVisionUpdate, this,
+            boost::cref(visionBundle), boost::ref(modesNewModes), _1));
+   } else {
+      for (unsigned i = 0; i < modes.size(); i++) {
+         modeVisionUpdate(visionBundle, modesNewModes, i);
+      }
+   }
+
    std::vector<SimpleGaussian*> allNewModes;
    for (unsigned i = 0; i < modes.size(); i++) {
-      std::vector<SimpleGaussian*> newModes = modes[i]->visionUpdate(visionBundle);
+      const std::vector<SimpleGaussian*> &newModes = modesNewModes[i];
       allNewModes.insert(allNewModes.end(), newModes.begin(), newModes.end());
 
       if (i == 0 && (visionBundle.fieldFeatures.size() > 0 || visionBundle.posts.size() > 0 ||
@@ -503,6 +526,12 @@ void MultiGaussianDistribution::visionUpdate(const VisionUpdateBundle &visionBun
    MY_ASSERT(checkValidDistribution(modes), "invalid distribution @ visionUpdate end");
 }
 
+void MultiGaussianDistribution::modeVisionUpdate(const VisionUpdateBundle &visionBundle,
+      std::vector<std::vector<SimpleGaussian*> > &newModes, unsigned i) {
+   PROFILE_ZONE(modeZone, "perception.localisation.mode");
+   newModes[i] = modes[i]->visionUpdate(visionBundle);
+}
+
 void MultiGaussianDistribution::applyRemoteUpdate(
       const BroadcastData &broadcastData, int teammateIndex, bool isFromGoalie) {
    MY_ASSERT(checkValidDistribution(modes), "invalid distribution @ remoteUpdate start");
@@ -35,6 +35,7 @@ Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #include "TeamBallTracker.hpp"
 #include "types/Odometry.hpp"
 #include "types/BroadcastData.hpp"
+#include "utils/WorkerPool.hpp"
 
 #include <vector>
 
@@ -45,7 +46,12 @@ Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
  */
 class MultiGaussianDistribution {
 public:
-   explicit MultiGaussianDistribution(unsigned maxGaussians, int playerNumber, const AbsCoord* initialPose = NULL);
+   /**
+    * @param modeThreads threads updating modes with vision in parallel, 0 for one per core and
+    *        1 to update them on the calling thread
+    */
+   explicit MultiGaussianDistribution(unsigned maxGaussians, int playerNumber,
+         const AbsCoord* initialPose = NULL, int modeThreads = 1);
    virtual ~MultiGaussianDistribution();
    
    /**
@@ -110,7 +116,9 @@ public:
    void processUpdate(const Odometry &odometry, const double dTimeSeconds, const bool canSeeBall);
    
    /**
-    * Perform the vision update with the given observed landmarks and vision features.
+    * Perform the vision update with the given observed landmarks and vision features. Modes are
+    * independent until their new modes are merged in, so with a pool they are updated in
+    * parallel, and their new modes are still added in mode order.
     */
    void visionUpdate(const VisionUpdateBundle &visionBundle);
    
@@ -148,6 +156,14 @@ private:
    unsigned numVisionUpdatesInReady;
    TeamBallTracker teamBallTracker;
 
+   // Updates modes with vision in parallel, or NULL to update them in turn.
+   WorkerPool *pool;
+
+   /**
+    * Updates mode i with vision, putting its new modes in newModes[i]. A WorkerPool task.
+    */
+   void modeVisionUpdate(const VisionUpdateBundle &visionBundle,
+         std::vector<std::vector<SimpleGaussian*> > &newModes, unsigned i);
    
    void doTeammateRobotVisionUpdate(const VisionUpdateBundle &visionBundle);
    bool isInInitialState(void);
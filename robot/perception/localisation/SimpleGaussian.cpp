@@ -4,6 +4,7 @@
 #include "Eigen/Geometry"
 #include "Eigen/LU"
 
+#include "KalmanUpdate.hpp"
 #include "LocalisationConstantsProvider.hpp"
 #include "LocalisationUtils.hpp"
 #include "LocalisationDefs.hpp"
@@ -25,15 +26,13 @@ using namespace Eigen;
 static const double EPSILON = 0.0001;
 static const double MAX_BALL_VELOCITY = 1000.0;
 
-// The max measurement dimension. This corresponds to seeing two goal posts, a ball, and the centre
-// circle, with each contributing a heading and a distance.
-// Doubled for use with the increased feature count of high resolution.
-// TODO: A proper fix for dynamic MAX_MEASUREMENT_DIM.
-static const int MAX_MEASUREMENT_DIM = 25;
-
 static const LocalisationConstantsProvider& constantsProvider(
       LocalisationConstantsProvider::instance());
 
+// Each thread updating modes solves ICP with its own solver. Like the profiler's rings these
+// live as long as their thread, so are never freed.
+static __thread ICPSolver *threadICPSolver = NULL;
+
 // These are the dimension indices for the robot and ball coordinates in the mean vector.
 static const int ROBOT_X_DIM = 0;
 static const int ROBOT_Y_DIM = 1;
@@ -305,7 +304,6 @@ SimpleGaussian::SimpleGaussian(
       const Eigen::MatrixXd &mean,
       const Eigen::MatrixXd &diagonalVariance) :
             DIM(dim),
-            identity(MatrixXd::Identity(dim, dim)),
             weight(weight),
             mean(mean),
             covariance(MatrixXd::Identity(dim, dim)),
@@ -329,7 +327,6 @@ SimpleGaussian::SimpleGaussian(
       bool isInReadyMode,
       const ObservedPostsHistory &observedPostsHistory) :
             DIM(dim),
-            identity(MatrixXd::Identity(dim, dim)),
             weight(weight),
             mean(mean),
             covariance(covariance),
@@ -1119,7 +1116,7 @@ void SimpleGaussian::applyRemoteUpdate(
    }
 
    //double lastWeightAdjustment =
-   performTrimmedKalmanUpdate(innovation, jacobian, observationVariance, true, true);
+   performTrimmedKalmanUpdate(accepted_shared_dim, innovation, jacobian, observationVariance, true, true);
 
    /* VWong: Removed invalid remote update probability
    // If the remote update did not go through (its weight is too small) then scale up that teammates
@@ -1565,45 +1562,28 @@ double SimpleGaussian::performKalmanUpdate(
    MY_ASSERT(observationDim <= MAX_MEASUREMENT_DIM, "observation dim greater than max measurement dim");
    MY_ASSERT(observationDim > 0, "observation dim is 0");
 
-   Eigen::MatrixXd trimmedInnovation = innovation.block(0, 0, observationDim, 1);
-   Eigen::MatrixXd trimmedJacobian = jacobian.block(0, 0, observationDim, DIM);
-   Eigen::MatrixXd trimmedObservationVariance =
-         observationVariance.block(0, 0, observationDim, observationDim);
-
-   return performTrimmedKalmanUpdate(trimmedInnovation, trimmedJacobian, trimmedObservationVariance, false, updateWeight);
+   return performTrimmedKalmanUpdate(observationDim, innovation, jacobian, observationVariance, false, updateWeight);
 }
 
 double SimpleGaussian::performTrimmedKalmanUpdate(
+      const int observationDim,
       const Eigen::MatrixXd &innovation,
       const Eigen::MatrixXd &jacobian,
       const Eigen::MatrixXd &observationVariance,
       const bool isSharedUpdate,
       const bool updateWeight) {
+   MY_ASSERT(jacobian.cols() >= (int) DIM, "jacobian cols unexpected");
 
-   const Eigen::MatrixXd jacobianT = jacobian.transpose();
-   MY_ASSERT(jacobianT.rows() == (int) DIM, "jacobianT rows unexpected");
-
-   Eigen::MatrixXd cjt;
-   if (isSharedUpdate) {
-      cjt = covariance * jacobianT;
-   } else {
-      cjt = sparseMultiplication(covariance, jacobianT, 0, 0, 5, jacobianT.cols());
-   }
-
-   Eigen::MatrixXd combinedCovariance;
-   if (isSharedUpdate) {
-      combinedCovariance = ((jacobian * cjt) + observationVariance);
+   double mahalanobisDistance;
+   if (DIM == MAIN_DIM) {
+      mahalanobisDistance = kalmanUpdate<MAIN_DIM>(mean, covariance, observationDim,
+            innovation, jacobian, observationVariance, !isSharedUpdate);
    } else {
-      Eigen::MatrixXd jcjt = sparseMultiplication(jacobian, 0, 0, jacobian.rows(), 5, cjt);
-      combinedCovariance = jcjt + observationVariance;
+      MY_ASSERT(DIM == SHARED_DIM, "state dim is neither main nor shared dim");
+      mahalanobisDistance = kalmanUpdate<SHARED_DIM>(mean, covariance, observationDim,
+            innovation, jacobian, observationVariance, !isSharedUpdate);
    }
 
-   const Eigen::MatrixXd combinedCovarianceInv = combinedCovariance.inverse();
-
-   const Eigen::MatrixXd kalman = cjt * combinedCovarianceInv;
-   MY_ASSERT(kalman.rows() == (int) DIM, "kalman rows unexpected");
-
-   mean = mean + kalman * innovation;
    clipToField(mean);
    clipBallOutOfRobot(mean);
 
@@ -1613,23 +1593,10 @@ double SimpleGaussian::performTrimmedKalmanUpdate(
       }
    }
 
-   Eigen::MatrixXd kj;
-   if (isSharedUpdate) {
-      kj = kalman * jacobian;
-   } else {
-      kj = sparseMultiplication(kalman, jacobian, 0, 0, jacobian.rows(), 5);
-   }
-
-   covariance = (identity - kj) * covariance;
-
    double weightAdjustment = 1.0;
 
-   const Eigen::MatrixXd weightUpdateMatrix =
-         innovation.transpose() * combinedCovarianceInv * innovation;
-   MY_ASSERT(weightUpdateMatrix.rows() == 1 && weightUpdateMatrix.cols() == 1, "weighted matrix update unexpected");
-
    //VWong - This looks like probability of observing the mean based on the current distribution (current gaussian estimate)
-   weightAdjustment = exp(-0.5 * weightUpdateMatrix(0, 0));
+   weightAdjustment = exp(-0.5 * mahalanobisDistance);
    if (weightAdjustment != weightAdjustment || weightAdjustment < EPSILON || isnan(weightAdjustment)) {
       weightAdjustment = EPSILON;
    } else if (weightAdjustment > 1.0) {
@@ -2020,7 +1987,10 @@ int SimpleGaussian::performICPUpdate(
       stubPosts = getICPQualityPosts(visionBundle);
    }
 
-   int icpResult = ICP::localise(getRobotPose(), filteredFeatures,
+   if (threadICPSolver == NULL) {
+      threadICPSolver = new ICPSolver();
+   }
+   int icpResult = threadICPSolver->localise(getRobotPose(), filteredFeatures,
          stubPosts, visionBundle.awayGoalProb, visionBundle.headYaw,
          visionBundle.fieldBoundaries, ballRRC, false);
 
@@ -2028,7 +1998,7 @@ int SimpleGaussian::performICPUpdate(
       return currentMeasurement;
    }
 
-   AbsCoord icpUpdate = ICP::getCombinedObs();
+   AbsCoord icpUpdate = threadICPSolver->getCombinedObs();
 
    double dx = icpUpdate.x() - mean(ROBOT_X_DIM, 0);
    double dy = icpUpdate.y() - mean(ROBOT_Y_DIM, 0);
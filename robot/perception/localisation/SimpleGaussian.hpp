@@ -361,7 +361,6 @@ private:
    // DIM (3,4) => Ball x,y world position.
    // DIM (5,6) => Ball x,y world velocity.
    const unsigned DIM;
-   const Eigen::MatrixXd identity;
 
    double weight;
    Eigen::MatrixXd mean; // DIM x 1
@@ -414,7 +413,13 @@ private:
          const Eigen::MatrixXd &observationVariance,
          const bool updateWeight);
    
+   /**
+    * Applies the first observationDim rows of a measurement, with kalmanUpdate specialised for
+    * DIM. A shared update may observe any dimension; otherwise only the robot pose and ball
+    * position are observed.
+    */
    double performTrimmedKalmanUpdate(
+         const int observationDim,
          const Eigen::MatrixXd &innovation,
          const Eigen::MatrixXd &jacobian,
          const Eigen::MatrixXd &observationVariance,
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "perception/vision/VisionDefinitions.hpp"
+
+/**
+ * A run of pixels of one colour within a row, from x0 up to but not
+ * including x1.
+ */
+struct ColourRun
+{
+    uint16_t x0;
+    uint16_t x1;
+    Colour colour;
+};
+
+/**
+ * A colour classified image as runs of one colour along each row. Field
+ * images are mostly long runs of green, so scans that only care about the
+ * other colours can step over whole runs, and the runs pack into a few bytes
+ * per row for sending and dumping saliency.
+ *
+ * Packed, each byte is a colour in the low three bits and a length of one to
+ * MAX_PACKED_LENGTH pixels in the high five, longer runs taking several bytes.
+ * Rows are packed one after the other, and no byte crosses a row.
+ */
+class ColourRuns
+{
+public:
+
+    // The longest run a packed byte can hold.
+    static const int MAX_PACKED_LENGTH = 32;
+
+    ColourRuns() : cols_(0), rows_(0) {}
+
+    /**
+     * Encodes image, cols x rows colours in row order.
+     */
+    inline void encode(const Colour* image, int cols, int rows)
+    {
+        cols_ = cols;
+        rows_ = rows;
+        runs_.clear();
+        rowStarts_.resize(rows + 1);
+        for(int y=0; y<rows; ++y)
+        {
+            rowStarts_[y] = runs_.size();
+            const Colour* row = image + y*cols;
+            int x = 0;
+            while(x < cols)
+            {
+                ColourRun run;
+                run.x0 = x;
+                run.colour = row[x];
+                for(++x; x < cols && row[x] == run.colour; ++x) {}
+                run.x1 = x;
+                runs_.push_back(run);
+            }
+        }
+        rowStarts_[rows] = runs_.size();
+    }
+
+    /**
+     * Writes the encoded image back out as cols x rows colours.
+     */
+    inline void decode(Colour* image) const
+    {
+        Colour* pixel = image;
+        for(unsigned int r=0; r<runs_.size(); ++r)
+        {
+            for(int x=runs_[r].x0; x<runs_[r].x1; ++x)
+                *(pixel++) = runs_[r].colour;
+        }
+    }
+
+    int getCols() const { return cols_; }
+    int getRows() const { return rows_; }
+
+    /**
+     * The total number of runs in the image.
+     */
+    int getNumRuns() const { return runs_.size(); }
+
+    /**
+     * The runs of row y, from rowBegin(y) up to but not including rowEnd(y).
+     * A row always has at least one run.
+     */
+    inline const ColourRun* rowBegin(int y) const
+    {
+        return &runs_[0] + rowStarts_[y];
+    }
+    inline const ColourRun* rowEnd(int y) const
+    {
+        return &runs_[0] + rowStarts_[y+1];
+    }
+
+    /**
+     * Appends the packed runs to bytes.
+     */
+    inline void pack(std::vector<uint8_t>& bytes) const
+    {
+        for(unsigned int r=0; r<runs_.size(); ++r)
+        {
+            int length = runs_[r].x1 - runs_[r].x0;
+            for(; length > 0; length -= MAX_PACKED_LENGTH)
+            {
+                const int chunk = std::min(length, MAX_PACKED_LENGTH);
+                bytes.push_back(runs_[r].colour | (chunk - 1) << 3);
+            }
+        }
+    }
+
+    /**
+     * Decodes size packed bytes of a cols x rows image into runs. Returns
+     * false, leaving the runs empty, if the bytes aren't such an image.
+     */
+    inline bool unpack(const uint8_t* bytes, size_t size, int cols, int rows)
+    {
+        cols_ = cols;
+        rows_ = rows;
+        runs_.clear();
+        rowStarts_.assign(rows + 1, 0);
+        int x = 0;
+        int y = 0;
+        for(size_t i=0; i<size; ++i)
+        {
+            const Colour colour = (Colour)(bytes[i] & 7);
+            const int length = (bytes[i] >> 3) + 1;
+            if(colour >= cNUM_COLOURS || y == rows || x + length > cols)
+            {
+                runs_.clear();
+                return false;
+            }
+
+            // Join chunks of one long run back together.
+            if(x != 0 && runs_.back().colour == colour)
+                runs_.back().x1 += length;
+            else
+            {
+                ColourRun run;
+                run.x0 = x;
+                run.x1 = x + length;
+                run.colour = colour;
+                runs_.push_back(run);
+            }
+
+            x += length;
+            if(x == cols)
+            {
+                x = 0;
+                rowStarts_[++y] = runs_.size();
+            }
+        }
+        if(y != rows)
+        {
+            runs_.clear();
+            return false;
+        }
+        return true;
+    }
+
+private:
+
+    // The size of the encoded image.
+    int cols_;
+    int rows_;
+
+    // Every row's runs in order, and the index of each row's first run, with
+    // one past the last row's at rowStarts_[rows_].
+    std::vector<ColourRun> runs_;
+    std::vector<int>       rowStarts_;
+};
@@ -2,31 +2,54 @@
 #include <algorithm>
 #include <vector>
 #include <utility>
+#include <new>
+#include <cstdlib>
+#include <cstring>
 
 #include "perception/vision/Fovea.hpp"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif // __SSE2__
+
 //#define FOVEA_TIMINGS
 #ifdef FOVEA_TIMINGS
 #include "utils/Timer.hpp"
 #endif // FOVEA_TIMINGS
 
 /**
- * Free the _colour, _grey and _edge arrays.
+ * Free the _colour, _grey, _edge and _rows arrays and the summed area tables,
+ * unless they came from the frame arena.
  */
 Fovea::~Fovea()
 {//*
     // Clear existing child fovea.
-    for(unsigned int fovea=0; fovea<child_fovea_.size(); ++fovea)
-        delete child_fovea_[fovea];
-    child_fovea_.clear();
+    releaseChildFovea();
+
+    // The reference pixels and runs are always on the heap.
+    delete[] _reference;
+    delete runs_;
+
+    // Arena memory is released wholesale when the arena is reset.
+    if(frameScoped)
+        return;
 
     // Clear data array.
     if(hasColour)
         delete[] _colour;
     if(hasGrey)
+    {
         delete[] _grey;
+        delete[] _rows;
+    }
     if(hasEdge)
-        delete[] _edge;
+    {
+        delete[] _edgeX;
+        delete[] _edgeY;
+    }
+    delete[] _colourSums;
+    delete[] _greySums;
+    delete[] _greySquareSums;
     //*/
 }
 
@@ -57,8 +80,7 @@ void Fovea::generate(const CombinedFrame& combined_frame,
 #ifdef FOVEA_TIMINGS
     static int startStopTime = 0;
     static int colourTime = 0;
-    static int blurTime = 0;
-    static int edgeTime = 0;
+    static int greyEdgeTime = 0;
     static int frameCount = 0;
 
     if(bb.width() == TOP_SALIENCY_COLS)
@@ -69,9 +91,7 @@ void Fovea::generate(const CombinedFrame& combined_frame,
 #endif // FOVEA_TIMINGS
 
     // Clear existing child fovea.
-    for(unsigned int fovea=0; fovea<child_fovea_.size(); ++fovea)
-        delete child_fovea_[fovea];
-    child_fovea_.clear();
+    releaseChildFovea();
 
     // Record combined_frame and colour_classifier in case child fovea need
     // them.
@@ -94,8 +114,25 @@ void Fovea::generate(const CombinedFrame& combined_frame,
     timer.restart();
 #endif // FOVEA_TIMINGS
 
-    // Generate colour image if needed.
-    if(hasColour)
+    // Work out which tiles changed, if regenerating incrementally.
+    bool reuse = false;
+    tilesRecomputed_ = tilesAcross_*tilesDown_;
+    if(incremental_)
+    {
+        reuse = canReuse_(combined_frame, colour_classifier, *startStop.first);
+        tilesRecomputed_ = markChangedTiles_(!reuse);
+        lastStartStop_ = *startStop.first;
+        lastTableVersion_ = colour_classifier.tableVersion();
+        haveReference_ = true;
+    }
+
+    // Regenerate just the changed tiles, or generate colour image if needed.
+    if(reuse)
+    {
+        regenerateTiles_(colour_classifier, *startStop.first,
+                                                             *startStop.second);
+    }
+    else if(hasColour)
     {
         if(top)
         {
@@ -115,24 +152,23 @@ void Fovea::generate(const CombinedFrame& combined_frame,
     timer.restart();
 #endif // FOVEA_TIMINGS
 
-    // Generate grey image if needed.
-    if(hasGrey)
-        blurGrey_();
+    // Generate grey and edge images if needed.
+    if(!reuse && hasGrey)
+        makeGreyEdge_();
 
 #ifdef FOVEA_TIMINGS
     if(bb.width() == TOP_SALIENCY_COLS)
-        blurTime += timer.elapsed_us();
-    timer.restart();
+        greyEdgeTime += timer.elapsed_us();
 #endif // FOVEA_TIMINGS
 
-    // Generate edge image if needed.
-    if(hasEdge)
-        makeEdge_();
+    // Build the summed area tables, unless nothing changed since last frame.
+    if(integral_ && (!reuse || tilesRecomputed_ > 0))
+        makeIntegral_();
 
-#ifdef FOVEA_TIMINGS
-    if(bb.width() == TOP_SALIENCY_COLS)
-        edgeTime += timer.elapsed_us();
-#endif // FOVEA_TIMINGS
+    // Encode the colour image as runs, unless nothing changed since they were
+    // last encoded.
+    if(runs_ && (!reuse || tilesRecomputed_ > 0 || runs_->getRows() == 0))
+        runs_->encode(_colour, bb.width(), bb.height());
 
     // Clean up x start stop.
     delete startStop.first;
@@ -144,12 +180,10 @@ void Fovea::generate(const CombinedFrame& combined_frame,
         std::cout << "1000 frame average" << std::endl << "Width: " << bb.width() << " Height: " << bb.height() << std::endl;
         std::cout << "Start stop time: " << startStopTime/frameCount << std::endl;
         std::cout << "Colour classification: " << colourTime/frameCount << std::endl;
-        std::cout << "Grey blur: " << blurTime/frameCount << std::endl;
-        std::cout << "Edge detection: " << edgeTime/frameCount << std::endl << std::endl;
+        std::cout << "Grey blur and edge detection: " << greyEdgeTime/frameCount << std::endl << std::endl;
         startStopTime = 0;
         colourTime = 0;
-        blurTime = 0;
-        edgeTime = 0;
+        greyEdgeTime = 0;
         frameCount = 0;
     }
 #endif // FOVEA_TIMINGS
@@ -372,14 +406,8 @@ void Fovea::makeColourTop_(const CombinedFrame& combined_frame,
         saliencyPixel = _colour + startStop[block];
         saliencyEnd = _colour + startStop[block+1];
         rawPixel = startStopRaw[block];
-        for(; saliencyPixel < saliencyEnd; ++saliencyPixel)
-        {
-            // Classify the pixel.
-            *saliencyPixel = colour_classifier.classifyTop(rawPixel);
-
-            // Move to the next raw pixel.
-            rawPixel += doubleDensity;
-        }
+        colour_classifier.classifyTopRun(rawPixel, doubleDensity,
+                                   saliencyPixel, saliencyEnd - saliencyPixel);
 
         // Move to the next block.
         ++block;
@@ -447,14 +475,8 @@ void Fovea::makeColourBot_(const CombinedFrame& combined_frame,
         saliencyPixel = _colour + startStop[block];
         saliencyEnd = _colour + startStop[block+1];
         rawPixel = startStopRaw[block];
-        for(; saliencyPixel < saliencyEnd; ++saliencyPixel)
-        {
-            // Classify the pixel.
-            *saliencyPixel = colour_classifier.classifyBot(rawPixel);
-
-            // Move to the next raw pixel.
-            rawPixel += doubleDensity;
-        }
+        colour_classifier.classifyBotRun(rawPixel, doubleDensity,
+                                   saliencyPixel, saliencyEnd - saliencyPixel);
 
         // Move to the next block.
         ++block;
@@ -479,9 +501,95 @@ void Fovea::makeColourBot_(const CombinedFrame& combined_frame,
 }
 
 /**
- * Creates a 3X3 gaussian kernel blurred greyscale image.
+ * Applies a [1 2 1] filter across three rows, dest[x] = left[x] + 2*centre[x]
+ * + right[x]. Used for both the horizontal pass (the same row at offsets of
+ * one pixel) and the vertical pass (three consecutive rows).
  */
-void Fovea::blurGrey_()
+static inline void filter121_(const int16_t* left, const int16_t* centre,
+                              const int16_t* right, int16_t* dest, int n)
+{
+    int x = 0;
+#ifdef __SSE2__
+    for(; x + 8 <= n; x += 8)
+    {
+        __m128i l = _mm_loadu_si128((const __m128i*)(left + x));
+        __m128i c = _mm_loadu_si128((const __m128i*)(centre + x));
+        __m128i r = _mm_loadu_si128((const __m128i*)(right + x));
+        _mm_storeu_si128((__m128i*)(dest + x),
+                      _mm_add_epi16(_mm_add_epi16(l, r), _mm_slli_epi16(c, 1)));
+    }
+#endif // __SSE2__
+    for(; x < n; ++x)
+        dest[x] = left[x] + 2*centre[x] + right[x];
+}
+
+/**
+ * Creates one row of the edge image from two consecutive grey rows.
+ *
+ * This is a Robert's cross edge detector. Filter a and b are convolved over
+ * the image, and the result is summed to produce the basic edge filters below.
+ * a = [1  0]
+ *     [0 -1]
+ * b = [0 -1]
+ *     [1  0]
+ * x edge = a+b = [1 -1]
+ *                [1 -1]
+ * y edge = a-b = [ 1  1]
+ *                [-1 -1]
+ * The "same" rule is applied on the right if padRight, otherwise the pixels
+ * right of the row are read, and passing the bottom row as both upper and
+ * lower applies it on the bottom.
+ */
+static inline void robertsRow_(const int16_t* upper, const int16_t* lower,
+                      int16_t* edgeX, int16_t* edgeY, int n, bool padRight)
+{
+    // The number of pixels with a right hand neighbour.
+    const int inner = padRight ? n-1 : n;
+
+    int x = 0;
+#ifdef __SSE2__
+    // Each block also reads the pixel to the right of its last pixel.
+    for(; x + 8 <= inner; x += 8)
+    {
+        __m128i a = _mm_sub_epi16(
+                               _mm_loadu_si128((const __m128i*)(upper + x)),
+                               _mm_loadu_si128((const __m128i*)(lower + x + 1)));
+        __m128i b = _mm_sub_epi16(
+                               _mm_loadu_si128((const __m128i*)(lower + x)),
+                               _mm_loadu_si128((const __m128i*)(upper + x + 1)));
+        _mm_storeu_si128((__m128i*)(edgeX + x), _mm_add_epi16(a, b));
+        _mm_storeu_si128((__m128i*)(edgeY + x), _mm_sub_epi16(a, b));
+    }
+#endif // __SSE2__
+    for(; x < inner; ++x)
+    {
+        int a = upper[x] - lower[x+1];
+        int b = lower[x] - upper[x+1];
+        edgeX[x] = a + b;
+        edgeY[x] = a - b;
+    }
+
+    // "Same" padding on the right.
+    if(padRight && x < n)
+    {
+        edgeX[x] = 0;
+        edgeY[x] = 2*(upper[x] - lower[x]);
+    }
+}
+
+/**
+ * Blurs the raw grey values of fovea row y horizontally into dest.
+ */
+void Fovea::blurRow_(int y, int16_t* dest)
+{
+    blurSpan_(y, 0, bb.width(), dest);
+}
+
+/**
+ * Blurs the raw grey values of columns x0 to x1 (exclusive) of fovea row y
+ * horizontally into dest.
+ */
+void Fovea::blurSpan_(int y, int x0, int x1, int16_t* dest)
 {
     // The distance between two saliency density y values, as the raw array is
     // in the YUV422 format (YUYVYUYV...).
@@ -490,177 +598,427 @@ void Fovea::blurGrey_()
     // The distance between two saliency density rows.
     const int row_size = density*2*(TOP_IMAGE_COLS*top + BOT_IMAGE_COLS*(!top));
 
-    // The width and height of the bounding box.
     const int width = bb.width();
-    const int height = bb.height();
-
-    // The number of saliency density pixels.
-    const int fovea_size = width*height;
-
-    // A storage array used to break up the calculation and reduce the number of
-    // required operations.
-    int grey_temp[fovea_size];
+    const int n = x1 - x0;
+
+    // Gather the span's grey values and one pixel either side, using "same"
+    // padding at the fovea edges: it is assumed the pixels off the image edge
+    // will be the same as the ones on the edge.
+    const int first = std::max(x0-1, 0);
+    const int last = std::min(x1, width-1);
+    int16_t* padded = _rows;
+    int16_t* curr = padded + (first - (x0-1));
+    const uint8_t* curr_raw = _rawImage + (bb.a.y()+y)*row_size +
+                                              (bb.a.x()+first)*double_density;
+    for(int x = first; x <= last; ++x)
+    {
+        *curr++ = *curr_raw;
+        curr_raw += double_density;
+    }
+    if(x0 == 0)
+        padded[0] = padded[1];
+    if(x1 == width)
+        padded[n+1] = padded[n];
 
-    // The current pixel in the temp image.
-    int* curr_temp;
+    filter121_(padded, padded+1, padded+2, dest, n);
+}
 
-    // The current pixel in the blurred grey image.
-    int* curr_pixel;
+/**
+ * Creates a 3X3 gaussian kernel blurred greyscale image and, if needed, the
+ * edge image in a single pass down the fovea.
+ */
+void Fovea::makeGreyEdge_()
+{
+    // The width and height of the bounding box.
+    const int width = bb.width();
+    const int height = bb.height();
 
-    // The current pixel in the raw image.
-    const uint8_t* curr_raw;
+    if(width <= 0 || height <= 0)
+        return;
 
     /*
     The blur is applied in the form of the convolutional filter below (on the
-    right), broken up into two steps. First the image is convolved by the filter
+    right), broken up into two steps. First each row is convolved by the filter
     on the left, then the result is convolved by the filter in the middle.
               [1]   [1 2 1]
     [1 2 1] * [2] = [2 4 2]
               [1]   [1 2 1]
-    Where parts of the filter are off the edge of the image the "same" rule is
-    applied: it is assumed the pixels off the image edge will be the same as the
-    ones on the edge.
+    Horizontally blurred rows are kept in a window of three scratch rows, so
+    each grey row is finished while the rows it needs are still in cache, and
+    the edge row above it is made straight after.
     */
+    int16_t* const blurred[3] = {_rows + (width+2),
+                                 _rows + 2*(width+2),
+                                 _rows + 3*(width+2)};
 
-    // Do the column edges.
-    curr_temp = grey_temp;
-    curr_raw = _rawImage;
+    blurRow_(0, blurred[0]);
     for(int y = 0; y < height; ++y)
     {
-        // Left.
-        *curr_temp = 3*(*curr_raw)+*(curr_raw+double_density);
+        // Blur the next row into the slot of the row no longer needed.
+        if(y+1 < height)
+            blurRow_(y+1, blurred[(y+1) % 3]);
+
+        // Vertical blur, with "same" padding on the top and bottom.
+        int16_t* grey_row = _grey + y*width;
+        filter121_(blurred[std::max(y-1, 0) % 3], blurred[y % 3],
+                   blurred[std::min(y+1, height-1) % 3], grey_row, width);
+
+        if(hasEdge && y > 0)
+            robertsRow_(grey_row-width, grey_row, _edgeX + (y-1)*width,
+                                            _edgeY + (y-1)*width, width, true);
+    }
 
-        // Right.
-        curr_temp += width-1;
-        curr_raw += row_size-double_density;
-        *curr_temp = *(curr_raw-double_density)+3*(*curr_raw);
+    // "Same" padding on the bottom.
+    if(hasEdge)
+    {
+        const int16_t* grey_row = _grey + (height-1)*width;
+        robertsRow_(grey_row, grey_row, _edgeX + (height-1)*width,
+                                  _edgeY + (height-1)*width, width, true);
+    }
+}
 
-        // Next.
-        ++curr_temp;
-        curr_raw += double_density;
+/**
+ * Creates the blurred grey image within a rectangle of the fovea, from x0, y0
+ * up to but not including x1, y1. Produces the same values as makeGreyEdge_.
+ */
+void Fovea::makeGreyRect_(int x0, int y0, int x1, int y1)
+{
+    const int width = bb.width();
+    const int height = bb.height();
+    const int n = x1 - x0;
+
+    if(n <= 0 || y1 <= y0)
+        return;
+
+    // A window of three horizontally blurred rows, as in makeGreyEdge_.
+    int16_t* const blurred[3] = {_rows + (width+2),
+                                 _rows + 2*(width+2),
+                                 _rows + 3*(width+2)};
+
+    const int first = std::max(y0-1, 0);
+    blurSpan_(first, x0, x1, blurred[first % 3]);
+    if(first < y0)
+        blurSpan_(y0, x0, x1, blurred[y0 % 3]);
+    for(int y = y0; y < y1; ++y)
+    {
+        if(y+1 < height)
+            blurSpan_(y+1, x0, x1, blurred[(y+1) % 3]);
+
+        filter121_(blurred[std::max(y-1, 0) % 3], blurred[y % 3],
+                   blurred[std::min(y+1, height-1) % 3],
+                                                   _grey + y*width + x0, n);
     }
+}
+
+/**
+ * Creates the edge image within a rectangle of the fovea from the grey image,
+ * from x0, y0 up to but not including x1, y1.
+ */
+void Fovea::makeEdgeRect_(int x0, int y0, int x1, int y1)
+{
+    const int width = bb.width();
+    const int height = bb.height();
 
-    // Do the image core.
-    curr_temp = grey_temp+1;
-    curr_raw = _rawImage + double_density;
-    for(int y=0; y < height; ++y)
+    for(int y = y0; y < y1; ++y)
     {
-        for (int x=1; x < width-1; ++x)
+        // "Same" padding on the bottom.
+        const int16_t* upper = _grey + y*width;
+        const int16_t* lower = (y+1 < height) ? upper + width : upper;
+        robertsRow_(upper + x0, lower + x0, _edgeX + y*width + x0,
+                           _edgeY + y*width + x0, x1 - x0, x1 == width);
+    }
+}
+
+/**
+ * Whether any of the Y, U or V values of n sampled pixels differ by more than
+ * FOVEA_TILE_THRESHOLD. Each sample is the four bytes from the pixel's Y, and
+ * classifyTop/classifyBot and the grey image only read bytes 0, 1 and 3 of
+ * them. Byte 2 is the Y of the next pixel in the image, never the sampled
+ * one, so is ignored; if the next pixel is itself sampled its own byte 0 is
+ * compared.
+ */
+static inline bool samplesDiffer_(const uint32_t* a, const uint32_t* b, int n)
+{
+    int x = 0;
+#ifdef __SSE2__
+    const __m128i mask = _mm_set1_epi32(0xFF00FFFF);
+    const __m128i threshold = _mm_set1_epi8(FOVEA_TILE_THRESHOLD);
+    const __m128i zero = _mm_setzero_si128();
+    for(; x + 4 <= n; x += 4)
+    {
+        __m128i va = _mm_and_si128(
+                          _mm_loadu_si128((const __m128i*)(a + x)), mask);
+        __m128i vb = _mm_and_si128(
+                          _mm_loadu_si128((const __m128i*)(b + x)), mask);
+        __m128i diff = _mm_or_si128(_mm_subs_epu8(va, vb),
+                                    _mm_subs_epu8(vb, va));
+        __m128i over = _mm_subs_epu8(diff, threshold);
+        if(_mm_movemask_epi8(_mm_cmpeq_epi8(over, zero)) != 0xFFFF)
+            return true;
+    }
+#endif // __SSE2__
+    for(; x < n; ++x)
+    {
+        for(int shift = 0; shift < 32; shift += (shift == 8) ? 16 : 8)
         {
-            *curr_temp = *(curr_raw-double_density) + 2*(*curr_raw) +
-                                                     *(curr_raw+double_density);
-            ++curr_temp;
-            curr_raw += double_density;
+            int va = (a[x] >> shift) & 0xFF;
+            int vb = (b[x] >> shift) & 0xFF;
+            if(std::abs(va - vb) > FOVEA_TILE_THRESHOLD)
+                return true;
         }
-        curr_temp += 2;
-        curr_raw += row_size - (width-2)*double_density;
     }
+    return false;
+}
 
-    // Now do the edge rows.
+/**
+ * When incremental, generate only regenerates the tiles whose pixels changed.
+ */
+void Fovea::setIncremental(bool incremental)
+{
+    incremental_ = incremental;
+    haveReference_ = false;
+    if(incremental && !_reference)
+        _reference = new uint32_t[bb.width() * bb.height()];
+}
 
-    // Top.
-    curr_pixel = _grey;
-    curr_temp = grey_temp;
-    for(int x=0; x < width; ++x)
+/**
+ * The fraction of tiles regenerated by the last call to generate.
+ */
+float Fovea::getRecomputedFraction() const
+{
+    const int tiles = tilesAcross_*tilesDown_;
+    return tiles ? (float)tilesRecomputed_/tiles : 0.0f;
+}
+
+/**
+ * When integral, generate also builds summed area tables for constant time
+ * rectangle queries.
+ */
+void Fovea::setIntegral(bool integral)
+{
+    integral_ = integral;
+    if(!integral)
+        return;
+    const int entries = (bb.width() + 1) * (bb.height() + 1);
+    if(hasColour && !_colourSums)
+        _colourSums = newPlane_<uint32_t>(entries * cNUM_COLOURS);
+    if(hasGrey && !_greySums)
     {
-        *curr_pixel = 3*(*curr_temp) + *(curr_temp+width);
-        ++curr_pixel;
-        ++curr_temp;
+        _greySums = newPlane_<uint32_t>(entries);
+        _greySquareSums = newPlane_<uint64_t>(entries);
     }
+}
 
-    // Bottom.
-    curr_pixel = _grey+fovea_size-width;
-    curr_temp = grey_temp+fovea_size-width;
-    for(int x=0; x < width; ++x)
+/**
+ * When run length, generate also encodes the colour image as runs along each
+ * row.
+ */
+void Fovea::setRunLength(bool run_length)
+{
+    if(run_length && hasColour && !runs_)
+        runs_ = new ColourRuns();
+    else if(!run_length)
     {
-        *curr_pixel = *(curr_temp-width) + 3*(*curr_temp);
-        ++curr_pixel;
-        ++curr_temp;
+        delete runs_;
+        runs_ = NULL;
     }
+}
 
-    // Finally complete the classification of the image core.
-    curr_pixel = _grey+width;
-    curr_temp = grey_temp+width;
-    for(int p = 0; p < width*(height-2); ++p)
+/**
+ * Builds the summed area tables of whichever of the colour and grey images
+ * this fovea has.
+ */
+void Fovea::makeIntegral_()
+{
+    if(_colourSums)
+    {
+        buildClassCounts(_colour, bb.width(), bb.height(), cNUM_COLOURS,
+                                                                  _colourSums);
+    }
+    if(_greySums)
     {
-        *curr_pixel = *(curr_temp-width) + 2*(*curr_temp) + *(curr_temp+width);
-        ++curr_pixel;
-        ++curr_temp;
+        buildSummedArea(_grey, bb.width(), bb.height(), _greySums);
+        buildSummedSquares(_grey, bb.width(), bb.height(), _greySquareSums);
     }
 }
 
 /**
- * Creates an edge image, where x values are x axis edges, y values are y axis
- * edges and positive edges are left low right high or top low bottom high.
+ * Counts the pixels of colour c in box, for when there are no tables.
  */
-void Fovea::makeEdge_()
+int Fovea::countColour_(const BBox& box, Colour c) const
 {
-    // The width and height of the bounding box.
-    const int width = bb.width();
-    const int height = bb.height();
+    int count = 0;
+    for(int y=box.a.y(); y<box.b.y(); ++y)
+    {
+        const Colour* pixel = _colour + y*width;
+        for(int x=box.a.x(); x<box.b.x(); ++x)
+            count += pixel[x] == c;
+    }
+    return count;
+}
+
+/**
+ * Sums the grey values, or their squares, in box, for when there are no
+ * tables.
+ */
+uint64_t Fovea::sumGrey_(const BBox& box, bool square) const
+{
+    uint64_t sum = 0;
+    for(int y=box.a.y(); y<box.b.y(); ++y)
+    {
+        const int16_t* pixel = _grey + y*width;
+        for(int x=box.a.x(); x<box.b.x(); ++x)
+            sum += square ? (uint64_t)(pixel[x]*pixel[x]) : pixel[x];
+    }
+    return sum;
+}
 
-    // The current pixel in the edge image.
-    Point* curr_pixel;
+/**
+ * Whether the images from the previous frame can be partly reused: the robot
+ * hasn't moved, so the robot parts excluded are the same, and the colour
+ * calibration hasn't changed.
+ */
+bool Fovea::canReuse_(const CombinedFrame& combined_frame,
+    const ColourClassifier& colour_classifier,
+                                       const std::vector<int>& startStop) const
+{
+    return haveReference_ && !combined_frame.camera_to_rr_.isRobotMoving() &&
+        colour_classifier.tableVersion() == lastTableVersion_ &&
+                                                    startStop == lastStartStop_;
+}
 
-    // The current pixel in the raw image.
-    const int* curr_grey;
+/**
+ * Compares every tile's sampled pixels to _reference, marking the changed
+ * tiles in dirtyTiles_ and updating their reference.
+ */
+int Fovea::markChangedTiles_(bool all)
+{
+    const int width = bb.width();
+    const int height = bb.height();
 
-    /*
-    This is a Robert's cross edge detector. Filter a and b are convolved over
-    the image, and the result is summed to produce the basic edge filters below.
-    a = [1  0]
-        [0 -1]
-    b = [0 -1]
-        [1  0]
-    x edge = a+b = [1 -1]
-                   [1 -1]
-    y edge = a-b = [ 1  1]
-                   [-1 -1]
-    */
+    // The current samples of one tile.
+    uint32_t tile[FOVEA_TILE_SIZE*FOVEA_TILE_SIZE];
 
-    // Calculate the edges.
-    curr_pixel = _edge;
-    curr_grey = _grey;
-    for(int y=0; y < height-1; ++y)
+    int marked = 0;
+    dirtyTiles_.assign(tilesAcross_*tilesDown_, 0);
+    for(int ty = 0; ty < tilesDown_; ++ty)
     {
-        for(int x=0; x < width-1; ++x)
+        const int y0 = ty*FOVEA_TILE_SIZE;
+        const int y1 = std::min(y0 + FOVEA_TILE_SIZE, height);
+        for(int tx = 0; tx < tilesAcross_; ++tx)
         {
-            // Calculate the "cross" values.
-            int a = *curr_grey - *(curr_grey+1+width);
-            int b = *(curr_grey+width) - *(curr_grey+1);
+            const int x0 = tx*FOVEA_TILE_SIZE;
+            const int n = std::min(FOVEA_TILE_SIZE, width - x0);
 
-            // Translate them into the edge values.
-            (*curr_pixel)[0] = a + b;
-            (*curr_pixel)[1] = a - b;
+            // Gather the tile, stopping comparing at the first difference.
+            bool changed = all;
+            for(int y = y0; y < y1; ++y)
+            {
+                uint32_t* curr = tile + (y-y0)*FOVEA_TILE_SIZE;
+                for(int x = 0; x < n; ++x)
+                    memcpy(curr + x, getSampledRaw_(x0+x, y), sizeof(uint32_t));
+                if(!changed)
+                    changed = samplesDiffer_(curr, _reference + y*width + x0, n);
+            }
 
-            // Move on to the next pixel.
-            ++curr_pixel;
-            ++curr_grey;
+            if(changed)
+            {
+                for(int y = y0; y < y1; ++y)
+                    memcpy(_reference + y*width + x0,
+                        tile + (y-y0)*FOVEA_TILE_SIZE, n*sizeof(uint32_t));
+                dirtyTiles_[ty*tilesAcross_ + tx] = 1;
+                ++marked;
+            }
         }
+    }
+    return marked;
+}
 
-        // "Same" padding on the right.
-        (*curr_pixel)[0] = 0;
-        (*curr_pixel)[1] = 2*(*curr_grey-*(curr_grey+width));
+/**
+ * Regenerates the colour, grey and edge images for the tiles marked in
+ * dirtyTiles_. The robot parts are unchanged from the last frame, so only the
+ * classified spans of startStop need reclassifying. The grey and edge images
+ * are regenerated a little past each tile, as far as the blur and edge
+ * filters spread a change.
+ */
+void Fovea::regenerateTiles_(const ColourClassifier& colour_classifier,
+    const std::vector<int>& startStop,
+                                const std::vector<const uint8_t*>& startStopRaw)
+{
+    const int width = bb.width();
+    const int height = bb.height();
+    const int doubleDensity = density*2;
 
-        // Move on to the next pixel.
-        ++curr_pixel;
-        ++curr_grey;
+    // Reclassify the parts of each classified span inside changed tiles. Even
+    // blocks are classified and always lie within one row.
+    if(hasColour)
+    {
+        for(unsigned int block = 0; block+1 < startStop.size(); block += 2)
+        {
+            if(startStop[block] >= startStop[block+1])
+                continue;
+            const int y = startStop[block] / width;
+            const int xStart = startStop[block] - y*width;
+            const int xEnd = startStop[block+1] - y*width;
+            const uint8_t* dirty = &dirtyTiles_[(y/FOVEA_TILE_SIZE)*tilesAcross_];
+
+            for(int tx = xStart/FOVEA_TILE_SIZE; tx*FOVEA_TILE_SIZE < xEnd; ++tx)
+            {
+                if(!dirty[tx])
+                    continue;
+
+                // Extend over neighbouring changed tiles.
+                const int x0 = std::max(xStart, tx*FOVEA_TILE_SIZE);
+                while((tx+1)*FOVEA_TILE_SIZE < xEnd && dirty[tx+1])
+                    ++tx;
+                const int x1 = std::min(xEnd, (tx+1)*FOVEA_TILE_SIZE);
+
+                const uint8_t* raw = startStopRaw[block] +
+                                                      (x0-xStart)*doubleDensity;
+                Colour* out = _colour + y*width + x0;
+                if(top)
+                    colour_classifier.classifyTopRun(raw, doubleDensity, out,
+                                                                       x1-x0);
+                else
+                    colour_classifier.classifyBotRun(raw, doubleDensity, out,
+                                                                       x1-x0);
+            }
+        }
     }
 
-    // "Same" padding on the bottom.
-    for(int x=0; x < width-1; ++x)
-    {
-        (*curr_pixel)[0] = 2*(*curr_grey-*(curr_grey+1));
-        (*curr_pixel)[1] = 0;
+    if(!hasGrey)
+        return;
 
-        // Move on to the next pixel.
-        ++curr_pixel;
-        ++curr_grey;
+    // A changed raw pixel changes the grey pixels around it, and the edge
+    // pixels up to two above and left of it. All the grey is made before any
+    // edges as edges of one tile can use the grey of the next.
+    for(int pass = 0; pass < (hasEdge ? 2 : 1); ++pass)
+    {
+        for(int ty = 0; ty < tilesDown_; ++ty)
+        {
+            const uint8_t* dirty = &dirtyTiles_[ty*tilesAcross_];
+            const int y0 = ty*FOVEA_TILE_SIZE;
+            const int y1 = std::min(y0 + FOVEA_TILE_SIZE, height);
+            for(int tx = 0; tx < tilesAcross_; ++tx)
+            {
+                if(!dirty[tx])
+                    continue;
+
+                // Runs of changed tiles are done together.
+                const int x0 = tx*FOVEA_TILE_SIZE;
+                while(tx+1 < tilesAcross_ && dirty[tx+1])
+                    ++tx;
+                const int x1 = std::min((tx+1)*FOVEA_TILE_SIZE, width);
+
+                if(pass == 0)
+                    makeGreyRect_(std::max(x0-1, 0), std::max(y0-1, 0),
+                          std::min(x1+1, width), std::min(y1+1, height));
+                else
+                    makeEdgeRect_(std::max(x0-2, 0), std::max(y0-2, 0),
+                          std::min(x1+1, width), std::min(y1+1, height));
+            }
+        }
     }
-
-    // "Same" padding on the bottom right.
-    (*curr_pixel)[0] = 0;
-    (*curr_pixel)[1] = 0;
 }
 
 /*
@@ -672,16 +1030,41 @@ Fovea* Fovea::getChildFovea(const BBox& bounding_box,
         const bool generate_fovea_colour, const bool generate_fovea_grey,
                                                  const bool generate_fovea_edge)
 {
-    // Create the new fovea.
-    Fovea* new_fovea = new Fovea(bounding_box, density_to_raw, top,
+    // Create the new fovea, in the frame arena if there is one.
+    Fovea* new_fovea;
+    if(arena_)
+        new_fovea = new (arena_->allocate<Fovea>()) Fovea(bounding_box,
+            density_to_raw, top, generate_fovea_colour, generate_fovea_grey,
+                                         generate_fovea_edge, arena_, true);
+    else
+        new_fovea = new Fovea(bounding_box, density_to_raw, top,
                generate_fovea_colour, generate_fovea_grey, generate_fovea_edge);
 
     // Record it for memory managment.
     child_fovea_.push_back(new_fovea);
 
+    // Children are queried like their parent.
+    new_fovea->setIntegral(integral_);
+
     // Generate its saliency images.
     new_fovea->generate(*combined_frame_, *colour_classifier_);
 
     // Return the newly generated fovea.
     return(new_fovea);
 }
+
+/*
+ * Destroys this fovea's child foveas. Must be called before resetting the
+ * arena they were allocated from.
+ */
+void Fovea::releaseChildFovea()
+{
+    for(unsigned int fovea=0; fovea<child_fovea_.size(); ++fovea)
+    {
+        if(arena_)
+            child_fovea_[fovea]->~Fovea();
+        else
+            delete child_fovea_[fovea];
+    }
+    child_fovea_.clear();
+}
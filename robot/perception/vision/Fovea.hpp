@@ -2,10 +2,22 @@
 #define PERCEPTION_VISION_FOVEA_H_
 
 #include "perception/vision/colour/ColourClassifierInterface.hpp"
+#include "perception/vision/ColourRuns.hpp"
 #include "perception/vision/VisionDefinitions.hpp"
 #include "types/CombinedFrame.hpp"
 #include "types/Point.hpp"
 #include "types/BBox.hpp"
+#include "utils/FrameArena.hpp"
+#include "utils/SummedAreaTable.hpp"
+
+/* Side length, in fovea pixels, of the tiles compared between frames when
+ * regenerating incrementally. */
+#define FOVEA_TILE_SIZE 16
+
+/* A tile is regenerated if any sampled Y, U or V value in it differs by more
+ * than this from when the tile was last generated. Just above the still
+ * camera's noise. */
+#define FOVEA_TILE_THRESHOLD 6
 
 
 class Fovea {
@@ -19,17 +31,32 @@ public:
      * whether the colour, blurred grey and edge images are generated
      * respectively. If edge is true grey will be generated as it is a
      * prerequisite.
+     *
+     * If arena is given child foveas are allocated from it, and last until it
+     * is reset. frame_scoped also allocates this fovea's images from arena,
+     * and is used for the child foveas themselves.
      */
-    Fovea(BBox bb, int density, bool top, bool colour, bool grey, bool edge) :
+    Fovea(BBox bb, int density, bool top, bool colour, bool grey, bool edge,
+          FrameArena* arena = NULL, bool frame_scoped = false) :
         bb(bb), density(density), top(top), hasColour(colour),
         hasGrey(grey || edge), hasEdge(edge),
-        _colour(colour  ? new Colour[bb.width() * bb.height()] : NULL),
-        _grey  (hasGrey ? new int   [bb.width() * bb.height()] : NULL),
-        _edge  (hasEdge ? new Point [bb.width() * bb.height()] : NULL),
-                                                       width(bb.b[0]-bb.a[0]) {}
+        frameScoped(frame_scoped && arena != NULL), arena_(arena),
+        _colour(colour  ? newPlane_<Colour> (bb.width() * bb.height()) : NULL),
+        _grey  (hasGrey ? newPlane_<int16_t>(bb.width() * bb.height()) : NULL),
+        _edgeX (hasEdge ? newPlane_<int16_t>(bb.width() * bb.height()) : NULL),
+        _edgeY (hasEdge ? newPlane_<int16_t>(bb.width() * bb.height()) : NULL),
+        _rows  (hasGrey ? newPlane_<int16_t>(4 * (bb.width() + 2)) : NULL),
+                                                       width(bb.b[0]-bb.a[0]),
+        incremental_(false), _reference(NULL), haveReference_(false),
+        lastTableVersion_(0),
+        tilesAcross_((bb.width() + FOVEA_TILE_SIZE - 1) / FOVEA_TILE_SIZE),
+        tilesDown_((bb.height() + FOVEA_TILE_SIZE - 1) / FOVEA_TILE_SIZE),
+        tilesRecomputed_(0), integral_(false), _colourSums(NULL),
+        _greySums(NULL), _greySquareSums(NULL), runs_(NULL) {}
 
     /**
-     * Free the _colour, _grey and _edge arrays.
+     * Free the _colour, _grey, _edge and _rows arrays and the summed area
+     * tables, unless they came from the frame arena.
      */
     ~Fovea();
 
@@ -40,6 +67,80 @@ public:
     void generate(const CombinedFrame& combined_frame, 
         const ColourClassifier& colour_classifier);
 
+    /**
+     * When incremental, generate only regenerates the tiles of the colour,
+     * grey and edge images whose pixels changed since the previous frame,
+     * as long as the robot is still, and keeps the rest. Intended for the
+     * full frame foveas, as it keeps a copy of the sampled pixels.
+     */
+    void setIncremental(bool incremental);
+
+    /**
+     * The fraction of tiles regenerated by the last call to generate.
+     */
+    float getRecomputedFraction() const;
+
+    /**
+     * When integral, generate also builds summed area tables of the colour
+     * classes and of the grey image and its square, so the counts and sums
+     * over any rectangle take constant time. Child foveas inherit it.
+     */
+    void setIntegral(bool integral);
+
+    /**
+     * Whether rectangle queries are answered from summed area tables.
+     */
+    bool hasIntegral() const { return integral_; }
+
+    /**
+     * When run length, generate also encodes the colour image as runs along
+     * each row, so scans can skip whole runs of green.
+     */
+    void setRunLength(bool run_length);
+
+    /**
+     * The colour image as runs along each row, or NULL if this fovea isn't
+     * run length.
+     */
+    const ColourRuns* getColourRuns() const { return runs_; }
+
+    /**
+     * Returns the number of pixels of colour c in box, relative to the fovea
+     * bounds, from box.a up to but not including box.b. Must be inside the
+     * fovea bounds. Without summed area tables the pixels are counted.
+     */
+    inline int getColourCount(const BBox& box, Colour c) const
+    {
+        if(_colourSums)
+            return sumRect(_colourSums, width, box.a.x(), box.a.y(),
+                                 box.b.x(), box.b.y(), (int)cNUM_COLOURS, c);
+        return countColour_(box, c);
+    }
+
+    /**
+     * Returns the sum of the blurred grey values in box, relative to the
+     * fovea bounds, from box.a up to but not including box.b.
+     */
+    inline uint32_t getGreySum(const BBox& box) const
+    {
+        if(_greySums)
+            return sumRect(_greySums, width, box.a.x(), box.a.y(), box.b.x(),
+                                                                   box.b.y());
+        return sumGrey_(box, false);
+    }
+
+    /**
+     * Returns the sum of the squared blurred grey values in box, relative to
+     * the fovea bounds, from box.a up to but not including box.b.
+     */
+    inline uint64_t getGreySquareSum(const BBox& box) const
+    {
+        if(_greySquareSums)
+            return sumRect(_greySquareSums, width, box.a.x(), box.a.y(),
+                                                        box.b.x(), box.b.y());
+        return sumGrey_(box, true);
+    }
+
     Fovea& operator=(const Fovea& f) { return *this; }
     const Fovea& operator=(const Fovea& f) const { return *this; }
 
@@ -74,6 +175,15 @@ public:
         return(_colour[x + y*width]);
     }
 
+    /**
+     * Returns the colour classified image, a row of the fovea's width at a
+     * time, for scans that walk many pixels at once.
+     */
+    inline const Colour* getFoveaColours() const
+    {
+        return _colour;
+    }
+
     /**
      * Get the fovea colour, where linearPos is y*foveaWidth+x and x and y are a
      * 2D coordinate within the fovea.
@@ -107,9 +217,9 @@ public:
      * x values are x axis edges, y values are y axis edges and positive edges
      * are left low right high or top low bottom high.
      */
-    inline const Point& getFoveaEdge(int x, int y) const
+    inline const Point getFoveaEdge(int x, int y) const
     {
-        return(_edge[x + y*width]);
+        return(Point(_edgeX[x + y*width], _edgeY[x + y*width]));
     }
 
     /**
@@ -119,9 +229,9 @@ public:
      * are left low right high or top low bottom high. linearPos is
      * y*foveaWidth+x and x and y are a 2D coordinate within the fovea.
      */
-    inline const Point& getFoveaEdge(int linearPos) const
+    inline const Point getFoveaEdge(int linearPos) const
     {
-        return(_edge[linearPos]);
+        return(Point(_edgeX[linearPos], _edgeY[linearPos]));
     }
 
     /**
@@ -131,7 +241,7 @@ public:
     inline const int getFoveaMagnitude(int x, int y) const
     {
         int pos = x + y * bb.width();
-        return((_edge[pos].x()*_edge[pos].x())+(_edge[pos].y()*_edge[pos].y()));
+        return((_edgeX[pos]*_edgeX[pos])+(_edgeY[pos]*_edgeY[pos]));
     }
 
     /**
@@ -141,8 +251,8 @@ public:
      */
     inline const int getFoveaMagnitude(int linearPos) const
     {
-        return((_edge[linearPos].x()*_edge[linearPos].x()) +
-                                   (_edge[linearPos].y()*_edge[linearPos].y()));
+        return((_edgeX[linearPos]*_edgeX[linearPos]) +
+                                           (_edgeY[linearPos]*_edgeY[linearPos]));
     }
 
     /**
@@ -194,6 +304,12 @@ public:
          const bool generate_fovea_colour, const bool generate_fovea_grey,
                                                 const bool generate_fovea_edge);
 
+     /*
+      * Destroys this fovea's child foveas. Must be called before resetting
+      * the arena they were allocated from.
+      */
+     void releaseChildFovea();
+
 protected:
     /**
      * Gets a pointer to the first item in the colour array.
@@ -228,15 +344,26 @@ private:
     // Whether this fovea has an edge image.
     const bool           hasEdge;
 
+    // Whether this fovea's images are allocated from arena_.
+    const bool           frameScoped;
+
+    // Where child foveas are allocated, or NULL to use the heap.
+    FrameArena*          arena_;
+
     // The colour classified image.
      Colour      *const _colour;
 
-    // The blurred greyscale image.
-    int          *const _grey;
+    // The blurred greyscale image. At most 16*255, so it fits in 16 bits.
+    int16_t      *const _grey;
 
-    // The edge image, where x values are x axis edges, y values are y axis
-    // edges and positive edges are left low right high or top low bottom high.
-    Point        *const _edge;
+    // The edge image as separate x and y axis edge planes, where positive
+    // edges are left low right high or top low bottom high.
+    int16_t      *const _edgeX;
+    int16_t      *const _edgeY;
+
+    // Scratch rows for generating the grey and edge images: one padded raw
+    // grey row and three horizontally blurred rows.
+    int16_t      *const _rows;
 
     // The width of the fovea in density pixels.
     const int            width;
@@ -251,6 +378,43 @@ private:
     // All this fovea's child fovea.
     std::vector<Fovea*> child_fovea_;
 
+    // Whether to regenerate only the tiles that changed.
+    bool                 incremental_;
+
+    // The sampled raw pixel (YUYV, or YVYU) for each fovea pixel when its
+    // tile was last generated, if incremental.
+    uint32_t*            _reference;
+
+    // Whether _reference and the images are from a previous frame.
+    bool                 haveReference_;
+
+    // The robot part start stop array and classifier version last frame.
+    std::vector<int>     lastStartStop_;
+    uint32_t             lastTableVersion_;
+
+    // The number of tiles on each axis, and whether each needs regenerating.
+    const int            tilesAcross_;
+    const int            tilesDown_;
+    std::vector<uint8_t> dirtyTiles_;
+
+    // The number of tiles regenerated by the last generate.
+    int                  tilesRecomputed_;
+
+    // Whether to build summed area tables.
+    bool                 integral_;
+
+    // Summed area tables, (width+1)*(height+1) entries each, if integral: the
+    // count of each colour, interleaved cNUM_COLOURS to an entry, and the sum
+    // of the grey image and of its square. A rectangle's grey sum is at most
+    // 16*255 per pixel, so fits in 32 bits for any fovea.
+    uint32_t*            _colourSums;
+    uint32_t*            _greySums;
+    uint64_t*            _greySquareSums;
+
+    // The colour image as runs along each row, if run length. Always on the
+    // heap.
+    ColourRuns*          runs_;
+
     /**
      * Creates a colour image. Optimised for using the top image.
      */
@@ -268,15 +432,93 @@ private:
                                const std::vector<const uint8_t*>& startStopRaw);
 
     /**
-     * Creates a 3X3 gaussian kernel blurred greyscale image.
+     * Allocates an image of size pixels from the arena if this fovea is
+     * frame scoped, or the heap otherwise.
+     */
+    template <class T>
+    T* newPlane_(int size) const
+    {
+        return frameScoped ? arena_->allocate<T>(size) : new T[size];
+    }
+
+    /**
+     * Creates a 3X3 gaussian kernel blurred greyscale image and, if needed,
+     * the edge image in a single pass down the fovea.
+     */
+    void makeGreyEdge_();
+
+    /**
+     * Blurs the raw grey values of fovea row y horizontally into dest.
+     */
+    void blurRow_(int y, int16_t* dest);
+
+    /**
+     * Blurs the raw grey values of columns x0 to x1 (exclusive) of fovea row
+     * y horizontally into dest.
+     */
+    void blurSpan_(int y, int x0, int x1, int16_t* dest);
+
+    /**
+     * Creates the blurred grey image within a rectangle of the fovea, from
+     * x0, y0 up to but not including x1, y1.
+     */
+    void makeGreyRect_(int x0, int y0, int x1, int y1);
+
+    /**
+     * Creates the edge image within a rectangle of the fovea from the grey
+     * image, from x0, y0 up to but not including x1, y1.
+     */
+    void makeEdgeRect_(int x0, int y0, int x1, int y1);
+
+    /**
+     * Returns a pointer to the raw pixel sampled for fovea pixel x, y.
+     */
+    inline const uint8_t* getSampledRaw_(int x, int y) const
+    {
+        const int imageCols = top ? TOP_IMAGE_COLS : BOT_IMAGE_COLS;
+        return _rawImage + ((bb.a.y()+y)*imageCols + bb.a.x()+x)*density*2;
+    }
+
+    /**
+     * Whether the images from the previous frame can be partly reused for
+     * this one.
+     */
+    bool canReuse_(const CombinedFrame& combined_frame,
+        const ColourClassifier& colour_classifier,
+                                     const std::vector<int>& startStop) const;
+
+    /**
+     * Compares every tile's sampled pixels to _reference, marking the changed
+     * tiles in dirtyTiles_ and updating their reference. If all is set every
+     * tile is marked and updated.
+     * @return the number of tiles marked
+     */
+    int markChangedTiles_(bool all);
+
+    /**
+     * Regenerates the colour, grey and edge images for the tiles marked in
+     * dirtyTiles_.
+     */
+    void regenerateTiles_(const ColourClassifier& colour_classifier,
+        const std::vector<int>& startStop,
+                               const std::vector<const uint8_t*>& startStopRaw);
+
+    /**
+     * Builds the summed area tables of whichever of the colour and grey
+     * images this fovea has.
+     */
+    void makeIntegral_();
+
+    /**
+     * Counts the pixels of colour c in box, for when there are no tables.
      */
-    void blurGrey_();
+    int countColour_(const BBox& box, Colour c) const;
 
     /**
-     * Creates an edge image, where x values are x axis edges, y values are y axis
-     * edges and positive edges are left low right high or top low bottom high.
+     * Sums the grey values, or their squares, in box, for when there are no
+     * tables.
      */
-    void makeEdge_();
+    uint64_t sumGrey_(const BBox& box, bool square) const;
 
     /**
      * Returns the raw grey value of the requested pixel, relative to the fovea
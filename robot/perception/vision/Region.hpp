@@ -255,7 +255,7 @@ public:
         #ifdef REGION_TEST
         int
         #else
-        Point&
+        Point
         #endif
         edge() { return getRegion_()->getPixelEdge_(getLinearPos_()); }
 
@@ -397,7 +397,7 @@ public:
     #ifdef REGION_TEST
     int
     #else
-    Point&
+    Point
     #endif
     getPixelEdge(int x, int y) const {
         return getPixelEdge_(getLinearPosFromXYFovea_(x, y));
@@ -414,6 +414,61 @@ public:
         return getPixelEdgeMagnitude_(getLinearPosFromXYFovea_(x, y));
     }
 
+    /**
+     * Count the pixels of a colour within a region-relative box, from
+     *  box.a up to but not including box.b. Counts are of fovea pixels, so
+     *  a region sparser than its fovea counts every fovea pixel in the box.
+     *  Constant time if the fovea has summed area tables.
+     * @box region-relative box
+     * @c the colour to count
+     * @return the number of fovea pixels of colour c in the box
+     */
+    inline int getColourCount(const BBox& box, Colour c) const {
+        return this_fovea_->getColourCount(getFoveaBox_(box), c);
+    }
+
+    /**
+     * For a region-relative box, return the fraction of its
+     *  fovea pixels that are a colour
+     * @box region-relative box
+     * @c the colour to count
+     * @return fraction of the box that is colour c, 0 if the box is empty
+     */
+    inline float getColourFraction(const BBox& box, Colour c) const {
+        BBox fovea_box = getFoveaBox_(box);
+        int area = fovea_box.width() * fovea_box.height();
+        return area > 0 ?
+            (float)this_fovea_->getColourCount(fovea_box, c) / area : 0.0f;
+    }
+
+    /**
+     * For a region-relative box, return the mean blurred grey value
+     * @box region-relative box
+     * @return mean blurred grey value of the box, 0 if the box is empty
+     */
+    inline float getGreyMean(const BBox& box) const {
+        BBox fovea_box = getFoveaBox_(box);
+        int area = fovea_box.width() * fovea_box.height();
+        return area > 0 ?
+            (float)this_fovea_->getGreySum(fovea_box) / area : 0.0f;
+    }
+
+    /**
+     * For a region-relative box, return the variance of the
+     *  blurred grey values
+     * @box region-relative box
+     * @return variance of the blurred grey values, 0 if the box is empty
+     */
+    inline float getGreyVariance(const BBox& box) const {
+        BBox fovea_box = getFoveaBox_(box);
+        int area = fovea_box.width() * fovea_box.height();
+        if (area == 0)
+            return 0.0f;
+        double mean = (double)this_fovea_->getGreySum(fovea_box) / area;
+        return (float)((double)this_fovea_->getGreySquareSum(fovea_box) /
+                                                        area - mean * mean);
+    }
+
     /**
      * Returns true if the underlying image that this
      *  region is referencing is the top camera. False if not
@@ -608,7 +663,7 @@ private:
     #ifdef REGION_TEST
     int
     #else
-    Point&
+    Point
     #endif
     getPixelEdge_(int linear_pos) const {
         return this_fovea_->getFoveaEdge(linear_pos);
@@ -638,6 +693,19 @@ private:
                 bounding_box_fovea_.a.y()) * this_fovea_->getBBox().width());
     }
 
+    // Region-relative box to the box of fovea pixels it covers
+    inline BBox getFoveaBox_(const BBox& box) const {
+        return BBox(
+            Point((box.a.x()*density_to_raw_)/raw_to_fovea_density_ +
+                      bounding_box_fovea_.a.x(),
+                  (box.a.y()*density_to_raw_)/raw_to_fovea_density_ +
+                      bounding_box_fovea_.a.y()),
+            Point((box.b.x()*density_to_raw_)/raw_to_fovea_density_ +
+                      bounding_box_fovea_.a.x(),
+                  (box.b.y()*density_to_raw_)/raw_to_fovea_density_ +
+                      bounding_box_fovea_.a.y()));
+    }
+
     bool is_top_camera_;
 
     Fovea* this_fovea_;
@@ -9,6 +9,7 @@
 #include "types/CombinedFovea.hpp"
 #include "types/CombinedFrame.hpp"
 #include "utils/Logger.hpp"
+#include "utils/Profiler.hpp"
 #include "perception/vision/Fovea.hpp"
 #include "perception/vision/regionfinder/ColourROI.hpp"
 #include "perception/vision/detector/BallDetector.hpp"
@@ -31,30 +32,36 @@ enum Detect {
     DETECTOR_TOTAL
 };
 
-void Vision::setupAlgorithms_() {
+void Vision::setupAlgorithms_(int ball_threads, const std::string &ball_extra_stages,
+        bool ball_hough_circle_fit, bool ball_tracking,
+        const RANSAC::Options &field_ransac) {
     addMiddleInfoProcessor_(MID_PROCESSOR_FIELD_BOUNDARY, new FieldBoundaryFinder());
     addMiddleInfoProcessor_(MID_PROCESSOR_COLOUR_ROI, new ColourROI());
     addDetector_(DETECTOR_ROBOT, new ClusterDetector());
     //addDetector_(DETECTOR_FIELD_LINE, new RegionFieldFeatureDetector());
-    addDetector_(DETECTOR_FIELD_LINE, new FieldLineDetectionLegacy());
-    addDetector_(DETECTOR_BALL, new BallDetector());
+    addDetector_(DETECTOR_FIELD_LINE, new FieldLineDetectionLegacy(field_ransac));
+    addDetector_(DETECTOR_BALL, new BallDetector(ball_threads, ball_extra_stages,
+                                                  ball_hough_circle_fit, ball_tracking));
 }
 
 void Vision::runAlgorithms_() {
-    Timer t;
-    t.restart();
-    runMiddleInfoProcessor_(MID_PROCESSOR_FIELD_BOUNDARY);
-    runMiddleInfoProcessor_(MID_PROCESSOR_COLOUR_ROI);
-    regionFinderTime += t.elapsed_us();
-    t.restart();
-    runDetector_(DETECTOR_ROBOT);
-    robotDetectorTime += t.elapsed_us();
-    t.restart();
-    runDetector_(DETECTOR_FIELD_LINE);
-    fieldFeaturesTime += t.elapsed_us();
-    t.restart();
-    runDetector_(DETECTOR_BALL);
-    ballDetectorTime += t.elapsed_us();
+    {
+        PROFILE_ZONE(zone, "vision.regionFinder");
+        runMiddleInfoProcessor_(MID_PROCESSOR_FIELD_BOUNDARY);
+        runMiddleInfoProcessor_(MID_PROCESSOR_COLOUR_ROI);
+    }
+    {
+        PROFILE_ZONE(zone, "vision.robotDetector");
+        runDetector_(DETECTOR_ROBOT);
+    }
+    {
+        PROFILE_ZONE(zone, "vision.fieldFeatures");
+        runDetector_(DETECTOR_FIELD_LINE);
+    }
+    {
+        PROFILE_ZONE(zone, "vision.ballDetector");
+        runDetector_(DETECTOR_BALL);
+    }
 }
 //////////////////////////////////////////
 
@@ -69,21 +76,40 @@ void Vision::runDetector_(uint32_t index) {
 Vision::Vision(
     bool run_colour_calibration,
     bool load_nnmc,
-    bool save_nnmc)
+    bool save_nnmc,
+    bool packed_lut,
+    bool incremental_fovea,
+    int ball_threads,
+    const std::string &ball_extra_stages,
+    bool integral_fovea,
+    bool run_length_fovea,
+    bool ball_hough_circle_fit,
+    bool ball_tracking,
+    const RANSAC::Options &field_ransac)
         : images_sampled_(-1),
     bbox_top_(BBox(Point(0,0), Point(TOP_SALIENCY_COLS, TOP_SALIENCY_ROWS))),
     bbox_bot_(BBox(Point(0,0), Point(BOT_SALIENCY_COLS, BOT_SALIENCY_ROWS))),
     combined_fovea_(CombinedFovea(
-        new Fovea(bbox_top_, TOP_SALIENCY_DENSITY, true, true, true, true),
-        new Fovea(bbox_bot_, BOT_SALIENCY_DENSITY, false, true, true, true)
+        new Fovea(bbox_top_, TOP_SALIENCY_DENSITY, true, true, true, true,
+                                                                       &arena_),
+        new Fovea(bbox_bot_, BOT_SALIENCY_DENSITY, false, true, true, true,
+                                                                       &arena_)
     )),
     full_region_top_(RegionI(bbox_top_, true, *combined_fovea_.top_, TOP_SALIENCY_DENSITY)),
     full_region_bot_(RegionI(bbox_bot_, false, *combined_fovea_.bot_, BOT_SALIENCY_DENSITY)),
-    frameCount(0), DCCTime(0), foveaTime(0), fieldFeaturesTime(0),
-    regionFinderTime(0), ballDetectorTime(0)
+    frameCount(0), arenaBytes(0),
+    arenaAllocations(0), arenaBlockAllocations(0), topTilesRecomputed(0),
+    botTilesRecomputed(0)
 {
     llog(INFO) << "Vision Created" << std::endl;
 
+    combined_fovea_.top_->setIncremental(incremental_fovea);
+    combined_fovea_.bot_->setIncremental(incremental_fovea);
+    combined_fovea_.top_->setIntegral(integral_fovea);
+    combined_fovea_.bot_->setIntegral(integral_fovea);
+    combined_fovea_.top_->setRunLength(run_length_fovea);
+    combined_fovea_.bot_->setRunLength(run_length_fovea);
+
     detectors_ = new Detector*[DETECTOR_TOTAL];
     middle_info_processors_ = new MiddleInfoProcessor*[MID_PROCESSOR_TOTAL];
 
@@ -94,14 +120,16 @@ Vision::Vision(
         middle_info_processors_[i] = NULL;
     }
 
-    setupAlgorithms_();
+    setupAlgorithms_(ball_threads, ball_extra_stages, ball_hough_circle_fit,
+                     ball_tracking, field_ransac);
 
     /*
      * initialise the colour classifier and colour model
      */
     //colour_classifier_ = new DynamicColourClassifier();
-    colour_classifier_top_ = new GreenYUVClassifier(run_colour_calibration, load_nnmc, save_nnmc, nnmc_filename_top);
-    colour_classifier_bot_ = new GreenYUVClassifier(run_colour_calibration, load_nnmc, save_nnmc, nnmc_filename_bot);
+    colour_classifier_top_ = new GreenYUVClassifier(run_colour_calibration, load_nnmc, save_nnmc, nnmc_filename_top, packed_lut);
+    colour_classifier_bot_ = new GreenYUVClassifier(run_colour_calibration, load_nnmc, save_nnmc, nnmc_filename_bot, packed_lut);
+    shareColourTables_();
 }
 
 Vision::~Vision() {
@@ -139,9 +167,6 @@ Detector* Vision::getDetector_(uint32_t index) {
 VisionInfoOut Vision::processFrame(const CombinedFrame& this_frame, const VisionInfoIn& info_in) {
 
 
-    Timer t;
-    uint32_t time;
-
     VisionInfoMiddle info_middle;
     VisionInfoOut info_out;
 
@@ -154,19 +179,34 @@ VisionInfoOut Vision::processFrame(const CombinedFrame& this_frame, const Vision
     // Track the number of frames we've seen.
     ++frameCount;
 
+    // Everything allocated from the arena last frame is released here, so
+    // anything with a destructor must be destroyed first.
+    combined_fovea_.releaseChildFovea();
+    arena_.reset();
+    info_middle_.arena = &arena_;
+
     info_middle_.colour_classifier_top_ = colour_classifier_top_;
     info_middle_.colour_classifier_bot_ = colour_classifier_bot_;
 
+    // Hold on to the current lookup tables for the whole frame, so
+    // recalibrating from another thread can't free them under us
+    ColourTablePin pin_top(*colour_classifier_top_);
+    ColourTablePin pin_bot(*colour_classifier_bot_);
+
     /*
      * Primary Region Creation
      */
-    t.restart();
-    combined_fovea_.generate(this_frame, *colour_classifier_top_, *colour_classifier_bot_);
+    {
+        PROFILE_ZONE(zone, "vision.fovea");
+        combined_fovea_.generate(this_frame, *colour_classifier_top_, *colour_classifier_bot_);
+    }
 
-    time = t.elapsed_us();
-    llog(VERBOSE) << "Fovea generation took " << time << " us" << std::endl;
-    foveaTime += time;
-    t.restart();
+    llog(VERBOSE) << "Fovea generation regenerated "
+        << combined_fovea_.top_->getRecomputedFraction() << " of top and "
+        << combined_fovea_.bot_->getRecomputedFraction() << " of bottom tiles"
+        << std::endl;
+    topTilesRecomputed += combined_fovea_.top_->getRecomputedFraction();
+    botTilesRecomputed += combined_fovea_.bot_->getRecomputedFraction();
 
     // TODO: Do not copy these, re-generate these? Probably trivial improvement - for later
     full_region_top_ = RegionI(bbox_top_, true, *combined_fovea_.top_, TOP_SALIENCY_DENSITY);
@@ -181,34 +221,33 @@ VisionInfoOut Vision::processFrame(const CombinedFrame& this_frame, const Vision
 
     runAlgorithms_();
 
-    // Log the 1000 frame average vision timings.
+    llog(VERBOSE) << "Frame arena: " << arena_.bytesAllocated() << " bytes in "
+        << arena_.allocations() << " allocations, "
+        << arena_.blockAllocations() << " heap blocks" << std::endl;
+    arenaBytes += arena_.bytesAllocated();
+    arenaAllocations += arena_.allocations();
+    arenaBlockAllocations += arena_.blockAllocations();
+
+    // Log the 1000 frame averages. Timings are in the profiler.
     if(frameCount == 1000)
     {
         // Reset the frame count.
         frameCount = 0;
 
-        // Print the timings.
-        llog(INFO) << std::endl << "VISION TIMINGS (us)" << std::endl;
-        llog(INFO) << "Average fovea generation time: " <<
-                                        ((float)foveaTime)/1000.0f << std::endl;
-        llog(INFO) << "Average robot detector time: " <<
-                                ((float)robotDetectorTime)/1000.0f << std::endl;
-        llog(INFO) << "Average field features time: " <<
-                                ((float)fieldFeaturesTime)/1000.0f << std::endl;
-        llog(INFO) << "Average Region finder time: " <<
-                                 ((float)regionFinderTime)/1000.0f << std::endl;
-        llog(INFO) << "Average ball detector time: " <<
-                               ((float)ballDetectorTime) / 1000.0f << std::endl;
-        llog(INFO) << "Average total processFrame time: " << ((float)(DCCTime+
-            foveaTime+fieldFeaturesTime+regionFinderTime+ballDetectorTime)) /
-                                                           1000.0f << std::endl;
-
-        // Reset timers.
-        DCCTime = 0;
-        foveaTime = 0;
-        fieldFeaturesTime = 0;
-        regionFinderTime = 0;
-        ballDetectorTime = 0;
+        llog(INFO) << "Average frame arena use: " << arenaBytes/1000
+            << " bytes in " << ((float)arenaAllocations)/1000.0f
+            << " allocations, heap blocks in 1000 frames: "
+            << arenaBlockAllocations << std::endl;
+        llog(INFO) << "Average fraction of fovea tiles regenerated: top "
+            << topTilesRecomputed/1000.0f << ", bottom "
+            << botTilesRecomputed/1000.0f << std::endl;
+
+        // Reset the sums.
+        arenaBytes = 0;
+        arenaAllocations = 0;
+        arenaBlockAllocations = 0;
+        topTilesRecomputed = 0;
+        botTilesRecomputed = 0;
     }
 
     return info_out_;
@@ -234,6 +273,7 @@ void Vision::loadNnmc(bool top, std::string filename) {
         colour_classifier_bot_->updateColours();
         colour_classifier_bot_->saveClassification();
     }
+    shareColourTables_();
 }
 
 void Vision::resetNnmc(bool top) {
@@ -243,6 +283,7 @@ void Vision::resetNnmc(bool top) {
     else {
         colour_classifier_bot_->resetNnmc();
     }
+    shareColourTables_();
 }
 
 void Vision::runNnmc(bool top, const uint8_t *frame, int stepsize) {
@@ -257,6 +298,7 @@ void Vision::runNnmc(bool top, const uint8_t *frame, int stepsize) {
             BOT_IMAGE_ROWS, BOT_IMAGE_COLS, info_in, stepsize);
         colour_classifier_bot_->saveClassification();
     }
+    shareColourTables_();
 }
 
 void Vision::runFillPoints(bool top, bool isGreen) {
@@ -268,4 +310,17 @@ void Vision::runFillPoints(bool top, bool isGreen) {
         colour_classifier_bot_->fillPoints(isGreen);
         colour_classifier_bot_->saveClassification();
     }
+    shareColourTables_();
+}
+
+void Vision::setNnmc(const uint8_t *nnmc) {
+    colour_classifier_top_->setNnmc(nnmc);
+    colour_classifier_bot_->shareTable(*colour_classifier_top_);
+}
+
+void Vision::shareColourTables_() {
+    if (!colour_classifier_bot_->sharesTable(*colour_classifier_top_) &&
+            colour_classifier_bot_->sameTable(*colour_classifier_top_)) {
+        colour_classifier_bot_->shareTable(*colour_classifier_top_);
+    }
 }
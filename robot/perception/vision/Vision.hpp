@@ -9,6 +9,7 @@
 #include "perception/vision/fullfinder/FullFinderInterface.hpp"
 #include "perception/vision/regionfinder/RegionFinderInterface.hpp"
 #include "perception/vision/middleinfoprocessor/MiddleInfoProcessorInterface.hpp"
+#include "perception/vision/other/Ransac.hpp"
 #include "gamecontroller/GameController.hpp"
 #include "types/VisionInfoIn.hpp"
 #include "types/VisionInfoMiddle.hpp"
@@ -16,6 +17,9 @@
 #include "types/CombinedFovea.hpp"
 #include "types/CombinedFrame.hpp"
 #include "utils/Timer.hpp"
+#include "utils/FrameArena.hpp"
+
+class GreenYUVClassifier;
 
 class Vision {
 friend class CalibrationTab;
@@ -27,7 +31,16 @@ public:
      */
     Vision(bool run_colour_calibration,
         bool load_nnmc,
-        bool save_nnmc);
+        bool save_nnmc,
+        bool packed_lut = false,
+        bool incremental_fovea = false,
+        int ball_threads = 1,
+        const std::string &ball_extra_stages = "",
+        bool integral_fovea = false,
+        bool run_length_fovea = false,
+        bool ball_hough_circle_fit = false,
+        bool ball_tracking = false,
+        const RANSAC::Options &field_ransac = RANSAC::Options());
 
     /**
      * Destructor for Vision module
@@ -54,10 +67,13 @@ public:
     void resetNnmc(bool top);
     void runNnmc(bool top, const uint8_t *frame, int stepsize);
     void runFillPoints(bool top, bool isGreen);
+    void setNnmc(const uint8_t *nnmc);
 
 private:
 
-    void setupAlgorithms_();
+    void setupAlgorithms_(int ball_threads, const std::string &ball_extra_stages,
+        bool ball_hough_circle_fit, bool ball_tracking,
+        const RANSAC::Options &field_ransac);
     void runAlgorithms_();
 
     void addMiddleInfoProcessor_(uint32_t, MiddleInfoProcessor*);
@@ -68,13 +84,19 @@ private:
     Detector* getDetector_(uint32_t);
     void runDetector_(uint32_t);
 
+    /**
+     * Let both cameras classify against one lookup table if their
+     * calibrations are the same, after either is changed
+     */
+    void shareColourTables_();
+
     /**
      * Class member variables
      */
     std::list<CombinedFovea> full_foveae_;
 
-    ColourClassifier* colour_classifier_top_;
-    ColourClassifier* colour_classifier_bot_;
+    GreenYUVClassifier* colour_classifier_top_;
+    GreenYUVClassifier* colour_classifier_bot_;
 
     Detector** detectors_;
     MiddleInfoProcessor** middle_info_processors_;
@@ -91,20 +113,24 @@ private:
     BBox bbox_top_;
     BBox bbox_bot_;
 
+    // Child foveas and detector scratch, reset at the start of each frame.
+    // Declared before combined_fovea_ as the foveas allocate from it.
+    FrameArena arena_;
+
     CombinedFovea combined_fovea_;
 
     // Full Regions
     RegionI full_region_top_;
     RegionI full_region_bot_;
 
-    // Keeps track of run times for average output.
+    // Keeps track of arena and fovea use for average output. Run times
+    // go to the profiler.
     int frameCount;
-    int DCCTime;
-    int foveaTime;
-    int fieldFeaturesTime;
-    int regionFinderTime;
-    int ballDetectorTime;
-    int robotDetectorTime;
+    uint64_t arenaBytes;
+    uint32_t arenaAllocations;
+    uint32_t arenaBlockAllocations;
+    float topTilesRecomputed;
+    float botTilesRecomputed;
 };
 
 #endif
@@ -7,6 +7,7 @@
 
 #include <sys/time.h>        /* For gettimeofday */
 #include <pthread.h>
+#include <algorithm>
 #include <vector>
 
 #include "blackboard/Blackboard.hpp"
@@ -19,12 +20,33 @@
 using namespace std;
 using namespace boost::algorithm;
 
+/* The RANSAC tuning for the field line and centre circle searches */
+static RANSAC::Options fieldRansacOptions(
+        const boost::program_options::variables_map &config) {
+    RANSAC::Options options;
+    options.confidence = config["vision.ransac_confidence"].as<float>();
+    options.preemptive = std::max(config["vision.ransac_preemptive"].as<int>(), 0);
+    options.localOptimisation =
+        config["vision.ransac_local_optimisation"].as<bool>();
+    return options;
+}
 
 VisionAdapter::VisionAdapter(Blackboard *bb)
    : Adapter(bb),
      vision_((blackboard->config)["vision.run_colour_calibration"].as<bool>(),
              (blackboard->config)["vision.load_nnmc"].as<bool>(),
-             (blackboard->config)["vision.save_nnmc"].as<bool>())
+             (blackboard->config)["vision.save_nnmc"].as<bool>(),
+             (blackboard->config)["vision.packed_lut"].as<bool>(),
+             (blackboard->config)["vision.incremental_fovea"].as<bool>(),
+             (blackboard->config)["vision.ball_threads"].as<int>(),
+             (blackboard->config)["vision.ball_extra_stages"].as<string>(),
+             (blackboard->config)["vision.integral_fovea"].as<bool>(),
+             (blackboard->config)["vision.run_length_fovea"].as<bool>(),
+             (blackboard->config)["vision.ball_hough_circle_fit"].as<bool>(),
+             (blackboard->config)["vision.ball_tracking"].as<bool>(),
+             fieldRansacOptions(blackboard->config)),
+     topDroppedFrames_(0),
+     botDroppedFrames_(0)
 {
     combined_camera_ = new CombinedCamera(
         (blackboard->config)["vision.dumpframes"].as<bool>(),
@@ -83,6 +105,18 @@ void VisionAdapter::tickCamera() {
          writeTo(vision, topFrame, combined_camera_->getFrameTop());
          writeTo(vision, botFrame, combined_camera_->getFrameBottom());
 
+         // The drivers drop frames when every buffer is still held, i.e.
+         // when we fall more than a few frames behind
+         uint32_t topDropped = combined_camera_->getCameraTop()->droppedFrames();
+         uint32_t botDropped = combined_camera_->getCameraBot()->droppedFrames();
+         if (topDropped != topDroppedFrames_ || botDropped != botDroppedFrames_) {
+             llog(WARNING) << "Camera dropped frames: top "
+                           << topDropped - topDroppedFrames_ << ", bottom "
+                           << botDropped - botDroppedFrames_ << endl;
+             topDroppedFrames_ = topDropped;
+             botDroppedFrames_ = botDropped;
+         }
+
          // Write the camera settings to the Blackboard
          // for syncing with OffNao's camera tab
          CombinedCameraSettings settings = combined_camera_->getCameraSettings();
@@ -92,17 +126,37 @@ void VisionAdapter::tickCamera() {
 }
 
 void VisionAdapter::tickProcess() {
+    VisionFrameResult result;
+    tickCompute(&result);
+    tickPublish(result);
+}
+
+void VisionAdapter::tickCompute(VisionFrameResult *result) {
     Timer t;
     VisionInfoIn info_in;
 
     int behaviourReadBuf = readFrom(behaviour, readBuf);
 
+    // Hold the frames tickCamera just read until they are published
+    if (combined_camera_ != NULL) {
+        Camera *top = combined_camera_->getCameraTop();
+        Camera *bot = combined_camera_->getCameraBot();
+        result->topFrame = top != NULL ? top->currentFrame() : FrameHandle();
+        result->botFrame = bot != NULL ? bot->currentFrame() : FrameHandle();
+    }
+
     // Used by the Python WallTimer.py
     // Might not belong here, just quick fixing Ready skill for now.
-    struct timeval tv;
-    gettimeofday(&tv, 0);
-
-    int64_t vision_timestamp = tv.tv_sec * 1e6 + tv.tv_usec;
+    int64_t vision_timestamp;
+    if (result->topFrame.valid()) {
+        vision_timestamp = result->topFrame.timestamp();
+        result->sequence = result->topFrame.sequence();
+    } else {
+        struct timeval tv;
+        gettimeofday(&tv, 0);
+        vision_timestamp = tv.tv_sec * 1e6 + tv.tv_usec;
+        result->sequence = 0;
+    }
 
     // TODO Read current Pose from blakboard
     conv_rr_.pose = readFrom(motion, pose);
@@ -144,6 +198,7 @@ void VisionAdapter::tickProcess() {
     info_in.top_camera_settings = readFrom(vision, topCameraSettings);
     info_in.bot_camera_settings = readFrom(vision, botCameraSettings);
     info_in.robot_pos = readFrom(localisation, robotPos);
+    info_in.ball_vel_rrc = readFrom(localisation, ballVelRRC);
 
     boost::shared_ptr<CombinedFrame> combined_frame_;
     combined_frame_ = boost::shared_ptr<CombinedFrame>(new CombinedFrame(
@@ -158,6 +213,9 @@ void VisionAdapter::tickProcess() {
 
     lastSecond = readFrom(vision, lastSecond);
 
+    // Only the reads need the lock, holding it through processFrame would
+    // stall Perception publishing and localising the previous frame
+    releaseLock(serialization);
     t.restart();
 
     /*
@@ -169,18 +227,12 @@ void VisionAdapter::tickProcess() {
     pthread_yield();
     usleep(1); // force sleep incase yield sucks
 
-    VisionInfoOut info_out = vision_.processFrame(*(combined_frame_.get()), info_in);
+    VisionInfoOut &info_out = result->info_out;
+    info_out = vision_.processFrame(*(combined_frame_.get()), info_in);
 
     llog(VERBOSE) << "Vision processFrame() took " << t.elapsed_us() << " us" << endl;
     t.restart();
 
-    /*
-     * Writing Results back to blackboard
-     */
-
-    // NOTE: You can add things back to the blackboard by going
-    // NOTE: writeTo(vision, [blackboard var name], info_out.[info_in var name])
-
     // Vision->Localisation Log: collect info to lastSecond
     /*
     if (vision_timestamp - lastSecond.initial_timestamp > 1000000) {
@@ -288,7 +340,25 @@ void VisionAdapter::tickProcess() {
     VarianceCalculator::setVariance(info_out.posts);
     VarianceCalculator::setVariance(info_out.features);
 
-    writeTo (vision, timestamp,       vision_timestamp        );
+    result->timestamp = vision_timestamp;
+    result->lastSecond = lastSecond;
+
+    llog(VERBOSE) << "Vision computing results took " << t.elapsed_us() << " us" << endl;
+}
+
+void VisionAdapter::tickPublish(const VisionFrameResult &result) {
+    Timer t;
+    const VisionInfoOut &info_out = result.info_out;
+
+    /*
+     * Writing Results back to blackboard
+     */
+    // NOTE: You can add things back to the blackboard by going
+    // NOTE: writeTo(vision, [blackboard var name], info_out.[info_in var name])
+    acquireLock(serialization);
+
+    writeTo (vision, timestamp,       result.timestamp        );
+    writeTo (vision, frameSequence,   result.sequence         );
     // Note that these regions will not be able to access their underlying pixel
     // data.
     writeTo (vision, regions,         info_out.regions        );
@@ -297,7 +367,7 @@ void VisionAdapter::tickProcess() {
     writeTo (vision, posts,           info_out.posts          );
     writeTo (vision, robots,          info_out.robots         );
     writeTo (vision, fieldFeatures,   info_out.features       );
-    writeTo (vision, lastSecond,      lastSecond              );
+    writeTo (vision, lastSecond,      result.lastSecond       );
     writeTo (vision, fieldBoundaries, info_out.boundaries     );
 
     releaseLock(serialization);
@@ -9,6 +9,24 @@
 #include "blackboard/Adapter.hpp"
 #include "blackboard/Blackboard.hpp"
 
+/**
+ * The results of processing one frame, waiting to be written to the
+ * blackboard. Lets the pipelined PerceptionThread process the next frame
+ * while localisation and behaviour are still using this one.
+ */
+struct VisionFrameResult {
+    VisionInfoOut info_out;
+    /* When the top camera captured the frame (us since epoch) */
+    int64_t timestamp;
+    /* The top camera driver's frame counter */
+    uint32_t sequence;
+    LastSecondInfo lastSecond;
+    /* Keep the frames' buffers from being refilled while the result is
+     * computed and until it has been published */
+    FrameHandle topFrame;
+    FrameHandle botFrame;
+};
+
 class VisionAdapter : Adapter {
 friend class AppAdaptor;
 public:
@@ -31,6 +49,10 @@ public:
     void tickCamera();
     /* Method for processing what is on the blackboard and writing resuts */
     void tickProcess();
+    /* Process the frame on the blackboard without writing the results */
+    void tickCompute(VisionFrameResult *result);
+    /* Write the results of tickCompute to the blackboard */
+    void tickPublish(const VisionFrameResult &result);
 
     // TODO: Temporary fix please resolve
 	CombinedCamera *combined_camera_;
@@ -42,6 +64,10 @@ private:
 
    /* Collection of info from frames from the last second */
     LastSecondInfo lastSecond;
+
+    /* Frames each camera had dropped when last checked */
+    uint32_t topDroppedFrames_;
+    uint32_t botDroppedFrames_;
 };
 
 #endif
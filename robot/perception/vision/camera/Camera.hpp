@@ -11,6 +11,8 @@
 #include <alvision/alvisiondefinitions.h>
 #include <linux/videodev2.h>
 
+#include "perception/vision/camera/FrameRing.hpp"
+
 #define IMAGE_WIDTH 640
 #define IMAGE_HEIGHT 480
 #define TOP_IMAGE_WIDTH 1280
@@ -69,6 +71,19 @@ class Camera {
        */
       virtual bool setControl(const uint32_t id, const int32_t value) = 0;
 
+      /**
+       * @returns how many frames the driver has dropped because none of its
+       * buffers were free, if the camera can tell
+       */
+      virtual uint32_t droppedFrames() const { return 0; }
+
+      /**
+       * @returns a handle to the frame last returned by get(), holding which
+       * keeps the frame intact, or an empty handle if the camera doesn't
+       * capture into a FrameRing
+       */
+      virtual FrameHandle currentFrame() const { return FrameHandle(); }
+
       /* Writes a frame to disk if we are currently recording */
       void writeFrame(const uint8_t*& imageTop,const uint8_t*& imageBot);
 
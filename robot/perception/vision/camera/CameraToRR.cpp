@@ -7,7 +7,13 @@
 
 using namespace std;
 
-CameraToRR::CameraToRR()
+/* Joint angle change (rad) between frames, and body rotation rate (rad/s),
+ * above which the robot is considered to be moving. Joint encoders jitter by
+ * about 0.002 rad when still. */
+#define MOVING_JOINT_DELTA 0.005
+#define MOVING_GYRO_RATE 0.05
+
+CameraToRR::CameraToRR() : haveLastAngles_(false), moving_(true)
 {
    for (int i = 0; i < IMAGE_COLS; i++) {
       topEndScanCoords_[i] = TOP_IMAGE_ROWS;
@@ -22,6 +28,21 @@ CameraToRR::~CameraToRR()
 void CameraToRR::updateAngles(SensorValues val)
 {
    values = val;
+
+   moving_ = !haveLastAngles_;
+   for (int i = 0; i < Joints::NUMBER_OF_JOINTS; ++i) {
+      // written so unknown (NaN) angles count as moving
+      if (!(fabs(val.joints.angles[i] - lastAngles_[i]) <= MOVING_JOINT_DELTA)) {
+         moving_ = true;
+      }
+      lastAngles_[i] = val.joints.angles[i];
+   }
+   if (fabs(val.sensors[Sensors::InertialSensor_GyroscopeX]) > MOVING_GYRO_RATE ||
+       fabs(val.sensors[Sensors::InertialSensor_GyroscopeY]) > MOVING_GYRO_RATE ||
+       fabs(val.sensors[Sensors::InertialSensor_GyroscopeZ]) > MOVING_GYRO_RATE) {
+      moving_ = true;
+   }
+   haveLastAngles_ = true;
 }
 
 RRCoord CameraToRR::convertToRR(const Point &p, bool isBall) const
@@ -62,7 +83,7 @@ float CameraToRR::pixelSeparationToDistance(int pixelSeparation,
 
 bool CameraToRR::isRobotMoving() const
 {
-   return true;
+   return moving_;
 }
 
 void CameraToRR::findEndScanValues() {
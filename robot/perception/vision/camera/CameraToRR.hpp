@@ -42,6 +42,12 @@ class CameraToRR {
 
       Pose pose;
       float pixelSeparationToDistance(int pixelSeparation, int realSeparation) const;
+
+      /**
+       * Whether any joint moved or the body rotated between the last two
+       * calls to updateAngles, i.e. whether the camera may have moved
+       * between the last two frames
+       **/
       bool isRobotMoving() const;
 
       /**
@@ -61,6 +67,11 @@ class CameraToRR {
     private:
       int topEndScanCoords_[IMAGE_COLS];
       int botEndScanCoords_[IMAGE_COLS];
+
+      // Joint angles at the previous updateAngles, to detect movement
+      float lastAngles_[Joints::NUMBER_OF_JOINTS];
+      bool haveLastAngles_;
+      bool moving_;
 };
 
 #endif
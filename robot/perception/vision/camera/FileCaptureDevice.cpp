@@ -0,0 +1,99 @@
+#include "perception/vision/camera/FileCaptureDevice.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+FileCaptureDevice::FileCaptureDevice(const string &filename,
+                                     size_t frameBytes,
+                                     unsigned int numBuffers)
+   : frameBytes(frameBytes), buffers(numBuffers), sequence(0) {
+   if (numBuffers > FRAME_RING_MAX_BUFFERS) {
+      throw runtime_error("too many capture buffers");
+   }
+
+   fd = open(filename.c_str(), O_CLOEXEC | O_RDONLY);
+   if (fd < 0) {
+      throw runtime_error("failed to open " + filename + ": " +
+                          strerror(errno));
+   }
+
+   struct stat buf;
+   if (fstat(fd, &buf) < 0 || buf.st_size < (off_t)frameBytes) {
+      close(fd);
+      throw runtime_error(filename + " does not hold a whole frame");
+   }
+   num_frames = buf.st_size / frameBytes;
+
+   for (unsigned int i = 0; i < numBuffers; ++i) {
+      buffers[i].resize(frameBytes);
+      queued.push_back(i);
+   }
+}
+
+FileCaptureDevice::~FileCaptureDevice() {
+   close(fd);
+}
+
+unsigned int FileCaptureDevice::numBuffers() const {
+   return buffers.size();
+}
+
+const uint8_t *FileCaptureDevice::buffer(unsigned int index) const {
+   return &buffers[index][0];
+}
+
+size_t FileCaptureDevice::length(unsigned int index) const {
+   return frameBytes;
+}
+
+bool FileCaptureDevice::dequeue(CapturedBuffer *captured) {
+   boost::mutex::scoped_lock l(lock);
+   if (done.empty()) {
+      // the driver would block until the next frame period
+      elapse_(1);
+      if (done.empty()) {
+         return false;
+      }
+   }
+   *captured = done.front();
+   done.pop_front();
+   return true;
+}
+
+void FileCaptureDevice::enqueue(unsigned int index) {
+   boost::mutex::scoped_lock l(lock);
+   queued.push_back(index);
+}
+
+void FileCaptureDevice::elapse(unsigned int frames) {
+   boost::mutex::scoped_lock l(lock);
+   elapse_(frames);
+}
+
+void FileCaptureDevice::elapse_(unsigned int frames) {
+   for (unsigned int i = 0; i < frames; ++i, ++sequence) {
+      if (queued.empty()) {
+         // nowhere to put it, so the frame is dropped
+         continue;
+      }
+      CapturedBuffer captured;
+      captured.index = queued.front();
+      captured.sequence = sequence;
+      captured.timestamp = (int64_t)sequence * FILE_CAPTURE_FRAME_PERIOD_US;
+      queued.pop_front();
+
+      off_t offset = (off_t)(sequence % num_frames) * frameBytes;
+      if (pread(fd, &buffers[captured.index][0], frameBytes, offset) !=
+          (ssize_t)frameBytes) {
+         queued.push_front(captured.index);
+         throw runtime_error("failed to read frame from recording");
+      }
+      done.push_back(captured);
+   }
+}
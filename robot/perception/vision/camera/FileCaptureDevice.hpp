@@ -0,0 +1,68 @@
+#ifndef PERCEPTION_VISION_CAMERA_FILECAPTUREDEVICE_H_
+#define PERCEPTION_VISION_CAMERA_FILECAPTUREDEVICE_H_
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+
+#include "perception/vision/camera/FrameRing.hpp"
+
+// 30 frames per second, as the Nao cameras run
+#define FILE_CAPTURE_FRAME_PERIOD_US 33333
+
+/**
+ * A stand-in for a V4L2 device that plays back a raw recording (frames of
+ * frameBytes back to back, e.g. a .yuv dump), so a FrameRing can be run on
+ * a desktop.
+ *
+ * It behaves like the driver: each frame period the next frame is copied
+ * into the oldest queued buffer, or dropped if every buffer is held, and
+ * dequeue waits for a frame by letting one period pass. Time is simulated
+ * rather than real, so tests can make frames go missing with elapse.
+ */
+class FileCaptureDevice : public CaptureDevice {
+   public:
+      /**
+       * @param filename the recording, which is played in a loop
+       * @param frameBytes the size of each frame in the recording
+       * @param numBuffers how many buffers to capture into, all queued
+       */
+      FileCaptureDevice(const std::string &filename, size_t frameBytes,
+                        unsigned int numBuffers);
+      ~FileCaptureDevice();
+
+      unsigned int numBuffers() const;
+      const uint8_t *buffer(unsigned int index) const;
+      size_t length(unsigned int index) const;
+      bool dequeue(CapturedBuffer *captured);
+      void enqueue(unsigned int index);
+
+      /**
+       * Let the device capture for frames periods, as if the caller had
+       * taken that long to come back for the next frame.
+       */
+      void elapse(unsigned int frames);
+
+      /* the number of frames in the recording */
+      unsigned int numFrames() const { return num_frames; }
+
+   private:
+      void elapse_(unsigned int frames);
+
+      int fd;
+      size_t frameBytes;
+      unsigned int num_frames;
+      std::vector<std::vector<uint8_t> > buffers;
+
+      boost::mutex lock;
+      /* buffers waiting to be filled, oldest first */
+      std::deque<unsigned int> queued;
+      /* buffers filled but not yet dequeued, oldest first */
+      std::deque<CapturedBuffer> done;
+      /* the sequence number of the next frame period */
+      uint32_t sequence;
+};
+
+#endif
@@ -0,0 +1,141 @@
+#include "perception/vision/camera/FrameRing.hpp"
+
+#include <sched.h>
+#include <stdexcept>
+
+FrameHandle::FrameHandle()
+   : ring_(NULL), data_(NULL) {
+   captured_.index = 0;
+   captured_.sequence = 0;
+   captured_.timestamp = 0;
+}
+
+FrameHandle::FrameHandle(FrameRing *ring, const CapturedBuffer &captured,
+                         const uint8_t *data)
+   : ring_(ring), captured_(captured), data_(data) {
+}
+
+FrameHandle::FrameHandle(const FrameHandle &other)
+   : ring_(other.ring_), captured_(other.captured_), data_(other.data_) {
+   if (ring_ != NULL) {
+      ring_->ref(captured_.index);
+   }
+}
+
+FrameHandle &FrameHandle::operator=(const FrameHandle &other) {
+   if (this != &other) {
+      // take the new reference first in case other refers to the same
+      // buffer, which releasing ours could otherwise requeue
+      if (other.ring_ != NULL) {
+         other.ring_->ref(other.captured_.index);
+      }
+      reset();
+      ring_ = other.ring_;
+      captured_ = other.captured_;
+      data_ = other.data_;
+   }
+   return *this;
+}
+
+FrameHandle::~FrameHandle() {
+   reset();
+}
+
+void FrameHandle::reset() {
+   if (ring_ != NULL) {
+      ring_->unref(captured_.index);
+      ring_ = NULL;
+      data_ = NULL;
+   }
+}
+
+size_t FrameHandle::length() const {
+   return ring_ != NULL ? ring_->device_->length(captured_.index) : 0;
+}
+
+FrameRing::FrameRing(CaptureDevice *device)
+   : device_(device), users_(1), released_(0), enqueuing_(0),
+     haveSequence_(false), lastSequence_(0), numCaptured_(0),
+     numDropped_(0) {
+   if (device_->numBuffers() > FRAME_RING_MAX_BUFFERS) {
+      delete device_;
+      throw std::runtime_error("too many capture buffers");
+   }
+   for (int i = 0; i < FRAME_RING_MAX_BUFFERS; ++i) {
+      refs_[i] = 0;
+   }
+}
+
+FrameRing::~FrameRing() {
+   delete device_;
+}
+
+void FrameRing::release() {
+   __sync_fetch_and_or(&released_, 1);
+   // an unref that saw the ring still open may be requeuing its buffer,
+   // which must happen before the owner takes the buffers back
+   while (enqueuing_ > 0) {
+      sched_yield();
+   }
+   unrefRing();
+}
+
+FrameHandle FrameRing::acquire() {
+   CapturedBuffer captured;
+   if (!device_->dequeue(&captured)) {
+      return FrameHandle();
+   }
+
+   // the driver's sequence counts the frames it dropped for want of a
+   // queued buffer as well as the ones it delivered
+   if (haveSequence_ && captured.sequence - lastSequence_ > 1) {
+      __sync_fetch_and_add(&numDropped_,
+                           captured.sequence - lastSequence_ - 1);
+   }
+   haveSequence_ = true;
+   lastSequence_ = captured.sequence;
+   __sync_fetch_and_add(&numCaptured_, 1);
+   __sync_fetch_and_add(&refs_[captured.index], 1);
+   __sync_fetch_and_add(&users_, 1);
+   return FrameHandle(this, captured, device_->buffer(captured.index));
+}
+
+uint32_t FrameRing::captured() const {
+   return numCaptured_;
+}
+
+uint32_t FrameRing::dropped() const {
+   return numDropped_;
+}
+
+unsigned int FrameRing::held() const {
+   unsigned int numHeld = 0;
+   for (unsigned int i = 0; i < device_->numBuffers(); ++i) {
+      if (refs_[i] > 0) {
+         ++numHeld;
+      }
+   }
+   return numHeld;
+}
+
+void FrameRing::ref(unsigned int index) {
+   __sync_fetch_and_add(&refs_[index], 1);
+   __sync_fetch_and_add(&users_, 1);
+}
+
+void FrameRing::unref(unsigned int index) {
+   if (__sync_sub_and_fetch(&refs_[index], 1) == 0) {
+      __sync_fetch_and_add(&enqueuing_, 1);
+      if (!released_) {
+         device_->enqueue(index);
+      }
+      __sync_fetch_and_sub(&enqueuing_, 1);
+   }
+   unrefRing();
+}
+
+void FrameRing::unrefRing() {
+   if (__sync_sub_and_fetch(&users_, 1) == 0) {
+      delete this;
+   }
+}
@@ -0,0 +1,169 @@
+#ifndef PERCEPTION_VISION_CAMERA_FRAMERING_H_
+#define PERCEPTION_VISION_CAMERA_FRAMERING_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// more than any camera driver we use will hand out
+#define FRAME_RING_MAX_BUFFERS 16
+
+/**
+ * A frame the device has filled, as reported when it was dequeued.
+ */
+struct CapturedBuffer {
+   /* which of the device's buffers holds the frame */
+   unsigned int index;
+   /* the driver's frame counter, which skips frames it had to drop */
+   uint32_t sequence;
+   /* when the driver captured the frame, in microseconds since the epoch */
+   int64_t timestamp;
+};
+
+/**
+ * Somewhere frames come from. The device owns a fixed set of buffers, fills
+ * the ones queued to it and hands them back through dequeue.
+ *
+ * enqueue may be called from any thread, including while another thread is
+ * blocked in dequeue waiting for a frame, as V4L2 allows.
+ */
+class CaptureDevice {
+   public:
+      virtual ~CaptureDevice() {}
+
+      /* how many buffers the device owns */
+      virtual unsigned int numBuffers() const = 0;
+
+      /* the memory of buffer index, valid while the device exists */
+      virtual const uint8_t *buffer(unsigned int index) const = 0;
+
+      /* the size in bytes of buffer index */
+      virtual size_t length(unsigned int index) const = 0;
+
+      /**
+       * Take the next filled buffer from the device.
+       *
+       * @return false if there was no frame ready
+       */
+      virtual bool dequeue(CapturedBuffer *captured) = 0;
+
+      /* give buffer index back to the device to be filled again */
+      virtual void enqueue(unsigned int index) = 0;
+};
+
+class FrameRing;
+
+/**
+ * A reference to a frame in a FrameRing. The frame's buffer goes back to
+ * the device when the last handle to it is released, so holding a handle
+ * keeps the frame from being overwritten while the ring moves on to
+ * newer frames.
+ *
+ * Handles may be copied and released from any thread, and keep their ring
+ * alive after its owner has released it.
+ */
+class FrameHandle {
+   public:
+      /* a handle to no frame */
+      FrameHandle();
+      FrameHandle(const FrameHandle &other);
+      FrameHandle &operator=(const FrameHandle &other);
+      ~FrameHandle();
+
+      /* drop this handle's reference, leaving it empty */
+      void reset();
+
+      /* whether this handle refers to a frame */
+      bool valid() const { return ring_ != NULL; }
+
+      const uint8_t *data() const { return data_; }
+      /* the size in bytes of the frame's buffer, or 0 if there is none */
+      size_t length() const;
+      uint32_t sequence() const { return captured_.sequence; }
+      int64_t timestamp() const { return captured_.timestamp; }
+
+   private:
+      friend class FrameRing;
+      FrameHandle(FrameRing *ring, const CapturedBuffer &captured,
+                  const uint8_t *data);
+
+      FrameRing *ring_;
+      CapturedBuffer captured_;
+      const uint8_t *data_;
+};
+
+/**
+ * Hands out the frames of a CaptureDevice as reference counted handles, and
+ * keeps count of the frames the driver dropped because every buffer was
+ * held.
+ *
+ * Unlike requeuing the previous buffer just before dequeuing the next one,
+ * a buffer is only requeued once nothing holds its frame, so one frame can
+ * still be processed after the next has been dequeued.
+ *
+ * The ring is reference counted by its owner and every handle, so it is
+ * released rather than deleted, and goes once the last of them lets go.
+ */
+class FrameRing {
+   public:
+      /**
+       * Starts handing out frames from device, which the ring takes
+       * ownership of. Every buffer is expected to be queued to the device
+       * already.
+       */
+      explicit FrameRing(CaptureDevice *device);
+
+      /**
+       * Stops giving buffers back to the device and drops the owner's
+       * reference, so the owner must not use the ring after. Handles still
+       * held keep the ring and their frames until they are released, but
+       * their buffers are left for the owner to take back, e.g. by stopping
+       * the stream. No buffer is given back to the device once this returns.
+       */
+      void release();
+
+      /**
+       * Dequeues the next frame. Only one thread may acquire from a ring.
+       *
+       * @return a handle to the frame, or an empty handle if none was ready
+       */
+      FrameHandle acquire();
+
+      /* frames handed out since the ring was created */
+      uint32_t captured() const;
+
+      /* frames the driver dropped since the ring was created */
+      uint32_t dropped() const;
+
+      /* buffers currently held by handles rather than queued to the device */
+      unsigned int held() const;
+
+   private:
+      friend class FrameHandle;
+      FrameRing(const FrameRing &);
+      FrameRing &operator=(const FrameRing &);
+      /* only deleted by the last release or unref */
+      ~FrameRing();
+
+      void ref(unsigned int index);
+      void unref(unsigned int index);
+      /* drop a reference to the ring, deleting it if it was the last */
+      void unrefRing();
+
+      CaptureDevice *device_;
+
+      /* handles referring to each buffer */
+      volatile int refs_[FRAME_RING_MAX_BUFFERS];
+      /* the owner, until it releases the ring, and every handle */
+      volatile int users_;
+      /* whether the owner has released the ring */
+      volatile int released_;
+      /* unrefs giving a buffer back to the device right now */
+      volatile int enqueuing_;
+
+      bool haveSequence_;
+      uint32_t lastSequence_;
+      volatile uint32_t numCaptured_;
+      volatile uint32_t numDropped_;
+};
+
+#endif
@@ -43,6 +43,7 @@ Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #include <iostream>
 #include <stdexcept>
 #include "perception/vision/camera/NaoCamera.hpp"
+#include "perception/vision/camera/V4L2CaptureDevice.hpp"
 #include "utils/Logger.hpp"
 #include "utils/speech.hpp"
 #include "utils/Timer.hpp"
@@ -113,7 +114,7 @@ using namespace AL;
  */
 NaoCamera::NaoCamera(Blackboard *blackboard, const char *filename, const IOMethod method,
                      const int format):
-      filename(filename), io(method), format(format) {
+      filename(filename), io(method), format(format), ring(NULL) {
 
    readCameraSettings(blackboard);
    // open your camera
@@ -163,7 +164,7 @@ NaoCamera::NaoCamera(Blackboard *blackboard, const char *filename, const IOMetho
 NaoCamera::NaoCamera(Blackboard *blackboard, const char *filename, const IOMethod method,
                      const int format,
                      int dummy, const std::string cameraChoice):
-      filename(filename), io(method), format(format),
+      filename(filename), io(method), format(format), ring(NULL),
                cameraChoice(cameraChoice)
 {
     readCameraSettings(blackboard);
@@ -268,7 +269,6 @@ bool NaoCamera::imgDimensions(int *const width, int *const height) {
 }
 
 const uint8_t *NaoCamera::read_frame(void) {
-   unsigned int i;
    const uint8_t *image = NULL;
    switch (io) {
       /* reading from file and video device are exactly the same */
@@ -293,82 +293,18 @@ const uint8_t *NaoCamera::read_frame(void) {
          break;
 
       case IO_METHOD_MMAP:
-         if (lastDequeued.index != UINT_MAX) {
-            if (-1 == ioctl(fd, VIDIOC_QBUF, &lastDequeued)) {
-               errno_throw("VIDEOC_BUF");
-            }
-         }
-
-         CLEAR(lastDequeued);
-
-         lastDequeued.type   = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-         lastDequeued.memory = V4L2_MEMORY_MMAP;
-
-         if (-1 == ioctl(fd, VIDIOC_DQBUF, &lastDequeued)) {
-            switch (errno) {
-               case EAGAIN:
-                  return false;
-
-               case EIO:
-                  /* Could ignore EIO, see spec. */
-                  std::cout << "eio" << std::endl;
-
-                  /* fall through */
-               case EFAULT:
-                  std::cout << "efault" << std::endl;
-
-               case EINVAL:
-                  std::cout << "einval" << std::endl;
-
-               default:
-                  std::cout << "lol mmap" << std::endl;
-                  errno_throw("VIDIOC_DQBUF");
-            }
-         }
-
-         assert(lastDequeued.index < n_buffers);
-
-         image = buffers[lastDequeued.index].start;
-
-         break;
-
       case IO_METHOD_USERPTR:
-         // TODO(jayen): verify that lastDequeued fix works for user pointers
-         if (lastDequeued.index != UINT_MAX) {
-            if (-1 == ioctl(fd, VIDIOC_QBUF, &lastDequeued)) {
-               errno_throw("VIDEOC_BUF");
+         {
+            // dequeue the next frame before letting go of the current one,
+            // so the current frame stays intact until there is a new one
+            FrameHandle next = ring->acquire();
+            if (!next.valid()) {
+               return NULL;
             }
+            current = next;
          }
 
-         CLEAR(lastDequeued);
-
-         lastDequeued.type   = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-         lastDequeued.memory = V4L2_MEMORY_USERPTR;
-
-         if (-1 == ioctl(fd, VIDIOC_DQBUF, &lastDequeued)) {
-            switch (errno) {
-               case EAGAIN:
-                  return false;
-
-               case EIO:
-                  /* Could ignore EIO, see spec. */
-
-                  /* fall through */
-
-               default:
-                  std::cout << "lol user?" << std::endl;
-                  errno_throw("VIDIOC_DQBUF");
-            }
-         }
-
-         for (i = 0; i < n_buffers; ++i)
-            if (lastDequeued.m.userptr == (uint32_t) buffers[i].start
-                && lastDequeued.length == buffers[i].length)
-               break;
-
-         assert(i < n_buffers);
-
-         image =(const uint8_t*) lastDequeued.m.userptr;
+         image = current.data();
 
          break;
 
@@ -413,6 +349,14 @@ const uint8_t *NaoCamera::get(const int colourSpace) {
    return image;
 }
 
+FrameHandle NaoCamera::currentFrame() const {
+   return current;
+}
+
+uint32_t NaoCamera::droppedFrames() const {
+   return ring ? ring->dropped() : 0;
+}
+
 bool NaoCamera::init_camera() {
    if (v4lDeviceP) {
       // GET video device information
@@ -527,6 +471,12 @@ void NaoCamera::stop_capturing(void) {
 
       case IO_METHOD_MMAP:
       case IO_METHOD_USERPTR:
+         // frames still held elsewhere keep the ring until they are
+         // released, and STREAMOFF takes back every buffer
+         current.reset();
+         ring->release();
+         ring = NULL;
+
          type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 
          if (-1 == ioctl(fd, VIDIOC_STREAMOFF, &type))
@@ -833,12 +783,15 @@ void NaoCamera::init_userp() {
 }
 
 void NaoCamera::start_capturing(void) {
-   // assign an impossible index to lastDequeued so we know not to
-   // re-enqueue if there have been no previous buffers
-   lastDequeued.index = UINT_MAX;
-
    unsigned int i;
    enum v4l2_buf_type type;
+   uint8_t *starts[NUM_FRAME_BUFFERS];
+   size_t lengths[NUM_FRAME_BUFFERS];
+
+   for (i = 0; i < n_buffers; ++i) {
+      starts[i] = buffers[i].start;
+      lengths[i] = buffers[i].length;
+   }
 
    switch (io) {
       case IO_METHOD_READ:
@@ -864,6 +817,10 @@ void NaoCamera::start_capturing(void) {
          if (-1 == ioctl(fd, VIDIOC_STREAMON, &type))
             errno_throw("VIDIOC_STREAMON");
 
+         ring = new FrameRing(new V4L2CaptureDevice(fd, V4L2_MEMORY_MMAP,
+                                                    starts, lengths,
+                                                    n_buffers));
+
          break;
 
       case IO_METHOD_USERPTR:
@@ -887,6 +844,10 @@ void NaoCamera::start_capturing(void) {
          if (-1 == ioctl(fd, VIDIOC_STREAMON, &type))
             errno_throw("VIDIOC_STREAMON");
 
+         ring = new FrameRing(new V4L2CaptureDevice(fd, V4L2_MEMORY_USERPTR,
+                                                    starts, lengths,
+                                                    n_buffers));
+
          break;
 
       default:
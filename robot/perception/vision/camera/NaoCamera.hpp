@@ -7,6 +7,7 @@
 
 #include "perception/vision/camera/Camera.hpp"
 #include "perception/vision/camera/CameraDefinitions.hpp"
+#include "perception/vision/camera/FrameRing.hpp"
 #include "perception/vision/camera/NaoCameraDefinitions.hpp"
 #include "types/CameraSettings.hpp"
 
@@ -55,6 +56,15 @@ class NaoCamera : public Camera {
        */
       bool imgDimensions(int *const width, int *const height);
       const uint8_t *get(const int colourSpace);
+
+      /**
+       * A handle to the frame last returned by get(), with its kernel
+       * timestamp and sequence number. Holding it keeps the frame intact
+       * after later calls to get(). Empty when using read.
+       */
+      FrameHandle currentFrame() const;
+
+      uint32_t droppedFrames() const;
       bool setControl(const uint32_t id, const int32_t value);
 
       //Camera setting fields.
@@ -186,16 +196,18 @@ class NaoCamera : public Camera {
       struct v4l2_querymenu querymenu;
 
       /**
-       * When dealing with mmap'ed buffers, we should
-       * 1. Dequeue a buffer and write its pointer to the blackboard
-       * 2. Allow perception to process the image
-       * 3. Enqueue the buffer again so it can be reused
-       *
-       * Before we were not allowing perception to process the current frame
-       * before enqueuing the buffer again, which could have potentially have
-       * lead to split images
+       * When dealing with mmap'ed or user pointer buffers, frames come from
+       * ring, and a buffer is only enqueued again once nothing holds its
+       * frame. NULL while not capturing or when using read.
+       */
+      FrameRing *ring;
+
+      /**
+       * The frame last returned by get(). It is held until the next frame
+       * has been dequeued, so perception can keep processing it until then
+       * and it can never be overwritten while in use (split images)
        */
-      struct v4l2_buffer lastDequeued;
+      FrameHandle current;
 
       // Keep track of the current camera choice as a human-readable string
       std::string cameraChoice;
@@ -0,0 +1,116 @@
+#include "perception/vision/camera/V4L2CaptureDevice.hpp"
+
+#include <sys/ioctl.h>
+#include <time.h>
+#include <linux/videodev2.h>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include "utils/Logger.hpp"
+
+using namespace std;
+
+/**
+ * reads the system error and writes it to the log, then throws an exception
+ * @param s an additional string, decribing the failed action
+ */
+static inline void errno_throw(const char *s) {
+   llog(ERROR) << s << " error "<< errno << ", " << strerror(errno) << endl;
+   throw runtime_error(strerror(errno));
+}
+
+V4L2CaptureDevice::V4L2CaptureDevice(int fd, uint32_t memory,
+                                     uint8_t *const *starts,
+                                     const size_t *lengths, unsigned int n)
+   : fd(fd), memory(memory), n_buffers(n) {
+   if (n > FRAME_RING_MAX_BUFFERS) {
+      throw runtime_error("too many capture buffers");
+   }
+   for (unsigned int i = 0; i < n; ++i) {
+      this->starts[i] = starts[i];
+      this->lengths[i] = lengths[i];
+   }
+}
+
+unsigned int V4L2CaptureDevice::numBuffers() const {
+   return n_buffers;
+}
+
+const uint8_t *V4L2CaptureDevice::buffer(unsigned int index) const {
+   return starts[index];
+}
+
+size_t V4L2CaptureDevice::length(unsigned int index) const {
+   return lengths[index];
+}
+
+bool V4L2CaptureDevice::dequeue(CapturedBuffer *captured) {
+   struct v4l2_buffer buf;
+   memset(&buf, 0, sizeof(buf));
+   buf.type   = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+   buf.memory = memory;
+
+   if (-1 == ioctl(fd, VIDIOC_DQBUF, &buf)) {
+      switch (errno) {
+         case EAGAIN:
+            return false;
+
+         case EIO:
+            /* Could ignore EIO, see spec. */
+
+            /* fall through */
+
+         default:
+            errno_throw("VIDIOC_DQBUF");
+      }
+   }
+
+   unsigned int index = buf.index;
+   if (memory == V4L2_MEMORY_USERPTR) {
+      for (index = 0; index < n_buffers; ++index)
+         if (buf.m.userptr == (unsigned long) starts[index]
+             && buf.length == lengths[index])
+            break;
+   }
+   if (index >= n_buffers) {
+      throw runtime_error("VIDIOC_DQBUF returned an unknown buffer");
+   }
+
+   captured->index = index;
+   captured->sequence = buf.sequence;
+   captured->timestamp = buf.timestamp.tv_sec * 1000000LL +
+                         buf.timestamp.tv_usec;
+#ifdef V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC
+   // newer drivers stamp frames with the monotonic clock rather than the
+   // time of day, so move those onto the time of day like older drivers
+   if ((buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) ==
+       V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC) {
+      struct timespec now, monotonic;
+      clock_gettime(CLOCK_REALTIME, &now);
+      clock_gettime(CLOCK_MONOTONIC, &monotonic);
+      captured->timestamp += (now.tv_sec - monotonic.tv_sec) * 1000000LL +
+                             (now.tv_nsec - monotonic.tv_nsec) / 1000;
+   }
+#endif
+   return true;
+}
+
+void V4L2CaptureDevice::enqueue(unsigned int index) {
+   struct v4l2_buffer buf;
+   memset(&buf, 0, sizeof(buf));
+   buf.type   = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+   buf.memory = memory;
+   buf.index  = index;
+   if (memory == V4L2_MEMORY_USERPTR) {
+      buf.m.userptr = (unsigned long) starts[index];
+      buf.length    = lengths[index];
+   }
+
+   // called when a handle is released, possibly from a destructor, so
+   // don't throw; the buffer is just lost to the ring
+   if (-1 == ioctl(fd, VIDIOC_QBUF, &buf)) {
+      llog(ERROR) << "VIDIOC_QBUF error " << errno << ", " << strerror(errno)
+                  << endl;
+   }
+}
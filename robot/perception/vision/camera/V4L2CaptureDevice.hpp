@@ -0,0 +1,37 @@
+#ifndef PERCEPTION_VISION_CAMERA_V4L2CAPTUREDEVICE_H_
+#define PERCEPTION_VISION_CAMERA_V4L2CAPTUREDEVICE_H_
+
+#include "perception/vision/camera/FrameRing.hpp"
+
+/**
+ * The streaming buffers of a V4L2 device, for a FrameRing. The device and
+ * its buffers are set up and owned by the caller (NaoCamera), which must
+ * have queued every buffer and started streaming.
+ */
+class V4L2CaptureDevice : public CaptureDevice {
+   public:
+      /**
+       * @param fd the open device
+       * @param memory V4L2_MEMORY_MMAP or V4L2_MEMORY_USERPTR
+       * @param starts where each buffer is mapped or allocated
+       * @param lengths the size of each buffer
+       * @param n the number of buffers
+       */
+      V4L2CaptureDevice(int fd, uint32_t memory, uint8_t *const *starts,
+                        const size_t *lengths, unsigned int n);
+
+      unsigned int numBuffers() const;
+      const uint8_t *buffer(unsigned int index) const;
+      size_t length(unsigned int index) const;
+      bool dequeue(CapturedBuffer *captured);
+      void enqueue(unsigned int index);
+
+   private:
+      int fd;
+      uint32_t memory;
+      uint8_t *starts[FRAME_RING_MAX_BUFFERS];
+      size_t lengths[FRAME_RING_MAX_BUFFERS];
+      unsigned int n_buffers;
+};
+
+#endif
@@ -0,0 +1,141 @@
+#include "perception/vision/colour/ClassifyRun.hpp"
+
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+void classifyRunScalar(const uint8_t *nnmc, const uint8_t *raw, int step,
+                       Colour *out, int n)
+{
+    for (int i = 0; i < n; ++i, raw += step)
+    {
+        uint8_t y = raw[0];
+        uint8_t u;
+        uint8_t v;
+        if ((size_t)raw & 0x2) {
+        //YV_U
+            v = raw[1];
+            u = raw[3];
+        } else {
+        //YU_V
+            u = raw[1];
+            v = raw[3];
+        }
+        out[i] = (Colour) nnmc[((v >> 1) << 14) | ((u >> 1) << 7) | (y >> 1)];
+    }
+}
+
+#ifdef __SSE2__
+
+/**
+ * Unaligned load of the four bytes of a pixel.
+ */
+static inline int loadPixelWord(const uint8_t *raw)
+{
+    int word;
+    memcpy(&word, raw, sizeof(word));
+    return word;
+}
+
+/**
+ * Narrow the low 16 bits of each 32 bit lane of a then b into eight 16 bit
+ * lanes. Sign extending first stops packs_epi32 from saturating.
+ */
+static inline __m128i packLow16(__m128i a, __m128i b)
+{
+    return _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16), 16),
+                           _mm_srai_epi32(_mm_slli_epi32(b, 16), 16));
+}
+
+/**
+ * Narrow the high 16 bits of each 32 bit lane of a then b into eight 16 bit
+ * lanes.
+ */
+static inline __m128i packHigh16(__m128i a, __m128i b)
+{
+    return _mm_packs_epi32(_mm_srai_epi32(a, 16), _mm_srai_epi32(b, 16));
+}
+
+void classifyRunSSE2(const uint8_t *nnmc, const uint8_t *raw, int step,
+                     Colour *out, int n)
+{
+    // Lanes set to all ones are pixels starting on the second Y of a
+    // macropixel (YV_U), the rest are YU_V. Eight pixels always span a
+    // multiple of four bytes, so the pattern is the same for every group.
+    int16_t phase[8];
+    for (int lane = 0; lane < 8; ++lane)
+        phase[lane] = ((size_t)(raw + lane * step) & 0x2) ? -1 : 0;
+    const __m128i yvu = _mm_loadu_si128((const __m128i*)phase);
+
+    const __m128i lowByte = _mm_set1_epi16(0x00FF);
+
+    // Multiplier pairs for madd_epi16 to compute lo + (hi << 14).
+    const __m128i indexScale = _mm_set1_epi32(1 | ((1 << 14) << 16));
+
+    int32_t index[8];
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8, raw += 8 * step)
+    {
+        // For each pixel, even holds bytes 0 and 1, odd holds bytes 2 and 3.
+        __m128i even;
+        __m128i odd;
+        if (step == 2)
+        {
+            // Pixel words overlap, so offset loads give both halves.
+            even = _mm_loadu_si128((const __m128i*)raw);
+            odd = _mm_loadu_si128((const __m128i*)(raw + 2));
+        }
+        else
+        {
+            __m128i first;
+            __m128i second;
+            if (step == 4)
+            {
+                first = _mm_loadu_si128((const __m128i*)raw);
+                second = _mm_loadu_si128((const __m128i*)(raw + 16));
+            }
+            else
+            {
+                first = _mm_set_epi32(loadPixelWord(raw + 3 * step),
+                                      loadPixelWord(raw + 2 * step),
+                                      loadPixelWord(raw + step),
+                                      loadPixelWord(raw));
+                second = _mm_set_epi32(loadPixelWord(raw + 7 * step),
+                                       loadPixelWord(raw + 6 * step),
+                                       loadPixelWord(raw + 5 * step),
+                                       loadPixelWord(raw + 4 * step));
+            }
+            even = packLow16(first, second);
+            odd = packHigh16(first, second);
+        }
+
+        __m128i y = _mm_and_si128(even, lowByte);
+        __m128i byte1 = _mm_srli_epi16(even, 8);
+        __m128i byte3 = _mm_srli_epi16(odd, 8);
+        __m128i u = _mm_or_si128(_mm_andnot_si128(yvu, byte1),
+                                 _mm_and_si128(yvu, byte3));
+        __m128i v = _mm_or_si128(_mm_andnot_si128(yvu, byte3),
+                                 _mm_and_si128(yvu, byte1));
+
+        // The y and u part of the index fits in 14 bits, and v in 7, so both
+        // halves fit a signed 16 bit lane until they are combined.
+        __m128i lo = _mm_or_si128(_mm_slli_epi16(_mm_srli_epi16(u, 1), 7),
+                                  _mm_srli_epi16(y, 1));
+        __m128i hi = _mm_srli_epi16(v, 1);
+
+        _mm_storeu_si128((__m128i*)index, _mm_madd_epi16(
+            _mm_unpacklo_epi16(lo, hi), indexScale));
+        _mm_storeu_si128((__m128i*)(index + 4), _mm_madd_epi16(
+            _mm_unpackhi_epi16(lo, hi), indexScale));
+
+        for (int lane = 0; lane < 8; ++lane)
+            out[i + lane] = (Colour) nnmc[index[lane]];
+    }
+
+    classifyRunScalar(nnmc, raw, step, out + i, n - i);
+}
+
+#endif // __SSE2__
@@ -0,0 +1,44 @@
+#ifndef PERCEPTION_VISION_COLOUR_CLASSIFYRUN_H_
+#define PERCEPTION_VISION_COLOUR_CLASSIFYRUN_H_
+
+#include <stdint.h>
+
+#include "perception/vision/VisionDefinitions.hpp"
+
+/**
+ * Classify a run of n pixels of a YUV422 image through a 128x128x128 colour
+ * lookup table laid out like ColourTable::nnmc, i.e. indexed by
+ * ((v >> 1) << 14) | ((u >> 1) << 7) | (y >> 1).
+ *
+ * raw points at the Y byte of the first pixel, and consecutive pixels are
+ * step bytes apart (twice the fovea density). Pixels are decoded exactly as
+ * GreenYUVClassifier::classifyTop does, so a pixel on the second Y of a
+ * macropixel takes its U from the following macropixel.
+ */
+void classifyRunScalar(const uint8_t *nnmc, const uint8_t *raw, int step,
+                       Colour *out, int n);
+
+#ifdef __SSE2__
+/**
+ * SSE2 version of classifyRunScalar. Decodes and builds lookup table indices
+ * for eight pixels at a time, the lookups themselves are still scalar as
+ * there is no gather instruction. Produces identical output and reads no
+ * bytes the scalar version doesn't.
+ */
+void classifyRunSSE2(const uint8_t *nnmc, const uint8_t *raw, int step,
+                     Colour *out, int n);
+#endif
+
+/**
+ * Classify a run with the fastest version available on this target.
+ */
+inline void classifyRun(const uint8_t *nnmc, const uint8_t *raw, int step,
+                        Colour *out, int n) {
+#ifdef __SSE2__
+    classifyRunSSE2(nnmc, raw, step, out, n);
+#else
+    classifyRunScalar(nnmc, raw, step, out, n);
+#endif
+}
+
+#endif
@@ -15,6 +15,36 @@ public:
     virtual Colour classifyTop(const uint8_t *pixel) const = 0;
     virtual Colour classifyBot(const uint8_t *pixel) const = 0;
 
+    /**
+     * Classify n pixels starting at raw, step bytes apart, into out.
+     * Subclasses can override these with a vectorised version, which must
+     * give the same result as calling classifyTop/classifyBot per pixel.
+     */
+    virtual void classifyTopRun(const uint8_t *raw, int step, Colour *out,
+        int n) const {
+        for (int i = 0; i < n; ++i, raw += step)
+            out[i] = classifyTop(raw);
+    }
+    virtual void classifyBotRun(const uint8_t *raw, int step, Colour *out,
+        int n) const {
+        for (int i = 0; i < n; ++i, raw += step)
+            out[i] = classifyBot(raw);
+    }
+
+    /**
+     * Keep the current lookup table alive until unpinTable. Any table
+     * classified against must be pinned by the caller, e.g. for a whole
+     * frame, if the calibration may be changed from another thread.
+     */
+    virtual void pinTable() const {}
+    virtual void unpinTable() const {}
+
+    /**
+     * Changes whenever the colour of any pixel value may have changed, so
+     * cached classifications can be invalidated.
+     */
+    virtual uint32_t tableVersion() const { return 0; }
+
     virtual void sampleImageScanLines(const uint8_t* image, bool top, int n_rows, int n_cols,
         const VisionInfoIn& info_in, int stepsize) = 0;
     virtual void loadNnmc(std::string filename) = 0;
@@ -26,4 +56,21 @@ public:
 
 };
 
+/**
+ * Pins a classifier's lookup table for the lifetime of this object
+ */
+class ColourTablePin {
+public:
+    explicit ColourTablePin(const ColourClassifier &classifier)
+        : classifier_(classifier) {
+        classifier_.pinTable();
+    }
+    ~ColourTablePin() {
+        classifier_.unpinTable();
+    }
+
+private:
+    const ColourClassifier &classifier_;
+};
+
 #endif
@@ -0,0 +1,49 @@
+#include "perception/vision/colour/ColourTable.hpp"
+
+#include <cstring>
+
+ColourTable::ColourTable(bool packed_lut)
+    : packed_lut_(packed_lut), refs_(1)
+{
+    // packed_ starts out all background too
+    memset(nnmc, cBACKGROUND, sizeof(nnmc));
+}
+
+ColourTable::ColourTable(const ColourTable &other)
+    : packed_lut_(other.packed_lut_), packed_(other.packed_), refs_(1)
+{
+    memcpy(nnmc, other.nnmc, sizeof(nnmc));
+}
+
+ColourTable::~ColourTable()
+{
+}
+
+void ColourTable::ref() const
+{
+    __sync_fetch_and_add(&refs_, 1);
+}
+
+void ColourTable::unref() const
+{
+    if (__sync_sub_and_fetch(&refs_, 1) == 0) {
+        delete this;
+    }
+}
+
+bool ColourTable::shared() const
+{
+    return __sync_fetch_and_add(&refs_, 0) > 1;
+}
+
+bool ColourTable::sameColours(const ColourTable &other) const
+{
+    return this == &other || memcmp(nnmc, other.nnmc, sizeof(nnmc)) == 0;
+}
+
+void ColourTable::update()
+{
+    if (packed_lut_) {
+        packed_.build(nnmc);
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef PERCEPTION_VISION_COLOUR_COLOURTABLE_H_
+#define PERCEPTION_VISION_COLOUR_COLOURTABLE_H_
+
+#include <stdint.h>
+
+#include "perception/vision/VisionDefinitions.hpp"
+#include "perception/vision/colour/ClassifyRun.hpp"
+#include "perception/vision/colour/PackedColourTable.hpp"
+
+#define COLOUR_TABLE_SIZE (128 * 128 * 128)
+
+/**
+ * A reference counted colour lookup table, shared by every
+ * GreenYUVClassifier using the same calibration.
+ *
+ * Tables are never written once published. A classifier that changes its
+ * calibration copies the table, edits the copy and then swaps it in, so
+ * other holders (e.g. the other camera) keep the table they had.
+ */
+class ColourTable {
+public:
+    /**
+     * A table classifying everything as background, with one reference.
+     */
+    explicit ColourTable(bool packed_lut);
+
+    /**
+     * A copy of other with one reference, for editing before publishing.
+     */
+    ColourTable(const ColourTable &other);
+
+    /**
+     * Take another reference to this table.
+     */
+    void ref() const;
+
+    /**
+     * Drop a reference, deleting the table when the last one is dropped.
+     */
+    void unref() const;
+
+    /**
+     * Whether more than one holder references this table.
+     */
+    bool shared() const;
+
+    /**
+     * Whether this table classifies every value the same as other.
+     */
+    bool sameColours(const ColourTable &other) const;
+
+    /**
+     * Rebuild derived tables after writing to nnmc, before publishing.
+     */
+    void update();
+
+    inline Colour lookup(uint8_t y, uint8_t u, uint8_t v) const {
+        if (packed_lut_)
+            return packed_.lookup(y, u, v);
+        return (Colour) nnmc[((v >> 1) << 14) | ((u >> 1) << 7) | (y >> 1)];
+    }
+
+    inline void classifyRun(const uint8_t *raw, int step, Colour *out,
+        int n) const {
+        if (packed_lut_)
+            packed_.classifyRun(raw, step, out, n);
+        else
+            ::classifyRun(nnmc, raw, step, out, n);
+    }
+
+    /**
+     * The dense table, indexed by
+     * ((v >> 1) << 14) | ((u >> 1) << 7) | (y >> 1). This is the master
+     * copy that calibration edits and nnmc files hold.
+     */
+    uint8_t nnmc[COLOUR_TABLE_SIZE];
+
+private:
+    // Tables are only deleted through unref
+    ~ColourTable();
+    ColourTable &operator=(const ColourTable &);
+
+    // Whether to classify with packed_ rather than nnmc
+    bool packed_lut_;
+
+    // Compact copy of nnmc that fits in L2 cache
+    PackedColourTable packed_;
+
+    mutable volatile int refs_;
+};
+
+#endif
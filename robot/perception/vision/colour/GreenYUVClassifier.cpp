@@ -1,5 +1,8 @@
 #include "perception/vision/colour/GreenYUVClassifier.hpp"
 
+#include <algorithm>
+#include <unistd.h>
+
 // Consider just adjacent neighbours (not diagonal)
 static const int di[] = { 0, 0, 0, 0,-1, 1};
 static const int dj[] = { 0, 0,-1, 1, 0, 0};
@@ -17,22 +20,13 @@ static const char bzip_magic[] = {'B', 'Z', 'h'};
 GreenYUVClassifier::GreenYUVClassifier(bool run_colour_calibration,
     bool load_nnmc,
     bool save_nnmc,
-    std::string nnmc_filename) : run_colour_calibration_(run_colour_calibration), save_nnmc_(save_nnmc) {
-    yuv_counts_ = std::vector< std::vector < std::vector <int> > > (Y_RANGE >> Y_BITSHIFT,
-                    std::vector < std::vector <int> > (U_RANGE >> U_BITSHIFT, 
-                        std::vector <int> (V_RANGE >> V_BITSHIFT, 0)));
-
-    is_white_ = std::vector< std::vector < std::vector <bool> > > (Y_RANGE >> Y_BITSHIFT,
-                    std::vector < std::vector <bool> > (U_RANGE >> U_BITSHIFT, 
-                        std::vector <bool> (V_RANGE >> V_BITSHIFT, false)));
-
-    is_green_ = std::vector< std::vector < std::vector <bool> > > (Y_RANGE >> Y_BITSHIFT,
-                    std::vector < std::vector <bool> > (U_RANGE >> U_BITSHIFT, 
-                        std::vector <bool> (V_RANGE >> V_BITSHIFT, false)));
-
-    is_black_ = std::vector< std::vector < std::vector <bool> > > (Y_RANGE >> Y_BITSHIFT,
-                    std::vector < std::vector <bool> > (U_RANGE >> U_BITSHIFT, 
-                        std::vector <bool> (V_RANGE >> V_BITSHIFT, false)));
+    std::string nnmc_filename,
+    bool packed_lut) : table_(new ColourTable(packed_lut)), readers_(0), table_version_(0), packed_lut_(packed_lut), run_colour_calibration_(run_colour_calibration), save_nnmc_(save_nnmc) {
+    const int num_bins = (Y_RANGE >> Y_BITSHIFT) * (U_RANGE >> U_BITSHIFT) *
+        (V_RANGE >> V_BITSHIFT);
+    is_white_.assign(num_bins, false);
+    is_green_.assign(num_bins, false);
+    is_black_.assign(num_bins, false);
 
     // Just so we don't load up an nnmc
 
@@ -52,25 +46,36 @@ GreenYUVClassifier::GreenYUVClassifier(bool run_colour_calibration,
     else {
         nnmc_loaded_ = false;
 
+        ColourTable *table = new ColourTable(packed_lut_);
+        uint8_t *nnmc = table->nnmc;
         for (uint8_t y = 0; y < (Y_RANGE >> Y_BITSHIFT); y++) {
             for (uint8_t u = 0; u < (U_RANGE >> U_BITSHIFT); u++) {
                 for (uint8_t v = 0; v < (V_RANGE >> V_BITSHIFT); v++) {
                     if (isWhite(y << Y_BITSHIFT, u << U_BITSHIFT,
                             v << V_BITSHIFT)) {
-                        nnmc_[(v << (Y_MAX_POW + U_MAX_POW)) | 
+                        nnmc[(v << (Y_MAX_POW + U_MAX_POW)) | 
                             (u << Y_MAX_POW) | y] = (uint8_t) cWHITE;
                     }
                     else {
-                        nnmc_[(v << (Y_MAX_POW + U_MAX_POW)) | 
+                        nnmc[(v << (Y_MAX_POW + U_MAX_POW)) | 
                             (u << Y_MAX_POW) | y] = (uint8_t) cBACKGROUND;
                     }
                 }
             }
         }
+        table->update();
+        publishTable_(table);
     } 
 }
 
+GreenYUVClassifier::~GreenYUVClassifier() {
+    table_->unref();
+}
+
 void GreenYUVClassifier::classifyYUV(uint8_t y, uint8_t u, uint8_t v, Colour colour, int radius) {
+    ColourTable *table = new ColourTable(*table_);
+    uint8_t *nnmc = table->nnmc;
+
     uint8_t min_y = std::max((y - radius) >> Y_BITSHIFT, 0);
     uint8_t max_y = std::min((y + radius) >> Y_BITSHIFT, (Y_RANGE - 1) >> Y_BITSHIFT);
     uint8_t min_u = std::max((u - radius) >> U_BITSHIFT, 0);
@@ -81,11 +86,13 @@ void GreenYUVClassifier::classifyYUV(uint8_t y, uint8_t u, uint8_t v, Colour col
     for (uint8_t y = min_y; y <= max_y; y++) {
         for (uint8_t u = min_u; u <= max_u; u++) {
             for (uint8_t v = min_v; v <= max_v; v++) {
-                nnmc_[(v << (Y_MAX_POW + U_MAX_POW)) | 
+                nnmc[(v << (Y_MAX_POW + U_MAX_POW)) | 
                     (u << Y_MAX_POW) | y] = (uint8_t) colour;
             }
         }
     }
+    table->update();
+    publishTable_(table);
 }
 
 void GreenYUVClassifier::sampleImageScanLines(const uint8_t* image, bool top, int n_rows, int n_cols, 
@@ -186,7 +193,7 @@ void GreenYUVClassifier::sampleImageScanLines(const uint8_t* image, bool top, in
            int v_val = getv(image, y_pos, x_pos, n_cols);
 
            //q_image->setPixel(x_pos, y_pos, QColor("green").rgb()); 
-           is_green_[y_val >> Y_BITSHIFT][u_val >> U_BITSHIFT][v_val >> V_BITSHIFT] = true;
+           is_green_[binIndex(y_val >> Y_BITSHIFT, u_val >> U_BITSHIFT, v_val >> V_BITSHIFT)] = true;
         }
         else {
             int grad_y = calculate_gradient(image, y_pos, x_pos, n_cols, grad_op, &gety, stepsize);
@@ -287,14 +294,14 @@ void GreenYUVClassifier::sampleImageScanLines(const uint8_t* image, bool top, in
                if (!isEdge) {
                   if (detectingGreen) {
                      //q_image->setPixel(x_pos, y_pos, QColor("green").rgb()); 
-                     is_green_[y_val >> Y_BITSHIFT][u_val >> U_BITSHIFT][v_val >> V_BITSHIFT] = true;
-                     is_white_[y_val >> Y_BITSHIFT][u_val >> U_BITSHIFT][v_val >> V_BITSHIFT] = false;
+                     is_green_[binIndex(y_val >> Y_BITSHIFT, u_val >> U_BITSHIFT, v_val >> V_BITSHIFT)] = true;
+                     is_white_[binIndex(y_val >> Y_BITSHIFT, u_val >> U_BITSHIFT, v_val >> V_BITSHIFT)] = false;
                      lastGreenY = y_val;
                   }
                   else {
                      //q_image->setPixel(x_pos, y_pos, QColor("white").rgb()); 
-                     is_white_[y_val >> Y_BITSHIFT][u_val >> U_BITSHIFT][v_val >> V_BITSHIFT] = true;
-                     is_green_[y_val >> Y_BITSHIFT][u_val >> U_BITSHIFT][v_val >> V_BITSHIFT] = false;
+                     is_white_[binIndex(y_val >> Y_BITSHIFT, u_val >> U_BITSHIFT, v_val >> V_BITSHIFT)] = true;
+                     is_green_[binIndex(y_val >> Y_BITSHIFT, u_val >> U_BITSHIFT, v_val >> V_BITSHIFT)] = false;
                   }
                }
                else {
@@ -557,17 +564,10 @@ void GreenYUVClassifier::draw_edge(const uint8_t* image, int n_rows, int n_col,
 }
 
 void GreenYUVClassifier::resetNnmc() {
-    for (uint8_t y = 0; y < (Y_RANGE >> Y_BITSHIFT); y++) {
-        for (uint8_t u = 0; u < (U_RANGE >> U_BITSHIFT); u++) {
-            for (uint8_t v = 0; v < (V_RANGE >> V_BITSHIFT); v++) {
-                nnmc_[(v << (Y_MAX_POW + U_MAX_POW)) | 
-                    (u << Y_MAX_POW) | y] = (uint8_t) cBACKGROUND;
-                is_green_[y][u][v] = false;
-                is_white_[y][u][v] = false;
-                is_black_[y][u][v] = false;
-            }
-        } 
-    } 
+    publishTable_(new ColourTable(packed_lut_));
+    std::fill(is_green_.begin(), is_green_.end(), false);
+    std::fill(is_white_.begin(), is_white_.end(), false);
+    std::fill(is_black_.begin(), is_black_.end(), false);
 }
 
 void GreenYUVClassifier::sampleImage(const uint8_t* image, bool top, int n_rows, int n_cols, 
@@ -576,14 +576,13 @@ void GreenYUVClassifier::sampleImage(const uint8_t* image, bool top, int n_rows,
 
     if ((top && fabs(head_yaw) < M_PI / 6) || 
             (!top && fabs(head_yaw) < M_PI / 4)) {
-        if (!first_sample_) {
-            for (unsigned int y = 0; y < yuv_counts_.size(); y++) {
-                for (unsigned int u = 0; u < yuv_counts_[0].size(); u++) {
-                    for (unsigned int v = 0; v < yuv_counts_[0][0].size(); v++) {
-                        yuv_counts_[y][u][v] = 0;
-                    }
-                }
-            } 
+        // The histogram is only allocated once we calibrate, most
+        // classifiers never need it
+        if (yuv_counts_.empty()) {
+            yuv_counts_.assign(is_green_.size(), 0);
+        }
+        else if (!first_sample_) {
+            std::fill(yuv_counts_.begin(), yuv_counts_.end(), 0);
         }
 
         int start_y, end_y, start_x, end_x, inc;
@@ -622,7 +621,7 @@ void GreenYUVClassifier::sampleImage(const uint8_t* image, bool top, int n_rows,
                 y_sum_ += y_val;
                 y_sampled_++;
 
-                yuv_counts_[y_val >> Y_BITSHIFT][u_val >> U_BITSHIFT][v_val >> V_BITSHIFT]++;
+                yuv_counts_[binIndex(y_val >> Y_BITSHIFT, u_val >> U_BITSHIFT, v_val >> V_BITSHIFT)]++;
             }
         }
 
@@ -671,17 +670,13 @@ double GreenYUVClassifier::getCoverage() {
     double coverage = 0;
     max_peak_count_ = 0;
 
-    for (unsigned int y = 0; y < yuv_counts_.size(); y++) {
-        for (unsigned int u = 0; u < yuv_counts_[0].size(); u++) {
-            for (unsigned int v = 0; v < yuv_counts_[0][0].size(); v++) {
-                if (yuv_counts_[y][u][v] > max_peak_count_) {
-                    max_peak_count_ = yuv_counts_[y][u][v];
-                } 
+    for (unsigned int bin = 0; bin < yuv_counts_.size(); bin++) {
+        if (yuv_counts_[bin] > max_peak_count_) {
+            max_peak_count_ = yuv_counts_[bin];
+        } 
 
-                if (is_green_[y][u][v]) {
-                    coverage += yuv_counts_[y][u][v];
-                }
-            }
+        if (is_green_[bin]) {
+            coverage += yuv_counts_[bin];
         }
     } 
 
@@ -694,18 +689,14 @@ double GreenYUVClassifier::expandVerticalPeak(double coverage, bool new_peak) {
         YUVTriple max_peak_bin(-1, -1, -1);
         max_peak_count_ = 0;
 
-        for (unsigned int y = 0; y < yuv_counts_.size(); y++) {
-            for (unsigned int u = 0; u < yuv_counts_[0].size(); u++) {
-                for (unsigned int v = 0; v < yuv_counts_[0][0].size(); v++) {
-                    if (!is_green_[y][u][v] && yuv_counts_[y][u][v] > max_peak_count_) {
-                        max_peak_bin.y_ = y;
-                        max_peak_bin.u_ = u; 
-                        max_peak_bin.v_ = v; 
+        for (unsigned int bin = 0; bin < yuv_counts_.size(); bin++) {
+            if (!is_green_[bin] && yuv_counts_[bin] > max_peak_count_) {
+                max_peak_bin.y_ = bin >> (U_MAX_POW + V_MAX_POW);
+                max_peak_bin.u_ = (bin >> V_MAX_POW) & ((1 << U_MAX_POW) - 1); 
+                max_peak_bin.v_ = bin & ((1 << V_MAX_POW) - 1); 
 
-                        max_peak_count_ = yuv_counts_[y][u][v];
-                    } 
-                }
-            }
+                max_peak_count_ = yuv_counts_[bin];
+            } 
         } 
 
         YUV_candidate_list_.push_back(max_peak_bin);;
@@ -729,12 +720,12 @@ double GreenYUVClassifier::expandVerticalPeak(double coverage, bool new_peak) {
         while (it != YUV_candidate_list_.end()) {
             // We need to do this check because although when a bucket was added, it may not have been green
             // So may be added twice
-            if (is_green_[it->y_][it->u_][it->v_]) {
+            if (is_green_[binIndex(it->y_, it->u_, it->v_)]) {
                 it = YUV_candidate_list_.erase(it);
             }
-            else if (yuv_counts_[it->y_][it->u_][it->v_] >= curr_peak_thresh) {
-                is_green_[it->y_][it->u_][it->v_] = true;
-                validated_count += yuv_counts_[it->y_][it->u_][it->v_];
+            else if (yuv_counts_[binIndex(it->y_, it->u_, it->v_)] >= curr_peak_thresh) {
+                is_green_[binIndex(it->y_, it->u_, it->v_)] = true;
+                validated_count += yuv_counts_[binIndex(it->y_, it->u_, it->v_)];
 
                 if (validated_count > target_count) {
                     return 1.0 * validated_count / total_count_;
@@ -745,7 +736,7 @@ double GreenYUVClassifier::expandVerticalPeak(double coverage, bool new_peak) {
                 for (unsigned int j = 0; j < neighbours.size(); j++) {
                     YUVTriple curr_neigh = neighbours[j];
 
-                    if (!is_green_[curr_neigh.y_][curr_neigh.u_][curr_neigh.v_]) {
+                    if (!is_green_[binIndex(curr_neigh.y_, curr_neigh.u_, curr_neigh.v_)]) {
                         YUV_candidate_list_.push_back(curr_neigh);
                     }
                 }
@@ -765,69 +756,45 @@ double GreenYUVClassifier::expandVerticalPeak(double coverage, bool new_peak) {
 }
 
 void GreenYUVClassifier::fillPoints(bool isGreen) {
-    std::vector< std::vector < std::vector <bool> > > *classif;
+    std::vector <bool> &classif = isGreen ? is_green_ : is_white_;
 
-    if (isGreen) {
-        classif = &is_green_;
-    }
-    else {
-        classif = &is_white_;
-    }
-
-    // Fill in for v, u, then y axis
-    unsigned int y, u, v;
-    unsigned int start, end;
+    const int y_size = Y_RANGE >> Y_BITSHIFT;
+    const int u_size = U_RANGE >> U_BITSHIFT;
+    const int v_size = V_RANGE >> V_BITSHIFT;
 
-    // Fill in v
-    for (y = 0; y < (*classif).size(); y++) {
-        for (u = 0; u < (*classif)[0].size(); u++) {
-            for (v = 0; v < (*classif)[0][0].size() && !(*classif)[y][u][v]; v++) {}
+    // Distance between neighbouring bins along each axis
+    const int y_stride = binIndex(1, 0, 0);
+    const int u_stride = binIndex(0, 1, 0);
+    const int v_stride = binIndex(0, 0, 1);
 
-            start = v;
-
-            for (v = (*classif)[0][0].size() - 1; v > start && !(*classif)[y][u][v]; v--) {}
-
-            end = v;
-
-            for (v = start; v <= end; v++) {
-                (*classif)[y][u][v] = true;
-            }
-        }
-    }         
-
-    // Fill in u
-    for (y = 0; y < (*classif).size(); y++) {
-        for (v = 0; v < (*classif)[0][0].size(); v++) {
-            for (u = 0; u < (*classif)[0].size() && !(*classif)[y][u][v]; u++) {}
-
-            start = u;
-
-            for (u = (*classif)[0].size() - 1; u > start && !(*classif)[y][u][v]; u--) {}
+    // Fill in for v, u, then y axis
+    fillLines(classif, v_size, v_stride, y_size, y_stride, u_size, u_stride);
+    fillLines(classif, u_size, u_stride, y_size, y_stride, v_size, v_stride);
+    fillLines(classif, y_size, y_stride, u_size, u_stride, v_size, v_stride);
+}
 
-            end = u;
+void GreenYUVClassifier::fillLines(std::vector <bool> &classif,
+        int size, int stride, int outer_size, int outer_stride,
+        int inner_size, int inner_stride) {
+    int start, end, i;
 
-            for (u = start; u <= end; u++) {
-                (*classif)[y][u][v] = true;
-            }
-        }
-    }  
+    for (int outer = 0; outer < outer_size; outer++) {
+        for (int inner = 0; inner < inner_size; inner++) {
+            const int line = outer * outer_stride + inner * inner_stride;
 
-    // Fill in y
-    for (u = 0; u < (*classif)[0].size(); u++) {
-        for (v = 0; v < (*classif)[0][0].size(); v++) {
-            for (y = 0; y < (*classif).size() && !(*classif)[y][u][v]; y++) {}
+            for (i = 0; i < size && !classif[line + i * stride]; i++) {}
 
-            start = y;
+            start = i;
 
-            for (y = (*classif).size() - 1; y > start && !(*classif)[y][u][v]; y--) {}
+            for (i = size - 1; i > start && !classif[line + i * stride]; i--) {}
 
-            end = y;
+            end = i;
 
-            for (y = start; y <= end; y++) {
-                (*classif)[y][u][v] = true;
+            for (i = start; i <= end; i++) {
+                classif[line + i * stride] = true;
             }
         }
-    }  
+    }
 }
 
 std::vector< YUVTriple > GreenYUVClassifier::getBinNeighbours(const YUVTriple &yuv) {
@@ -849,31 +816,37 @@ bool GreenYUVClassifier::amWalking(const ActionCommand::All &commands) {
 }
 
 void GreenYUVClassifier::saveClassification(void) {
+    // Every entry is rewritten, so start from a fresh table
+    ColourTable *table = new ColourTable(packed_lut_);
+    uint8_t *nnmc = table->nnmc;
+
     for (uint8_t y = 0; y < (Y_RANGE >> Y_BITSHIFT); y++) {
         for (uint8_t u = 0; u < (U_RANGE >> U_BITSHIFT); u++) {
             for (uint8_t v = 0; v < (V_RANGE >> V_BITSHIFT); v++) {
                 if (isGreen(y << Y_BITSHIFT, u << U_BITSHIFT, 
                         v << V_BITSHIFT, true)) {
-                    nnmc_[(v << (Y_MAX_POW + U_MAX_POW)) | 
+                    nnmc[(v << (Y_MAX_POW + U_MAX_POW)) | 
                         (u << Y_MAX_POW) | y] = (uint8_t) cGREEN;
                 } 
                 else if (isWhite(y << Y_BITSHIFT, 
                         u << U_BITSHIFT, v << V_BITSHIFT)) {
-                    nnmc_[(v << (Y_MAX_POW + U_MAX_POW)) | 
+                    nnmc[(v << (Y_MAX_POW + U_MAX_POW)) | 
                         (u << Y_MAX_POW) | y] = (uint8_t) cWHITE;
                 }
                 else if (isBlack(y << Y_BITSHIFT, 
                         u << U_BITSHIFT, v << V_BITSHIFT)) {
-                    nnmc_[(v << (Y_MAX_POW + U_MAX_POW)) | 
+                    nnmc[(v << (Y_MAX_POW + U_MAX_POW)) | 
                         (u << Y_MAX_POW) | y] = (uint8_t) cBLACK;
                 }
                 else {
-                    nnmc_[(v << (Y_MAX_POW + U_MAX_POW)) | 
+                    nnmc[(v << (Y_MAX_POW + U_MAX_POW)) | 
                         (u << Y_MAX_POW) | y] = (uint8_t) cBACKGROUND;
                 }
             }
         } 
     } 
+    table->update();
+    publishTable_(table);
 }
 
 void GreenYUVClassifier::saveNnmc(std::string filename) {
@@ -883,7 +856,7 @@ void GreenYUVClassifier::saveNnmc(std::string filename) {
     if (! bzerror == BZ_OK) {
         throw std::runtime_error("error opening nnmc file for compression");
     }
-    BZ2_bzWrite (&bzerror, bf, &nnmc_, sizeof (nnmc_));
+    BZ2_bzWrite (&bzerror, bf, table_->nnmc, sizeof (table_->nnmc));
     if (! bzerror == BZ_OK) {
         throw std::runtime_error("error compressing nnmc file");
     }
@@ -898,9 +871,11 @@ void GreenYUVClassifier::loadNnmc(std::string filename) {
     size_t nnmc_size = (Y_RANGE >> Y_BITSHIFT) * (U_RANGE >> U_BITSHIFT) *
         (V_RANGE >> V_BITSHIFT);
     FILE *f = fopen(filename.c_str(), "rb");
+    ColourTable *table = new ColourTable(packed_lut_);
 
     char magic[ sizeof (bzip_magic) ];
     if (fread(magic, 1, sizeof(magic), f) != sizeof(magic)) {
+        table->unref();
         throw std::runtime_error("error openning nnmc file");
     }
     fseek(f, 0, SEEK_SET);
@@ -913,23 +888,28 @@ void GreenYUVClassifier::loadNnmc(std::string filename) {
         int bzerror;
         BZFILE *bf = BZ2_bzReadOpen(&bzerror, f, 0, 0, 0, 0);
         if (! bzerror == BZ_OK) {
+           table->unref();
            throw std::runtime_error("error openning nnmc file for decompression");
         }
-        BZ2_bzRead (&bzerror, bf, nnmc_, nnmc_size);
+        BZ2_bzRead (&bzerror, bf, table->nnmc, nnmc_size);
         if (! bzerror == BZ_OK && ! bzerror == BZ_STREAM_END) {
+            table->unref();
             throw std::runtime_error("error decompressing nnmc file");
         }
         BZ2_bzReadClose(&bzerror, bf);
         if (! bzerror == BZ_OK) {
+           table->unref();
            throw std::runtime_error("error closing nnmc file");
         }
     } 
     else {
         /* Read uncompressed file, faster loading */
         size_t ret;
-        ret = fread(nnmc_, nnmc_size, 1, f);
+        ret = fread(table->nnmc, nnmc_size, 1, f);
     }
     fclose(f);
+    table->update();
+    publishTable_(table);
 
     /*
     // For converting between old and new nnmc (since we have changed cPLANE_COLOURS)
@@ -962,22 +942,71 @@ void GreenYUVClassifier::loadNnmc(std::string filename) {
 }
 
 void GreenYUVClassifier::updateColours() {
+    const uint8_t *nnmc = table_->nnmc;
+
     for (uint8_t y = 0; y < (Y_RANGE >> Y_BITSHIFT); y++) {
         for (uint8_t u = 0; u < (U_RANGE >> U_BITSHIFT); u++) {
             for (uint8_t v = 0; v < (V_RANGE >> V_BITSHIFT); v++) {
-                if (nnmc_[(v << (Y_MAX_POW + U_MAX_POW)) |
+                if (nnmc[(v << (Y_MAX_POW + U_MAX_POW)) |
                         (u << Y_MAX_POW) | y] == (uint8_t) cGREEN) {
-                    is_green_[y][u][v] = true;
+                    is_green_[binIndex(y, u, v)] = true;
                 }
-                else if (nnmc_[(v << (Y_MAX_POW + U_MAX_POW)) |
+                else if (nnmc[(v << (Y_MAX_POW + U_MAX_POW)) |
                         (u << Y_MAX_POW) | y] == (uint8_t) cWHITE) {
-                    is_white_[y][u][v] = true;
+                    is_white_[binIndex(y, u, v)] = true;
                 }
-                else if (nnmc_[(v << (Y_MAX_POW + U_MAX_POW)) |
+                else if (nnmc[(v << (Y_MAX_POW + U_MAX_POW)) |
                         (u << Y_MAX_POW) | y] == (uint8_t) cBLACK) {
-                    is_black_[y][u][v] = true;
+                    is_black_[binIndex(y, u, v)] = true;
                 }
             }
         } 
     } 
 }
+
+void GreenYUVClassifier::pinTable() const {
+    __sync_fetch_and_add(&readers_, 1);
+}
+
+void GreenYUVClassifier::unpinTable() const {
+    __sync_fetch_and_sub(&readers_, 1);
+}
+
+void GreenYUVClassifier::setNnmc(const uint8_t *nnmc) {
+    ColourTable *table = new ColourTable(packed_lut_);
+    memcpy(table->nnmc, nnmc, sizeof(table->nnmc));
+    table->update();
+    publishTable_(table);
+}
+
+void GreenYUVClassifier::shareTable(const GreenYUVClassifier &other) {
+    if (sharesTable(other)) {
+        return;
+    }
+    other.table_->ref();
+    publishTable_(other.table_);
+}
+
+bool GreenYUVClassifier::sameTable(const GreenYUVClassifier &other) const {
+    return table_->sameColours(*other.table_);
+}
+
+bool GreenYUVClassifier::sharesTable(const GreenYUVClassifier &other) const {
+    return table_ == other.table_;
+}
+
+void GreenYUVClassifier::publishTable_(ColourTable *table) {
+    ColourTable *old = table_;
+
+    // table must be complete before any reader can see it
+    __sync_synchronize();
+    table_ = table;
+    __sync_fetch_and_add(&table_version_, 1);
+
+    // A reader pins before loading table_, so once there are no pinned
+    // readers nobody can still hold old. Readers only pin for a frame.
+    while (__sync_fetch_and_add(&readers_, 0) != 0) {
+        usleep(500);
+    }
+    old->unref();
+}
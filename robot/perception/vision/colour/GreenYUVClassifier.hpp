@@ -4,6 +4,7 @@
 #include "perception/vision/other/otsu.hpp"
 #include "perception/vision/other/YUV.hpp"
 #include "perception/vision/colour/ColourClassifierInterface.hpp"
+#include "perception/vision/colour/ColourTable.hpp"
 #include "perception/vision/VisionDefinitions.hpp"
 #include "types/VisionInfoIn.hpp"
 #include "types/JointValues.hpp"
@@ -48,7 +49,10 @@ public:
     GreenYUVClassifier(bool run_colour_calibration,
         bool load_nnmc,
         bool save_nnmc,
-        std::string nnmc_filename);
+        std::string nnmc_filename,
+        bool packed_lut = false);
+
+    ~GreenYUVClassifier();
 
     /*
      * Classify first sees if the pixel isGreen. If not, then it sees if the pixel isWhite.
@@ -72,8 +76,7 @@ public:
             u = pixel[1];
         }
 
-        return (Colour) nnmc_[((v >> V_BITSHIFT) << (Y_MAX_POW + U_MAX_POW)) | 
-            ((u >> U_BITSHIFT) << Y_MAX_POW) | (y >> Y_BITSHIFT)];
+        return table_->lookup(y, u, v);
     }
 
     inline Colour classifyBot(const uint8_t *pixel) const {
@@ -95,8 +98,17 @@ public:
             u = pixel[1];
         }
 
-        return (Colour) nnmc_[((v >> V_BITSHIFT) << (Y_MAX_POW + U_MAX_POW)) | 
-            ((u >> U_BITSHIFT) << Y_MAX_POW) | (y >> Y_BITSHIFT)];
+        return table_->lookup(y, u, v);
+    }
+
+    void classifyTopRun(const uint8_t *raw, int step, Colour *out,
+        int n) const {
+        table_->classifyRun(raw, step, out, n);
+    }
+
+    void classifyBotRun(const uint8_t *raw, int step, Colour *out,
+        int n) const {
+        table_->classifyRun(raw, step, out, n);
     }
 
     void sampleImageScanLines(const uint8_t* image, bool top, int n_rows, int n_cols,
@@ -136,14 +148,65 @@ public:
     int calculate_threshold(const uint8_t* image, int n_rows, int n_cols, Gradient_Operator grad_op,
         uint8_t (*getYUV)(const uint8_t*, int, int, int));
 
-    uint8_t nnmc_[(Y_RANGE >> Y_BITSHIFT) * (U_RANGE >> U_BITSHIFT) *
-        (V_RANGE >> V_BITSHIFT)];
-    
+    void pinTable() const;
+    void unpinTable() const;
+    uint32_t tableVersion() const { return table_version_; }
+
+    // The dense lookup table currently classified against
+    const uint8_t *nnmc() const { return table_->nnmc; }
+
+    // Replace the lookup table with a copy of nnmc
+    void setNnmc(const uint8_t *nnmc);
+
+    // Classify with other's lookup table, dropping ours
+    void shareTable(const GreenYUVClassifier &other);
+
+    // Whether this and other classify every value the same
+    bool sameTable(const GreenYUVClassifier &other) const;
+
+    // Whether this and other use the same lookup table
+    bool sharesTable(const GreenYUVClassifier &other) const;
+
 private:
-    std::vector< std::vector < std::vector <int> > > yuv_counts_;
-    std::vector< std::vector < std::vector <bool> > > is_white_;
-    std::vector< std::vector < std::vector <bool> > > is_green_;
-    std::vector< std::vector < std::vector <bool> > > is_black_;
+    // The published lookup table. Only ever replaced as a whole by
+    // publishTable_, so readers see either the old or the new table.
+    ColourTable *volatile table_;
+
+    // Number of readers that have pinned table_
+    mutable volatile int readers_;
+
+    // Incremented each time table_ is replaced
+    volatile uint32_t table_version_;
+
+    // Swap table in for table_, taking over its reference, then drop the
+    // old table once no reader can still be using it. Calibration edits a
+    // copy of table_ and publishes it here, so it is never written in
+    // place.
+    void publishTable_(ColourTable *table);
+
+    // Whether to build packed lookup tables
+    bool packed_lut_;
+
+    // Not copyable, a copy would share table_ without taking a reference
+    GreenYUVClassifier(const GreenYUVClassifier &);
+    GreenYUVClassifier &operator=(const GreenYUVClassifier &);
+
+    // Calibration histogram and classifications, flattened y, u, v major
+    // and indexed with binIndex. The histogram is allocated on first use.
+    std::vector <int> yuv_counts_;
+    std::vector <bool> is_white_;
+    std::vector <bool> is_green_;
+    std::vector <bool> is_black_;
+
+    // Index of a bitshifted YUV bin in the calibration arrays
+    static inline int binIndex(int y, int u, int v) {
+        return (((y << U_MAX_POW) | u) << V_MAX_POW) | v;
+    }
+
+    // Fill between the outermost set bins of every line of size bins
+    // spaced stride apart, for all lines in the outer and inner axes
+    void fillLines(std::vector <bool> &classif, int size, int stride,
+        int outer_size, int outer_stride, int inner_size, int inner_stride);
 
     long long y_sum_;
     int y_sampled_;
@@ -219,15 +282,15 @@ private:
     void classifyYUV(uint8_t y, uint8_t u, uint8_t v, Colour colour, int radius);
 
     inline bool isGreen(uint8_t y_val, uint8_t u_val, uint8_t v_val, bool top) const {
-        return is_green_[y_val >> Y_BITSHIFT][u_val >> U_BITSHIFT][v_val >> V_BITSHIFT];
+        return is_green_[binIndex(y_val >> Y_BITSHIFT, u_val >> U_BITSHIFT, v_val >> V_BITSHIFT)];
     }
 
     inline bool isBlack(uint8_t y_val, uint8_t u_val, uint8_t v_val) const {
-        return is_black_[y_val >> Y_BITSHIFT][u_val >> U_BITSHIFT][v_val >> V_BITSHIFT];
+        return is_black_[binIndex(y_val >> Y_BITSHIFT, u_val >> U_BITSHIFT, v_val >> V_BITSHIFT)];
     }
     
     inline bool isWhite(uint8_t y_val, uint8_t u_val, uint8_t v_val) const {
-        return is_white_[y_val >> Y_BITSHIFT][u_val >> U_BITSHIFT][v_val >> V_BITSHIFT];
+        return is_white_[binIndex(y_val >> Y_BITSHIFT, u_val >> U_BITSHIFT, v_val >> V_BITSHIFT)];
 
 
 
@@ -0,0 +1,80 @@
+#include "perception/vision/colour/PackedColourTable.hpp"
+
+#include <cstring>
+
+PackedColourTable::PackedColourTable()
+    : directory_(PACKED_NUM_BLOCKS, PACKED_UNIFORM | cBACKGROUND)
+{
+}
+
+void PackedColourTable::build(const uint8_t *nnmc)
+{
+    leaves_.clear();
+
+    uint8_t leaf[PACKED_BLOCK_BYTES];
+
+    for (int bv = 0; bv < (1 << PACKED_V_BLOCKS_POW); ++bv) {
+        for (int bu = 0; bu < (1 << PACKED_U_BLOCKS_POW); ++bu) {
+            for (int by = 0; by < (1 << PACKED_Y_BLOCKS_POW); ++by) {
+                memset(leaf, 0, sizeof(leaf));
+                const uint8_t first = nnmc[
+                    ((bv << PACKED_BLOCK_V_POW) << 14) |
+                    ((bu << PACKED_BLOCK_U_POW) << 7) |
+                    (by << PACKED_BLOCK_Y_POW)];
+                bool uniform = true;
+
+                int offset = 0;
+                for (int v = 0; v < (1 << PACKED_BLOCK_V_POW); ++v) {
+                    for (int u = 0; u < (1 << PACKED_BLOCK_U_POW); ++u) {
+                        const uint8_t *row = nnmc +
+                            (((bv << PACKED_BLOCK_V_POW) | v) << 14) +
+                            (((bu << PACKED_BLOCK_U_POW) | u) << 7) +
+                            (by << PACKED_BLOCK_Y_POW);
+                        for (int y = 0; y < (1 << PACKED_BLOCK_Y_POW);
+                             ++y, ++offset) {
+                            uniform &= (row[y] == first);
+                            leaf[offset >> 1] |=
+                                (row[y] & 0xF) << ((offset & 1) << 2);
+                        }
+                    }
+                }
+
+                uint16_t &entry = directory_[
+                    (bv << (PACKED_U_BLOCKS_POW + PACKED_Y_BLOCKS_POW)) |
+                    (bu << PACKED_Y_BLOCKS_POW) | by];
+                if (uniform) {
+                    entry = PACKED_UNIFORM | first;
+                } else {
+                    entry = leaves_.size() / PACKED_BLOCK_BYTES;
+                    leaves_.insert(leaves_.end(), leaf,
+                                   leaf + PACKED_BLOCK_BYTES);
+                }
+            }
+        }
+    }
+}
+
+void PackedColourTable::classifyRun(const uint8_t *raw, int step, Colour *out,
+                                    int n) const
+{
+    for (int i = 0; i < n; ++i, raw += step)
+    {
+        if ((size_t)raw & 0x2) {
+        //YV_U
+            out[i] = lookup(raw[0], raw[3], raw[1]);
+        } else {
+        //YU_V
+            out[i] = lookup(raw[0], raw[1], raw[3]);
+        }
+    }
+}
+
+size_t PackedColourTable::size() const
+{
+    return directory_.size() * sizeof(uint16_t) + leaves_.size();
+}
+
+int PackedColourTable::numLeaves() const
+{
+    return leaves_.size() / PACKED_BLOCK_BYTES;
+}
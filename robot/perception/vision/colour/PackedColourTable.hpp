@@ -0,0 +1,98 @@
+#ifndef PERCEPTION_VISION_COLOUR_PACKEDCOLOURTABLE_H_
+#define PERCEPTION_VISION_COLOUR_PACKEDCOLOURTABLE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "perception/vision/VisionDefinitions.hpp"
+
+/*
+ * The dense table is split into blocks of 4 (v) x 4 (u) x 8 (y) entries. A
+ * block packed at 4 bits per entry is 64 bytes, one cache line.
+ */
+#define PACKED_BLOCK_V_POW 2
+#define PACKED_BLOCK_U_POW 2
+#define PACKED_BLOCK_Y_POW 3
+#define PACKED_BLOCK_BYTES 64
+
+/* Number of blocks along each axis, as powers of two, of the 7 bit axes */
+#define PACKED_V_BLOCKS_POW (7 - PACKED_BLOCK_V_POW)
+#define PACKED_U_BLOCKS_POW (7 - PACKED_BLOCK_U_POW)
+#define PACKED_Y_BLOCKS_POW (7 - PACKED_BLOCK_Y_POW)
+#define PACKED_NUM_BLOCKS (1 << (PACKED_V_BLOCKS_POW + PACKED_U_BLOCKS_POW + \
+                                 PACKED_Y_BLOCKS_POW))
+
+/* Set in a block's directory entry if the whole block is one colour, which
+ * is then held in the low bits */
+#define PACKED_UNIFORM 0x8000
+
+/**
+ * A compact, two level copy of a 128x128x128 colour lookup table laid out
+ * like ColourTable::nnmc.
+ *
+ * Calibrations are mostly large areas of background and green, so most
+ * blocks of neighbouring YUV values are a single colour. Those are stored
+ * directly in a 32KB directory; only blocks straddling a colour boundary get
+ * a 64 byte leaf of 4 bit entries. A typical table is a few hundred KB
+ * rather than 2MB, so it can stay in the Atom's 512KB L2 along with the
+ * frame.
+ */
+class PackedColourTable {
+public:
+    PackedColourTable();
+
+    /**
+     * Rebuild from a dense table, indexed by
+     * ((v >> 1) << 14) | ((u >> 1) << 7) | (y >> 1).
+     */
+    void build(const uint8_t *nnmc);
+
+    /**
+     * Colour of a full range YUV value.
+     */
+    inline Colour lookup(uint8_t y, uint8_t u, uint8_t v) const {
+        // Drop the bit the dense table ignores, then split each axis into
+        // the block number and the position within the block.
+        y >>= 1;
+        u >>= 1;
+        v >>= 1;
+        uint16_t entry = directory_[
+            ((v >> PACKED_BLOCK_V_POW) << (PACKED_U_BLOCKS_POW +
+                                           PACKED_Y_BLOCKS_POW)) |
+            ((u >> PACKED_BLOCK_U_POW) << PACKED_Y_BLOCKS_POW) |
+            (y >> PACKED_BLOCK_Y_POW)];
+        if (entry & PACKED_UNIFORM)
+            return (Colour) (entry & ~PACKED_UNIFORM);
+
+        int offset =
+            ((v & ((1 << PACKED_BLOCK_V_POW) - 1)) << (PACKED_BLOCK_U_POW +
+                                                       PACKED_BLOCK_Y_POW)) |
+            ((u & ((1 << PACKED_BLOCK_U_POW) - 1)) << PACKED_BLOCK_Y_POW) |
+            (y & ((1 << PACKED_BLOCK_Y_POW) - 1));
+        uint8_t pair = leaves_[entry * PACKED_BLOCK_BYTES + (offset >> 1)];
+        return (Colour) ((pair >> ((offset & 1) << 2)) & 0xF);
+    }
+
+    /**
+     * Classify a run of n pixels of a YUV422 image, step bytes apart. Pixels
+     * are decoded as in classifyRunScalar.
+     */
+    void classifyRun(const uint8_t *raw, int step, Colour *out, int n) const;
+
+    /**
+     * Bytes used by the directory and leaves.
+     */
+    size_t size() const;
+
+    /**
+     * Number of blocks that needed a leaf.
+     */
+    int numLeaves() const;
+
+private:
+    std::vector<uint16_t> directory_;
+    std::vector<uint8_t> leaves_;
+};
+
+#endif
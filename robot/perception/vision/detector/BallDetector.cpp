@@ -7,17 +7,26 @@
 
 #include "types/RansacTypes.hpp"
 #include "types/VisionInfoOut.hpp"
-#include "types/GroupLinks.hpp"
 #include "types/Point.hpp"
 #include "types/BBox.hpp"
+#include "types/VisionInfoIn.hpp"
+#include "types/VisionInfoMiddle.hpp"
+
+#include "utils/Logger.hpp"
+#include "utils/SPLDefs.hpp"
 
 #include "soccer.hpp"
 
 #include <iostream>
 #include <math.h>
 #include <climits>
+#include <new>
 #include <vector>
 
+#include <boost/algorithm/string.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread/mutex.hpp>
+
 #define VARIANCE_CHECK_CONFORMITY_WEIGHT  1
 #define STRONG_EDGE_THRESHOLD       (500*500)
 #define MED_EDGE_THRESHOLD          (300*300)
@@ -59,6 +68,26 @@
 // detector.
 #define WHITE_HEAVY_THRESHOLD 0.05
 
+// Frames between logging how the cascade stages did and reordering them.
+#define BALL_CASCADE_WINDOW 1000
+
+// Frames before the stages are first reordered by what they were measured at.
+#define BALL_CASCADE_WARMUP 100
+
+// Frames after the last ball that detectTracked still looks for it, at
+// about the frame rate it moves the ball at.
+#define BALL_TRACK_FRAMES 10
+#define BALL_TRACK_FPS 30.0f
+
+// The smallest half width of a tracked window, and how wide a tracked window
+// can be zoomed in to before zooming in less, in region pixels.
+#define BALL_TRACK_MIN_HALF_WIDTH 16
+#define BALL_TRACK_MAX_COLS 64
+
+// The portion of the square around the fitted circle that must be classified
+// white for the whiteDensity stage. A ball's white patches fill about half.
+#define BALL_MIN_WHITE_PROPORTION 0.2
+
 //#define BALL_DETECTOR_TIMINGS 1
 //#define BALL_DEBUG 1
 #define EARLY_EXIT 1 // Find the first ball and stop.
@@ -91,6 +120,104 @@
     Timer frame_timer;
 #endif // BALL_DETECTOR_TIMINGS
 
+// Candidates evaluated in parallel share the frame arena.
+static boost::mutex arena_lock;
+
+/* Get memory for a new region. Regions come from the frame arena when there is
+ one, so they cost no heap allocation and are all released when it is reset. */
+static void* newRegionMemory(FrameArena *arena){
+    if (arena != NULL) {
+        boost::mutex::scoped_lock lock(arena_lock);
+        return arena->allocate<RegionI>();
+    }
+    return ::operator new(sizeof(RegionI));
+}
+
+/* Release a region created in newRegionMemory. */
+static void deleteRegion(const RegionI *region, FrameArena *arena){
+    if (arena != NULL) {
+        region->~RegionI();
+    } else {
+        delete region;
+    }
+}
+
+BallDetector::BallDetector(int threads, const std::string &extra_stages,
+        bool hough_circle_fit, bool track_ball) : pool_(NULL),
+        cascade_("ball"), cascade_frames_(BALL_CASCADE_WINDOW - BALL_CASCADE_WARMUP),
+        arena_(NULL),
+        circle_fit_method_(hough_circle_fit ? CircleFit::HOUGH : CircleFit::EXHAUSTIVE),
+        track_ball_(track_ball), last_ball_rrc_(0, 0),
+        frames_since_ball_(BALL_TRACK_FRAMES + 1),
+        crazy_ball_cycle_(0), last_normal_ball_(0) {
+    // Nothing is known about the stages until they have run, so they are
+    // declared alike and run in the order listed, the order they always ran
+    // in. After BALL_CASCADE_WARMUP frames updateCascade orders them by what
+    // they were measured at, and keeps doing so every BALL_CASCADE_WINDOW.
+    cascade_.addStage("regionOtsu",
+        boost::bind(&BallDetector::regionOtsuStage, this, _1), 1, 0);
+    int circle_fit = cascade_.addStage("circleFit",
+        boost::bind(&BallDetector::circleFitStage, this, _1), 1, 0);
+    int circle_otsu = cascade_.addStage("circleOtsu",
+        boost::bind(&BallDetector::circleOtsuStage, this, _1), 1, 0);
+    int internal_regions = cascade_.addStage("internalRegions",
+        boost::bind(&BallDetector::internalRegionsStage, this, _1), 1, 0);
+
+    // The in circle otsu and the internal regions need the circle, and look
+    // at the region it was trimmed to. The thresholds they share, and the
+    // region's thresholds the circle fit finds its points with, are worked
+    // out by whichever stage needs them first.
+    cascade_.depend(circle_otsu, circle_fit);
+    cascade_.depend(internal_regions, circle_fit);
+
+    std::vector<std::string> extras;
+    boost::split(extras, extra_stages, boost::is_any_of(","));
+    for (unsigned int i = 0; i < extras.size(); ++i) {
+        std::string name = boost::trim_copy(extras[i]);
+        int stage;
+        if (name.empty()) {
+            continue;
+        } else if (name == "hog") {
+            stage = cascade_.addStage(name,
+                boost::bind(&BallDetector::hogStage, this, _1), 1, 0);
+        } else if (name == "pattern") {
+            stage = cascade_.addStage(name,
+                boost::bind(&BallDetector::patternStage, this, _1), 1, 0);
+        } else if (name == "sphereCheck") {
+            stage = cascade_.addStage(name,
+                boost::bind(&BallDetector::sphereCheckStage, this, _1), 1, 0);
+        } else if (name == "whiteDensity") {
+            stage = cascade_.addStage(name,
+                boost::bind(&BallDetector::whiteDensityStage, this, _1), 1, 0);
+        } else {
+            llog(WARNING) << "Unknown ball detector stage " << name << std::endl;
+            continue;
+        }
+        // Look at the same region however they are ordered
+        cascade_.depend(stage, circle_fit);
+    }
+
+    if (threads != 1) {
+        pool_ = new WorkerPool(std::max(threads, 0));
+        if (pool_->size() == 1) {
+            delete pool_;
+            pool_ = NULL;
+        }
+    }
+
+    unsigned int workers = (pool_ != NULL) ? pool_->size() : 1;
+    for (unsigned int i = 0; i < workers; ++i) {
+        scratch_.push_back(new BallDetectorScratch());
+    }
+}
+
+BallDetector::~BallDetector() {
+    delete pool_;
+    for (unsigned int i = 0; i < scratch_.size(); ++i) {
+        delete scratch_[i];
+    }
+}
+
 /* Given a region, determine if we want to zoom in.
  Returns true/false depending on if a new region is created. */
 void BallDetector::regenerateRegion(BallDetectorVisionBundle &bdvb, bool aspectCheck){
@@ -138,10 +265,10 @@ void BallDetector::regenerateRegion(BallDetectorVisionBundle &bdvb, bool aspectC
 
     //std::cout << "width: " << width_padding << " height: " << height_padding << "\n";
 
-    RegionI *region = new RegionI(*bdvb.region, BBox(newBounds.a, newBounds.b));
+    RegionI *region = new (newRegionMemory(arena_)) RegionI(*bdvb.region, BBox(newBounds.a, newBounds.b));
     if (bdvb.region_created == true){
 
-        delete bdvb.region;
+        deleteRegion(bdvb.region, arena_);
     }
 
     bdvb.region = region;
@@ -179,9 +306,9 @@ void BallDetector::trimRegionBasedOnCircleCandidatePoints(BallDetectorVisionBund
     newBounds.b.x() = max_x;
     newBounds.a.y() = min_y;
 
-    RegionI *region = new RegionI(*bdvb.region, BBox(newBounds.a, newBounds.b));
+    RegionI *region = new (newRegionMemory(arena_)) RegionI(*bdvb.region, BBox(newBounds.a, newBounds.b));
     if (bdvb.region_created == true){
-        delete bdvb.region;
+        deleteRegion(bdvb.region, arena_);
     }
 
     bdvb.region = region;
@@ -237,9 +364,9 @@ void BallDetector::regenerateRegionFromCircleFit(BallDetectorVisionBundle &bdvb,
     bdvb.circle_fit.result_circle.centre.x() += left_diff;
     bdvb.circle_fit.result_circle.centre.y() += top_diff;
 
-    RegionI *region = new RegionI(*bdvb.region, BBox(newBounds.a, newBounds.b));
+    RegionI *region = new (newRegionMemory(arena_)) RegionI(*bdvb.region, BBox(newBounds.a, newBounds.b));
     if (bdvb.region_created == true){
-        delete bdvb.region;
+        deleteRegion(bdvb.region, arena_);
     }
     bdvb.region = region;
     bdvb.region_created = true;
@@ -277,18 +404,26 @@ bool BallDetector::checkPartialRegion(BallDetectorVisionBundle& bdvb){
 }
 
 /* Clear the ball detector vision bundles */
-static void clearBDVBs(std::vector <BallDetectorVisionBundle> &bdvbs){
+static void clearBDVBs(std::vector <BallDetectorVisionBundle> &bdvbs,
+                                                           FrameArena *arena){
 
         for (std::vector <BallDetectorVisionBundle>::iterator it = bdvbs.begin();
                 it != bdvbs.end(); it++) {
 
             if (it->region_created){
-                delete it->region;
+                deleteRegion(it->region, arena);
             }
         }
 }
 
 void BallDetector::detect(const VisionInfoIn& info_in, const VisionInfoMiddle& info_middle, VisionInfoOut& info_out) {
+    arena_ = info_middle.arena;
+
+    if (++cascade_frames_ == BALL_CASCADE_WINDOW) {
+        updateCascade();
+    }
+    ++frames_since_ball_;
+
     // If you are the goalie and it is looking over its shoulder, don't let it detect balls
 
     // 70 degrees
@@ -304,103 +439,111 @@ void BallDetector::detect(const VisionInfoIn& info_in, const VisionInfoMiddle& i
     frame_timer.restart();
 #endif // BALL_DETECTOR_TIMINGS
 
-    for (std::vector<RegionI>::const_reverse_iterator rit = regions.rbegin();
-        rit != regions.rend(); ++rit, region_index--)
-    {
-        // This is our internal ROI
+    // Only search everywhere if the ball isn't where it should be
+    if (track_ball_ && detectTracked(info_in, info_middle, info_out)) {
+        last_normal_ball_ = 0;
+        return;
+    }
 
-        std::vector <BallDetectorVisionBundle> ball_regions;
-        //naiveROI(info_in, &regions[region], info_middle, info_out, true, ball_regions);
-        //blackROI(info_in, &regions[region], info_middle, info_out, true, ball_regions);
-        //circleROI(info_in, &regions[region], info_middle, info_out, true, ball_regions);
+    bool parallel = pool_ != NULL;
 #ifdef BALL_DETECTOR_USES_VDM
-        if (vdm != NULL) {
-            VisionDebugQuery q = vdm->getQuery();
-            if (region_index == q.region_index) {
-                vdm->vision_debug_blackboard.values["Draw This Region"] = 1;
-            } else {
-                vdm->vision_debug_blackboard.values["Draw This Region"] = 0;
-            }
+    // Debug drawing follows the serial loop
+    parallel = parallel && vdm == NULL;
+#endif // BALL_DETECTOR_USES_VDM
+
+    if (parallel) {
+        if (detectInParallel(info_in, info_middle, info_out)) {
+#ifdef EARLY_EXIT
+            last_normal_ball_ = 0;
+            return;
+#endif // EARLY_EXIT
         }
+    } else {
+        for (std::vector<RegionI>::const_reverse_iterator rit = regions.rbegin();
+            rit != regions.rend(); ++rit, region_index--)
+        {
+            // This is our internal ROI
+
+            std::vector <BallDetectorVisionBundle> ball_regions;
+            //naiveROI(info_in, &regions[region], info_middle, info_out, true, ball_regions);
+            //blackROI(info_in, &regions[region], info_middle, info_out, true, ball_regions);
+            //circleROI(info_in, &regions[region], info_middle, info_out, true, ball_regions);
+#ifdef BALL_DETECTOR_USES_VDM
+            if (vdm != NULL) {
+                VisionDebugQuery q = vdm->getQuery();
+                if (region_index == q.region_index) {
+                    vdm->vision_debug_blackboard.values["Draw This Region"] = 1;
+                } else {
+                    vdm->vision_debug_blackboard.values["Draw This Region"] = 0;
+                }
+            }
 #endif // BALL_DETECTOR_USES_VDM
 
 #ifdef BALL_DETECTOR_TIMINGS
-        timer.restart();
+            timer.restart();
 #endif // BALL_DETECTOR_TIMINGS
-        comboROI(info_in, *rit, info_middle, info_out, true, ball_regions);
+            comboROI(info_in, *rit, info_middle, info_out, true, ball_regions);
 #ifdef BALL_DETECTOR_TIMINGS
-            roi_count++;
-            roi_time += timer.elapsed_us();
+                roi_count++;
+                roi_time += timer.elapsed_us();
 #endif // BALL_DETECTOR_TIMINGS
 
-        subregion_index = 1;
-        //std::cout << "SUB_BALLS " << ball_regions.size() << std::endl;
-        for (std::vector <BallDetectorVisionBundle>::iterator it = ball_regions.begin();
-                it != ball_regions.end(); it++, subregion_index++) {
+            subregion_index = 1;
+            //std::cout << "SUB_BALLS " << ball_regions.size() << std::endl;
+            for (std::vector <BallDetectorVisionBundle>::iterator it = ball_regions.begin();
+                    it != ball_regions.end(); it++, subregion_index++) {
 
 #ifdef BALL_DETECTOR_TIMINGS
-            timer.restart();
+                timer.restart();
 #endif // BALL_DETECTOR_TIMINGS
-            float confidence = confidenceThatRegionIsBall(*it);
+                float confidence = confidenceThatRegionIsBall(*it, *scratch_[0]);
 #ifdef BALL_DETECTOR_TIMINGS
-            confidence_count++;
-            confidence_time += timer.elapsed_us();
+                confidence_count++;
+                confidence_time += timer.elapsed_us();
 #endif // BALL_DETECTOR_TIMINGS
 
-            if (confidence > BALL_DETECTOR_CONFIDENCE_THRESHOLD){
-                //std::cout << "FOUND BALL dist: " << it->ball.rr.distance() << " heading: "
-                    //<< RAD2DEG(it->ball.rr.heading()) << std::endl;
+                if (confidence > BALL_DETECTOR_CONFIDENCE_THRESHOLD){
+                    //std::cout << "FOUND BALL dist: " << it->ball.rr.distance() << " heading: "
+                        //<< RAD2DEG(it->ball.rr.heading()) << std::endl;
 #ifdef BALL_DEBUG
-                std::cout << "FOUND BALL" << std::endl;
-                //std::cout << "ball.rr.distance(): " << rr.distance() << " ball.rr.heading(): " << rr.heading() << std::endl;
-                std::cout << "ball.imageCoords[0]: " << it->ball.imageCoords[0] << " ball.imageCoords[1]: " << it->ball.imageCoords[1] << std::endl;
-                std::cout << "ball.radius: " << it->ball.radius << std::endl;
-                std::cout << "ball.neckRelative.x: " << it->ball.neckRelative.x << " ball.neckRelative.y: " << it->ball.neckRelative.y << " ball.neckRelative.z: " << it->ball.neckRelative.z << std::endl;
-                std::cout << "ball.topCamera: " << it->ball.topCamera << std::endl;
-                std::cout << "ball.visionVar: " << it->ball.visionVar << std::endl;
+                    std::cout << "FOUND BALL" << std::endl;
+                    //std::cout << "ball.rr.distance(): " << rr.distance() << " ball.rr.heading(): " << rr.heading() << std::endl;
+                    std::cout << "ball.imageCoords[0]: " << it->ball.imageCoords[0] << " ball.imageCoords[1]: " << it->ball.imageCoords[1] << std::endl;
+                    std::cout << "ball.radius: " << it->ball.radius << std::endl;
+                    std::cout << "ball.neckRelative.x: " << it->ball.neckRelative.x << " ball.neckRelative.y: " << it->ball.neckRelative.y << " ball.neckRelative.z: " << it->ball.neckRelative.z << std::endl;
+                    std::cout << "ball.topCamera: " << it->ball.topCamera << std::endl;
+                    std::cout << "ball.visionVar: " << it->ball.visionVar << std::endl;
 #endif // BALL_DEBUG
-                //*/
-
-                // Set the ball back to the region
-                it->ball.imageCoords.x() = (it->region->getBoundingBoxRaw().a.x() + it->region->getBoundingBoxRaw().b.x())/2;
-                it->ball.imageCoords.y() = (it->region->getBoundingBoxRaw().a.y() + it->region->getBoundingBoxRaw().b.y())/2;
-                //it->ball.imageCoords.x() = it->region->getBoundingBoxRaw().a.x() + it->circle_fit.result_circle.centre.x() * it->region->getDensity();
-                //it->ball.imageCoords.y() = it->region->getBoundingBoxRaw().a.y() + it->circle_fit.result_circle.centre.y() * it->region->getDensity();
-                // Adjustment for the old system that continued the coordinate system for the bottom frame.
-                it->ball.topCamera = (it->region->isTopCamera());
-                if (!(it->region->isTopCamera())){
-                    it->ball.imageCoords.y() += TOP_IMAGE_ROWS;
-                }
-                it->ball.radius = (it->circle_fit.result_circle.radius * it->region->getDensity());
+                    //*/
 
-                last_ball_distance_ = it->ball.rr.distance();
-                info_out.balls.push_back(it->ball);
+                    acceptBall(*it, info_out);
 #ifdef EARLY_EXIT
-// We don't want to early exit while using vdm
+    // We don't want to early exit while using vdm
 #ifdef BALL_DETECTOR_USES_VDM
-                if (vdm == NULL) {
-                    clearBDVBs(ball_regions);
-                    return;
-                }
+                    if (vdm == NULL) {
+                        clearBDVBs(ball_regions, arena_);
+                        return;
+                    }
 #else
-                clearBDVBs(ball_regions);
-                last_normal_ball_ = 0;
-                return;
+                    clearBDVBs(ball_regions, arena_);
+                    last_normal_ball_ = 0;
+                    return;
 #endif // BALL_DETECTOR_USES_VDM
 #endif // EARLY_EXIT
-            }
+                }
 #ifdef BALL_DETECTOR_USES_VDM
-            if (vdm != NULL) {
-                VisionDebugQuery q = vdm->getQuery();
-                std::cout << "REGION " << region_index << "/" << q.region_index << std::endl;
-                std::cout << "SUBREGION " << subregion_index << "/" << q.subregion_index << std::endl;
-                if (region_index == q.region_index && subregion_index == q.subregion_index) {
-                    it->drawBall();
+                if (vdm != NULL) {
+                    VisionDebugQuery q = vdm->getQuery();
+                    std::cout << "REGION " << region_index << "/" << q.region_index << std::endl;
+                    std::cout << "SUBREGION " << subregion_index << "/" << q.subregion_index << std::endl;
+                    if (region_index == q.region_index && subregion_index == q.subregion_index) {
+                        it->drawBall();
+                    }
                 }
-            }
 #endif // BALL_DETECTOR_USES_VDM
+            }
+            clearBDVBs(ball_regions, arena_);
         }
-        clearBDVBs(ball_regions);
     }
 
     // If we havn't exited there is no normal ball.
@@ -471,7 +614,7 @@ void BallDetector::detect(const VisionInfoIn& info_in, const VisionInfoMiddle& i
 #ifdef BALL_DETECTOR_TIMINGS
                         timer.restart();
 #endif // BALL_DETECTOR_TIMINGS
-                        float confidence = confidenceThatRegionIsBall(*it);
+                        float confidence = confidenceThatRegionIsBall(*it, *scratch_[0]);
 #ifdef BALL_DETECTOR_TIMINGS
                         confidence_count++;
                         confidence_time += timer.elapsed_us();
@@ -517,7 +660,7 @@ void BallDetector::detect(const VisionInfoIn& info_in, const VisionInfoMiddle& i
                         }
 #endif // BALL_DETECTOR_USES_VDM
                     }
-                    clearBDVBs(ball_regions);
+                    clearBDVBs(ball_regions, arena_);
                 }
             }
         }
@@ -626,6 +769,166 @@ void BallDetector::detect(const VisionInfoIn& info_in, const VisionInfoMiddle& i
 #endif // BALL_DETECTOR_TIMINGS
 }
 
+/* Only confidenceThatRegionIsBall runs on the worker pool, one candidate per
+ * task, each worker with its own scratch bundle. Candidate generation stays on
+ * the calling thread: comboROI, rescaleRegion and the child foveas they cut
+ * for each candidate are all made serially before the pool starts. The only
+ * region a worker makes is the circle fit's trimmed region, which takes its
+ * memory from the arena under arena_lock. Balls are accepted serially after
+ * the pool finishes, in the order the serial loop in detect would find them. */
+bool BallDetector::detectInParallel(const VisionInfoIn& info_in, const VisionInfoMiddle& info_middle,
+        VisionInfoOut& info_out) {
+    const std::vector<RegionI> &regions = info_middle.roi;
+
+    // Generate every candidate first, in the order the serial loop would
+    // try them.
+    CandidateBatch batch;
+    for (std::vector<RegionI>::const_reverse_iterator rit = regions.rbegin();
+        rit != regions.rend(); ++rit)
+    {
+#ifdef BALL_DETECTOR_TIMINGS
+        timer.restart();
+#endif // BALL_DETECTOR_TIMINGS
+        comboROI(info_in, *rit, info_middle, info_out, true, batch.candidates);
+#ifdef BALL_DETECTOR_TIMINGS
+        roi_count++;
+        roi_time += timer.elapsed_us();
+#endif // BALL_DETECTOR_TIMINGS
+    }
+
+    batch.confidences.assign(batch.candidates.size(), 0);
+    batch.first_ball = batch.candidates.size();
+    pool_->run(batch.candidates.size(),
+        boost::bind(&BallDetector::evaluateCandidate, this, &batch, _1, _2));
+
+    bool found = false;
+    for (unsigned int i = 0; i < batch.candidates.size(); ++i) {
+        if (batch.confidences[i] > BALL_DETECTOR_CONFIDENCE_THRESHOLD) {
+            acceptBall(batch.candidates[i], info_out);
+            found = true;
+#ifdef EARLY_EXIT
+            break;
+#endif // EARLY_EXIT
+        }
+    }
+    clearBDVBs(batch.candidates, arena_);
+    return found;
+}
+
+void BallDetector::evaluateCandidate(CandidateBatch *batch, unsigned int candidate,
+        unsigned int worker) {
+#ifdef EARLY_EXIT
+    // An earlier candidate already won, so the serial loop would never have
+    // got this far.
+    if (candidate > batch->first_ball) {
+        return;
+    }
+#endif // EARLY_EXIT
+
+    float confidence = confidenceThatRegionIsBall(batch->candidates[candidate],
+        *scratch_[worker]);
+    batch->confidences[candidate] = confidence;
+
+    if (confidence > BALL_DETECTOR_CONFIDENCE_THRESHOLD) {
+        // Keep the earliest ball, whichever worker finishes first.
+        unsigned int first = batch->first_ball;
+        while (candidate < first) {
+            first = __sync_val_compare_and_swap(&batch->first_ball, first, candidate);
+        }
+    }
+}
+
+void BallDetector::acceptBall(BallDetectorVisionBundle &bdvb, VisionInfoOut& info_out) {
+    // Set the ball back to the region
+    bdvb.ball.imageCoords.x() = (bdvb.region->getBoundingBoxRaw().a.x() + bdvb.region->getBoundingBoxRaw().b.x())/2;
+    bdvb.ball.imageCoords.y() = (bdvb.region->getBoundingBoxRaw().a.y() + bdvb.region->getBoundingBoxRaw().b.y())/2;
+    //bdvb.ball.imageCoords.x() = bdvb.region->getBoundingBoxRaw().a.x() + bdvb.circle_fit.result_circle.centre.x() * bdvb.region->getDensity();
+    //bdvb.ball.imageCoords.y() = bdvb.region->getBoundingBoxRaw().a.y() + bdvb.circle_fit.result_circle.centre.y() * bdvb.region->getDensity();
+    // Adjustment for the old system that continued the coordinate system for the bottom frame.
+    bdvb.ball.topCamera = (bdvb.region->isTopCamera());
+    if (!(bdvb.region->isTopCamera())){
+        bdvb.ball.imageCoords.y() += TOP_IMAGE_ROWS;
+    }
+    bdvb.ball.radius = (bdvb.circle_fit.result_circle.radius * bdvb.region->getDensity());
+
+    last_ball_distance_ = bdvb.ball.rr.distance();
+    last_ball_rrc_ = bdvb.ball.rr.toCartesian();
+    frames_since_ball_ = 0;
+    info_out.balls.push_back(bdvb.ball);
+}
+
+bool BallDetector::detectTracked(const VisionInfoIn& info_in, const VisionInfoMiddle& info_middle,
+        VisionInfoOut& info_out) {
+    if (offNao || frames_since_ball_ > BALL_TRACK_FRAMES ||
+            info_middle.full_regions.size() < 2) {
+        return false;
+    }
+
+    // Where the ball should be now, robot relative
+    float seconds = frames_since_ball_ / BALL_TRACK_FPS;
+    Point predicted(last_ball_rrc_.x() + info_in.ball_vel_rrc.x() * seconds,
+                    last_ball_rrc_.y() + info_in.ball_vel_rrc.y() * seconds);
+
+    // The bottom and top of the ball in the image, where the bottom camera
+    // continues on from the top camera's rows
+    Point bottom = info_in.cameraToRR.pose.robotToImageXY(predicted, 0);
+    Point top = info_in.cameraToRR.pose.robotToImageXY(predicted, 2 * BALL_RADIUS);
+    bool is_top_camera = bottom.y() < TOP_IMAGE_ROWS;
+    if (is_top_camera != (top.y() < TOP_IMAGE_ROWS)) {
+        // Split across the cameras, so leave it to the full search
+        return false;
+    }
+    int cols = is_top_camera ? TOP_IMAGE_COLS : BOT_IMAGE_COLS;
+    int rows = is_top_camera ? TOP_IMAGE_ROWS : BOT_IMAGE_ROWS;
+    if (!is_top_camera) {
+        bottom.y() -= TOP_IMAGE_ROWS;
+        top.y() -= TOP_IMAGE_ROWS;
+    }
+
+    // Allow for the ball having moved other than predicted the longer it has
+    // been since it was seen
+    Point centre = (bottom + top) / 2;
+    int diameter = abs(bottom.y() - top.y());
+    int half_width = std::max(diameter * (2 + frames_since_ball_) / 2,
+        BALL_TRACK_MIN_HALF_WIDTH);
+    if (centre.x() + half_width < 0 || centre.x() - half_width >= cols ||
+            centre.y() + half_width < 0 || centre.y() - half_width >= rows) {
+        return false;
+    }
+
+    // Zoom in on the window from the saliency as far as its size allows
+    const RegionI &full = info_middle.full_regions[is_top_camera ? 0 : 1];
+    int full_density = full.getDensity();
+    int density = 1;
+    while (density < full_density && 2 * half_width / density > BALL_TRACK_MAX_COLS) {
+        density <<= 1;
+    }
+    BBox box(Point((centre.x() - half_width) / full_density,
+                   (centre.y() - half_width) / full_density),
+             Point((centre.x() + half_width) / full_density + 1,
+                   (centre.y() + half_width) / full_density + 1));
+    RegionI window(full, box, full_density / density, DENSITY_DECREASE,
+        density != full_density, false, false);
+    if (window.getCols() <= 0 || window.getRows() <= 0) {
+        return false;
+    }
+
+    std::vector <BallDetectorVisionBundle> ball_regions;
+    comboROI(info_in, window, info_middle, info_out, true, ball_regions);
+
+    bool found = false;
+    for (std::vector <BallDetectorVisionBundle>::iterator it = ball_regions.begin();
+            it != ball_regions.end(); it++) {
+        if (confidenceThatRegionIsBall(*it, *scratch_[0]) > BALL_DETECTOR_CONFIDENCE_THRESHOLD) {
+            acceptBall(*it, info_out);
+            found = true;
+            break;
+        }
+    }
+    clearBDVBs(ball_regions, arena_);
+    return found;
+}
+
 /* Given a region, check the aspect ratio. This is simply length/height. */
 static inline double checkRegionAspectRatio(const RegionI& region, BallDetectorVisionBundle& bdvb){
     return (double) region.getCols()/region.getRows();
@@ -914,10 +1217,10 @@ bool BallDetector::blackROI(const VisionInfoIn& info_in, const RegionI& region,
         newBounds.a.y() -= 0.2 * bdvb.diam_expected_size_pixels / bdvb.region->getDensity();
         */
 
-        RegionI *region = new RegionI(*bdvb.region, BBox(newBounds.a, newBounds.b));
+        RegionI *region = new (newRegionMemory(arena_)) RegionI(*bdvb.region, BBox(newBounds.a, newBounds.b));
 
         if (bdvb.region_created == true){
-            delete bdvb.region;
+            deleteRegion(bdvb.region, arena_);
         }
 
         bdvb.region = region;
@@ -1110,10 +1413,23 @@ void BallDetector::processInCircleOtsu(BallDetectorVisionBundle &bdvb) {
 #endif // BALL_DEBUG
 }
 
-float BallDetector::confidenceThatRegionIsBall(BallDetectorVisionBundle &bdvb){
+float BallDetector::confidenceThatRegionIsBall(BallDetectorVisionBundle &bdvb,
+        BallDetectorScratch &scratch){
 
     checkPartialRegion(bdvb);
 
+    // Every feature left can veto the ball, so the confidence is just
+    // whether the cascade passed it.
+    BallCandidate candidate(&bdvb, &scratch);
+    return cascade_.run(candidate) ? 1.0f : 0.0f;
+}
+
+void BallDetector::regionOtsu(BallCandidate &candidate) {
+    if (candidate.region_otsu_done) {
+        return;
+    }
+    BallDetectorVisionBundle &bdvb = *candidate.bdvb;
+
 #ifdef BALL_DETECTOR_TIMINGS
     timer2.restart();
 #endif // BALL_DETECTOR_TIMINGS
@@ -1123,41 +1439,40 @@ float BallDetector::confidenceThatRegionIsBall(BallDetectorVisionBundle &bdvb){
     preprocess_time += timer2.elapsed_us();
 #endif // BALL_DETECTOR_TIMINGS
 
-    float running_confidence = 0;
-
-    // Early exit if otsu failed
+    // Judged now, as the in circle otsu replaces the thresholds
+    candidate.region_otsu_done = true;
+    candidate.region_otsu_passed = analyseOtsu(bdvb);
+}
 
-    if (!analyseOtsuIntraClassVar(bdvb.intra_class_var_top_)) {
-        running_confidence = 0;
-#ifdef BALL_DEBUG
-    std::cout << "Top intra class var too low: " << bdvb.intra_class_var_top_ << "\n";
-#endif // BALL_DEBUG
-        return running_confidence;
+void BallDetector::circleOtsu(BallCandidate &candidate) {
+    if (candidate.circle_otsu_done) {
+        return;
     }
+    BallDetectorVisionBundle &bdvb = *candidate.bdvb;
 
-    if (!analyseOtsuIntraClassVar(bdvb.intra_class_var_bot_)) {
-        running_confidence = 0;
-#ifdef BALL_DEBUG
-    std::cout << "Bot intra class var too low: " << bdvb.intra_class_var_bot_ << "\n";
-#endif // BALL_DEBUG
-        return running_confidence;
-    }
+#ifdef BALL_DETECTOR_TIMINGS
+    timer2.restart();
+#endif // BALL_DETECTOR_TIMINGS
+    processInCircleOtsu(bdvb);
+#ifdef BALL_DETECTOR_TIMINGS
+    in_circle_otsu_count++;
+    in_circle_otsu_time += timer2.elapsed_us();
+#endif // BALL_DETECTOR_TIMINGS
 
-    if (!analyseOtsuThresh(bdvb.otsu_top_threshold_)) {
-        running_confidence = 0;
-#ifdef BALL_DEBUG
-    std::cout << "Top otsu thresh too low: " << bdvb.otsu_top_threshold_ << "\n";
-#endif // BALL_DEBUG
-        return running_confidence;
-    }
+    candidate.circle_otsu_done = true;
+    candidate.circle_otsu_passed = analyseOtsu(bdvb);
+}
 
-    if (!analyseOtsuThresh(bdvb.otsu_bot_threshold_)) {
-        running_confidence = 0;
-#ifdef BALL_DEBUG
-    std::cout << "Bot otsu thresh too low: " << bdvb.otsu_bot_threshold_ << "\n";
-#endif // BALL_DEBUG
-        return running_confidence;
-    }
+bool BallDetector::regionOtsuStage(BallCandidate &candidate) {
+    regionOtsu(candidate);
+    return candidate.region_otsu_passed;
+}
+
+bool BallDetector::circleFitStage(BallCandidate &candidate) {
+    BallDetectorVisionBundle &bdvb = *candidate.bdvb;
+
+    // Finds its points with the region's thresholds
+    regionOtsu(candidate);
 
 #ifdef BALL_DETECTOR_TIMINGS
     timer2.restart();
@@ -1177,121 +1492,122 @@ float BallDetector::confidenceThatRegionIsBall(BallDetectorVisionBundle &bdvb){
 
     bdvb.ball.radius = (bdvb.circle_fit.result_circle.radius) * bdvb.region->getDensity();
 
-    // Rescale region.
-    //rescaleRegion(bdvb);
-
-    // Pre process some things. This generates the otsu's threshold.
-    //preProcess(bdvb);
+    // Reject if circle is not found
+    return bdvb.ball.radius >= 2;
+}
 
-    //processHOG(*bdvb.region, bdvb);
-    //processPattern(*bdvb.region, bdvb);
-    // Circle fit needs to run before internal region check because the resulting circle
-    // is used inside.
+bool BallDetector::circleOtsuStage(BallCandidate &candidate) {
+    circleOtsu(candidate);
+    return candidate.circle_otsu_passed;
+}
 
-    // Circle fit already happened inside naive ROI.
-    // The midpoint where the otsu's top/bottom switches over.
+bool BallDetector::internalRegionsStage(BallCandidate &candidate) {
+    BallDetectorVisionBundle &bdvb = *candidate.bdvb;
 
-    // Early exit if circle is not found
+    // Split by the in circle thresholds and contrast normalisation
+    circleOtsu(candidate);
 
-    if (bdvb.ball.radius < 2) {
-        return 0;
-    }
 #ifdef BALL_DETECTOR_TIMINGS
     timer2.restart();
 #endif // BALL_DETECTOR_TIMINGS
-    processInCircleOtsu(bdvb);
+    processInternalRegions(*bdvb.region, bdvb, bdvb.circle_fit.result_circle, bdvb.internal_regions,
+        *candidate.scratch);
 #ifdef BALL_DETECTOR_TIMINGS
-    in_circle_otsu_count++;
-    in_circle_otsu_time += timer2.elapsed_us();
+    internal_region_count++;
+    internal_region_time += timer2.elapsed_us();
 #endif // BALL_DETECTOR_TIMINGS
 
+    // These used to be worth 0.4 and 0.2 of a 0.5 threshold, so a ball
+    // needs both.
+    return analyseInternalRegions(bdvb.internal_regions, bdvb) &&
+        analyseInternalRegionsTotal(bdvb.internal_regions, bdvb);
+}
+
+bool BallDetector::hogStage(BallCandidate &candidate) {
+    processHOG(*candidate.bdvb->region, *candidate.bdvb);
+    return analyseHOG(candidate.bdvb->hog);
+}
+
+bool BallDetector::patternStage(BallCandidate &candidate) {
+    processPattern(*candidate.bdvb->region, *candidate.bdvb);
+    return analysePattern(candidate.bdvb->pattern);
+}
+
+bool BallDetector::sphereCheckStage(BallCandidate &candidate) {
+    processSphereCheck(*candidate.bdvb->region, *candidate.bdvb);
+    return analyseSphereCheck(candidate.bdvb->sphere_check);
+}
+
+bool BallDetector::whiteDensityStage(BallCandidate &candidate) {
+    const RegionI &region = *candidate.bdvb->region;
+    const RANSACCircle &circle = candidate.bdvb->circle_fit.result_circle;
+
+    // The square around the circle, clipped to the region. Constant time if
+    // the fovea has summed area tables.
+    BBox square(
+        Point(std::max((int)(circle.centre.x() - circle.radius), 0),
+              std::max((int)(circle.centre.y() - circle.radius), 0)),
+        Point(std::min((int)(circle.centre.x() + circle.radius), region.getCols()),
+              std::min((int)(circle.centre.y() + circle.radius), region.getRows())));
+    if (square.width() <= 0 || square.height() <= 0) {
+        return false;
+    }
+    return region.getColourFraction(square, cWHITE) >= BALL_MIN_WHITE_PROPORTION;
+}
+
+void BallDetector::updateCascade() {
+    cascade_frames_ = 0;
+
+    std::vector<CascadeStageStats> stats = cascade_.stats();
+    for (unsigned int i = 0; i < stats.size(); ++i) {
+        if (stats[i].runs == 0) {
+            continue;
+        }
+        llog(INFO) << "Ball stage " << stats[i].name << ": " << stats[i].runs
+            << " runs, " << 100 * stats[i].rejections / stats[i].runs
+            << "% rejected, " << stats[i].us / stats[i].runs << "us each" << std::endl;
+    }
+
+    cascade_.order(true);
+    cascade_.resetStats();
+
+    std::ostringstream order;
+    for (unsigned int k = 0; k < cascade_.stageOrder().size(); ++k) {
+        order << stats[cascade_.stageOrder()[k]].name << " ";
+    }
+    llog(INFO) << "Ball stage order: " << order.str() << "("
+        << cascade_.expectedCost() << "us per candidate)" << std::endl;
+}
+
+bool BallDetector::analyseOtsu(BallDetectorVisionBundle &bdvb) {
     if (!analyseOtsuIntraClassVar(bdvb.intra_class_var_top_)) {
-        running_confidence = 0;
 #ifdef BALL_DEBUG
     std::cout << "Top intra class var too low: " << bdvb.intra_class_var_top_ << "\n";
 #endif // BALL_DEBUG
-        return running_confidence;
+        return false;
     }
 
     if (!analyseOtsuIntraClassVar(bdvb.intra_class_var_bot_)) {
-        running_confidence = 0;
 #ifdef BALL_DEBUG
     std::cout << "Bot intra class var too low: " << bdvb.intra_class_var_bot_ << "\n";
 #endif // BALL_DEBUG
-        return running_confidence;
+        return false;
     }
 
     if (!analyseOtsuThresh(bdvb.otsu_top_threshold_)) {
-        running_confidence = 0;
 #ifdef BALL_DEBUG
     std::cout << "Top otsu thresh too low: " << bdvb.otsu_top_threshold_ << "\n";
 #endif // BALL_DEBUG
-        return running_confidence;
+        return false;
     }
 
     if (!analyseOtsuThresh(bdvb.otsu_bot_threshold_)) {
-        running_confidence = 0;
 #ifdef BALL_DEBUG
     std::cout << "Bot otsu thresh too low: " << bdvb.otsu_bot_threshold_ << "\n";
 #endif // BALL_DEBUG
-        return running_confidence;
-    }
-
-#ifdef BALL_DETECTOR_TIMINGS
-    timer2.restart();
-#endif // BALL_DETECTOR_TIMINGS
-    processInternalRegions(*bdvb.region, bdvb, bdvb.circle_fit.result_circle, bdvb.internal_regions);
-#ifdef BALL_DETECTOR_TIMINGS
-    internal_region_count++;
-    internal_region_time += timer2.elapsed_us();
-#endif // BALL_DETECTOR_TIMINGS
-    //processSphereCheck(*bdvb.region, bdvb);
-
-    /*
-    // hog.print();
-    if (analyseHOG(bdvb.hog)) {
-        //std::cout << "HOG argees" << std::endl;
-        running_confidence += 0.0;
-    }
-    // pattern.print();
-    if (analysePattern(bdvb.pattern)) {
-        // std::cout << "Pattern argees" << std::endl;
-        running_confidence += 0.0;
-    }*/
-
-    // Circle fit
-    /*if (analyseCircleFit(bdvb.circle_fit)) {
-        running_confidence += 0.0;
-        //std::cout << "Circle fit agrees" << std::endl;
-    }*/
-
-    // internal_regions.print();
-    if (analyseInternalRegions(bdvb.internal_regions, bdvb)) {
-        //std::cout << "Internal Region argees" << std::endl;
-        running_confidence += 0.4;
-    }
-
-    //*
-    if (analyseInternalRegionsTotal(bdvb.internal_regions, bdvb)) {
-        //std::cout << "Internal Region argees" << std::endl;
-        running_confidence += 0.2;
-    }
-    //*/
-
-    /*
-    if (analyseInternalRegionCircles(internal_region_circles)) {
-         //std::cout << "Internal Region circles argees" << std::endl;
-        running_confidence += 0.4;
+        return false;
     }
-    */
-    /*
-    // sphere_check.print();
-    if (analyseSphereCheck(bdvb.sphere_check)) {
-        // std::cout << "Sphere Check argees" << std::endl;
-        running_confidence += 0.0;
-    }*/
-
-    return running_confidence;
+    return true;
 }
 
 void BallDetector::rescaleRegion(BallDetectorVisionBundle &bdvb) {
@@ -1316,11 +1632,11 @@ void BallDetector::rescaleRegion(BallDetectorVisionBundle &bdvb) {
     // Actually create the region at the new density. Colour classification and
     // edge image is needed
 
-    const RegionI *new_region = new RegionI((*bdvb.region), 1 << density_change, DENSITY_DECREASE,
+    const RegionI *new_region = new (newRegionMemory(arena_)) RegionI((*bdvb.region), 1 << density_change, DENSITY_DECREASE,
                                                              true, false, false);
 
     if (bdvb.region_created) {
-        delete bdvb.region;
+        deleteRegion(bdvb.region, arena_);
     }
 
     // For vatnao (might be necessary for other stuff)
@@ -1642,9 +1958,10 @@ void BallDetector::preProcess(BallDetectorVisionBundle &bdvb){
 }
 
 void BallDetector::processInternalRegions(const RegionI& base_region, BallDetectorVisionBundle &bdvb,
-        RANSACCircle &result_circle, InternalRegionFeatures &internal_regions)
+        RANSACCircle &result_circle, InternalRegionFeatures &internal_regions,
+        BallDetectorScratch &scratch)
 {
-    connectedComponentAnalysisNotWhiteAndInside(base_region, bdvb, result_circle);
+    connectedComponentAnalysisNotWhiteAndInside(base_region, bdvb, result_circle, scratch);
 
     InternalRegionFeatures internal_region_features;
     internal_region_features.num_internal_regions = 0;
@@ -1667,26 +1984,27 @@ void BallDetector::processInternalRegions(const RegionI& base_region, BallDetect
     double area_circle = result_circle.radius * result_circle.radius * M_PI;
 
     // Count the number of groups that do not touch the edge.
-    for(int group=0; group<group_links_.size(); ++group)
+    const std::vector<CCABoxStats>& groups = scratch.components.stats();
+    for(unsigned int group=0; group<groups.size(); ++group)
     {
-        if(group_counts_[group] > min_internal_group_size &&
-                group_counts_[group] < max_internal_group_size)
+        if(groups[group].count > min_internal_group_size &&
+                groups[group].count < max_internal_group_size)
         {
             InternalRegion r;
-            r.num_pixels = group_counts_[group];
-            r.min_x = group_low_xs_[group];
-            r.max_x = group_high_xs_[group];
-            r.min_y = group_low_ys_[group];
-            r.max_y = group_high_ys_[group];
+            r.num_pixels = groups[group].count;
+            r.min_x = groups[group].low_x;
+            r.max_x = groups[group].high_x;
+            r.min_y = groups[group].low_y;
+            r.max_y = groups[group].high_y;
 
             if (
-                (DISTANCE_SQR(centre_x, centre_y, group_low_xs_[group], group_low_ys_[group])
+                (DISTANCE_SQR(centre_x, centre_y, r.min_x, r.min_y)
                     < result_circle.radius * result_circle.radius) &&
-                (DISTANCE_SQR(centre_x, centre_y, group_low_xs_[group], group_high_ys_[group])
+                (DISTANCE_SQR(centre_x, centre_y, r.min_x, r.max_y)
                     < result_circle.radius * result_circle.radius) &&
-                (DISTANCE_SQR(centre_x, centre_y, group_high_xs_[group], group_low_ys_[group])
+                (DISTANCE_SQR(centre_x, centre_y, r.max_x, r.min_y)
                     < result_circle.radius * result_circle.radius) &&
-                (DISTANCE_SQR(centre_x, centre_y, group_high_xs_[group], group_high_ys_[group])
+                (DISTANCE_SQR(centre_x, centre_y, r.max_x, r.max_y)
                     < result_circle.radius * result_circle.radius)) {
                 r.completely_internal = true;
                 internal_region_features.num_internal_regions++;
@@ -1859,399 +2177,66 @@ void BallDetector::processCircleFit(const RegionI& region, BallDetectorVisionBun
 
 void BallDetector::findBestCircleFit(BallDetectorVisionBundle &bdvb, float max_radius, std::vector<bool> **cons, std::vector <bool> cons_buf[2], float e, unsigned int n,
         float min_radius_prop, float step_size, PartialBallSide partial_ball_side) {
-    // Systematically start from radius equal to half the columns and slowly reducing the radius
-    // Try all centres such that the circle wholly fits inside the region
-    // Find the first circle that meets criteria (similar to RANSAC)
-
-    // Code largely (at least variance code) taken from RANSAC. Not sure what it means ~ VictorW
-    RANSACCircle c;
-    c.centre = PointF(0, 0);
-    c.radius = 0;
-
-    float curr_radius = max_radius;
+    // The lowest variance circle, searching radii from max_radius down and
+    // centres such that the circle wholly fits inside the region
+    int curr_iterations = 0;
+    CircleFit::findBest(bdvb.circle_fit_points,
+        bdvb.region->getCols(), bdvb.region->getRows(), max_radius, e, n,
+        min_radius_prop, step_size, partial_ball_side, circle_fit_method_,
+        bdvb.circle_fit.result_circle, &curr_iterations);
 
-    unsigned int j;
-    float pos_var[4], neg_var[4];
-    const int e2 = e * e;
+#ifdef BALL_DETECTOR_TIMINGS
+    circlefit_iterations += curr_iterations;
+    circlefit_max_iterations = std::max(circlefit_max_iterations, curr_iterations);
+#endif // BALL_DETECTOR_TIMINGS
 
-    float x_coverage_prop = 0.75;
-    float y_coverage_prop = 0.55;
+}
 
-#ifdef BALL_DEBUG
-    float max_prop_x = 0;
-    float max_prop_y_l = 0;
-    float max_prop_y_r = 0;
-#endif // BALL_DEBUG
+void BallDetector::findLargestCircleFit(BallDetectorVisionBundle &bdvb, float max_radius, std::vector<bool> **cons, std::vector <bool> cons_buf[2], float e, unsigned int n,
+        float min_radius_prop, float step_size, PartialBallSide partial_ball_side) {
+    // The largest circle whose edge points cover enough of its top half,
+    // searching as findBestCircleFit does
+    int curr_iterations = 0;
+    CircleFit::findLargest(bdvb.circle_fit_points,
+        bdvb.region->getCols(), bdvb.region->getRows(), max_radius, e,
+        min_radius_prop, step_size, partial_ball_side, circle_fit_method_,
+        bdvb.circle_fit.result_circle, &curr_iterations);
 
 #ifdef BALL_DETECTOR_TIMINGS
-    int curr_iterations = 0;
+    circlefit_iterations += curr_iterations;
+    circlefit_max_iterations = std::max(circlefit_max_iterations, curr_iterations);
 #endif // BALL_DETECTOR_TIMINGS
 
-    /* error of best circle found so far */
-    float minerr = std::numeric_limits<float>::max();
-    c.var = std::numeric_limits<float>::max();
+}
 
-    std::vector<bool> *best_concensus, *this_concensus;
-    best_concensus = &cons_buf[0];
-    //std::cout << "Cols: " << bdvb.region->getCols() << " Rows: " << bdvb.region->getRows() << "\n";
+void BallDetector::processCircleFitSizeEst(const RegionI& region, BallDetectorVisionBundle &bdvb){
+    /* Generate the candidate points */
+    getCircleCandidatePoints(region, bdvb, false);
 
-    while (curr_radius > min_radius_prop * max_radius) {
-        //std::cout << "Rad: " << curr_radius << "\n";
-        c.radius = curr_radius;
+    // Ransac
+    float radius = (bdvb.diam_expected_size_pixels) * 0.45;
+    //float radius = region.getRows() * 0.45;
 
-        // Start from the top left most centre
-        float centre_x = (partial_ball_side == BALL_SIDE_LEFT) ? 0 : curr_radius;
-        float right_bound = bdvb.region->getCols();
-        float square_radius = curr_radius*curr_radius;
+    float radius_e = radius * 0.1;
+    uint16_t k = 10;
+    float e = radius * 0.05;//3.0; // was 15.0
+    //uint16_t n = std::max((int) (0.7 * bdvb.circle_fit_points.size()), 10);
+    uint16_t n = std::max((int) (1.5 * 2 * M_PI * radius), 20);
+    unsigned int seed = 42;
 
-        right_bound -= (partial_ball_side == BALL_SIDE_RIGHT) ? 0 : curr_radius;
+    //if (region.isTopCamera()) n += 5;
 
-        while (centre_x < right_bound + 1) {
-            //std::cout << "Centre_x: " << centre_x << "\n";
-            float centre_y = (partial_ball_side == BALL_SIDE_TOP) ? 0 : curr_radius;
-            float bottom_bound = bdvb.region->getRows();
+    std::vector<bool> *con, cons_buf[2];
+    cons_buf[0].resize(bdvb.circle_fit_points.size());
+    cons_buf[1].resize(bdvb.circle_fit_points.size());
+    con = &cons_buf[0];
+    bdvb.circle_fit.result_circle = RANSACCircle(PointF(0,0), 0.0);
 
-            bottom_bound -= (partial_ball_side == BALL_SIDE_BOTTOM) ? 0 : curr_radius;
-
-            while (centre_y < bottom_bound + 1) {
-#ifdef BALL_DETECTOR_TIMINGS
-                circlefit_iterations++;
-                curr_iterations++;
-#endif // BALL_DETECTOR_TIMINGS
-                //std::cout << "Centre: " << centre_x << "," << centre_y << " rad: " << curr_radius << "\n";
-                c.centre = PointF(centre_x, centre_y);
-
-                if (best_concensus == &cons_buf[0]) {
-                    this_concensus = &cons_buf[1];
-                } else {
-                   this_concensus = &cons_buf[0];
-                }
-
-                for (j = 0; j < 4; ++ j) {
-                   pos_var[j] = neg_var[j] = 0;
-                }
-
-                unsigned int n_concensus_points = 0;
-                std::set <int> x_values;
-                std::set <int> y_values_l;
-                std::set <int> y_values_r;
-
-                for (j = 0; j != bdvb.circle_fit_points.size(); ++ j) {
-                   const PointF &p = bdvb.circle_fit_points[j].cast<float>();
-                   const PointF &d = c.centre - p;
-
-                   // Technically incorrect, but faster than a sqrt.
-                    float dist = d.norm() - c.radius;
-                    float dist2 = dist*dist;
-
-                    if (dist2 < e2) {
-                        int quadrant = 0;
-                        if (d.x() > 0) {
-                            if (d.y() > 0) {
-                                quadrant = 0;
-                            } else {
-                                quadrant = 3;
-                            }
-                        } else {
-                            if (d.y() > 0) {
-                                quadrant = 1;
-                            } else {
-                                quadrant = 2;
-                            }
-                        }
-
-                        if (dist > 0) {
-                            pos_var[quadrant] += dist2;
-                        } else {
-                            neg_var[quadrant] += dist2;
-                        }
-
-                        ++ n_concensus_points;
-                        (*this_concensus)[j] = true;
-                    } else {
-                        (*this_concensus)[j] = false;
-                    }
-                }
-
-                const float k = 0.2;
-
-                c.var = 0;
-                for (j = 0; j < 4; ++ j) {
-                    float diff_var = pos_var[j] - neg_var[j];
-                    c.var += pos_var[j] + neg_var[j] + diff_var * diff_var;
-                }
-
-                c.var = (k * c.var) - n_concensus_points;
-
-//std::cout << "Centrex: " << c.centre.x() << " Centrey: " << c.centre.y() << " radius: " << c.radius << " var: " << c.var << "\n";
-
-                // Changed condition to look at x_coverage instead
-
-                if (c.var < minerr && n_concensus_points >= n) {
-#ifdef BALL_DEBUG
-                    std::cout << "____________MAXPROP FOUND: " << ((float) x_values.size()) / (2 * curr_radius) << ", " <<
-                        ((float) y_values_l.size()) / (curr_radius) << ", " <<
-                        ((float) y_values_r.size()) / (curr_radius) << "\n";
-                    std::cout << "Circle Found: " << c.centre.x() << "," << c.centre.y() << " radius: " << c.radius << "\n";
-#endif // BALL_DEBUG
-                    minerr = c.var;
-                    c.var  = c.var / (bdvb.circle_fit_points.size() * e);
-                    bdvb.circle_fit.result_circle = c;
-                    best_concensus = this_concensus;
-
-                        // Select the first one that meets the requirements
-
-                    bdvb.circle_fit.result_circle = c;
-                }
-
-                centre_y += step_size;
-            }
-
-            centre_x += step_size;
-        }
-
-        curr_radius -= 1;
-    }
-
-#ifdef BALL_DETECTOR_TIMINGS
-    circlefit_max_iterations = std::max(circlefit_max_iterations, curr_iterations);
-#endif // BALL_DETECTOR_TIMINGS
-
-#ifdef BALL_DEBUG
-    std::cout << "____________MAXPROP: " << max_prop_x << ", " <<
-        max_prop_y_l << ", " << max_prop_y_r << "\n";
-    std::cout << "No circle found\n";
-#endif // BALL_DEBUG
-}
-
-
-void BallDetector::findLargestCircleFit(BallDetectorVisionBundle &bdvb, float max_radius, std::vector<bool> **cons, std::vector <bool> cons_buf[2], float e, unsigned int n,
-        float min_radius_prop, float step_size, PartialBallSide partial_ball_side) {
-    // Systematically start from radius equal to half the columns and slowly reducing the radius
-    // Try all centres such that the circle wholly fits inside the region
-    // Find the first circle that meets criteria (similar to RANSAC)
-
-    // Code largely (at least variance code) taken from RANSAC. Not sure what it means ~ VictorW
-    RANSACCircle c;
-    c.centre = PointF(0, 0);
-    c.radius = 0;
-
-    float curr_radius = max_radius;
-
-    unsigned int j;
-    float pos_var[4], neg_var[4];
-    const int e2 = e * e;
-
-    float x_coverage_prop = 0.75;
-    float y_coverage_prop = 0.55;
-
-#ifdef BALL_DEBUG
-    float max_prop_x = 0;
-    float max_prop_y_l = 0;
-    float max_prop_y_r = 0;
-#endif // BALL_DEBUG
-
-#ifdef BALL_DETECTOR_TIMINGS
-    int curr_iterations = 0;
-#endif // BALL_DETECTOR_TIMINGS
-
-    /* error of best circle found so far */
-    float minerr = std::numeric_limits<float>::max();
-    c.var = std::numeric_limits<float>::max();
-
-    std::vector<bool> *best_concensus, *this_concensus;
-    best_concensus = &cons_buf[0];
-    //std::cout << "Cols: " << bdvb.region->getCols() << " Rows: " << bdvb.region->getRows() << "\n";
-
-    while (curr_radius > min_radius_prop * max_radius) {
-        //std::cout << "Rad: " << curr_radius << "\n";
-        c.radius = curr_radius;
-
-        // Start from the top left most centre
-        float centre_x = (partial_ball_side == BALL_SIDE_LEFT) ? 0 : curr_radius;
-        float right_bound = bdvb.region->getCols();
-
-        right_bound -= (partial_ball_side == BALL_SIDE_RIGHT) ? 0 : curr_radius;
-
-        while (centre_x < right_bound + 1) {
-            //std::cout << "Centre_x: " << centre_x << "\n";
-            float centre_y = (partial_ball_side == BALL_SIDE_TOP) ? 0 : curr_radius;
-            float bottom_bound = bdvb.region->getRows();
-
-            bottom_bound -= (partial_ball_side == BALL_SIDE_BOTTOM) ? 0 : curr_radius;
-
-            while (centre_y < bottom_bound + 1) {
-#ifdef BALL_DETECTOR_TIMINGS
-                circlefit_iterations++;
-                curr_iterations++;
-#endif // BALL_DETECTOR_TIMINGS
-                //std::cout << "Centre: " << centre_x << "," << centre_y << " rad: " << curr_radius << "\n";
-                c.centre = PointF(centre_x, centre_y);
-
-                if (best_concensus == &cons_buf[0]) {
-                    this_concensus = &cons_buf[1];
-                } else {
-                   this_concensus = &cons_buf[0];
-                }
-
-                for (j = 0; j < 4; ++ j) {
-                   pos_var[j] = neg_var[j] = 0;
-                }
-
-                unsigned int n_concensus_points = 0;
-                std::set <int> x_values;
-                std::set <int> y_values_l;
-                std::set <int> y_values_r;
-
-                for (j = 0; j != bdvb.circle_fit_points.size(); ++ j) {
-                   const PointF &p = bdvb.circle_fit_points[j].cast<float>();
-                   const PointF &d = c.centre - p;
-
-                   /* TODO(carl) look into integer version of this */
-                    float dist = d.norm() - c.radius;
-                    float dist2 = dist * dist;
-
-                    if (dist2 < e2) {
-                        int quadrant = 0;
-                        if (d.x() > 0) {
-                            if (d.y() > 0) {
-                                quadrant = 0;
-                            } else {
-                                quadrant = 3;
-                            }
-                        } else {
-                            if (d.y() > 0) {
-                                quadrant = 1;
-                            } else {
-                                quadrant = 2;
-                            }
-                        }
-
-                        if (dist > 0) {
-                            pos_var[quadrant] += dist2;
-                        } else {
-                            neg_var[quadrant] += dist2;
-                        }
-
-                        if (bdvb.circle_fit_points[j].y() <= centre_y
-                            && bdvb.circle_fit_points[j].y() >= centre_y - curr_radius
-                            && bdvb.circle_fit_points[j].x() >= centre_x - curr_radius
-                            && bdvb.circle_fit_points[j].x() <= centre_x + curr_radius) {
-                            x_values.insert(bdvb.circle_fit_points[j].x());
-
-                            if (bdvb.circle_fit_points[j].x() < centre_x) {
-                                y_values_l.insert(bdvb.circle_fit_points[j].y());
-                            }
-                            else {
-                                y_values_r.insert(bdvb.circle_fit_points[j].y());
-                            }
-                        }
-
-                        ++ n_concensus_points;
-                        (*this_concensus)[j] = true;
-                    } else {
-                        (*this_concensus)[j] = false;
-                    }
-                }
-
-                /*
-                const float k = 0.2;
-
-                c.var = 0;
-                for (j = 0; j < 4; ++ j) {
-                    float diff_var = pos_var[j] - neg_var[j];
-                    c.var += pos_var[j] + neg_var[j] + diff_var * diff_var;
-                }
-
-                c.var = (k * c.var) - n_concensus_points;
-                */
-
-//std::cout << "Centrex: " << c.centre.x() << " Centrey: " << c.centre.y() << " radius: " << c.radius << " var: " << c.var << "\n";
-
-                // Changed condition to look at x_coverage instead
-
-#ifdef BALL_DEBUG
-                if (((float) x_values.size()) / (2 * curr_radius) > max_prop_x &&
-                        ((float) y_values_l.size() / curr_radius) > max_prop_y_l &&
-                        ((float) y_values_r.size() / curr_radius) > max_prop_y_r) {
-                    max_prop_x = std::max(max_prop_x, ((float) x_values.size()) / (2 * curr_radius));
-                    max_prop_y_l = std::max(max_prop_y_l, ((float) y_values_l.size()) / (curr_radius));
-                    max_prop_y_r = std::max(max_prop_y_r, ((float) y_values_r.size()) / (curr_radius));
-                }
-#endif // BALL_DEBUG
-
-                if (x_values.size() >= x_coverage_prop * (2 * curr_radius)
-                    && y_values_l.size() >= y_coverage_prop * curr_radius
-                    && y_values_r.size() >= y_coverage_prop * curr_radius) {
-                //if (c.var < minerr && n_concensus_points >= n) {
-#ifdef BALL_DEBUG
-                    std::cout << "____________MAXPROP FOUND: " << ((float) x_values.size()) / (2 * curr_radius) << ", " <<
-                        ((float) y_values_l.size()) / (curr_radius) << ", " <<
-                        ((float) y_values_r.size()) / (curr_radius) << "\n";
-                    std::cout << "Circle Found: " << c.centre.x() << "," << c.centre.y() << " radius: " << c.radius << "\n";
-#endif // BALL_DEBUG
-                    //minerr = c.var;
-                    //c.var  = c.var / (bdvb.circle_fit_points.size() * e);
-                    bdvb.circle_fit.result_circle = c;
-                    best_concensus = this_concensus;
-
-                        // Select the first one that meets the requirements
-
-                    bdvb.circle_fit.result_circle = c;
-#ifdef BALL_DETECTOR_TIMINGS
-                    circlefit_max_iterations = std::max(circlefit_max_iterations, curr_iterations);
-#endif // BALL_DETECTOR_TIMINGS
-                    return;
-                }
-
-                centre_y += step_size;
-            }
-
-            centre_x += step_size;
-        }
-
-        curr_radius -= step_size;
-    }
-
-#ifdef BALL_DETECTOR_TIMINGS
-    circlefit_max_iterations = std::max(circlefit_max_iterations, curr_iterations);
-#endif // BALL_DETECTOR_TIMINGS
-
-#ifdef BALL_DEBUG
-    std::cout << "____________MAXPROP: " << max_prop_x << ", " <<
-        max_prop_y_l << ", " << max_prop_y_r << "\n";
-    std::cout << "No circle found\n";
-#endif // BALL_DEBUG
-}
-
-void BallDetector::processCircleFitSizeEst(const RegionI& region, BallDetectorVisionBundle &bdvb){
-    /* Generate the candidate points */
-    getCircleCandidatePoints(region, bdvb, false);
-
-    // Ransac
-    float radius = (bdvb.diam_expected_size_pixels) * 0.45;
-    //float radius = region.getRows() * 0.45;
-
-    float radius_e = radius * 0.1;
-    uint16_t k = 10;
-    float e = radius * 0.05;//3.0; // was 15.0
-    //uint16_t n = std::max((int) (0.7 * bdvb.circle_fit_points.size()), 10);
-    uint16_t n = std::max((int) (1.5 * 2 * M_PI * radius), 20);
-    unsigned int seed = 42;
-
-    //if (region.isTopCamera()) n += 5;
-
-    std::vector<bool> *con, cons_buf[2];
-    cons_buf[0].resize(bdvb.circle_fit_points.size());
-    cons_buf[1].resize(bdvb.circle_fit_points.size());
-    con = &cons_buf[0];
-    bdvb.circle_fit.result_circle = RANSACCircle(PointF(0,0), 0.0);
-
-    //bdvb.circle_fit.circle_found = RANSAC::findCircleOfRadius3P(bdvb.circle_fit_points, radius, radius_e, &con, bdvb.circle_fit.result_circle, k, e, n, cons_buf, &seed);
-    float centre_bound = radius * 0.4;
-    bdvb.circle_fit.circle_found = RANSAC::findCircleOfRadius3PInsideBounds(bdvb.circle_fit_points, radius, radius_e, &con,
-        bdvb.circle_fit.result_circle, k, e, n, cons_buf, &seed,
-        centre_bound, bdvb.region->getCols() - centre_bound, centre_bound, bdvb.region->getRows() - centre_bound);
+    //bdvb.circle_fit.circle_found = RANSAC::findCircleOfRadius3P(bdvb.circle_fit_points, radius, radius_e, &con, bdvb.circle_fit.result_circle, k, e, n, cons_buf, &seed);
+    float centre_bound = radius * 0.4;
+    bdvb.circle_fit.circle_found = RANSAC::findCircleOfRadius3PInsideBounds(bdvb.circle_fit_points, radius, radius_e, &con,
+        bdvb.circle_fit.result_circle, k, e, n, cons_buf, &seed,
+        centre_bound, bdvb.region->getCols() - centre_bound, centre_bound, bdvb.region->getRows() - centre_bound);
 
     std::cout << "Target radius: " << radius << "\n";
     std::cout << "Rows: " << bdvb.region->getRows() << " Cols: " << bdvb.region->getCols() << "\n";
@@ -2494,7 +2479,8 @@ std::string BallDetector::getFeatureSummary(VisionInfoOut& info_out, BallDetecto
     //processHOG(region, bdvb);
     //processPattern(region, bdvb);
     //processCircleFit(*bdvb.region, bdvb);
-    processInternalRegions(*bdvb.region, bdvb, bdvb.circle_fit.result_circle, bdvb.internal_regions);
+    processInternalRegions(*bdvb.region, bdvb, bdvb.circle_fit.result_circle, bdvb.internal_regions,
+        *scratch_[0]);
 
     //std::vector <CircleFitFeatures> internal_region_circles = processInternalRegionCircles(region, bdvb);
     //processSphereCheck(region, bdvb);
@@ -2515,553 +2501,68 @@ std::string BallDetector::getFeatureSummary(VisionInfoOut& info_out, BallDetecto
 }
 
 // **************************** CONNECTED COMPONENT ANALYSIS *******************************************
-// ******************************* UGLY repeated code **************************************************
-
-void BallDetector::connectedComponentAnalysisWhite(const RegionI& base_region,
-        BallDetectorVisionBundle &bdvb)
-{
-    // Reset group_links for use.
-    group_links_.fullReset();
-
-    // Clear the data vectors (hopefully leaving space allocated).
-
-    // The number of pixels in each group.
-    group_counts_.clear();
-
-    // The smallest x value in each group.
-    group_low_xs_.clear();
-
-    // The largest x value in each group.
-    group_high_xs_.clear();
-
-    // The smallest y value in each group.
-    group_low_ys_.clear();
 
-    // The largest y value in each group.
-    group_high_ys_.clear();
-
-    // The x value of the topmost pixel
-    group_top_x_.clear();
-
-    // The y value of the topmost pixel
-    group_top_y_.clear();
-
-    // Set to USHRT_MAX when there is no neighbour.
-    uint16_t top_neighbour = USHRT_MAX;
-    uint16_t left_neighbour = USHRT_MAX;
-    bool has_neighbour = false;
-
-    int white_black_threshold = bdvb.otsu_top_threshold_;
-    int above_white_black_threshold = bdvb.otsu_top_threshold_;
-    /*
-    for (std::vector<int>::iterator it = top_histogram.begin(); it != top_histogram.end(); ++it) {std::cout << *it << " ";}
-    std::cout << std::endl;
-    for (std::vector<int>::iterator it = bot_histogram.begin(); it != bot_histogram.end(); ++it) {std::cout << *it << " ";}
-    std::cout << std::endl;
-    std::cout << "Top threshold: " << top_white_black_threshold << " Bot threshold: " << bot_white_black_threshold << std::endl;
-    // */
-
-    // Iterators that move through the region.
-    RegionI::iterator_raw cur_point = base_region.begin_raw();
-    RegionI::iterator_raw above = base_region.begin_raw();
-    RegionI::iterator_raw left = base_region.begin_raw();
-
-    // Track the literal location of the iterators.
-    int x = 0;
-    int y = 0;
-
-    // A pointer tracking through the underlying array of groups.
-    uint16_t* group = groups_;
-
-    // The number of rows and columns in the region.
-    int rows = base_region.getRows();
-    int cols = base_region.getCols();
-    // Connected component analysis.
-
-    for(int pixel=0; pixel < cols*rows; ++pixel)
-    {
-        if (pixel / cols > rows / 2) {
-            white_black_threshold = bdvb.otsu_bot_threshold_;
-        }
-        if(white_black_threshold == bdvb.otsu_bot_threshold_ && pixel/cols > (rows/2)+1)
-            above_white_black_threshold = bdvb.otsu_bot_threshold_;
-
-        /*
-        // Add second forward slash to above line and get pretty printouts of the regions in ascii
-        printPixel(white_black_threshold, *(cur_point.raw()), u, v, x, y, circle);
-        if ((pixel + 1) % cols == 0) {
-            std::cout << std::endl;
-        }
-        // */
-
-        // If this is not a white pixel, group it.
-
-        if (isWhiteY(white_black_threshold, *(cur_point.raw())))
-        {
-
-            // Get all neighbours.
-            has_neighbour = false;
-            if (x != 0 && isWhiteY(white_black_threshold, *(left.raw())))
-            {
-                left_neighbour = *(group-1);
-                has_neighbour = true;
-            }
-            else
-                left_neighbour = USHRT_MAX;
-
-            if(y != 0 && isWhiteY(above_white_black_threshold, *(above.raw())))
-            {
-                top_neighbour = *(group-cols);
-                has_neighbour = true;
-            }
-            else
-                top_neighbour = USHRT_MAX;
-
-            // If there are no neighbours create a new label.
-            if(!has_neighbour)
-            {
-                // Try to add the new group. If this fails, the group cap has
-                // been hit and CCA should terminate.
-                if(!group_links_.newGroup())
-                    break;
-
-                *group = group_links_.size()-1;
-                group_low_xs_.push_back(x);
-                group_high_xs_.push_back(x);
-                group_low_ys_.push_back(y);
-                group_high_ys_.push_back(y);
-                group_counts_.push_back(1);
-                group_top_x_.push_back(x);
-                group_top_y_.push_back(y);
-            }
-            // If there is a neighbour build components.
-            else
-            {
-                if(top_neighbour < left_neighbour)
-                {
-                    // Set the pixel's group.
-                    *group = top_neighbour;
-
-                    // Add a parent to the left neighbour if needed.
-                    if(left_neighbour != USHRT_MAX)
-                    {
-                        bool new_link;
-                        new_link = group_links_.addLink(left_neighbour,
-                                                                  top_neighbour);
-                        if(new_link)
-                        {
-                            push_heap(group_links_.begin(left_neighbour),
-                                      group_links_.end(left_neighbour),
-                                                           std::greater<int>());
-                        }
-                    }
-
-                    // Update bounding box.
-                    group_counts_[top_neighbour] += 1;
-                    if(group_high_xs_[top_neighbour] < x) {
-                        group_high_xs_[top_neighbour] = x;
-                    }
-                    if(group_high_ys_[top_neighbour] < y) {
-                        group_high_ys_[top_neighbour] = y;
-                    }
-                }
-                else
-                {
-                    // Set the pixel's group.
-                    *group = left_neighbour;
-
-                    // Add a parent to the top neighbour if needed.
-                    if(top_neighbour != USHRT_MAX)
-                    {
-                        bool new_link;
-                        new_link = group_links_.addLink(top_neighbour,
-                                                                 left_neighbour);
-                        if(new_link)
-                        {
-                            push_heap(group_links_.begin(top_neighbour),
-                                      group_links_.end(top_neighbour),
-                                                           std::greater<int>());
-                        }
-                    }
-
-                    // Update bounding box.
-                    group_counts_[left_neighbour] += 1;
-                    if(group_high_xs_[left_neighbour] < x)
-                        group_high_xs_[left_neighbour] = x;
-                    if(group_high_ys_[left_neighbour] < y)
-                        group_high_ys_[left_neighbour] = y;
-                }
-            }
-        }
-
-        ++cur_point;
-        if(pixel > 0)
-            ++left;
-        if(pixel >= cols)
-            ++above;
-        ++x;
-        ++group;
-        if(x == cols)
-        {
-            x = 0;
-            ++y;
+/* Pixels at least as bright as the region's Otsu threshold, which is the
+ * bottom threshold below the middle row */
+class WhiteYMask {
+public:
+    WhiteYMask(const RegionI& region, const BallDetectorVisionBundle& bdvb)
+        : region_(region), top_threshold_(bdvb.otsu_top_threshold_),
+          bot_threshold_(bdvb.otsu_bot_threshold_),
+          midpoint_(region.getRows() / 2) {}
+
+    inline void row(int y, int cols, uint8_t* mask) const {
+        int threshold = (y > midpoint_) ? bot_threshold_ : top_threshold_;
+        for (int x = 0; x < cols; ++x) {
+            mask[x] = isWhiteY(threshold, *region_.getPixelRaw(x, y));
         }
     }
 
-    // Don't need a full second pass as we only need bounding boxes. Combining
-    // by grabbing pixel location extremes is sufficient. May be a faster way
-    // to implement this.
-
-    // Find the parent group for each group.
-    bool changed = true;
-    while(changed)
-    {
-        changed = false;
-        for(int group=0; group<group_links_.size(); group++)
-        {
-            // Tell all linked groups the lowest linked group.
-            for(int owner=1; owner<group_links_.size(group); owner++)
-            {
-                // Insert in sorted order.
-                changed = true;
-                if(group_links_.get(group, owner) != group)
-                {
-                    bool new_link;
-                    new_link = group_links_.addLink(group_links_.get(group, owner),
-                                                      group_links_.get(group, 0));
-                    if(new_link)
-                    {
-                        push_heap(group_links_.begin(
-                            group_links_.get(group, owner)),
-                            group_links_.end(group_links_.get(group, owner)),
-                                                           std::greater<int>());
-                    }
-                }
-            }
-
-            // Delete all but the lowest owner.
-            group_links_.clearHigh(group);
+private:
+    const RegionI& region_;
+    int top_threshold_;
+    int bot_threshold_;
+    int midpoint_;
+};
+
+/* Pixels inside the circle darker than the Otsu threshold, after the row's
+ * contrast normalisation */
+class NotWhiteInsideMask {
+public:
+    NotWhiteInsideMask(const RegionI& region,
+        const BallDetectorVisionBundle& bdvb, const RANSACCircle& circle)
+        : region_(region), bdvb_(bdvb), circle_(circle) {}
+
+    inline void row(int y, int cols, uint8_t* mask) const {
+        int threshold = (y > bdvb_.otsu_midpoint_) ?
+            bdvb_.otsu_bot_threshold_ : bdvb_.otsu_top_threshold_;
+        double multiplier = bdvb_.contrast_row_multiplier[y];
+        for (int x = 0; x < cols; ++x) {
+            uint8_t grey = NORMALISE_PIXEL(*region_.getPixelRaw(x, y), multiplier);
+            mask[x] = isNotWhiteY(threshold, grey) && isInsideRadius(x, y, circle_);
         }
     }
 
-    // Apply combinations.
-    for(int group=group_links_.size()-1; group>=0; group--)
-    {
-        int owner = group_links_.get(group, 0);
-        if(owner != group)
-        {
-            group_counts_[owner] += group_counts_[group];
-            group_counts_[group] = 0;
-            if(group_low_xs_[group] < group_low_xs_[owner])
-                group_low_xs_[owner] = group_low_xs_[group];
-            if(group_low_ys_[group] < group_low_ys_[owner])
-                group_low_ys_[owner] = group_low_ys_[group];
-            if(group_high_xs_[group] > group_high_xs_[owner])
-                group_high_xs_[owner] = group_high_xs_[group];
-            if(group_high_ys_[group] > group_high_ys_[owner])
-                group_high_ys_[owner] = group_high_ys_[group];
-            if(group_top_y_[group] < group_top_y_[owner]) {
-                group_top_y_[owner] = group_top_y_[group];
-                group_top_x_[owner] = group_top_x_[group];
-            }
-        }
-    }
+private:
+    const RegionI& region_;
+    const BallDetectorVisionBundle& bdvb_;
+    const RANSACCircle& circle_;
+};
+
+void BallDetector::connectedComponentAnalysisWhite(const RegionI& base_region,
+        BallDetectorVisionBundle &bdvb, BallDetectorScratch &scratch)
+{
+    scratch.components.label(WhiteYMask(base_region, bdvb),
+        base_region.getCols(), base_region.getRows());
 }
 
-// **************************** CONNECTED COMPONENT ANALYSIS *******************************************
-// ******************************* UGLY repeated code **************************************************
-// TODO(Vctr) - adding comments won't make ugly code prettier :)
 void BallDetector::connectedComponentAnalysisNotWhiteAndInside(const RegionI& base_region,
         BallDetectorVisionBundle &bdvb,
-        RANSACCircle &circle)
+        RANSACCircle &circle,
+        BallDetectorScratch &scratch)
 {
-    // Reset group_links for use.
-    group_links_.fullReset();
-
-    // Clear the data vectors (hopefully leaving space allocated).
-
-    // The number of pixels in each group.
-    group_counts_.clear();
-
-    // The smallest x value in each group.
-    group_low_xs_.clear();
-
-    // The largest x value in each group.
-    group_high_xs_.clear();
-
-    // The smallest y value in each group.
-    group_low_ys_.clear();
-
-    // The largest y value in each group.
-    group_high_ys_.clear();
-
-    // The x value of the topmost pixel
-    group_top_x_.clear();
-
-    // The y value of the topmost pixel
-    group_top_y_.clear();
-
-    // Set to USHRT_MAX when there is no neighbour.
-    uint16_t top_neighbour = USHRT_MAX;
-    uint16_t left_neighbour = USHRT_MAX;
-    bool has_neighbour = false;
-
-    int white_black_threshold = bdvb.otsu_top_threshold_;
-    int above_white_black_threshold = bdvb.otsu_top_threshold_;
-    int otsu_midpoint = bdvb.otsu_midpoint_;
-    /*
-    for (std::vector<int>::iterator it = top_histogram.begin(); it != top_histogram.end(); ++it) {std::cout << *it << " ";}
-    std::cout << std::endl;
-    for (std::vector<int>::iterator it = bot_histogram.begin(); it != bot_histogram.end(); ++it) {std::cout << *it << " ";}
-    std::cout << std::endl;
-    std::cout << "Top threshold: " << top_white_black_threshold << " Bot threshold: " << bot_white_black_threshold << std::endl;
-    // */
-
-    // Iterators that move through the region.
-    RegionI::iterator_raw cur_point = base_region.begin_raw();
-    RegionI::iterator_raw above = base_region.begin_raw();
-    RegionI::iterator_raw left = base_region.begin_raw();
-
-    // Track the literal location of the iterators.
-    int x = 0;
-    int y = 0;
-
-    // A pointer tracking through the underlying array of groups.
-    uint16_t* group = groups_;
-
-    // The number of rows and columns in the region.
-    int rows = base_region.getRows();
-    int cols = base_region.getCols();
-    // Connected component analysis.
-
-    for(int pixel=0; pixel < cols*rows; ++pixel)
-    {
-        if (pixel / cols > otsu_midpoint) {
-            white_black_threshold = bdvb.otsu_bot_threshold_;
-        }
-        if(white_black_threshold == bdvb.otsu_bot_threshold_ && pixel/cols > (otsu_midpoint)+1)
-            above_white_black_threshold = bdvb.otsu_bot_threshold_;
-
-        uint8_t u;
-        uint8_t v;
-        if(base_region.getDensity() > 1 || pixel%2 == 0)
-        {
-            u = *(cur_point.raw()+1);
-            v = *(cur_point.raw()+3);
-        }
-        else
-        {
-            u = *(cur_point.raw()-1);
-            v = *(cur_point.raw()+1);
-        }
-
-        /*
-        // Add second forward slash to above line and get pretty printouts of the regions in ascii
-        printPixel(white_black_threshold, *(cur_point.raw()), u, v, x, y, circle);
-        if ((pixel + 1) % cols == 0) {
-            std::cout << std::endl;
-        }
-        // */
-
-        // If this is not a white pixel, group it.
-
-        if (isNotWhiteAndInside(white_black_threshold, NORMALISE_PIXEL(*(cur_point.raw()), bdvb.contrast_row_multiplier[y]),
-                    u, v, x, y, circle))
-        {
-            uint8_t lu;
-            uint8_t lv;
-            uint8_t au;
-            uint8_t av;
-            if(base_region.getDensity() > 1 || pixel%2 == 0)
-            {
-                lu = *(left.raw()+1);
-                lv = *(left.raw()+3);
-            }
-            else
-            {
-                lu = *(left.raw()-1);
-                lv = *(left.raw()+1);
-            }
-            if(base_region.getDensity() > 1 || pixel%2 == 0)
-            {
-                au = *(above.raw()+1);
-                av = *(above.raw()+3);
-            }
-            else
-            {
-                au = *(above.raw()-1);
-                av = *(above.raw()+1);
-            }
-
-            // Get all neighbours.
-            has_neighbour = false;
-            if (x != 0 && isNotWhiteAndInside(white_black_threshold, NORMALISE_PIXEL(*(left.raw()), bdvb.contrast_row_multiplier[y]),
-                        lu, lv, x - 1, y, circle))
-            {
-                left_neighbour = *(group-1);
-                has_neighbour = true;
-            }
-            else
-                left_neighbour = USHRT_MAX;
-
-            if(y != 0 && isNotWhiteAndInside(above_white_black_threshold, NORMALISE_PIXEL(*(above.raw()), bdvb.contrast_row_multiplier[y-1]),
-                        au, av, x, y - 1, circle))
-            {
-                top_neighbour = *(group-cols);
-                has_neighbour = true;
-            }
-            else
-                top_neighbour = USHRT_MAX;
-
-            // If there are no neighbours create a new label.
-            if(!has_neighbour)
-            {
-                // Try to add the new group. If this fails, the group cap has
-                // been hit and CCA should terminate.
-                if(!group_links_.newGroup())
-                    break;
-
-                *group = group_links_.size()-1;
-                group_low_xs_.push_back(x);
-                group_high_xs_.push_back(x);
-                group_low_ys_.push_back(y);
-                group_high_ys_.push_back(y);
-                group_counts_.push_back(1);
-                group_top_x_.push_back(x);
-                group_top_y_.push_back(y);
-            }
-            // If there is a neighbour build components.
-            else
-            {
-                if(top_neighbour < left_neighbour)
-                {
-                    // Set the pixel's group.
-                    *group = top_neighbour;
-
-                    // Add a parent to the left neighbour if needed.
-                    if(left_neighbour != USHRT_MAX)
-                    {
-                        bool new_link;
-                        new_link = group_links_.addLink(left_neighbour,
-                                                                  top_neighbour);
-                        if(new_link)
-                        {
-                            push_heap(group_links_.begin(left_neighbour),
-                                      group_links_.end(left_neighbour),
-                                                           std::greater<int>());
-                        }
-                    }
-
-                    // Update bounding box.
-                    group_counts_[top_neighbour] += 1;
-                    if(group_high_xs_[top_neighbour] < x) {
-                        group_high_xs_[top_neighbour] = x;
-                    }
-                    if(group_high_ys_[top_neighbour] < y) {
-                        group_high_ys_[top_neighbour] = y;
-                    }
-                }
-                else
-                {
-                    // Set the pixel's group.
-                    *group = left_neighbour;
-
-                    // Add a parent to the top neighbour if needed.
-                    if(top_neighbour != USHRT_MAX)
-                    {
-                        bool new_link;
-                        new_link = group_links_.addLink(top_neighbour,
-                                                                 left_neighbour);
-                        if(new_link)
-                        {
-                            push_heap(group_links_.begin(top_neighbour),
-                                      group_links_.end(top_neighbour),
-                                                           std::greater<int>());
-                        }
-                    }
-
-                    // Update bounding box.
-                    group_counts_[left_neighbour] += 1;
-                    if(group_high_xs_[left_neighbour] < x)
-                        group_high_xs_[left_neighbour] = x;
-                    if(group_high_ys_[left_neighbour] < y)
-                        group_high_ys_[left_neighbour] = y;
-                }
-            }
-        }
-
-        ++cur_point;
-        if(pixel > 0)
-            ++left;
-        if(pixel >= cols)
-            ++above;
-        ++x;
-        ++group;
-        if(x == cols)
-        {
-            x = 0;
-            ++y;
-        }
-    }
-
-    // Don't need a full second pass as we only need bounding boxes. Combining
-    // by grabbing pixel location extremes is sufficient. May be a faster way
-    // to implement this.
-
-    // Find the parent group for each group.
-    bool changed = true;
-    while(changed)
-    {
-        changed = false;
-        for(int group=0; group<group_links_.size(); group++)
-        {
-            // Tell all linked groups the lowest linked group.
-            for(int owner=1; owner<group_links_.size(group); owner++)
-            {
-                // Insert in sorted order.
-                changed = true;
-                if(group_links_.get(group, owner) != group)
-                {
-                    bool new_link;
-                    new_link = group_links_.addLink(group_links_.get(group, owner),
-                                                      group_links_.get(group, 0));
-                    if(new_link)
-                    {
-                        push_heap(group_links_.begin(
-                            group_links_.get(group, owner)),
-                            group_links_.end(group_links_.get(group, owner)),
-                                                           std::greater<int>());
-                    }
-                }
-            }
-
-            // Delete all but the lowest owner.
-            group_links_.clearHigh(group);
-        }
-    }
-
-    // Apply combinations.
-    for(int group=group_links_.size()-1; group>=0; group--)
-    {
-        int owner = group_links_.get(group, 0);
-        if(owner != group)
-        {
-            group_counts_[owner] += group_counts_[group];
-            group_counts_[group] = 0;
-            if(group_low_xs_[group] < group_low_xs_[owner])
-                group_low_xs_[owner] = group_low_xs_[group];
-            if(group_low_ys_[group] < group_low_ys_[owner])
-                group_low_ys_[owner] = group_low_ys_[group];
-            if(group_high_xs_[group] > group_high_xs_[owner])
-                group_high_xs_[owner] = group_high_xs_[group];
-            if(group_high_ys_[group] > group_high_ys_[owner])
-                group_high_ys_[owner] = group_high_ys_[group];
-            if(group_top_y_[group] < group_top_y_[owner]) {
-                group_top_y_[owner] = group_top_y_[group];
-                group_top_x_[owner] = group_top_x_[group];
-            }
-        }
-    }
+    scratch.components.label(NotWhiteInsideMask(base_region, bdvb, circle),
+        base_region.getCols(), base_region.getRows());
 }
 
 bool BallDetector::shouldRunCrazyBallDetector(const VisionInfoIn& info_in)
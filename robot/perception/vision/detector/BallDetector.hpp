@@ -5,12 +5,13 @@
 
 #include "perception/vision/detector/DetectorInterface.hpp"
 #include "perception/vision/Region.hpp"
+#include "perception/vision/other/CircleFit.hpp"
 #include "types/VisionInfoOut.hpp"
-#include "types/GroupLinks.hpp"
 
 #include "types/RansacTypes.hpp"
-
-#define MAX_RES TOP_IMAGE_COLS*TOP_IMAGE_ROWS
+#include "utils/Cascade.hpp"
+#include "utils/ConnectedComponents.hpp"
+#include "utils/WorkerPool.hpp"
 
 #define NUM_ANGLE_BINS 8
 #define NUM_GREYSCALE_HISTOGRAM_BINS 16
@@ -23,14 +24,6 @@
 
 #endif // BALL_DETECTOR_USES_VDM
 
-enum PartialBallSide {
-    BALL_SIDE_LEFT = 0,
-    BALL_SIDE_TOP,
-    BALL_SIDE_RIGHT,
-    BALL_SIDE_BOTTOM,
-    BALL_SIDE_TOTAL
-};
-
 struct HOGFeatures {
     int angle_counts[NUM_ANGLE_BINS];
     int opposites[4];
@@ -264,10 +257,48 @@ struct BallDetectorVisionBundle {
 #endif // BALL_DETECTOR_USES_VDM
 };
 
+/* Per thread buffers for the connected component analysis of a candidate,
+ * kept between frames to avoid reallocation. */
+struct BallDetectorScratch {
+    // The groups found by the last CCA, with their sizes and bounding boxes.
+    ConnectedComponents<CCABoxStats> components;
+};
+
+/* A candidate being run through the ball cascade, and the worker's scratch.
+ * Also records which of the thresholds shared by several stages have been
+ * worked out, and whether they passed, so the stages can run in any order
+ * that has the circle fitted before it is used. */
+struct BallCandidate {
+    BallCandidate(BallDetectorVisionBundle *bdvb, BallDetectorScratch *scratch)
+        : bdvb(bdvb), scratch(scratch), region_otsu_done(false),
+          region_otsu_passed(false), circle_otsu_done(false),
+          circle_otsu_passed(false) {}
+
+    BallDetectorVisionBundle *bdvb;
+    BallDetectorScratch *scratch;
+    bool region_otsu_done;
+    bool region_otsu_passed;
+    bool circle_otsu_done;
+    bool circle_otsu_passed;
+};
+
 class BallDetector: public Detector {
     public:
 
-        BallDetector() : crazy_ball_cycle_(0), last_normal_ball_(0) {}
+        /**
+         * @param threads how many threads evaluate ball candidates, counting
+         * the vision thread; 0 means one per core and 1 runs serially
+         * @param extra_stages comma separated cascade stages to run as well
+         * as the standard ones, out of hog, pattern, sphereCheck and
+         * whiteDensity
+         * @param hough_circle_fit whether circles are fitted to candidates by
+         * hough voting and least squares instead of trying every circle
+         * @param track_ball whether to look where the last ball should now
+         * be before searching every region
+         */
+        explicit BallDetector(int threads = 1, const std::string &extra_stages = "",
+            bool hough_circle_fit = false, bool track_ball = false);
+        ~BallDetector();
 
         /**
          * detect implementation of abstract infterface function
@@ -296,7 +327,8 @@ class BallDetector: public Detector {
         void getSizeEst(BallDetectorVisionBundle &bdvb, const VisionInfoIn& info_in, VisionInfoOut& info_out);
 
         void processInternalRegions(const RegionI &baseRegion, BallDetectorVisionBundle &bdvb,
-            RANSACCircle &result_circle, InternalRegionFeatures &internal_regions);
+            RANSACCircle &result_circle, InternalRegionFeatures &internal_regions,
+            BallDetectorScratch &scratch);
 
         bool naiveROI(const VisionInfoIn& info_in, const RegionI& region, const VisionInfoMiddle& info_middle, VisionInfoOut& info_out, bool doReject, std::vector <BallDetectorVisionBundle> &res);
 
@@ -306,15 +338,13 @@ class BallDetector: public Detector {
 
         bool comboROI(const VisionInfoIn& info_in, const RegionI& region, const VisionInfoMiddle& info_middle, VisionInfoOut& info_out, bool doReject, std::vector <BallDetectorVisionBundle> &res);
 
-        // I know this is ugly copied code. But unless we template it (so the compiler knows about it and can inline)
-        // Not sure how to make this clean AND efficient
-
         void connectedComponentAnalysisWhite(const RegionI& base_region,
-            BallDetectorVisionBundle &bdvb);
+            BallDetectorVisionBundle &bdvb, BallDetectorScratch &scratch);
 
         void connectedComponentAnalysisNotWhiteAndInside(const RegionI& base_region,
             BallDetectorVisionBundle &bdvb,
-            RANSACCircle &circle);
+            RANSACCircle &circle,
+            BallDetectorScratch &scratch);
 
         bool checkPartialRegion(BallDetectorVisionBundle &bdvb);
 
@@ -325,7 +355,29 @@ class BallDetector: public Detector {
         void findBestCircleFit(BallDetectorVisionBundle &bdvb, float max_radius, std::vector<bool> **cons, std::vector <bool> cons_buf[2], float e, unsigned int n,
             float min_radius_prop, float step_size, PartialBallSide partial_ball_side);
     private:
-        float confidenceThatRegionIsBall(BallDetectorVisionBundle &bdvb);
+        float confidenceThatRegionIsBall(BallDetectorVisionBundle &bdvb,
+            BallDetectorScratch &scratch);
+
+        // Work out the candidate's region and in circle otsu thresholds, and
+        // judge them, unless another stage already has.
+        void regionOtsu(BallCandidate &candidate);
+        void circleOtsu(BallCandidate &candidate);
+
+        // Stages of cascade_, each returning false to reject the candidate.
+        bool regionOtsuStage(BallCandidate &candidate);
+        bool circleFitStage(BallCandidate &candidate);
+        bool circleOtsuStage(BallCandidate &candidate);
+        bool internalRegionsStage(BallCandidate &candidate);
+        bool hogStage(BallCandidate &candidate);
+        bool patternStage(BallCandidate &candidate);
+        bool sphereCheckStage(BallCandidate &candidate);
+        bool whiteDensityStage(BallCandidate &candidate);
+
+        // Logs how the cascade stages did over the last window and reorders
+        // them by it.
+        void updateCascade();
+
+        bool analyseOtsu(BallDetectorVisionBundle &bdvb);
 
         bool isHeadTiltedForward(VisionInfoOut& info_out);
 
@@ -355,33 +407,72 @@ class BallDetector: public Detector {
 
         bool shouldRunCrazyBallDetector(const VisionInfoIn& info_in);
 
-        // The set of links between groups generated during CCA. Here to avoid
-        // reallocation.
-        GroupLinks group_links_;
+        // The candidates of one frame, shared by the workers evaluating them.
+        struct CandidateBatch {
+            std::vector<BallDetectorVisionBundle> candidates;
+
+            // The confidence of each candidate, or 0 if it was skipped.
+            std::vector<float> confidences;
+
+            // The first candidate found to be a ball so far, or the number
+            // of candidates if none has been.
+            volatile unsigned int first_ball;
+        };
+
+        /**
+         * Finds balls as the serial loop in detect does, but evaluates the
+         * candidates of every region across the worker pool. Candidates,
+         * including rescaled regions and child foveas, are still generated
+         * serially; only their confidences are computed in parallel.
+         *
+         * @return whether a ball was found
+         */
+        bool detectInParallel(const VisionInfoIn& info_in, const VisionInfoMiddle& info_middle,
+            VisionInfoOut& info_out);
+
+        // Worker pool task computing the confidence of one candidate.
+        void evaluateCandidate(CandidateBatch *batch, unsigned int candidate, unsigned int worker);
+
+        // Sets the ball's image position from its final region and reports it.
+        void acceptBall(BallDetectorVisionBundle &bdvb, VisionInfoOut& info_out);
+
+        /**
+         * Looks for the ball in a window around where the last ball found
+         * should be now, moved by its velocity from localisation, zoomed in
+         * to full density as far as the window's size allows.
+         *
+         * @return whether a ball was found there
+         */
+        bool detectTracked(const VisionInfoIn& info_in, const VisionInfoMiddle& info_middle,
+            VisionInfoOut& info_out);
 
-        // The ID of the group for each pixel.
-        uint16_t groups_[MAX_RES];
+        // CCA buffers, one per worker so candidates can be evaluated in
+        // parallel. The first is the calling thread's.
+        std::vector<BallDetectorScratch *> scratch_;
 
-        // The number of pixels in each group.
-        std::vector<int> group_counts_;
+        // Evaluates candidates in parallel, or NULL to run serially.
+        WorkerPool *pool_;
 
-        // The smallest x value in each group.
-        std::vector<int> group_low_xs_;
+        // The features a candidate must pass to be a ball.
+        Cascade<BallCandidate> cascade_;
 
-        // The largest x value in each group.
-        std::vector<int> group_high_xs_;
+        // Frames since the cascade was last reordered.
+        int cascade_frames_;
 
-        // The smallest y value in each group.
-        std::vector<int> group_low_ys_;
+        // Per frame scratch memory that regions are allocated from, or NULL
+        // to use the heap.
+        FrameArena* arena_;
 
-        // The largest y value in each group.
-        std::vector<int> group_high_ys_;
+        // How findBestCircleFit and findLargestCircleFit search.
+        CircleFit::Method circle_fit_method_;
 
-        // The x value of the topmost pixel
-        std::vector<int> group_top_x_;
+        // Whether detect tries detectTracked first.
+        bool track_ball_;
 
-        // The y value of the topmost pixel
-        std::vector<int> group_top_y_;
+        // Where the last ball accepted was, robot relative cartesian (mm),
+        // and the frames since.
+        Point last_ball_rrc_;
+        int frames_since_ball_;
 
         int crazy_ball_cycle_;
         int last_normal_ball_;
@@ -92,7 +92,7 @@ void ClusterDetector::findRobot(Cluster& candidate, const VisionInfoIn& info_in,
             candidate.regions.size() > MIN_CLUSTER_SIZE) {
         // clusters should not extend over both top and bottom cameras so we can just check the first region
         Point pointForRR = Point(bb.b.x() - bb.a.x(),
-            bb.b.y() + (!candidate.regions[0].isTopCamera()) * TOP_IMAGE_ROWS);
+            bb.b.y() + (!candidate.top_camera) * TOP_IMAGE_ROWS);
 
         int robot_height = 0;
 
@@ -123,6 +123,7 @@ void ClusterDetector::findRobot(Cluster& candidate, const VisionInfoIn& info_in,
 
 void ClusterDetector::resetCluster(Cluster& cluster) {
     cluster.regions.clear();
+    cluster.top_camera = true;
     cluster.top = 0;
     cluster.bottom = 0;
     cluster.left = 0;
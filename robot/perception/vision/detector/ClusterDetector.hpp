@@ -20,7 +20,10 @@
 #define MIN_CLUSTER_SIZE 4
 
 struct Cluster {
-    std::vector<RegionI> regions;
+    // only the regions' raw bounding boxes are needed, so they are all that
+    // are copied, not the regions themselves
+    std::vector<BBox> regions;
+    bool top_camera;
     // all the values are raw
     int top;
     int bottom;
@@ -46,8 +49,11 @@ struct Cluster {
 
     void addRegionToCluster(const RegionI& region) {
         bool firstRegion = regions.size() == 0 ? true : false;
-        regions.push_back(region);
         BBox bb = region.getBoundingBoxRaw();
+        regions.push_back(bb);
+        if (firstRegion) {
+            top_camera = region.isTopCamera();
+        }
         if (top > bb.a.y() || firstRegion) {
             top = bb.a.y();
         }
@@ -68,6 +74,9 @@ struct Cluster {
     };
 
     void addClusterToCluster(Cluster& cluster) {
+        if (regions.size() == 0) {
+            top_camera = cluster.top_camera;
+        }
         regions.insert(regions.end(), cluster.regions.begin(), cluster.regions.end());
         if (cluster.top < top) {
             top = cluster.top;
@@ -89,9 +98,8 @@ struct Cluster {
         int region_size = 0;
         int region_size_bottom_half = 0; 
         int midpoint = (bottom + top)*2 / 3;
-        BBox current;
-        for (std::vector<RegionI>::iterator it = regions.begin(); it != regions.end(); it++) {
-            current = it->getBoundingBoxRaw();
+        for (std::vector<BBox>::iterator it = regions.begin(); it != regions.end(); it++) {
+            const BBox& current = *it;
             int size = current.height() * current.width();
 
             region_size += size;
@@ -33,7 +33,8 @@ using namespace std;
 #define LINES 1
 #define CIRCLES 2
 
-FieldLineDetectionLegacy::FieldLineDetectionLegacy()
+FieldLineDetectionLegacy::FieldLineDetectionLegacy(
+    const RANSAC::Options &ransac) : ransacOptions(ransac)
 {
 
     // Setup landmarks
@@ -1289,7 +1290,7 @@ void FieldLineDetectionLegacy::findFieldLinesAndCircles(const vector<FieldLinePo
         resultLine = RANSACLine(Point(0, 0), Point(0, 0));
         resultCircle = RANSACCircle(PointF(0, 0), 0.0);
         if (RANSAC::findLinesAndCircles(fieldPoints1, CENTER_CIRCLE_DIAMETER / 2, &con, resultLine, resultCircle,
-                                        k, e, n, consBuf, seed))
+                                        k, e, n, consBuf, seed, ransacOptions))
         {
 
             uint16_t b = 0;
@@ -1451,7 +1452,7 @@ void FieldLineDetectionLegacy::findFieldLinesInFovea(const vector<FieldLinePoint
         consBuf[1].clear();
         resultLine = RANSACLine(Point(0, 0), Point(0, 0));
         if (RANSAC::findLine(fieldPoints1, &con, resultLine,
-                             k, e, n, consBuf, seed))
+                             k, e, n, consBuf, seed, ransacOptions))
         {
 
             uint16_t b = 0;
@@ -11,7 +11,8 @@
 class FieldLineDetectionLegacy : public Detector
 {
   public:
-    FieldLineDetectionLegacy();
+    explicit FieldLineDetectionLegacy(
+        const RANSAC::Options &ransac = RANSAC::Options());
 
     // VictorW: HACK Wrapper
     void detect(const VisionInfoIn &info_in, const VisionInfoMiddle &info_middle, VisionInfoOut &info_out);
@@ -178,6 +179,9 @@ class FieldLineDetectionLegacy : public Detector
 
     const Fovea *topFovea;
     const Fovea *botFovea;
+
+    // Tuning for the line and centre circle RANSAC searches
+    RANSAC::Options ransacOptions;
 };
 
 struct cmpPoints
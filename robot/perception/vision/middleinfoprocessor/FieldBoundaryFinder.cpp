@@ -32,6 +32,7 @@ Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 
 #include <limits>
 
+#include "perception/vision/middleinfoprocessor/FieldBoundaryScan.hpp"
 #include "perception/vision/other/Ransac.hpp"
 #include "perception/vision/VisionDefinitions.hpp"
 
@@ -56,6 +57,7 @@ FieldBoundaryFinder::FieldBoundaryFinder() {
    // note, this is a lot faster than letting the vector resize itself
    boundaryPointsTop.reserve(TOP_SALIENCY_COLS);
    boundaryPointsBot.reserve(BOT_SALIENCY_COLS);
+   boundaryPointsRest.reserve(TOP_SALIENCY_COLS);
 }
 
 void FieldBoundaryFinder::find(const VisionInfoIn& info_in, VisionInfoMiddle& info_middle, VisionInfoOut& info_out) {
@@ -150,12 +152,9 @@ void FieldBoundaryFinder::fieldBoundaryPoints(
    int intercept = horizon_adj.first / fovea.getDensity();
 
    int i, j, start;
-   int colour_j;
-   int image_end, fovea_end;
+   int image_end;
    int horizon_ave;
    int fieldline_width_at_top;
-   int green_count, white_count, overshoot;
-   bool possible_fieldline;
 
 
    /* Calculate width of field line if it were to be present at the top of
@@ -199,15 +198,9 @@ void FieldBoundaryFinder::fieldBoundaryPoints(
    int cols = TOP_SALIENCY_COLS;
    if (!top) cols = BOT_SALIENCY_COLS;
    for (i = 0; i < cols; ++i) {
-      if (i != 0) {
-         greenTops[i] = greenTops[i - 1];
-      } else {
-         greenTops[0] = 0;
-      }
-
       float horizonIntercept = gradient * i + intercept;
       if (!top) horizonIntercept -= ROWS / fovea.getDensity();
-      start = std::min(std::max(0.0f, horizonIntercept), (float)(ROWS / fovea.getDensity())); //start of the scan must not got below the image
+      scanStart[i] = std::min(std::max(0.0f, horizonIntercept), (float)(ROWS / fovea.getDensity())); //start of the scan must not got below the image
 
       if (top) {
          image_end = info_in.cameraToRR.getTopEndScanCoord(
@@ -217,79 +210,49 @@ void FieldBoundaryFinder::fieldBoundaryPoints(
                      fovea.mapFoveaToImage(Point(i, 0)).x());
       }
 
-      fovea_end = fovea.mapImageToFovea(Point(0, image_end)).y();
-
-      white_count = 0;
-      overshoot   = 0;
+      scanEnd[i] = fovea.mapImageToFovea(Point(0, image_end)).y();
+   }
 
-      j = start;
-      colour_j = j;
+   /* Search every column for the field boundary at once */
+   fieldBoundaryScan(fovea.getFoveaColours(), fovea.getBBox().width(), cols,
+                     scanStart, scanEnd, consecutive_green, scanFound);
 
-      /* Test for fieldline at top of image */
-      possible_fieldline = false;
-      for (; j < fieldline_width_at_top; ++ j, ++ colour_j) {
-         if (fovea.getFoveaColour(i, colour_j) == cWHITE) {
-            possible_fieldline = true;
-            break;
-         }
+   for (i = 0; i < cols; ++i) {
+      if (i != 0) {
+         greenTops[i] = greenTops[i - 1];
+      } else {
+         greenTops[0] = 0;
       }
 
-      /* Now search for the field boundary */
-      green_count =  0;
-      white_count =  0;
-      overshoot   = -1;
-
-      colour_j -= (j - start);
-      j  = start;
-
-      // NOTE: REMOVE THIS AFTER BRAZIL, THIS IS A SPECIAL CASE FOR THE NICE BLACK BORDER WE GET
-      //bool seenBlack = false;
-      for (; j < fovea_end; ++ j, ++ colour_j) {
-         Colour c = fovea.getFoveaColour(i, colour_j);
-         //if (*c == cBLACK) seenBlack = true;
-         //if (!seenBlack) continue;
-
-         if (c == cGREEN) {
-            ++ green_count;
-            ++ overshoot;
-            white_count = 0;
-
-            if (green_count == consecutive_green) {
-               j -= overshoot;
-
-               /* Check that we didn't detect a fieldline */
-               if (possible_fieldline && j < start + fieldline_width_at_top) {
-                  break;
-               }
-               if (j != 0) {
-                  if (top) {
-                     boundaryPointsTop.push_back(Point(i, j) * fovea.getDensity());
-                  } else {
-                     Point p = Point(i, j) * fovea.getDensity();
-                     p.y() += ROWS;
-                     boundaryPointsBot.push_back(p);
-                  }
-               } else {
-                  ++ greenTops[i];
-               }
-
+      j = scanFound[i];
+      if (j < 0) {
+         continue;
+      }
+      start = scanStart[i];
+
+      /* Check that we didn't detect a fieldline */
+      if (j < start + fieldline_width_at_top) {
+         bool possible_fieldline = false;
+         for (int k = start; k < fieldline_width_at_top; ++ k) {
+            if (fovea.getFoveaColour(i, k) == cWHITE) {
+               possible_fieldline = true;
                break;
             }
-         } else if ((c == cWHITE || c == cBACKGROUND)
-                 && (white_count < 1 && green_count != 0))
-         {
-            /* Allow for white between two green pixels */
-            ++ overshoot;
-            ++ white_count;
-         } else if (c == cWHITE && green_count == 0) {
-            /* first pixel can be white */
-            overshoot   = 0;
-            white_count = 1;
+         }
+         if (possible_fieldline) {
+            continue;
+         }
+      }
+      if (j != 0) {
+         if (top) {
+            boundaryPointsTop.push_back(Point(i, j) * fovea.getDensity());
          } else {
-            green_count =  0;
-            white_count =  0;
-            overshoot   = -1;
+            Point p = Point(i, j) * fovea.getDensity();
+            p.y() += ROWS;
+            boundaryPointsBot.push_back(p);
          }
+      } else {
+         ++ greenTops[i];
       }
    }
 }
@@ -343,15 +306,15 @@ void FieldBoundaryFinder::fieldBoundaryLines(unsigned int *seed,
        * First remove points belonging to the first line
        * Then run RANSAC again
        */
-      std::vector<Point> boundaryPoints2;
+      boundaryPointsRest.clear();
       for (i = 0; i < boundaryPoints->size(); ++i) {
          if (! (*cons)[i]) {
-            boundaryPoints2.push_back(boundaryPoints->at(i));
+            boundaryPointsRest.push_back((*boundaryPoints)[i]);
          }
       }
 
       lines.resize(2);
-      if (! ransac(g, boundaryPoints2, &cons, lines[1], k, e, n, consBuf, seed)) {
+      if (! ransac(g, boundaryPointsRest, &cons, lines[1], k, e, n, consBuf, seed)) {
          lines.resize(1);
       }
 
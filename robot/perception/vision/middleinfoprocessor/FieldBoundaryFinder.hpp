@@ -55,6 +55,11 @@ class FieldBoundaryFinder : public MiddleInfoProcessor
       std::vector<Point> boundaryPointsTop;
       std::vector<Point> boundaryPointsBot;
 
+      /**
+       * The points left for a second line once the first line's are taken
+       **/
+      std::vector<Point> boundaryPointsRest;
+
       /**
        * The coordinates of the top of the field in the image
        * The coordinates are given in image coordinates
@@ -62,6 +67,15 @@ class FieldBoundaryFinder : public MiddleInfoProcessor
       int topStartScanCoords[IMAGE_COLS];
       int botStartScanCoords[IMAGE_COLS];
 
+      /**
+       * Each saliency column's rows to scan for the field boundary, from
+       * scanStart up to but not including scanEnd, and the row the
+       * boundary was found on, or -1 if it wasn't
+       **/
+      int scanStart[TOP_SALIENCY_COLS];
+      int scanEnd[TOP_SALIENCY_COLS];
+      int scanFound[TOP_SALIENCY_COLS];
+
       void find(const VisionInfoIn& info_in, VisionInfoMiddle& info_middle, VisionInfoOut& info_out);
 
       /**
@@ -0,0 +1,166 @@
+#include "perception/vision/middleinfoprocessor/FieldBoundaryScan.hpp"
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <limits>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+void fieldBoundaryScanScalar(const Colour *colour, int width, int cols,
+                             const int *start, const int *end,
+                             int consecutive_green, int *found)
+{
+   for (int x = 0; x < cols; ++x) {
+      found[x] = -1;
+
+      int green_count =  0;
+      int white_count =  0;
+      int overshoot   = -1;
+      for (int j = start[x]; j < end[x]; ++ j) {
+         Colour c = colour[x + j * width];
+
+         if (c == cGREEN) {
+            ++ green_count;
+            ++ overshoot;
+            white_count = 0;
+
+            if (green_count == consecutive_green) {
+               found[x] = j - overshoot;
+               break;
+            }
+         } else if ((c == cWHITE || c == cBACKGROUND)
+                 && (white_count < 1 && green_count != 0))
+         {
+            /* Allow for white between two green pixels */
+            ++ overshoot;
+            ++ white_count;
+         } else if (c == cWHITE && green_count == 0) {
+            /* first pixel can be white */
+            overshoot   = 0;
+            white_count = 1;
+         } else {
+            green_count =  0;
+            white_count =  0;
+            overshoot   = -1;
+         }
+      }
+   }
+}
+
+#ifdef __SSE2__
+
+/**
+ * Load sixteen colours as bytes.
+ */
+static inline __m128i loadColours(const Colour *colour)
+{
+   const __m128i *p = (const __m128i *)colour;
+   return _mm_packus_epi16(
+      _mm_packs_epi32(_mm_loadu_si128(p), _mm_loadu_si128(p + 1)),
+      _mm_packs_epi32(_mm_loadu_si128(p + 2), _mm_loadu_si128(p + 3)));
+}
+
+/**
+ * Lanes of a where mask is set, and of b elsewhere.
+ */
+static inline __m128i select(__m128i mask, __m128i a, __m128i b)
+{
+   return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+void fieldBoundaryScanSSE2(const Colour *colour, int width, int cols,
+                           const int *start, const int *end,
+                           int consecutive_green, int *found)
+{
+   const __m128i zero = _mm_setzero_si128();
+   const __m128i ones = _mm_set1_epi8(-1);
+   const __m128i one = _mm_set1_epi8(1);
+   const __m128i green = _mm_set1_epi8(cGREEN);
+   const __m128i white = _mm_set1_epi8(cWHITE);
+   const __m128i background = _mm_set1_epi8(cBACKGROUND);
+   const __m128i needed = _mm_set1_epi8(consecutive_green);
+
+   int x0 = 0;
+   for (; x0 + 16 <= cols; x0 += 16) {
+      // Each column's rows as 16 bit lanes, the first eight columns then
+      // the last, for the rows scanned to be packed into a byte mask
+      int16_t bounds[4][8];
+      int first = std::numeric_limits<int>::max();
+      int last = std::numeric_limits<int>::min();
+      for (int lane = 0; lane < 16; ++lane) {
+         found[x0 + lane] = -1;
+         bounds[lane / 8][lane % 8] = start[x0 + lane];
+         bounds[2 + lane / 8][lane % 8] = end[x0 + lane];
+         first = std::min(first, start[x0 + lane]);
+         last = std::max(last, end[x0 + lane]);
+      }
+      const __m128i startLo = _mm_loadu_si128((const __m128i *)bounds[0]);
+      const __m128i startHi = _mm_loadu_si128((const __m128i *)bounds[1]);
+      const __m128i endLo = _mm_loadu_si128((const __m128i *)bounds[2]);
+      const __m128i endHi = _mm_loadu_si128((const __m128i *)bounds[3]);
+
+      __m128i greens = zero;
+      __m128i whites = zero;
+      __m128i overshoot = ones;
+      __m128i done = zero;
+      for (int j = first; j < last; ++j) {
+         const __m128i row = _mm_set1_epi16(j);
+         __m128i active = _mm_packs_epi16(
+            _mm_andnot_si128(_mm_cmpgt_epi16(startLo, row),
+                             _mm_cmpgt_epi16(endLo, row)),
+            _mm_andnot_si128(_mm_cmpgt_epi16(startHi, row),
+                             _mm_cmpgt_epi16(endHi, row)));
+         active = _mm_andnot_si128(done, active);
+
+         const __m128i c = loadColours(colour + x0 + j * width);
+         const __m128i isGreen = _mm_cmpeq_epi8(c, green);
+         const __m128i isWhite = _mm_cmpeq_epi8(c, white);
+         const __m128i isBackground = _mm_cmpeq_epi8(c, background);
+         const __m128i noGreens = _mm_cmpeq_epi8(greens, zero);
+         const __m128i noWhites = _mm_cmpeq_epi8(whites, zero);
+
+         // The scalar branches: green, white or background between greens,
+         // a white first pixel, and anything else starting over
+         const __m128i between = _mm_andnot_si128(noGreens, _mm_and_si128(
+            noWhites, _mm_or_si128(isWhite, isBackground)));
+         const __m128i firstWhite = _mm_and_si128(isWhite, noGreens);
+         const __m128i counted = _mm_or_si128(isGreen, between);
+
+         const __m128i newGreens = _mm_and_si128(counted,
+            _mm_add_epi8(greens, _mm_and_si128(isGreen, one)));
+         const __m128i newWhites = _mm_and_si128(
+            _mm_or_si128(between, firstWhite), one);
+         const __m128i newOvershoot = select(counted,
+            _mm_add_epi8(overshoot, one), _mm_andnot_si128(firstWhite, ones));
+
+         greens = select(active, newGreens, greens);
+         whites = select(active, newWhites, whites);
+         overshoot = select(active, newOvershoot, overshoot);
+
+         const __m128i finished = _mm_and_si128(active, _mm_and_si128(
+            isGreen, _mm_cmpeq_epi8(newGreens, needed)));
+         int mask = _mm_movemask_epi8(finished);
+         if (mask) {
+            int8_t overshoots[16];
+            _mm_storeu_si128((__m128i *)overshoots, overshoot);
+            for (int lane = 0; lane < 16; ++lane) {
+               if (mask & (1 << lane)) {
+                  found[x0 + lane] = j - overshoots[lane];
+               }
+            }
+            done = _mm_or_si128(done, finished);
+            if (_mm_movemask_epi8(done) == 0xFFFF) {
+               break;
+            }
+         }
+      }
+   }
+
+   fieldBoundaryScanScalar(colour + x0, width, cols - x0, start + x0,
+                           end + x0, consecutive_green, found + x0);
+}
+
+#endif // __SSE2__
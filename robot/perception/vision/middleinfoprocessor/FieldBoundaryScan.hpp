@@ -0,0 +1,47 @@
+#ifndef PERCEPTION_VISION_MIDDLEINFOPROCESSOR_FIELD_BOUNDARY_SCAN
+#define PERCEPTION_VISION_MIDDLEINFOPROCESSOR_FIELD_BOUNDARY_SCAN
+
+#include "perception/vision/VisionDefinitions.hpp"
+
+/**
+ * Scans down each of the first cols columns of a colour classified image,
+ * width pixels to a row, for the first run of consecutive_green green
+ * pixels, as FieldBoundaryFinder::fieldBoundaryPoints does. A run may
+ * start with a white pixel, and one white or background pixel may come
+ * between greens.
+ *
+ * Column x is scanned from row start[x] up to but not including end[x].
+ * found[x] is set to the row its run starts on, or -1 if it has none.
+ */
+void fieldBoundaryScanScalar(const Colour *colour, int width, int cols,
+                             const int *start, const int *end,
+                             int consecutive_green, int *found);
+
+#ifdef __SSE2__
+/**
+ * SSE2 version of fieldBoundaryScanScalar. Scans sixteen columns at once a
+ * row at a time, each column keeping its own counts in a byte lane, and
+ * leaves any last columns short of sixteen to the scalar version. Produces
+ * identical output. consecutive_green must be under 64.
+ */
+void fieldBoundaryScanSSE2(const Colour *colour, int width, int cols,
+                           const int *start, const int *end,
+                           int consecutive_green, int *found);
+#endif
+
+/**
+ * Scan with the fastest version available on this target.
+ */
+inline void fieldBoundaryScan(const Colour *colour, int width, int cols,
+                              const int *start, const int *end,
+                              int consecutive_green, int *found) {
+#ifdef __SSE2__
+   fieldBoundaryScanSSE2(colour, width, cols, start, end, consecutive_green,
+                         found);
+#else
+   fieldBoundaryScanScalar(colour, width, cols, start, end,
+                           consecutive_green, found);
+#endif
+}
+
+#endif
@@ -0,0 +1,449 @@
+#include "CircleFit.hpp"
+
+#include <math.h>
+
+#include <algorithm>
+#include <limits>
+#include <set>
+
+using namespace std;
+
+namespace {
+
+/* The most circles HOUGH refines and scores */
+const int HOUGH_PEAKS = 3;
+
+/* The range of centres a circle of radius r may have */
+struct CentreBounds
+{
+   CentreBounds(float r, int cols, int rows, PartialBallSide side)
+      : x0(side == BALL_SIDE_LEFT ? 0 : r),
+        x1(cols - (side == BALL_SIDE_RIGHT ? 0 : r)),
+        y0(side == BALL_SIDE_TOP ? 0 : r),
+        y1(rows - (side == BALL_SIDE_BOTTOM ? 0 : r))
+   {
+   }
+
+   PointF clamp(const PointF &p) const
+   {
+      return PointF(std::max(x0, std::min(x1, p.x())),
+                    std::max(y0, std::min(y1, p.y())));
+   }
+
+   float x0, x1, y0, y1;
+};
+
+/**
+ * The variance of the points within sqrt(e2) of c, as RANSAC scores
+ * circles: their squared distances in each quadrant, plus the square of
+ * their imbalance either side of the circle, less their number.
+ */
+float circleVariance(const vector<Point> &points, const RANSACCircle &c,
+                     int e2, unsigned int *count)
+{
+   float pos_var[4] = {0, 0, 0, 0};
+   float neg_var[4] = {0, 0, 0, 0};
+   unsigned int n_concensus_points = 0;
+
+   for (unsigned int j = 0; j != points.size(); ++ j) {
+      const PointF &p = points[j].cast<float>();
+      const PointF &d = c.centre - p;
+
+      float dist = d.norm() - c.radius;
+      float dist2 = dist * dist;
+
+      if (dist2 < e2) {
+         int quadrant;
+         if (d.x() > 0) {
+            quadrant = (d.y() > 0) ? 0 : 3;
+         } else {
+            quadrant = (d.y() > 0) ? 1 : 2;
+         }
+
+         if (dist > 0) {
+            pos_var[quadrant] += dist2;
+         } else {
+            neg_var[quadrant] += dist2;
+         }
+         ++ n_concensus_points;
+      }
+   }
+
+   const float k = 0.2;
+
+   float var = 0;
+   for (int j = 0; j < 4; ++ j) {
+      float diff_var = pos_var[j] - neg_var[j];
+      var += pos_var[j] + neg_var[j] + diff_var * diff_var;
+   }
+
+   *count = n_concensus_points;
+   return (k * var) - n_concensus_points;
+}
+
+/**
+ * Whether the points within sqrt(e2) of c cover at least three quarters of
+ * the columns across its top half, and over half the rows down each side
+ * of it.
+ */
+bool circleCovered(const vector<Point> &points, const RANSACCircle &c,
+                   int e2)
+{
+   const float x_coverage_prop = 0.75;
+   const float y_coverage_prop = 0.55;
+
+   const float centre_x = c.centre.x();
+   const float centre_y = c.centre.y();
+   const float radius = c.radius;
+
+   std::set <int> x_values;
+   std::set <int> y_values_l;
+   std::set <int> y_values_r;
+
+   for (unsigned int j = 0; j != points.size(); ++ j) {
+      const Point &point = points[j];
+      const PointF &d = c.centre - point.cast<float>();
+
+      float dist = d.norm() - radius;
+      if (dist * dist < e2
+          && point.y() <= centre_y
+          && point.y() >= centre_y - radius
+          && point.x() >= centre_x - radius
+          && point.x() <= centre_x + radius) {
+         x_values.insert(point.x());
+
+         if (point.x() < centre_x) {
+            y_values_l.insert(point.y());
+         } else {
+            y_values_r.insert(point.y());
+         }
+      }
+   }
+
+   return x_values.size() >= x_coverage_prop * (2 * radius)
+       && y_values_l.size() >= y_coverage_prop * radius
+       && y_values_r.size() >= y_coverage_prop * radius;
+}
+
+/* The lowest variance circle of those considered with at least n inliers */
+struct BestCircle
+{
+   BestCircle(const vector<Point> &points, float e, unsigned int n)
+      : points(points), e(e), e2(e * e), n(n),
+        minerr(std::numeric_limits<float>::max()),
+        circle(PointF(0, 0), 0), found(false), scored(0)
+   {
+   }
+
+   void consider(RANSACCircle c)
+   {
+      unsigned int n_concensus_points;
+      c.var = circleVariance(points, c, e2, &n_concensus_points);
+      ++ scored;
+
+      if (c.var < minerr && n_concensus_points >= n) {
+         minerr = c.var;
+         c.var  = c.var / (points.size() * e);
+         circle = c;
+         found = true;
+      }
+   }
+
+   const vector<Point> &points;
+   const float e;
+   const int e2;
+   const unsigned int n;
+
+   /* error of best circle found so far */
+   float minerr;
+   RANSACCircle circle;
+   bool found;
+   int scored;
+};
+
+/**
+ * Finds the circles with the most points on them. Each point votes once
+ * for every cell x cell square its circle's centre could be in, at radii
+ * cell apart, and the best voted cells are taken, bar neighbours of better
+ * ones.
+ */
+void houghPeaks(const vector<Point> &points, int cols, int rows,
+                float max_radius, float min_radius, float cell,
+                PartialBallSide side, vector<RANSACCircle> &peaks)
+{
+   vector<float> radii;
+   for (float r = max_radius; r > min_radius; r -= cell) {
+      radii.push_back(r);
+   }
+   if (radii.empty()) {
+      return;
+   }
+
+   const float inv_cell = 1 / cell;
+   const int grid_cols = cols * inv_cell + 1;
+   const int grid_rows = rows * inv_cell + 1;
+   const int grid_size = grid_cols * grid_rows;
+   vector<int> votes(grid_size * radii.size(), 0);
+   vector<int> voter(grid_size * radii.size(), -1);
+
+   vector<float> dx, dy;
+   for (unsigned int b = 0; b < radii.size(); ++ b) {
+      const float r = radii[b];
+      // Centres are voted for to the nearest cell, so a region that only
+      // just fits the circle still gets votes
+      const CentreBounds bounds(r, cols, rows, side);
+      const float x0 = std::max(bounds.x0 - cell / 2, 0.0f);
+      const float x1 = std::min(bounds.x1 + cell / 2, (float)cols);
+      const float y0 = std::max(bounds.y0 - cell / 2, 0.0f);
+      const float y1 = std::min(bounds.y1 + cell / 2, (float)rows);
+      if (x0 > x1 || y0 > y1) {
+         continue;
+      }
+
+      // Step around the circle less than a cell at a time so no cell on
+      // it is missed
+      const int steps = std::max(8, (int)ceilf(3 * M_PI * r * inv_cell));
+      dx.resize(steps);
+      dy.resize(steps);
+      for (int a = 0; a < steps; ++ a) {
+         dx[a] = r * cosf(2 * M_PI * a / steps);
+         dy[a] = r * sinf(2 * M_PI * a / steps);
+      }
+
+      int *bin_votes = &votes[b * grid_size];
+      int *bin_voter = &voter[b * grid_size];
+      for (unsigned int j = 0; j != points.size(); ++ j) {
+         const float px = points[j].x();
+         const float py = points[j].y();
+         for (int a = 0; a < steps; ++ a) {
+            const float x = px + dx[a];
+            const float y = py + dy[a];
+            if (x < x0 || x > x1 || y < y0 || y > y1) {
+               continue;
+            }
+            const int i = (int)(x * inv_cell) +
+                          (int)(y * inv_cell) * grid_cols;
+            if (bin_voter[i] != (int)j) {
+               bin_voter[i] = j;
+               ++ bin_votes[i];
+            }
+         }
+      }
+   }
+
+   for (int peak = 0; peak < HOUGH_PEAKS; ++ peak) {
+      int best = -1;
+      int best_votes = 2;
+      for (unsigned int i = 0; i < votes.size(); ++ i) {
+         if (votes[i] > best_votes) {
+            best_votes = votes[i];
+            best = i;
+         }
+      }
+      if (best < 0) {
+         break;
+      }
+
+      const int b = best / grid_size;
+      const int gx = (best % grid_size) % grid_cols;
+      const int gy = (best % grid_size) / grid_cols;
+      const CentreBounds bounds(radii[b], cols, rows, side);
+      peaks.push_back(RANSACCircle(
+         bounds.clamp(PointF((gx + 0.5f) * cell, (gy + 0.5f) * cell)),
+         radii[b]));
+
+      // Neighbouring cells are mostly votes for the same circle
+      for (int nb = std::max(b - 1, 0);
+           nb <= std::min(b + 1, (int)radii.size() - 1); ++ nb) {
+         for (int ny = std::max(gy - 1, 0);
+              ny <= std::min(gy + 1, grid_rows - 1); ++ ny) {
+            for (int nx = std::max(gx - 1, 0);
+                 nx <= std::min(gx + 1, grid_cols - 1); ++ nx) {
+               votes[nb * grid_size + ny * grid_cols + nx] = 0;
+            }
+         }
+      }
+   }
+}
+
+/**
+ * Fits c to the points within tolerance of it by least squares, in the
+ * algebraic sense, a few times over, keeping its radius from min_radius to
+ * max_radius and its centre in bounds.
+ */
+RANSACCircle refineCircle(const vector<Point> &points, RANSACCircle c,
+                          float tolerance, float e, float max_radius,
+                          float min_radius, int cols, int rows,
+                          PartialBallSide side)
+{
+   for (int pass = 0; pass < 3; ++ pass) {
+      // Moments about the inliers' mean, for conditioning
+      float mx = 0, my = 0;
+      unsigned int n = 0;
+      for (unsigned int j = 0; j != points.size(); ++ j) {
+         const PointF &p = points[j].cast<float>();
+         if (fabsf((c.centre - p).norm() - c.radius) < tolerance) {
+            mx += p.x();
+            my += p.y();
+            ++ n;
+         }
+      }
+      if (n < 3) {
+         break;
+      }
+      mx /= n;
+      my /= n;
+
+      float suu = 0, svv = 0, suv = 0;
+      float suuu = 0, svvv = 0, suvv = 0, svuu = 0;
+      for (unsigned int j = 0; j != points.size(); ++ j) {
+         const PointF &p = points[j].cast<float>();
+         if (fabsf((c.centre - p).norm() - c.radius) < tolerance) {
+            const float u = p.x() - mx;
+            const float v = p.y() - my;
+            suu += u * u;
+            svv += v * v;
+            suv += u * v;
+            suuu += u * u * u;
+            svvv += v * v * v;
+            suvv += u * v * v;
+            svuu += v * u * u;
+         }
+      }
+
+      const float det = suu * svv - suv * suv;
+      if (fabsf(det) < 1e-6f) {
+         break;
+      }
+      const float bu = (suuu + suvv) / 2;
+      const float bv = (svvv + svuu) / 2;
+      const float uc = (bu * svv - bv * suv) / det;
+      const float vc = (bv * suu - bu * suv) / det;
+      const float radius = sqrtf(uc * uc + vc * vc + (suu + svv) / n);
+
+      c.radius = std::max(min_radius, std::min(max_radius, radius));
+      c.centre = CentreBounds(c.radius, cols, rows, side).clamp(
+         PointF(uc + mx, vc + my));
+      tolerance = e;
+   }
+   return c;
+}
+
+/**
+ * The circles worth scoring out of a HOUGH search: its peaks, and the
+ * peaks refined.
+ */
+void houghCandidates(const vector<Point> &points, int cols, int rows,
+                     float max_radius, float e, float min_radius_prop,
+                     float step_size, PartialBallSide side,
+                     vector<RANSACCircle> &candidates)
+{
+   const float min_radius = min_radius_prop * max_radius;
+   const float cell = std::max(step_size, 1.0f);
+
+   houghPeaks(points, cols, rows, max_radius, min_radius, cell, side,
+              candidates);
+
+   const unsigned int peaks = candidates.size();
+   for (unsigned int i = 0; i < peaks; ++ i) {
+      candidates.push_back(refineCircle(points, candidates[i], e + cell, e,
+                                        max_radius, min_radius, cols, rows,
+                                        side));
+   }
+}
+
+}
+
+bool CircleFit::findBest(const vector<Point> &points, int cols, int rows,
+                         float max_radius, float e, unsigned int n,
+                         float min_radius_prop, float step_size,
+                         PartialBallSide partial_ball_side, Method method,
+                         RANSACCircle &result, int *iterations)
+{
+   BestCircle best(points, e, n);
+
+   if (method == HOUGH) {
+      vector<RANSACCircle> candidates;
+      houghCandidates(points, cols, rows, max_radius, e, min_radius_prop,
+                      step_size, partial_ball_side, candidates);
+      for (unsigned int i = 0; i < candidates.size(); ++ i) {
+         best.consider(candidates[i]);
+      }
+   } else {
+      // Every centre such that the circle fits in the region, from the
+      // largest radius down
+      for (float curr_radius = max_radius;
+           curr_radius > min_radius_prop * max_radius; curr_radius -= 1) {
+         const CentreBounds bounds(curr_radius, cols, rows,
+                                   partial_ball_side);
+         for (float centre_x = bounds.x0; centre_x < bounds.x1 + 1;
+              centre_x += step_size) {
+            for (float centre_y = bounds.y0; centre_y < bounds.y1 + 1;
+                 centre_y += step_size) {
+               best.consider(
+                  RANSACCircle(PointF(centre_x, centre_y), curr_radius));
+            }
+         }
+      }
+   }
+
+   if (iterations != NULL) {
+      *iterations += best.scored;
+   }
+   if (best.found) {
+      result = best.circle;
+   }
+   return best.found;
+}
+
+bool CircleFit::findLargest(const vector<Point> &points, int cols, int rows,
+                            float max_radius, float e,
+                            float min_radius_prop, float step_size,
+                            PartialBallSide partial_ball_side, Method method,
+                            RANSACCircle &result, int *iterations)
+{
+   const int e2 = e * e;
+   int scored = 0;
+   bool found = false;
+
+   if (method == HOUGH) {
+      vector<RANSACCircle> candidates;
+      houghCandidates(points, cols, rows, max_radius, e, min_radius_prop,
+                      step_size, partial_ball_side, candidates);
+      for (unsigned int i = 0; i < candidates.size(); ++ i) {
+         ++ scored;
+         if ((! found || candidates[i].radius > result.radius) &&
+             circleCovered(points, candidates[i], e2)) {
+            result = candidates[i];
+            found = true;
+         }
+      }
+   } else {
+      // The first circle found, trying every centre such that the circle
+      // fits in the region, from the largest radius down
+      for (float curr_radius = max_radius;
+           ! found && curr_radius > min_radius_prop * max_radius;
+           curr_radius -= step_size) {
+         const CentreBounds bounds(curr_radius, cols, rows,
+                                   partial_ball_side);
+         for (float centre_x = bounds.x0;
+              ! found && centre_x < bounds.x1 + 1; centre_x += step_size) {
+            for (float centre_y = bounds.y0;
+                 ! found && centre_y < bounds.y1 + 1;
+                 centre_y += step_size) {
+               RANSACCircle c(PointF(centre_x, centre_y), curr_radius);
+               ++ scored;
+               if (circleCovered(points, c, e2)) {
+                  result = c;
+                  found = true;
+               }
+            }
+         }
+      }
+   }
+
+   if (iterations != NULL) {
+      *iterations += scored;
+   }
+   return found;
+}
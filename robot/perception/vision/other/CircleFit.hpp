@@ -0,0 +1,67 @@
+#ifndef PERCEPTION_VISION_CIRCLEFIT_H_
+#define PERCEPTION_VISION_CIRCLEFIT_H_
+
+#include <vector>
+
+#include "types/RansacTypes.hpp"
+#include "types/Point.hpp"
+
+/* The side of a region a ball is cut off by, if any */
+enum PartialBallSide {
+   BALL_SIDE_LEFT = 0,
+   BALL_SIDE_TOP,
+   BALL_SIDE_RIGHT,
+   BALL_SIDE_BOTTOM,
+   BALL_SIDE_TOTAL
+};
+
+/**
+ * Fits circles of a range of radii to a region's edge points, for the ball
+ * detector.
+ *
+ * The circles are centred so they fit in the cols x rows region, except
+ * that a circle may cross its partial_ball_side. Radii run from max_radius
+ * down to, but not including, min_radius_prop * max_radius.
+ *
+ * EXHAUSTIVE tries every centre on a step_size grid at every radius, scoring
+ * each against every point. HOUGH has each point vote for the centres and
+ * radii it could lie on, on a grid of step_size cells, then refines the
+ * few best voted circles by least squares and scores only those, which
+ * costs far less on regions much bigger than the ball.
+ */
+namespace CircleFit
+{
+   enum Method {
+      EXHAUSTIVE = 0,
+      HOUGH
+   };
+
+   /**
+    * Finds the circle of lowest variance that has at least n points within
+    * e of it. Exhaustively, radii step down by one pixel at a time.
+    *
+    * @param iterations if not NULL, incremented by the circles scored
+    * @return whether a circle was found, leaving result alone if not
+    */
+   bool findBest(const std::vector<Point> &points, int cols, int rows,
+                 float max_radius, float e, unsigned int n,
+                 float min_radius_prop, float step_size,
+                 PartialBallSide partial_ball_side, Method method,
+                 RANSACCircle &result, int *iterations = NULL);
+
+   /**
+    * Finds the largest circle whose points within e of it cover most of
+    * its top half, across and down each side. Exhaustively, this is the
+    * first such circle found stepping radii down by step_size.
+    *
+    * @param iterations if not NULL, incremented by the circles scored
+    * @return whether a circle was found, leaving result alone if not
+    */
+   bool findLargest(const std::vector<Point> &points, int cols, int rows,
+                    float max_radius, float e, float min_radius_prop,
+                    float step_size, PartialBallSide partial_ball_side,
+                    Method method, RANSACCircle &result,
+                    int *iterations = NULL);
+}
+
+#endif
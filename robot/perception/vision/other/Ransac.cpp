@@ -1,195 +1,483 @@
 #include "Ransac.hpp"
 #include "utils/basic_maths.hpp"
 
+#include <algorithm>
 #include <limits>
 #include <iostream>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif // __SSE2__
+
 using namespace std;
 
-bool RANSAC::findLine(const std::vector<Point>  &points,
-                 std::vector<bool>        **cons,
-                 RANSACLine                &result,
-                 unsigned int               k,
-                 float                      e,
-                 unsigned int               n,
-                 std::vector<bool>          cons_buf[2],
-                 unsigned int              *seed
-                )
+namespace {
+
+#ifdef __SSE2__
+/* Adds the four lanes of v */
+inline float sumLanes(__m128 v)
 {
-    return RANSAC::findLineConstrained(points, cons, result, k, e, n, cons_buf, seed, -1.f);
+   float lanes[4];
+   _mm_storeu_ps(lanes, v);
+   return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
 }
+#endif // __SSE2__
 
-
-bool RANSAC::findLineConstrained(const std::vector<Point>  &points,
-                      std::vector<bool>        **cons,
-                      RANSACLine                &result,
-                      unsigned int               k,
-                      float                      e,
-                      unsigned int               n,
-                      std::vector<bool>          cons_buf[2],
-                      unsigned int              *seed,
-                      float                      slopeConstraint
-                     )
+/**
+ * Scores points against the line t1 * x + t2 * y + t3 = 0. Points whose
+ * unnormalised distance is below limit are inliers, and their distances, or
+ * squared distances, are summed.
+ *
+ * Residuals score a point at a time with point(), or four at a time with
+ * block(), each returning a bit per inlier.
+ */
+class LineResidual
 {
-   if (points.size() < n || n < 2) {
-      return false;
-   }
-
-   /* error of best line found so far */
-   float minerr = std::numeric_limits<float>::max();
-
-   std::vector<bool> *best_concensus, *this_concensus;
-   best_concensus = &cons_buf[0];
+   public:
+      LineResidual(const RANSACLine &l, float limit, bool squared)
+         : t1(l.t1), t2(l.t2), t3(l.t3), limit(limit), squared(squared),
+           sum(0)
+      {
+#ifdef __SSE2__
+         t1s = _mm_set1_ps(t1);
+         t2s = _mm_set1_ps(t2);
+         t3s = _mm_set1_ps(t3);
+         limits = _mm_set1_ps(limit);
+         absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+         sums = _mm_setzero_ps();
+#endif // __SSE2__
+      }
 
-   unsigned int i, j;
+      inline int point(float x, float y)
+      {
+         const float dist = fabsf(t1 * x + t2 * y + t3);
+         if (dist < limit) {
+            sum += squared ? dist * dist : dist;
+            return 1;
+         }
+         return 0;
+      }
 
-   /**
-    * Randomly select 2 points and create a line
-    */
-   for (i = 0; i < k; ++ i) {
-      unsigned int p1, p2;
-      p1 = rand_r(seed) % points.size();
-      do {
-         p2 = rand_r(seed) % points.size();
-      } while (p1 == p2);
+      inline int block(const float *x, const float *y)
+      {
+#ifdef __SSE2__
+         __m128 dist = _mm_add_ps(_mm_add_ps(
+               _mm_mul_ps(t1s, _mm_loadu_ps(x)),
+               _mm_mul_ps(t2s, _mm_loadu_ps(y))), t3s);
+         dist = _mm_and_ps(dist, absMask);
+         const __m128 in = _mm_cmplt_ps(dist, limits);
+         if (squared) {
+            dist = _mm_mul_ps(dist, dist);
+         }
+         sums = _mm_add_ps(sums, _mm_and_ps(in, dist));
+         return _mm_movemask_ps(in);
+#else
+         return point(x[0], y[0]) | point(x[1], y[1]) << 1 |
+                point(x[2], y[2]) << 2 | point(x[3], y[3]) << 3;
+#endif // __SSE2__
+      }
 
-      RANSACLine l(points[p1], points[p2]);
-      float slope = -((float)l.t1) / ((float)l.t2);
-      if(slopeConstraint > 0.f && (slope < (1/slopeConstraint) || slope > slopeConstraint)) continue;
+      /* The summed distances of the inliers */
+      float total() const
+      {
+#ifdef __SSE2__
+         return sum + sumLanes(sums);
+#else
+         return sum;
+#endif // __SSE2__
+      }
 
-      /**
-       * figure out the variance (sum of distances of points from the line)
-       * could use dist() here, but since the denominator is consistent, we
-       * save time and implement it again here.
-       */
-      const float denom = sqrt(l.t1*l.t1 + l.t2*l.t2);
-      const float newe  = e*denom;
+   private:
+      const float t1, t2, t3;
+      const float limit;
+      const bool squared;
+      float sum;
+#ifdef __SSE2__
+      __m128 t1s, t2s, t3s, limits, absMask, sums;
+#endif // __SSE2__
+};
 
-      /**
-       * Choose the currently unused concensus buffer
-       */
-      if (best_concensus == &cons_buf[0]) {
-         this_concensus = &cons_buf[1];
-      } else {
-         this_concensus = &cons_buf[0];
+/**
+ * Scores points against a circle. Points whose squared distance from the
+ * circle is below e2 are inliers, and their squared distances are summed,
+ * rounded down to integers if truncate. With quadrants the sums are kept
+ * separately for each quadrant around the centre and each side of the
+ * circle.
+ */
+class CircleResidual
+{
+   public:
+      CircleResidual(PointF centre, float radius, float e2, bool truncate,
+                     bool quadrants)
+         : cx(centre.x()), cy(centre.y()), radius(radius), e2(e2),
+           truncate(truncate), quadrants(quadrants), sum(0)
+      {
+         for (int q = 0; q < 4; ++ q) {
+            pos[q] = neg[q] = 0;
+         }
+#ifdef __SSE2__
+         cxs = _mm_set1_ps(cx);
+         cys = _mm_set1_ps(cy);
+         radii = _mm_set1_ps(radius);
+         e2s = _mm_set1_ps(e2);
+         sums = _mm_setzero_ps();
+         for (int q = 0; q < 4; ++ q) {
+            posSums[q] = negSums[q] = _mm_setzero_ps();
+         }
+#endif // __SSE2__
       }
 
-      unsigned int n_concensus_points = 0;
-      for (j = 0; j != points.size(); ++ j) {
-         const Point &p = points[j];
-         float dist = (l.t1 * p.x() + l.t2 * p.y() + l.t3);
-
-         if (dist < 0) {
-            dist = -dist;
+      inline int point(float x, float y)
+      {
+         const float dx = cx - x;
+         const float dy = cy - y;
+         const float dist = sqrtf(dx * dx + dy * dy) - radius;
+         float dist2 = dist * dist;
+         if (!(dist2 < e2)) {
+            return 0;
          }
+         if (truncate) {
+            dist2 = (int)dist2;
+         }
+         if (quadrants) {
+            const int q = dx > 0 ? (dy > 0 ? 0 : 3) : (dy > 0 ? 1 : 2);
+            if (dist > 0) {
+               pos[q] += dist2;
+            } else {
+               neg[q] += dist2;
+            }
+         } else {
+            sum += dist2;
+         }
+         return 1;
+      }
 
-         if (dist < newe) {
-            l.var += dist;
-            ++ n_concensus_points;
-            (*this_concensus)[j] = true;
+      inline int block(const float *x, const float *y)
+      {
+#ifdef __SSE2__
+         const __m128 dx = _mm_sub_ps(cxs, _mm_loadu_ps(x));
+         const __m128 dy = _mm_sub_ps(cys, _mm_loadu_ps(y));
+         const __m128 dist = _mm_sub_ps(_mm_sqrt_ps(_mm_add_ps(
+               _mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy))), radii);
+         __m128 dist2 = _mm_mul_ps(dist, dist);
+
+         // An integer is below e2 exactly when its float was, so compare
+         // before truncating, which overflows far from the circle
+         const __m128 in = _mm_cmplt_ps(dist2, e2s);
+         if (truncate) {
+            dist2 = _mm_cvtepi32_ps(_mm_cvttps_epi32(dist2));
+         }
+         dist2 = _mm_and_ps(in, dist2);
+
+         if (quadrants) {
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 right = _mm_cmpgt_ps(dx, zero);
+            const __m128 up = _mm_cmpgt_ps(dy, zero);
+            const __m128 outside = _mm_cmpgt_ps(dist, zero);
+            const __m128 posDist2 = _mm_and_ps(outside, dist2);
+            const __m128 negDist2 = _mm_andnot_ps(outside, dist2);
+            __m128 quadrant[4];
+            quadrant[0] = _mm_and_ps(right, up);
+            quadrant[1] = _mm_andnot_ps(right, up);
+            quadrant[2] = _mm_andnot_ps(_mm_or_ps(right, up), in);
+            quadrant[3] = _mm_andnot_ps(up, right);
+            for (int q = 0; q < 4; ++ q) {
+               posSums[q] = _mm_add_ps(posSums[q],
+                                       _mm_and_ps(quadrant[q], posDist2));
+               negSums[q] = _mm_add_ps(negSums[q],
+                                       _mm_and_ps(quadrant[q], negDist2));
+            }
          } else {
-            (*this_concensus)[j] = false;
+            sums = _mm_add_ps(sums, dist2);
+         }
+         return _mm_movemask_ps(in);
+#else
+         return point(x[0], y[0]) | point(x[1], y[1]) << 1 |
+                point(x[2], y[2]) << 2 | point(x[3], y[3]) << 3;
+#endif // __SSE2__
+      }
+
+      /* The summed squared distances of the inliers */
+      float total() const
+      {
+#ifdef __SSE2__
+         return sum + sumLanes(sums);
+#else
+         return sum;
+#endif // __SSE2__
+      }
+
+      /* The findCircleOfRadius3P variance: the squared distances in each
+       * quadrant, plus the square of their imbalance across the circle */
+      float quadrantVariance() const
+      {
+         float var = 0;
+         for (int q = 0; q < 4; ++ q) {
+            float p = pos[q];
+            float n = neg[q];
+#ifdef __SSE2__
+            p += sumLanes(posSums[q]);
+            n += sumLanes(negSums[q]);
+#endif // __SSE2__
+            const float diff_var = p - n;
+            var += p + n + diff_var * diff_var;
          }
+         return var;
       }
-      l.var /= denom;
 
-      const float k = 0.2;
-      l.var = (k * l.var) - n_concensus_points;
-      if (l.var < minerr && n_concensus_points >= n) {
-         minerr = l.var;
-         l.var  = l.var / (points.size() * e);
-         result = l;
-         //std::cout << result.t1 << " " << result.t2 << " " << result.t3 << " " << result.var << std::endl;
-         best_concensus = this_concensus;
+   private:
+      const float cx, cy;
+      const float radius;
+      const float e2;
+      const bool truncate;
+      const bool quadrants;
+      float sum;
+      float pos[4], neg[4];
+#ifdef __SSE2__
+      __m128 cxs, cys, radii, e2s, sums;
+      __m128 posSums[4], negSums[4];
+#endif // __SSE2__
+};
+
+/**
+ * Scores every point against residual, a word of the consensus set at a
+ * time. Gives up, returning false, as soon as fewer than need points could
+ * be inliers.
+ */
+template <class Residual>
+bool scorePoints(const RANSAC::PointSet &points, Residual &residual,
+                 unsigned int need, RANSAC::Consensus &cons,
+                 unsigned int *count)
+{
+   const unsigned int size = points.size();
+   const float *xs = points.x();
+   const float *ys = points.y();
+   unsigned int inliers = 0;
+   unsigned int i = 0;
+   for (unsigned int w = 0; i < size; ++ w) {
+      const unsigned int end = std::min(i + 32, size);
+      uint32_t bits = 0;
+      unsigned int shift = 0;
+      for (; i + 4 <= end; i += 4, shift += 4) {
+         bits |= (uint32_t)residual.block(xs + i, ys + i) << shift;
+      }
+      for (; i < end; ++ i, ++ shift) {
+         bits |= (uint32_t)residual.point(xs[i], ys[i]) << shift;
+      }
+      *cons.word(w) = bits;
+      inliers += __builtin_popcount(bits);
+      if (inliers + (size - i) < need) {
+         return false;
       }
    }
+   *count = inliers;
+   return true;
+}
 
-   if (minerr < std::numeric_limits<float>::max()) {
-      *cons = best_concensus;
-      return true;
-   } else {
-      return false;
+/**
+ * The T(d,d) test: whether d random points are all inliers. Scores a copy
+ * of residual, so its sums are untouched.
+ */
+template <class Residual>
+bool pretest(const RANSAC::PointSet &points, Residual residual,
+             unsigned int d, unsigned int *seed)
+{
+   for (unsigned int i = 0; i < d; ++ i) {
+      const unsigned int j = rand_r(seed) % points.size();
+      if (! residual.point(points.x()[j], points.y()[j])) {
+         return false;
+      }
    }
+   return true;
 }
 
+/**
+ * The fewest inliers a model needs to beat minerr, when it scores at least
+ * offset less its number of inliers, and at least n.
+ */
+unsigned int inliersNeeded(float minerr, float offset, unsigned int n)
+{
+   const float bound = offset - minerr;
+   if (bound < 0) {
+      return n;
+   }
+   if (bound >= std::numeric_limits<unsigned int>::max()) {
+      return std::numeric_limits<unsigned int>::max();
+   }
+   return std::max(n, (unsigned int)floorf(bound) + 1);
+}
 
-bool RANSAC::findCircleOfRadius(
-      const std::vector<Point>  &points,
-      float                      radius,
-      std::vector<bool>        **cons,
-      RANSACCircle              &result,
-          unsigned int               k,
-      float                      e,
-      unsigned int               n,
-      std::vector<bool>          cons_buf[2],
-      unsigned int              *seed)
+/**
+ * Fits a line to the inliers of cons by total least squares, with its end
+ * points at the extremes of the inliers along it.
+ */
+bool fitLine(const std::vector<Point> &points, const RANSAC::Consensus &cons,
+             RANSACLine &line)
 {
-   if (points.size() < n || n < 2) {
+   double sx = 0, sy = 0;
+   unsigned int m = 0;
+   for (unsigned int j = 0; j < points.size(); ++ j) {
+      if (cons[j]) {
+         sx += points[j].x();
+         sy += points[j].y();
+         ++ m;
+      }
+   }
+   if (m < 2) {
       return false;
    }
+   const double mx = sx / m;
+   const double my = sy / m;
+
+   double sxx = 0, sxy = 0, syy = 0;
+   for (unsigned int j = 0; j < points.size(); ++ j) {
+      if (cons[j]) {
+         const double dx = points[j].x() - mx;
+         const double dy = points[j].y() - my;
+         sxx += dx * dx;
+         sxy += dx * dy;
+         syy += dy * dy;
+      }
+   }
 
-   const int e2 = e * e;
-
-   /* error of best circle found so far */
-   float minerr = std::numeric_limits<float>::max();
+   /* The direction of greatest spread */
+   const double angle = 0.5 * atan2(2 * sxy, sxx - syy);
+   const double ux = cos(angle);
+   const double uy = sin(angle);
+   double tmin = std::numeric_limits<double>::max();
+   double tmax = -tmin;
+   for (unsigned int j = 0; j < points.size(); ++ j) {
+      if (cons[j]) {
+         const double t = (points[j].x() - mx) * ux + (points[j].y() - my) * uy;
+         tmin = std::min(tmin, t);
+         tmax = std::max(tmax, t);
+      }
+   }
 
-   std::vector<bool> *best_concensus, *this_concensus;
-   best_concensus = &cons_buf[0];
+   const Point p1((int)round(mx + ux * tmin), (int)round(my + uy * tmin));
+   const Point p2((int)round(mx + ux * tmax), (int)round(my + uy * tmax));
+   if (p1 == p2) {
+      return false;
+   }
+   line = RANSACLine(p1, p2);
+   return true;
+}
 
-   unsigned int i, j;
+/**
+ * Scores a line for findLineConstrained: a fifth of the inliers' summed
+ * distance less their number. Returns false if it can't beat minerr.
+ */
+bool scoreLineConstrained(const RANSAC::PointSet &points, RANSACLine &l,
+                          float e, float minerr, unsigned int n,
+                          float slopeConstraint,
+                          const RANSAC::Options &options, unsigned int *seed,
+                          RANSAC::Consensus &cons, unsigned int *count)
+{
+   float slope = -((float)l.t1) / ((float)l.t2);
+   if (slopeConstraint > 0.f &&
+       (slope < (1/slopeConstraint) || slope > slopeConstraint)) {
+      return false;
+   }
 
    /**
-    * Randomly select 2 points and create a circle
+    * figure out the variance (sum of distances of points from the line)
+    * could use dist() here, but since the denominator is consistent, we
+    * save time and implement it again here.
     */
-   for (i = 0; i < k; ++ i) {
-      unsigned int p1, p2;
-      p1 = rand_r(seed) % points.size();
-      do {
-         p2 = rand_r(seed) % points.size();
-      } while (p1 == p2);
+   const float denom = sqrt(l.t1*l.t1 + l.t2*l.t2);
+   const float newe  = e*denom;
 
-      RANSACCircle c(points[p1], points[p2], radius);
-      Point centre = c.centre.cast<int>();
-      /**
-       * Choose the currently unused concensus buffer
-       */
-      if (best_concensus == &cons_buf[0]) {
-         this_concensus = &cons_buf[1];
-      } else {
-         this_concensus = &cons_buf[0];
-      }
-      unsigned int n_concensus_points = 0;
-      for (j = 0; j != points.size(); ++ j) {
-         const Point &p = points[j];
-         /* TODO(carl) look into integer version of this */
-         float dist = sqrt((centre - p).squaredNorm()) - radius;
-         int dist2 = dist * dist;
-         if (dist2 < e2) {
-            c.var += dist2;
-            ++ n_concensus_points;
-            (*this_concensus)[j] = true;
-         } else {
-            (*this_concensus)[j] = false;
+   LineResidual residual(l, newe, false);
+   if (options.preemptive &&
+       ! pretest(points, residual, options.preemptive, seed)) {
+      return false;
+   }
+   if (! scorePoints(points, residual, inliersNeeded(minerr, 0, n), cons,
+                     count)) {
+      return false;
+   }
+
+   const float k = 0.2;
+   l.var = (k * residual.total() / denom) - *count;
+   return l.var < minerr && *count >= n;
+}
+
+/**
+ * Moves a circle's centre to best fit the inliers of cons at its radius, by
+ * a few Gauss-Newton steps on their distances from the circle.
+ */
+bool fitCircleCentre(const std::vector<Point> &points,
+                     const RANSAC::Consensus &cons, RANSACCircle &circle)
+{
+   double cx = circle.centre.x();
+   double cy = circle.centre.y();
+   for (int step = 0; step < 5; ++ step) {
+      double jxx = 0, jxy = 0, jyy = 0, gx = 0, gy = 0;
+      for (unsigned int j = 0; j < points.size(); ++ j) {
+         if (! cons[j]) {
+            continue;
+         }
+         const double dx = cx - points[j].x();
+         const double dy = cy - points[j].y();
+         const double d = sqrt(dx * dx + dy * dy);
+         if (d == 0) {
+            continue;
          }
+         const double ux = dx / d;
+         const double uy = dy / d;
+         const double f = d - circle.radius;
+         jxx += ux * ux;
+         jxy += ux * uy;
+         jyy += uy * uy;
+         gx += ux * f;
+         gy += uy * f;
       }
-      const float k = 0.2;
-      c.var = (k * c.var) - n_concensus_points;
-      if (c.var < minerr && n_concensus_points >= n) {
-         minerr = c.var;
-         c.var  = c.var / (points.size() * e);
-         result = c;
-         best_concensus = this_concensus;
+      const double det = jxx * jyy - jxy * jxy;
+      if (fabs(det) < 1e-9) {
+         return false;
       }
+      cx -= (jyy * gx - jxy * gy) / det;
+      cy -= (jxx * gy - jxy * gx) / det;
    }
-   if (minerr < std::numeric_limits<float>::max()) {
-      *cons = best_concensus;
-      return true;
-   } else {
+   circle.centre = PointF(cx, cy);
+   circle.secondaryCentre = circle.centre;
+   return true;
+}
+
+/**
+ * Scores a circle for findCircleOfRadius: a fifth of the inliers' summed
+ * squared distance from the circle about its whole pixel centre, less their
+ * number. Returns false if it can't beat minerr.
+ */
+bool scoreCircleOfRadius(const RANSAC::PointSet &points, RANSACCircle &c,
+                         int e2, float minerr, unsigned int n,
+                         const RANSAC::Options &options, unsigned int *seed,
+                         RANSAC::Consensus &cons, unsigned int *count)
+{
+   Point centre = c.centre.cast<int>();
+
+   /* Squared distances were integers, so still truncate them */
+   CircleResidual residual(centre.cast<float>(), c.radius, e2, true, false);
+   if (options.preemptive &&
+       ! pretest(points, residual, options.preemptive, seed)) {
       return false;
    }
+   if (! scorePoints(points, residual, inliersNeeded(minerr, 0, n), cons,
+                     count)) {
+      return false;
+   }
+
+   const float k = 0.2;
+   c.var = (k * residual.total()) - *count;
+   return c.var < minerr && *count >= n;
 }
 
-bool RANSAC::findCircleOfRadius3P(
+/**
+ * As findCircleOfRadius3P, only drawing circles centred inside the bounds if
+ * bounded. Gives up after maxFails draws of the wrong radius if giveUp, and
+ * otherwise skips to the next iteration.
+ */
+bool findCircle3P(
       const std::vector<Point>  &points,
       float                      radius,
       float                      radius_e,
@@ -199,7 +487,15 @@ bool RANSAC::findCircleOfRadius3P(
       float                      e,
       unsigned int               n,
       std::vector<bool>          cons_buf[2],
-      unsigned int              *seed)
+      unsigned int              *seed,
+      const RANSAC::Options     &options,
+      bool                       bounded,
+      int min_bound_x,
+      int max_bound_x,
+      int min_bound_y,
+      int max_bound_y,
+      int                        maxFails,
+      bool                       giveUp)
 {
    if (points.size() < n || n < 3) {
       return false;
@@ -210,21 +506,20 @@ bool RANSAC::findCircleOfRadius3P(
    /* error of best circle found so far */
    float minerr = std::numeric_limits<float>::max();
 
-   std::vector<bool> *best_concensus, *this_concensus;
-   best_concensus = &cons_buf[0];
+   RANSAC::PointSet set(points);
+   RANSAC::Consensus best_concensus, this_concensus;
+   best_concensus.resize(points.size());
+   this_concensus.resize(points.size());
 
-   unsigned int i, j;
-
-   float pos_var[4], neg_var[4];
-
-   RANSACCircle c;
-   for (i = 0; i < k; ++ i) {
+   unsigned int iterations = k;
+   for (unsigned int i = 0; i < iterations; ++ i) {
       /**
        * Randomly select 3 points and create a circle
        */
+      RANSACCircle c;
       unsigned int p1, p2, p3;
       int radius_fails = 0;
-      while (radius_fails < 20) {
+      while (radius_fails < maxFails) {
          p1 = rand_r(seed) % points.size();
          do {
             p2 = rand_r(seed) % points.size();
@@ -235,110 +530,200 @@ bool RANSAC::findCircleOfRadius3P(
 
          RANSACCircle tmp(points[p1], points[p2], points[p3]);
 
-         if (! isnan(tmp.radius) && fabsf(tmp.radius - radius) <= radius_e) {
-            c = tmp;
-            break;
+         if (! bounded ||
+             (tmp.centre.x() >= min_bound_x && tmp.centre.x() <= max_bound_x &&
+              tmp.centre.y() >= min_bound_y && tmp.centre.y() <= max_bound_y)) {
+            if (! isnan(tmp.radius) && fabsf(tmp.radius - radius) <= radius_e) {
+               c = tmp;
+               break;
+            }
          }
 
          ++ radius_fails;
-
       }
-      if (radius_fails == 20) {
-         return false;
+      if (radius_fails == maxFails) {
+         if (giveUp) {
+            return false;
+         }
+         continue;
       }
 
-      /**
-       * Choose the currently unused concensus buffer
-       */
-      if (best_concensus == &cons_buf[0]) {
-         this_concensus = &cons_buf[1];
-      } else {
-         this_concensus = &cons_buf[0];
+      CircleResidual residual(c.centre, c.radius, e2, false, true);
+      if (options.preemptive &&
+          ! pretest(set, residual, options.preemptive, seed)) {
+         continue;
+      }
+      unsigned int n_concensus_points;
+      if (! scorePoints(set, residual, inliersNeeded(minerr, 0, n),
+                        this_concensus, &n_concensus_points)) {
+         continue;
       }
 
-      for (j = 0; j < 4; ++ j) {
-         pos_var[j] = neg_var[j] = 0;
+      c.var = (0.2f * residual.quadrantVariance()) - n_concensus_points;
+      if (c.var < minerr && n_concensus_points >= n) {
+         minerr = c.var;
+         c.var  = c.var / (points.size() * e);
+         result = c;
+         best_concensus.swap(this_concensus);
+         iterations = RANSAC::adaptiveIterations(options.confidence,
+               n_concensus_points, points.size(), 3, k);
       }
+   }
 
-      unsigned int n_concensus_points = 0;
-      for (j = 0; j != points.size(); ++ j) {
-         const PointF &p = points[j].cast<float>();
-         const PointF &d = c.centre - p;
-         /* TODO(carl) look into integer version of this */
-         float dist = d.norm() - c.radius;
-         float dist2 = dist * dist;
+   if (minerr < std::numeric_limits<float>::max()) {
+      best_concensus.copyTo(cons_buf[0], points.size());
+      *cons = &cons_buf[0];
+      return true;
+   } else {
+      return false;
+   }
+}
 
-         if (dist2 < e2) {
-            int quadrant = 0;
-            if (d.x() > 0) {
-               if (d.y() > 0) {
-                  quadrant = 0;
-               } else {
-                  quadrant = 3;
-               }
-            } else {
-               if (d.y() > 0) {
-                  quadrant = 1;
-               } else {
-                  quadrant = 2;
-               }
-            }
+}
 
-            if (dist > 0) {
-               pos_var[quadrant] += dist2;
-            } else {
-               neg_var[quadrant] += dist2;
-            }
+unsigned int RANSAC::adaptiveIterations(float confidence, unsigned int inliers,
+                                        unsigned int total,
+                                        unsigned int sampleSize,
+                                        unsigned int k)
+{
+   if (confidence <= 0 || confidence >= 1 || total == 0) {
+      return k;
+   }
+   const double allInliers = pow((double)inliers / total, (double)sampleSize);
+   if (allInliers <= 0) {
+      return k;
+   }
+   if (allInliers >= 1) {
+      return std::min(k, 1u);
+   }
+   const double needed = ceil(log(1 - confidence) / log(1 - allInliers));
+   return needed < k ? (unsigned int)needed : k;
+}
 
-            ++ n_concensus_points;
-            (*this_concensus)[j] = true;
-         } else {
-            (*this_concensus)[j] = false;
-         }
-      }
+void RANSAC::PointSet::assign(const std::vector<Point> &points)
+{
+   xs.resize(points.size());
+   ys.resize(points.size());
+   for (unsigned int i = 0; i < points.size(); ++ i) {
+      xs[i] = points[i].x();
+      ys[i] = points[i].y();
+   }
+}
+
+void RANSAC::Consensus::copyTo(std::vector<bool> &out,
+                               unsigned int size) const
+{
+   if (out.size() < size) {
+      out.resize(size);
+   }
+   for (unsigned int i = 0; i < size; ++ i) {
+      out[i] = (*this)[i];
+   }
+}
+
+bool RANSAC::findLine(const std::vector<Point>  &points,
+                 std::vector<bool>        **cons,
+                 RANSACLine                &result,
+                 unsigned int               k,
+                 float                      e,
+                 unsigned int               n,
+                 std::vector<bool>          cons_buf[2],
+                 unsigned int              *seed,
+                 const Options             &options
+                )
+{
+    return RANSAC::findLineConstrained(points, cons, result, k, e, n, cons_buf, seed, -1.f, options);
+}
+
+
+bool RANSAC::findLineConstrained(const std::vector<Point>  &points,
+                      std::vector<bool>        **cons,
+                      RANSACLine                &result,
+                      unsigned int               k,
+                      float                      e,
+                      unsigned int               n,
+                      std::vector<bool>          cons_buf[2],
+                      unsigned int              *seed,
+                      float                      slopeConstraint,
+                      const Options             &options
+                     )
+{
+   if (points.size() < n || n < 2) {
+      return false;
+   }
+
+   /* error of best line found so far */
+   float minerr = std::numeric_limits<float>::max();
+
+   PointSet set(points);
+   Consensus best_concensus, this_concensus;
+   best_concensus.resize(points.size());
+   this_concensus.resize(points.size());
 
-      const float k = 0.2;
+   /**
+    * Randomly select 2 points and create a line
+    */
+   unsigned int iterations = k;
+   for (unsigned int i = 0; i < iterations; ++ i) {
+      unsigned int p1, p2;
+      p1 = rand_r(seed) % points.size();
+      do {
+         p2 = rand_r(seed) % points.size();
+      } while (p1 == p2);
 
-      c.var = 0;
-      for (j = 0; j < 4; ++ j) {
-         float diff_var = pos_var[j] - neg_var[j];
-         c.var += pos_var[j] + neg_var[j] + diff_var * diff_var;
+      RANSACLine l(points[p1], points[p2]);
+      unsigned int n_concensus_points;
+      if (! scoreLineConstrained(set, l, e, minerr, n, slopeConstraint,
+                                 options, seed, this_concensus,
+                                 &n_concensus_points)) {
+         continue;
       }
 
-      c.var = (k * c.var) - n_concensus_points;
-      if (c.var < minerr && n_concensus_points >= n) {
-         minerr = c.var;
-         c.var  = c.var / (points.size() * e);
-         result = c;
-         best_concensus = this_concensus;
+      /* Refit to the inliers, keeping the refit if it's better still */
+      if (options.localOptimisation) {
+         RANSACLine refit;
+         unsigned int refit_points;
+         if (fitLine(points, this_concensus, refit) &&
+             scoreLineConstrained(set, refit, e, l.var, n, slopeConstraint,
+                                  Options(), seed, best_concensus,
+                                  &refit_points)) {
+            l = refit;
+            n_concensus_points = refit_points;
+            best_concensus.swap(this_concensus);
+         }
       }
+
+      minerr = l.var;
+      l.var  = l.var / (points.size() * e);
+      result = l;
+      best_concensus.swap(this_concensus);
+      iterations = adaptiveIterations(options.confidence, n_concensus_points,
+                                      points.size(), 2, k);
    }
 
    if (minerr < std::numeric_limits<float>::max()) {
-      *cons = best_concensus;
+      best_concensus.copyTo(cons_buf[0], points.size());
+      *cons = &cons_buf[0];
       return true;
    } else {
       return false;
    }
 }
 
-bool RANSAC::findCircleOfRadius3PInsideBounds(
+
+bool RANSAC::findCircleOfRadius(
       const std::vector<Point>  &points,
       float                      radius,
-      float                      radius_e,
       std::vector<bool>        **cons,
       RANSACCircle              &result,
-      unsigned int               k,
+          unsigned int               k,
       float                      e,
       unsigned int               n,
       std::vector<bool>          cons_buf[2],
       unsigned int              *seed,
-      int min_bound_x,
-      int max_bound_x,
-      int min_bound_y,
-      int max_bound_y)
+      const Options             &options)
 {
-   if (points.size() < n || n < 3) {
+   if (points.size() < n || n < 2) {
       return false;
    }
 
@@ -347,124 +732,97 @@ bool RANSAC::findCircleOfRadius3PInsideBounds(
    /* error of best circle found so far */
    float minerr = std::numeric_limits<float>::max();
 
-   std::vector<bool> *best_concensus, *this_concensus;
-   best_concensus = &cons_buf[0];
-
-   unsigned int i, j;
+   PointSet set(points);
+   Consensus best_concensus, this_concensus;
+   best_concensus.resize(points.size());
+   this_concensus.resize(points.size());
 
-   float pos_var[4], neg_var[4];
-
-   RANSACCircle c;
-   c.centre = PointF(0, 0);
-   c.radius = 0;
-   
-   for (i = 0; i < k; ++ i) {
-      /**
-       * Randomly select 3 points and create a circle
-       */
-      unsigned int p1, p2, p3;
-      int radius_fails = 0;
-      while (radius_fails < 40) {
-         p1 = rand_r(seed) % points.size();
-         do {
-            p2 = rand_r(seed) % points.size();
-         } while (p1 == p2);
-         do {
-            p3 = rand_r(seed) % points.size();
-         } while (p1 == p3 || p2 == p3);
-
-         RANSACCircle tmp(points[p1], points[p2], points[p3]);
-
-         if (tmp.centre.x() >= min_bound_x && tmp.centre.x() <= max_bound_x &&
-            tmp.centre.y() >= min_bound_y && tmp.centre.y() <= max_bound_y) {
-           if (! isnan(tmp.radius) && fabsf(tmp.radius - radius) <= radius_e) {
-              c = tmp;
-              break;
-           }
-         }
-
-         ++ radius_fails;
-
-      }
-      if (radius_fails == 20) {
-         return false;
-      }
-
-      /**
-       * Choose the currently unused concensus buffer
-       */
-      if (best_concensus == &cons_buf[0]) {
-         this_concensus = &cons_buf[1];
-      } else {
-         this_concensus = &cons_buf[0];
-      }
+   /**
+    * Randomly select 2 points and create a circle
+    */
+   unsigned int iterations = k;
+   for (unsigned int i = 0; i < iterations; ++ i) {
+      unsigned int p1, p2;
+      p1 = rand_r(seed) % points.size();
+      do {
+         p2 = rand_r(seed) % points.size();
+      } while (p1 == p2);
 
-      for (j = 0; j < 4; ++ j) {
-         pos_var[j] = neg_var[j] = 0;
+      RANSACCircle c(points[p1], points[p2], radius);
+      unsigned int n_concensus_points;
+      if (! scoreCircleOfRadius(set, c, e2, minerr, n, options, seed,
+                                this_concensus, &n_concensus_points)) {
+         continue;
       }
 
-      unsigned int n_concensus_points = 0;
-      for (j = 0; j != points.size(); ++ j) {
-         const PointF &p = points[j].cast<float>();
-         const PointF &d = c.centre - p;
-         /* TODO(carl) look into integer version of this */
-         float dist = d.norm() - c.radius;
-         float dist2 = dist * dist;
-
-         if (dist2 < e2) {
-            int quadrant = 0;
-            if (d.x() > 0) {
-               if (d.y() > 0) {
-                  quadrant = 0;
-               } else {
-                  quadrant = 3;
-               }
-            } else {
-               if (d.y() > 0) {
-                  quadrant = 1;
-               } else {
-                  quadrant = 2;
-               }
-            }
-
-            if (dist > 0) {
-               pos_var[quadrant] += dist2;
-            } else {
-               neg_var[quadrant] += dist2;
-            }
-
-            ++ n_concensus_points;
-            (*this_concensus)[j] = true;
-         } else {
-            (*this_concensus)[j] = false;
+      /* Refit to the inliers, keeping the refit if it's better still */
+      if (options.localOptimisation) {
+         RANSACCircle refit = c;
+         unsigned int refit_points;
+         if (fitCircleCentre(points, this_concensus, refit) &&
+             scoreCircleOfRadius(set, refit, e2, c.var, n, Options(), seed,
+                                 best_concensus, &refit_points)) {
+            c = refit;
+            n_concensus_points = refit_points;
+            best_concensus.swap(this_concensus);
          }
       }
 
-      const float k = 0.2;
-
-      c.var = 0;
-      for (j = 0; j < 4; ++ j) {
-         float diff_var = pos_var[j] - neg_var[j];
-         c.var += pos_var[j] + neg_var[j] + diff_var * diff_var;
-      }
-
-      c.var = (k * c.var) - n_concensus_points;
-      if (c.var < minerr && n_concensus_points >= n) {
-         minerr = c.var;
-         c.var  = c.var / (points.size() * e);
-         result = c;
-         best_concensus = this_concensus;
-      }
+      minerr = c.var;
+      c.var  = c.var / (points.size() * e);
+      result = c;
+      best_concensus.swap(this_concensus);
+      iterations = adaptiveIterations(options.confidence, n_concensus_points,
+                                      points.size(), 2, k);
    }
-
    if (minerr < std::numeric_limits<float>::max()) {
-      *cons = best_concensus;
+      best_concensus.copyTo(cons_buf[0], points.size());
+      *cons = &cons_buf[0];
       return true;
    } else {
       return false;
    }
 }
 
+bool RANSAC::findCircleOfRadius3P(
+      const std::vector<Point>  &points,
+      float                      radius,
+      float                      radius_e,
+      std::vector<bool>        **cons,
+      RANSACCircle              &result,
+      unsigned int               k,
+      float                      e,
+      unsigned int               n,
+      std::vector<bool>          cons_buf[2],
+      unsigned int              *seed,
+      const Options             &options)
+{
+   return findCircle3P(points, radius, radius_e, cons, result, k, e, n,
+                       cons_buf, seed, options, false, 0, 0, 0, 0, 20, true);
+}
+
+bool RANSAC::findCircleOfRadius3PInsideBounds(
+      const std::vector<Point>  &points,
+      float                      radius,
+      float                      radius_e,
+      std::vector<bool>        **cons,
+      RANSACCircle              &result,
+      unsigned int               k,
+      float                      e,
+      unsigned int               n,
+      std::vector<bool>          cons_buf[2],
+      unsigned int              *seed,
+      int min_bound_x,
+      int max_bound_x,
+      int min_bound_y,
+      int max_bound_y,
+      const Options             &options)
+{
+   return findCircle3P(points, radius, radius_e, cons, result, k, e, n,
+                       cons_buf, seed, options, true, min_bound_x,
+                       max_bound_x, min_bound_y, max_bound_y, 40, false);
+}
+
 // Commented out as these seems to be reminicent from Dave's Ball Detector (2016)
 // /* Note that this is essentially the same function as findCircleofRadius3P */
 // /* Except that we use the BallDetection getExpectedRadius function to determine */
@@ -609,6 +967,7 @@ bool RANSAC::findCircleOfRadius3PInsideBounds(
 //    }
 // }
 
+
 bool RANSAC::findLinesAndCircles(const std::vector<Point>  &points,
                       float                      radius,
                       std::vector<bool>        **cons,
@@ -618,7 +977,8 @@ bool RANSAC::findLinesAndCircles(const std::vector<Point>  &points,
                       float                      e,
                       unsigned int               n,
                       std::vector<bool>          cons_buf[2],
-                      unsigned int              *seed
+                      unsigned int              *seed,
+                      const Options             &options
                      )
 {
    if (points.size() < n || n < 2) {
@@ -629,28 +989,19 @@ bool RANSAC::findLinesAndCircles(const std::vector<Point>  &points,
    float minerr = std::numeric_limits<float>::max();
    const int e2 = e * e;
 
-   std::vector<bool> *best_concensus, *this_concensus;
-   best_concensus = &cons_buf[0];
-
-   unsigned int i, j;
+   PointSet set(points);
+   Consensus best_concensus, this_concensus;
+   best_concensus.resize(points.size());
+   this_concensus.resize(points.size());
 
    /**
     * Randomly select 2 points and create a line
     */
-   for (i = 0; i < k; ++ i) {
+   unsigned int iterations = k;
+   for (unsigned int i = 0; i < iterations; ++ i) {
       unsigned int p1, p2;
       p1 = rand_r(seed) % points.size();
       p2 = p1;
-/*
-      int count = 0;
-      while ((p1 == p2) ||
-            (DISTANCE_SQR(points[p1].x(), points[p1].y(),
-                          points[p2].x(), points[p2].y()) < (100*100))) {
-         p2 = rand_r(seed) % points.size();
-         count++;
-         if (count > 40) return false;
-      }
-*/
 
       while (p1 == p2) {
          p2 = rand_r(seed) % points.size();
@@ -666,60 +1017,25 @@ bool RANSAC::findLinesAndCircles(const std::vector<Point>  &points,
       const float denom = sqrt(l.t1*l.t1 + l.t2*l.t2);
       const float newe  = e*denom;
 
-      /**
-       * Choose the currently unused concensus buffer
-       */
-      if (best_concensus == &cons_buf[0]) {
-         this_concensus = &cons_buf[1];
-      } else {
-         this_concensus = &cons_buf[0];
-      }
-      float distsum = 0;
-      unsigned int n_concensus_points = 0;
-      for (j = 0; j != points.size(); ++ j) {
-         const Point &p = points[j];
-         float dist = (l.t1 * p.x() + l.t2 * p.y() + l.t3);
-
-         if (dist < 0) {
-            dist = -dist;
-         }
-
-         if (dist < newe) {
-            l.var += (dist*dist);
-            ++ n_concensus_points;
-            (*this_concensus)[j] = true;
-         } else {
-            (*this_concensus)[j] = false;
+      /* Lines score their inliers' summed squared distance over 100, less
+       * their number */
+      LineResidual lineResidual(l, newe, true);
+      unsigned int n_concensus_points;
+      if ((! options.preemptive ||
+           pretest(set, lineResidual, options.preemptive, seed)) &&
+          scorePoints(set, lineResidual, inliersNeeded(minerr, 0, n),
+                      this_concensus, &n_concensus_points)) {
+         l.var = -(float)n_concensus_points;
+         l.var += lineResidual.total() / (denom * denom) / 100;
+         if (l.var < minerr && n_concensus_points >= n) {
+            minerr = l.var;
+            resultLine = l;
+            best_concensus.swap(this_concensus);
+            iterations = adaptiveIterations(options.confidence,
+                                            n_concensus_points,
+                                            points.size(), 2, k);
          }
       }
-      l.var /= (denom * denom);
-      distsum = l.var;
-      //const float k = 0.2;
-      //l.var = (k * l.var) - n_concensus_points;
-      //l.var /= (n_concensus_points/2);
-      //l.var -= (n_concensus_points/points.size());
-      l.var = n_concensus_points;
-      l.var *= -1;
-      //std::cout << "l.var1 = " << l.var << std::endl;
-      l.var += distsum / 100;
-      //std::cout << "l.var2 = " << l.var << std::endl;
-      if (l.var < minerr && n_concensus_points >= n) {
-         minerr = l.var;
-         resultLine = l;
-         //std::cout << "line var = " << l.var
-         //          << " and distsum = " << distsum << std::endl;
-         //std::cout << result.t1 << " " << result.t2 << " " << result.t3 << " " << result.var << std::endl;
-         best_concensus = this_concensus;
-      }
-
-//      int count = 0;
-//      while ((p1 == p2) ||
-//            (DISTANCE_SQR(points[p1].x(), points[p1].y(),
-//                          points[p2].x(), points[p2].y()) < (200*200))) {
-//         p2 = rand_r(seed) % points.size();
-//         count++;
-//         if (count > 40) return false;
-//      }
 
       // Also try and find a circle through those two points
       RANSACCircle c(points[p1], points[p2], radius);
@@ -728,68 +1044,36 @@ bool RANSAC::findLinesAndCircles(const std::vector<Point>  &points,
       }
       Point centre = c.centre.cast<int>();
 
-      //
-      // Choose the currently unused concensus buffer
-      //
-      if (best_concensus == &cons_buf[0]) {
-         this_concensus = &cons_buf[1];
-      } else {
-         this_concensus = &cons_buf[0];
-      }
-
-      n_concensus_points = 0;
-/*
-      float point_dist = sqrt((points[p1] - points[p2]).squaredNorm());
-      std::cout << "p1 = " << p1 << " p2 = " << p2 << std::endl;
-      std::cout << "p1 = ( " << points[p1].x() << ", " << points[p1].y()
-                << ")" << std::endl;
-      std::cout << "p2 = ( " << points[p2].x() << ", " << points[p2].y()
-                << ")" << std::endl;
-      std::cout << "points dist = " << point_dist << std::endl;
-      std::cout << "centre = ( " << centre.x() << ", " << centre.y()
-                << ")" << std::endl;
-*/
-      for (j = 0; j != points.size(); ++ j) {
-         const Point &p = points[j];
-         // TODO(carl) look into integer version of this
-         float dist = sqrt((centre - p).squaredNorm()) - radius;
-         float dist2 = dist*dist;
-//         std::cout << "j = " << j << " and dist = " << dist << std::endl;
-
-         if (dist2 < e2) {
-            c.var += dist2;
-            ++ n_concensus_points;
-            (*this_concensus)[j] = true;
-         } else {
-            (*this_concensus)[j] = false;
-         }
+      /* Circles score the same, plus 8 */
+      CircleResidual circleResidual(centre.cast<float>(), radius, e2, false,
+                                    false);
+      if (options.preemptive &&
+          ! pretest(set, circleResidual, options.preemptive, seed)) {
+         continue;
       }
-      distsum = c.var;
-      //c.var = (k * c.var) - n_concensus_points;
-      //c.var /= (n_concensus_points * n_concensus_points);
-
-      if (n_concensus_points == 0) {
-         //std::cout << "no points in ransac circle :(" << std::endl;
+      if (! scorePoints(set, circleResidual,
+                        inliersNeeded(minerr, 8, std::max(n, 1u)),
+                        this_concensus, &n_concensus_points)) {
          continue;
       }
 
-      //c.var /= (n_concensus_points/2);
-      //c.var -= (n_concensus_points/points.size());
       c.var = n_concensus_points;
       c.var *= -1;
-      c.var += 8 + distsum / 100;
+      c.var += 8 + circleResidual.total() / 100;
       if (c.var < minerr && n_concensus_points >= n) {
          minerr = c.var;
          resultCircle = c;
-         best_concensus = this_concensus;
-         //std::cout << "circle var = " << c.var
-         //          << " and distsum = " << distsum << std::endl;
+         best_concensus.swap(this_concensus);
+         iterations = adaptiveIterations(options.confidence,
+                                         n_concensus_points, points.size(),
+                                         2, k);
       }
 
    }
 
    if (minerr < std::numeric_limits<float>::max()) {
-      *cons = best_concensus;
+      best_concensus.copyTo(cons_buf[0], points.size());
+      *cons = &cons_buf[0];
       return true;
    } else {
       return false;
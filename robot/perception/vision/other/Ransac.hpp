@@ -1,6 +1,8 @@
 #ifndef PERCEPTION_VISION_RANSAC_H_
 #define PERCEPTION_VISION_RANSAC_H_
 
+#include <stdint.h>
+
 #include <vector>
 
 #include "types/RansacTypes.hpp"
@@ -8,6 +10,104 @@
 
 namespace RANSAC
 {
+   /**
+    * Tuning shared by the RANSAC searches.
+    *
+    * By default a search draws all k models, as it always has. It can
+    * instead stop once it is confidence sure of having drawn a sample of
+    * only inliers, judged by the inlier ratio of the best model so far.
+    * Each model's scoring stops as soon as it can no longer beat the best,
+    * which never changes the result. TestRansac's benchmarks compare each
+    * option against the search as it was before any of them.
+    */
+   struct Options
+   {
+      Options() : confidence(0), preemptive(0), localOptimisation(false)
+      {
+      }
+
+      /* Stop once this sure of an all inlier sample, 0 to always run k */
+      float confidence;
+
+      /* If nonzero, a model must fit this many random points before the
+       * rest are scored (the T(d,d) test), trading some accuracy for speed
+       * when most models are bad */
+      unsigned int preemptive;
+
+      /* Refit each new best line, or circle of known radius, to its inliers
+       * by least squares, and keep the refit if it scores better
+       * (LO-RANSAC) */
+      bool localOptimisation;
+   };
+
+   /**
+    * The number of iterations needed to be confidence sure of drawing a
+    * sample of sampleSize points that are all inliers, when inliers of total
+    * points are, capped at k.
+    */
+   unsigned int adaptiveIterations(float confidence, unsigned int inliers,
+                                   unsigned int total, unsigned int sampleSize,
+                                   unsigned int k);
+
+   /**
+    * Points as separate x and y arrays of floats, so residuals are scored
+    * four points at a time.
+    */
+   class PointSet
+   {
+      public:
+         PointSet() {}
+         explicit PointSet(const std::vector<Point> &points) { assign(points); }
+
+         void assign(const std::vector<Point> &points);
+
+         unsigned int size() const { return xs.size(); }
+         const float *x() const { return &xs[0]; }
+         const float *y() const { return &ys[0]; }
+
+      private:
+         std::vector<float> xs;
+         std::vector<float> ys;
+   };
+
+   /**
+    * A consensus set, a bit per point packed 32 to a word.
+    */
+   class Consensus
+   {
+      public:
+         Consensus() {}
+
+         void resize(unsigned int size) { words.resize((size + 31) / 32); }
+
+         bool operator[](unsigned int i) const
+         {
+            return (words[i / 32] >> (i % 32)) & 1;
+         }
+
+         void set(unsigned int i, bool inlier)
+         {
+            if (inlier) {
+               words[i / 32] |= 1u << (i % 32);
+            } else {
+               words[i / 32] &= ~(1u << (i % 32));
+            }
+         }
+
+         uint32_t *word(unsigned int w) { return &words[w]; }
+
+         void swap(Consensus &other) { words.swap(other.words); }
+
+         /**
+          * Writes the first size bits into the caller's consensus buffer,
+          * which the search functions return through cons.
+          */
+         void copyTo(std::vector<bool> &out, unsigned int size) const;
+
+      private:
+         std::vector<uint32_t> words;
+   };
+
    /**
     * Ransac generators
     */
@@ -66,6 +166,9 @@ namespace RANSAC
    template <> class Generator<RANSACLine>
    {
    public:
+      /* The number of points drawn for each model */
+      static const unsigned int SAMPLE_SIZE = 2;
+
       bool operator() (
             RANSACLine &item,
             const std::vector<Point> &points,
@@ -86,6 +189,7 @@ namespace RANSAC
     *                   concensus set
     * @param n          The minimum number of points needed to form a concensus set
     * @param            seed A seed value
+    * @param options    Termination and scoring tuning, see Options
     **/
    bool findLine(const std::vector<Point>  &points,
                  std::vector<bool>        **cons,
@@ -94,7 +198,8 @@ namespace RANSAC
                  float                      e,
                  unsigned int               n,
                  std::vector<bool>          cons_buf[2],
-                 unsigned int              *seed
+                 unsigned int              *seed,
+                 const Options             &options = Options()
                 );
 
    /**
@@ -110,7 +215,8 @@ namespace RANSAC
                  unsigned int               n,
                  std::vector<bool>          cons_buf[2],
                  unsigned int              *seed,
-                 float                      slopeConstraint
+                 float                      slopeConstraint,
+                 const Options             &options = Options()
                 );
 
    /**
@@ -128,6 +234,7 @@ namespace RANSAC
     *                   concensus set
     * @param n          The minimum number of points needed to form a concensus set
     * @param            seed A seed value
+    * @param options    Termination and scoring tuning, see Options
     **/
    bool findCircleOfRadius(const std::vector<Point>  &points,
                            float                      radius,
@@ -137,7 +244,8 @@ namespace RANSAC
                            float                      e,
                            unsigned int               n,
                            std::vector<bool>          cons_buf[2],
-                           unsigned int              *seed
+                           unsigned int              *seed,
+                           const Options             &options = Options()
                           );
 
       /**
@@ -155,6 +263,7 @@ namespace RANSAC
        *                   concensus set
        * @param n          The minimum number of points needed to form a concensus set
        * @param            seed A seed value
+       * @param options    Termination and scoring tuning, see Options
        **/
       bool findLinesAndCircles(const std::vector<Point>  &points,
                                      float                      radius,
@@ -165,7 +274,8 @@ namespace RANSAC
                                      float                      e,
                                      unsigned int               n,
                                      std::vector<bool>          cons_buf[2],
-                                     unsigned int              *seed
+                                     unsigned int              *seed,
+                                     const Options             &options = Options()
                                     );
    /**
     * Implementation of the RANSAC algorithm for finding a circle with a
@@ -183,6 +293,7 @@ namespace RANSAC
     *                   concensus set
     * @param n          The minimum number of points needed to form a concensus set
     * @param            seed A seed value
+    * @param options    Termination and scoring tuning, see Options
     **/
    bool findCircleOfRadius3P(const std::vector<Point>  &points,
                              float                      radius,
@@ -193,7 +304,8 @@ namespace RANSAC
                              float                      e,
                              unsigned int               n,
                              std::vector<bool>          cons_buf[2],
-                             unsigned int              *seed
+                             unsigned int              *seed,
+                             const Options             &options = Options()
                             );
 
    // Same as above but reject circles with centre outside the given bounds
@@ -210,7 +322,8 @@ namespace RANSAC
                              int min_bound_x,
                              int max_bound_x,
                              int min_bound_y,
-                             int max_bound_y
+                             int max_bound_y,
+                             const Options             &options = Options()
                             );
 
     // Commented out as these seems to be a ball detection algorithm from Dave's Ball Detector (2016)
@@ -253,7 +366,8 @@ namespace RANSAC
             float                      e,
             unsigned int               n,
             std::vector<bool>          cons_buf[2],
-            unsigned int              *seed
+            unsigned int              *seed,
+            const Options             &options = Options()
            );
    };
 
@@ -8,7 +8,8 @@ bool RANSAC::Ransac<T, G, A>::operator () (
       float                      e,
       unsigned int               n,
       std::vector<bool>          cons_buf[2],
-      unsigned int              *seed
+      unsigned int              *seed,
+      const Options             &options
      )
 {
    if (points.size() < n)
@@ -19,36 +20,27 @@ bool RANSAC::Ransac<T, G, A>::operator () (
    /* error of best line found so far */
    float minerr = std::numeric_limits<float>::max();
 
-   std::vector<bool> *best_concensus, *this_concensus;
-   best_concensus = &cons_buf[0];
-
+   /* Acceptors take a point at a time, so only options.confidence applies */
+   Consensus best_concensus, this_concensus;
+   best_concensus.resize(points.size());
+   this_concensus.resize(points.size());
 
    unsigned int i, j;
-   for (i = 0; i < k; ++ i) {
+   unsigned int iterations = k;
+   for (i = 0; i < iterations; ++ i) {
       /* Generate a model */
       T model;
       if (! generator(model, points, seed)) {
          break;
       }
 
-      /* Choose the currently unused concensus buffer */
-      if (best_concensus == &cons_buf[0]) {
-         this_concensus = &cons_buf[1];
-      } else {
-         this_concensus = &cons_buf[0];
-      }
-
       unsigned int n_concensus_points = 0;
       A acceptor(model, e);
 
       for (j = 0; j < points.size(); ++ j) {
-         const Point &p = points[j];
-         if (acceptor.accept(p)) {
-            ++ n_concensus_points;
-            (*this_concensus)[j] = true;
-         } else {
-            (*this_concensus)[j] = false;
-         }
+         const bool inlier = acceptor.accept(points[j]);
+         this_concensus.set(j, inlier);
+         n_concensus_points += inlier;
       }
 
       acceptor.finalise();
@@ -59,12 +51,16 @@ bool RANSAC::Ransac<T, G, A>::operator () (
       if (model.var < minerr && n_concensus_points >= n) {
          minerr = model.var;
          result = model;
-         best_concensus = this_concensus;
+         best_concensus.swap(this_concensus);
+         iterations = adaptiveIterations(options.confidence,
+                                         n_concensus_points, points.size(),
+                                         G::SAMPLE_SIZE, k);
       }
    }
 
    if (minerr < std::numeric_limits<float>::max()) {
-      *cons = best_concensus;
+      best_concensus.copyTo(cons_buf[0], points.size());
+      *cons = &cons_buf[0];
       return true;
    } else {
       return false;
@@ -8,6 +8,7 @@ Created on Fri Oct 07 10:22:53 2016
 #include <stdint.h>
 #include <algorithm>
 #include <cstdlib>
+#include <cstring>
 #include <cmath>
 #include <string>
 #include <ctime>
@@ -125,52 +126,69 @@ void ColourROI::find(const VisionInfoIn& info_in, VisionInfoMiddle& info_middle,
     }
 }
 
-// Finds ROI in just the top or bottom image.
-template<int cols, int rows> inline void
-                ColourROI::findROIImage_(const RegionI& region,
-                    std::vector<RegionI>& regions_out, VisionInfoOut& info_out)
+// White pixels below the field boundary, the foreground of ColourROI's CCA.
+class WhiteBelowFieldBoundary
 {
-    // Reset group_links for use.
-    group_links_.fullReset();
-
-    // Clear the data vectors (hopefully leaving space allocated).
+public:
+    WhiteBelowFieldBoundary(const Colour* colours, int width,
+                           const int* col_starts) : colours_(colours),
+                                     width_(width), col_starts_(col_starts) {}
 
-    // The number of pixels in each group.
-    group_counts_.clear();
+    inline void row(int y, int cols, uint8_t* mask) const
+    {
+        const Colour* colour = colours_ + y*width_;
+        for(int x=0; x<cols; ++x)
+            mask[x] = (y > col_starts_[x]) & (colour[x] == cWHITE);
+    }
 
-    // The smallest x value in each group.
-    group_low_xs_.clear();
+private:
+    const Colour* colours_;
+    int width_;
+    const int* col_starts_;
+};
 
-    // The largest x value in each group.
-    group_high_xs_.clear();
+// As WhiteBelowFieldBoundary, but from the fovea's runs, so runs of green cost
+// one step each.
+class WhiteRunsBelowFieldBoundary
+{
+public:
+    WhiteRunsBelowFieldBoundary(const ColourRuns* runs, int x0, int y0,
+                                const int* col_starts) : runs_(runs), x0_(x0),
+                                               y0_(y0), col_starts_(col_starts) {}
 
-    // The smallest y value in each group.
-    group_low_ys_.clear();
+    inline void row(int y, int cols, uint8_t* mask) const
+    {
+        memset(mask, 0, cols);
+        const ColourRun* end = runs_->rowEnd(y0_ + y);
+        for(const ColourRun* run = runs_->rowBegin(y0_ + y); run != end; ++run)
+        {
+            if(run->colour != cWHITE)
+                continue;
+            const int start = std::max(run->x0 - x0_, 0);
+            const int stop = std::min(run->x1 - x0_, cols);
+            for(int x=start; x<stop; ++x)
+                mask[x] = y > col_starts_[x];
+        }
+    }
 
-    // The largest y value in each group.
-    group_high_ys_.clear();
+private:
+    const ColourRuns* runs_;
+    int x0_;
+    int y0_;
+    const int* col_starts_;
+};
 
+// Finds ROI in just the top or bottom image.
+template<int cols, int rows> inline void
+                ColourROI::findROIImage_(const RegionI& region,
+                    std::vector<RegionI>& regions_out, VisionInfoOut& info_out)
+{
 #ifdef DEBUG_OPTIMISE
     // Timer for optimisation.
     Timer timer;
     timer.restart();
 #endif // DEBUG_OPTIMISE
 
-    // Set to USHRT_MAX when there is no neighbour.
-    uint16_t top_neighbour = USHRT_MAX;
-    uint16_t left_neighbour = USHRT_MAX;
-    bool has_neighbour = false;
-
-    // Iterators that move through the region.
-    RegionI::iterator_fovea cur_point = region.begin_fovea();
-
-    // Track the literal location of the iterators.
-    int x = 0;
-    int y = 0;
-
-    // A pointer tracking through the underlying array of groups.
-    uint16_t* group = groups_;
-
     // The maximum number of pixels that can be contained in a single region.
     int max_region_size;
     if(region.isTopCamera())
@@ -196,193 +214,40 @@ template<int cols, int rows> inline void
         }
     }
 
-    // Connected component analysis.
-    for(int pixel=0; pixel < cols*rows; ++pixel)
+    // Connected component analysis. Groups crossing CUT_SIZE boundaries are
+    // kept apart, to be merged below if they look like one object. The full
+    // region is the whole fovea, so its rows can be read directly.
+    const Fovea* fovea = region.getInternalFovea();
+    const BBox& fovea_box = region.getBoundingBoxFovea();
+    const int fovea_width = fovea->getBBox().width();
+    const ColourRuns* runs = fovea->getColourRuns();
+    if(runs)
     {
-        // If this is a white pixel, group it. TODO: Make this fast.
-        if(y > col_starts[x] && cur_point.colour() == cWHITE)
-        {
-            // Get all neighbours.
-            has_neighbour = false;
-            if(x % CUT_SIZE != 0 && y > col_starts[x-1] &&
-                                               cur_point.colourLeft() == cWHITE)
-            {
-                left_neighbour = *(group-1);
-                has_neighbour = true;
-            }
-            else
-                left_neighbour = USHRT_MAX;
-            if(y > col_starts[x]+1 && y % CUT_SIZE != 0 &&
-                                              cur_point.colourAbove() == cWHITE)
-            {
-                top_neighbour = *(group-cols);
-                has_neighbour = true;
-            }
-            else
-                top_neighbour = USHRT_MAX;
-
-            // If there are no neighbours create a new label.
-            if(!has_neighbour)
-            {
-                // Try to add the new group. If this fails, the group cap has
-                // been hit and CCA should terminate.
-                if(!group_links_.newGroup())
-                    break;
-
-                *group = group_links_.size()-1;
-                group_low_xs_.push_back(x);
-                group_high_xs_.push_back(x);
-                group_low_ys_.push_back(y);
-                group_high_ys_.push_back(y);
-                group_counts_.push_back(1);
-            }
-            // If there is a neighbour build components.
-            else
-            {
-                if(top_neighbour < left_neighbour)
-                {
-                    // Set the pixel's group.
-                    *group = top_neighbour;
-
-                    // Add a parent to the left neighbour if needed.
-                    if(left_neighbour != USHRT_MAX)
-                    {
-                        bool new_link;
-                        new_link = group_links_.addLink(left_neighbour,
-                                                                 top_neighbour);
-                        if(new_link)
-                        {
-                            push_heap(group_links_.begin(left_neighbour),
-                                      group_links_.end(left_neighbour),
-                                                           std::greater<int>());
-                        }
-                    }
-
-                    // Update bounding box.
-                    group_counts_[top_neighbour] += 1;
-                    if(group_high_xs_[top_neighbour] < x)
-                        group_high_xs_[top_neighbour] = x;
-                    if(group_high_ys_[top_neighbour] < y)
-                        group_high_ys_[top_neighbour] = y;
-                }
-                else
-                {
-                    // Set the pixel's group.
-                    *group = left_neighbour;
-
-                    // Add a parent to the top neighbour if needed.
-                    if(top_neighbour != USHRT_MAX)
-                    {
-                        bool new_link;
-                        new_link = group_links_.addLink(top_neighbour,
-                                                                 left_neighbour);
-                        if(new_link)
-                        {
-                            push_heap(group_links_.begin(top_neighbour),
-                                      group_links_.end(top_neighbour),
-                                                           std::greater<int>());
-                        }
-                    }
-
-                    // Update bounding box.
-                    group_counts_[left_neighbour] += 1;
-                    if(group_high_xs_[left_neighbour] < x)
-                        group_high_xs_[left_neighbour] = x;
-                    if(group_high_ys_[left_neighbour] < y)
-                        group_high_ys_[left_neighbour] = y;
-                }
-            }
-        }
-
-        ++cur_point;
-        ++x;
-        ++group;
-        if(x == cols)
-        {
-            x = 0;
-            ++y;
-        }
+        components_.label(WhiteRunsBelowFieldBoundary(runs, fovea_box.a.x(),
+                     fovea_box.a.y(), col_starts), cols, rows, CUT_SIZE);
     }
-
-    // Don't need a full second pass as we only need bounding boxes. Combining
-    // by grabbing pixel location extremes is sufficient. May be a faster way
-    // to implement this.
+    else
+    {
+        components_.label(WhiteBelowFieldBoundary(fovea->getInternalColour() +
+            fovea_box.a.y()*fovea_width + fovea_box.a.x(), fovea_width,
+                                            col_starts), cols, rows, CUT_SIZE);
+    }
+    groups_ = components_.stats();
+    const int num_groups = groups_.size();
 
 #ifdef DEBUG_OPTIMISE
     std::cout << "CCA: " << timer.elapsed_us() << std::endl;
-    std::cout << "Number of groups: " << group_links_.size() << std::endl;
+    std::cout << "Number of groups: " << num_groups << std::endl;
     int white_pix = 0;
-    for(int group=0; group<group_links_.size(); ++group)
-        white_pix += group_counts_[group];
+    for(int group=0; group<num_groups; ++group)
+        white_pix += groups_[group].count;
     std::cout << "Number of white pixels: " << white_pix << std::endl;
-    int num_groups_combined = 0;
-    timer.restart();
-#endif // DEBUG_OPTIMISE
-
-    // Find the parent group for each group.
-    bool changed = true;
-    while(changed)
-    {
-        changed = false;
-        for(int group=0; group<group_links_.size(); group++)
-        {
-            // Tell all linked groups the lowest linked group.
-            for(int owner=1; owner<group_links_.size(group); owner++)
-            {
-                // Insert in sorted order.
-                changed = true;
-                if(group_links_.get(group, owner) != group)
-                {
-                    bool new_link;
-                    new_link = group_links_.addLink(group_links_.get(group,
-                                            owner), group_links_.get(group, 0));
-                    if(new_link)
-                    {
-                        push_heap(group_links_.begin(
-                            group_links_.get(group, owner)),
-                            group_links_.end(group_links_.get(group, owner)),
-                                                           std::greater<int>());
-                    }
-                }
-            }
-
-            // Delete all but the lowest owner.
-            group_links_.clearHigh(group);
-        }
-    }
-
-    // Apply combinations.
-    for(int group=group_links_.size()-1; group>=0; group--)
-    {
-        int owner = group_links_.get(group, 0);
-        if(owner != group)
-        {
-#ifdef DEBUG_OPTIMISE
-            ++num_groups_combined;
-#endif // DEBUG_OPTIMISE
-            group_counts_[owner] += group_counts_[group];
-            group_counts_[group] = 0;
-            if(group_low_xs_[group] < group_low_xs_[owner])
-                group_low_xs_[owner] = group_low_xs_[group];
-            if(group_low_ys_[group] < group_low_ys_[owner])
-                group_low_ys_[owner] = group_low_ys_[group];
-            if(group_high_xs_[group] > group_high_xs_[owner])
-                group_high_xs_[owner] = group_high_xs_[group];
-            if(group_high_ys_[group] > group_high_ys_[owner])
-                group_high_ys_[owner] = group_high_ys_[group];
-        }
-    }
-
-#ifdef DEBUG_OPTIMISE
-    std::cout << "Group combining: " << timer.elapsed_us() << std::endl;
-    std::cout << "Num groups: " << group_links_.size()-num_groups_combined <<
-                                                                      std::endl;
     timer.restart();
     int num_merges = 0;
 #endif // DEBUG_OPTIMISE
 
     // Merge groups where density remains good.
-    changed = true;
+    bool changed = true;
     int thresh = MERGE_MULT_1;
     while(changed)
     {
@@ -390,65 +255,67 @@ template<int cols, int rows> inline void
 
         // Check through the groups for merging. Groups are implicitly sorted
         // from upper left to bottom right by upper left corner.
-        for(int group1=0; group1<group_links_.size(); ++group1)
+        for(int group1=0; group1<num_groups; ++group1)
         {
-            if(group_counts_[group1] > EARLY_IGNORE_THRESHOLD)
+            if(groups_[group1].count > EARLY_IGNORE_THRESHOLD)
             {
                 int group2=group1+1;
-                int group1_width = group_high_xs_[group1]-group_low_xs_[group1];
-                int group1_size = group1_width * (group_high_ys_[group1] -
-                                                         group_low_ys_[group1]);
+                int group1_width = groups_[group1].high_x-groups_[group1].low_x;
+                int group1_size = group1_width * (groups_[group1].high_y -
+                                                         groups_[group1].low_y);
                 bool continue_check = true;
 
                 // Continue while it is reasonably probable that a below
                 // threshold group can be created.
-                while(group2 < group_links_.size() && continue_check)
+                while(group2 < num_groups && continue_check)
                 {
-                    if(group_counts_[group2] > EARLY_IGNORE_THRESHOLD)
+                    if(groups_[group2].count > EARLY_IGNORE_THRESHOLD)
                     {
                         // If both groups have pixels and density after
                         // combining is good, combine.
-                        int xL = std::min(group_low_xs_[group1],
-                                                         group_low_xs_[group2]);
-                        int xH = std::max(group_high_xs_[group1],
-                                                        group_high_xs_[group2]);
-                        int yL = std::min(group_low_ys_[group1],
-                                                         group_low_ys_[group2]);
-                        int yH = std::max(group_high_ys_[group1],
-                                                        group_high_ys_[group2]);
+                        int xL = std::min(groups_[group1].low_x,
+                                                         groups_[group2].low_x);
+                        int xH = std::max(groups_[group1].high_x,
+                                                        groups_[group2].high_x);
+                        int yL = std::min(groups_[group1].low_y,
+                                                         groups_[group2].low_y);
+                        int yH = std::max(groups_[group1].high_y,
+                                                        groups_[group2].high_y);
                         int size = (xH-xL+1)*(yH-yL+1);
 
                         // To avoid division the ratio comparison is done by
                         // multiplying the number of white pixels by a value and
                         // comparing that to the size of the new bounding box
                         // times 10 (to allow a decimal place).
-                        if((group_counts_[group1]+group_counts_[group2])*thresh
+                        if((groups_[group1].count+groups_[group2].count)*thresh
                                             > size*10 && size < max_region_size)
                         {
 #ifdef DEBUG_OPTIMISE
                             ++num_merges;
 #endif // DEBUG_OPTIMISE
                             changed = true;
-                            group_low_xs_[group1] = xL;
-                            group_high_xs_[group1] = xH;
-                            group_low_ys_[group1] = yL;
-                            group_high_ys_[group1] = yH;
-                            group_counts_[group1] += group_counts_[group2];
-                            group_counts_[group2] = 0;
-                            group1_width = group_high_xs_[group1] -
-                                                          group_low_xs_[group1];
-                            group1_size = group1_width * (group_high_ys_[group1]
-                                                       - group_low_ys_[group1]);
+                            groups_[group1].low_x = xL;
+                            groups_[group1].high_x = xH;
+                            groups_[group1].low_y = yL;
+                            groups_[group1].high_y = yH;
+                            groups_[group1].count += groups_[group2].count;
+                            groups_[group2].count = 0;
+                            group1_width = groups_[group1].high_x -
+                                                          groups_[group1].low_x;
+                            group1_size = group1_width * (groups_[group1].high_y
+                                                       - groups_[group1].low_y);
                         }
                     }
                     ++group2;
+                    if(group2 == num_groups)
+                        break;
 
                     // Check if we should continue.
-                    int empty_space = group1_width * (group_low_ys_[group2] -
-                                                        group_high_ys_[group1]);
+                    int empty_space = group1_width * (groups_[group2].low_y -
+                                                        groups_[group1].high_y);
                     if(empty_space > 0)
                     {
-                        continue_check = group_counts_[group1]*thresh >
+                        continue_check = groups_[group1].count*thresh >
                                                    (empty_space+group1_size)*10;
                     }
                 }
@@ -489,20 +356,20 @@ template<int cols, int rows> inline void
     // NOTE: contains a number of inactive heuristics, included as we may want
     // them later.
     vector2i roi;
-    for(int group=0; group<group_links_.size(); group++)
+    for(int group=0; group<num_groups; group++)
     {
         // Check the group actually has pixels.
-        if(group_counts_[group] > LATE_IGNORE_THRESHOLD)
+        if(groups_[group].count > LATE_IGNORE_THRESHOLD)
         {
             // The corners of the new ROI.
             Point upper_left;
             Point lower_right;
 
             // Calculate corners.
-            upper_left[0] = group_low_xs_[group];
-            upper_left[1] = group_low_ys_[group];
-            lower_right[0] = group_high_xs_[group]+1;
-            lower_right[1] = group_high_ys_[group]+1;
+            upper_left[0] = groups_[group].low_x;
+            upper_left[1] = groups_[group].low_y;
+            lower_right[0] = groups_[group].high_x+1;
+            lower_right[1] = groups_[group].high_y+1;
 
             // Create a region of interest.
             info_out.regions.push_back(RegionI(region, BBox(upper_left,
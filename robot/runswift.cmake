@@ -20,12 +20,19 @@ SET(SOCCER_SRCS
    perception/vision/camera/Camera.cpp
    perception/vision/camera/NaoCamera.cpp
    perception/vision/camera/NaoCameraV4.cpp
+   perception/vision/camera/FrameRing.cpp
+   perception/vision/camera/V4L2CaptureDevice.cpp
+   perception/vision/camera/FileCaptureDevice.cpp
    perception/vision/camera/CameraToRR.cpp
    perception/vision/camera/CombinedCamera.cpp
    perception/vision/camera/NaoCameraDefinitions.cpp
    perception/vision/other/VarianceCalculator.cpp
    perception/vision/other/YUV.cpp
    perception/vision/other/Ransac.cpp
+   perception/vision/other/CircleFit.cpp
+   perception/vision/colour/ClassifyRun.cpp
+   perception/vision/colour/PackedColourTable.cpp
+   perception/vision/colour/ColourTable.cpp
    perception/vision/colour/GreenYUVClassifier.cpp
    perception/vision/regionfinder/ColourROI.cpp
    perception/vision/detector/BallDetector.cpp
@@ -34,6 +41,7 @@ SET(SOCCER_SRCS
    perception/vision/detector/ClusterDetector.cpp
    perception/vision/detector/RegionFieldFeatureDetector.cpp
    perception/vision/middleinfoprocessor/FieldBoundaryFinder.cpp
+   perception/vision/middleinfoprocessor/FieldBoundaryScan.cpp
    perception/vision/middleinfoprocessor/NaiveHorizonFieldBoundaryFinder.cpp
    perception/dumper/PerceptionDumper.cpp
 
@@ -86,10 +94,12 @@ SET(SOCCER_SRCS
    # Misc
    utils/Connection.cpp
    utils/LeastSquaresLine.cpp
-   utils/Cluster.cpp
    #utils/bzip_compress.cpp
    utils/options.cpp
    utils/Logger.cpp
+   utils/FrameArena.cpp
+   utils/Profiler.cpp
+   utils/WorkerPool.cpp
    gamecontroller/GameController.cpp
    gamecontroller/RoboCupGameControlData.cpp
    utils/snappy/snappy-sinksource.cc
@@ -11,18 +11,54 @@ SET(TEST_RUNSWIFT_SRCS
         tests/TestBresenhamPtr.cpp
         tests/TestRansac.cpp
         tests/TestFovea.cpp
+        tests/TestIncrementalFovea.cpp
+        tests/TestClassifyRun.cpp
+        tests/TestPackedColourTable.cpp
+        tests/TestFrameRing.cpp
+        tests/TestFrameArena.cpp
+        tests/TestProfiler.cpp
+        tests/TestWorkerPool.cpp
+        tests/TestCascade.cpp
+        tests/TestSummedAreaTable.cpp
+        tests/TestConnectedComponents.cpp
+        tests/TestColourRuns.cpp
+        tests/TestCircleFit.cpp
+        tests/TestFieldBoundaryScan.cpp
 
-        perception/vision/Ransac.cpp
+        perception/vision/Fovea.cpp
+        perception/vision/camera/CameraToRR.cpp
+        perception/kinematics/Pose.cpp
+        soccer.cpp
+        perception/vision/other/Ransac.cpp
+        perception/vision/other/CircleFit.cpp
+        perception/vision/colour/ClassifyRun.cpp
+        perception/vision/middleinfoprocessor/FieldBoundaryScan.cpp
+        perception/vision/colour/PackedColourTable.cpp
+        perception/vision/camera/FrameRing.cpp
+        perception/vision/camera/FileCaptureDevice.cpp
+        utils/Profiler.cpp
+        utils/WorkerPool.cpp
+        utils/FrameArena.cpp
 
 
         #ROBOT FILTER TESTS AND DEPENDENCIES
         tests/perception/localisation/robotfilter/TestRobotFilter.cpp
         tests/perception/localisation/robotfilter/types/TestRobotObservation.cpp
         tests/perception/localisation/robotfilter/types/TestGroupedRobots.cpp
+        tests/perception/localisation/TestKalmanUpdate.cpp
+        tests/perception/localisation/TestICP.cpp
 
         perception/localisation/robotfilter/RobotFilter.cpp
         perception/localisation/robotfilter/types/GroupedRobots.cpp
         perception/localisation/robotfilter/types/RobotObservation.cpp
+        perception/localisation/ICP.cpp
+        perception/localisation/SimpleGaussian.cpp
+        perception/localisation/VarianceProvider.cpp
+        perception/localisation/ObservedPostsHistory.cpp
+        perception/localisation/LocalisationUtils.cpp
+        perception/localisation/LocalisationConstantsProvider.cpp
+        utils/Logger.cpp
+        thread/Thread.cpp
 )
 
 # TODO(Peter): This -fno-access-control is probably leaking into Offnao
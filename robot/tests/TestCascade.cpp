@@ -0,0 +1,132 @@
+#define BOOST_TEST_DYN_LINK
+#include <unistd.h>
+
+#include <stdexcept>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "utils/Cascade.hpp"
+
+/* A stage that passes candidates not divisible by divisor */
+static bool notMultipleOf(int divisor, int &candidate) {
+   return candidate % divisor != 0;
+}
+
+/* As notMultipleOf, but taking a while */
+static bool slowNotMultipleOf(int divisor, int &candidate) {
+   usleep(200);
+   return candidate % divisor != 0;
+}
+
+/* A cascade rejecting multiples of 2, 3 and 5, declared in that order but
+ * with the cheapest rejections last */
+struct CascadeFixture {
+   CascadeFixture() : cascade("test.cascade") {
+      two = cascade.addStage("two", boost::bind(notMultipleOf, 2, _1),
+                             100, 0.5);
+      three = cascade.addStage("three", boost::bind(notMultipleOf, 3, _1),
+                               10, 0.33);
+      five = cascade.addStage("five", boost::bind(notMultipleOf, 5, _1),
+                              1, 0.2);
+   }
+
+   Cascade<int> cascade;
+   int two;
+   int three;
+   int five;
+};
+
+BOOST_FIXTURE_TEST_SUITE(cascade, CascadeFixture)
+
+BOOST_AUTO_TEST_CASE(cheapest_rejection_first)
+{
+   const std::vector<int> &order = cascade.stageOrder();
+   BOOST_REQUIRE_EQUAL(order.size(), 3u);
+   BOOST_CHECK_EQUAL(order[0], five);
+   BOOST_CHECK_EQUAL(order[1], three);
+   BOOST_CHECK_EQUAL(order[2], two);
+   BOOST_CHECK_CLOSE(cascade.expectedCost(),
+                     1 + 10 * 0.8f + 100 * 0.8f * 0.67f, 0.01);
+}
+
+BOOST_AUTO_TEST_CASE(dependencies_come_first)
+{
+   cascade.depend(five, two);
+   const std::vector<int> &order = cascade.stageOrder();
+   BOOST_CHECK_EQUAL(order[0], three);
+   BOOST_CHECK_EQUAL(order[1], two);
+   BOOST_CHECK_EQUAL(order[2], five);
+
+   BOOST_CHECK_THROW(cascade.depend(two, five), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(order_does_not_change_decisions)
+{
+   std::vector<bool> before;
+   for (int i = 0; i < 100; ++i) {
+      before.push_back(cascade.run(i));
+   }
+   cascade.depend(three, two);
+   cascade.depend(five, three);
+   for (int i = 0; i < 100; ++i) {
+      BOOST_CHECK_EQUAL(cascade.run(i), (bool)before[i]);
+      BOOST_CHECK_EQUAL(cascade.run(i),
+                        i % 2 != 0 && i % 3 != 0 && i % 5 != 0);
+   }
+}
+
+BOOST_AUTO_TEST_CASE(counts_runs_and_rejections)
+{
+   for (int i = 0; i < 30; ++i) {
+      cascade.run(i);
+   }
+   std::vector<CascadeStageStats> stats = cascade.stats();
+   // five runs on everything, three on what five passes, and so on
+   BOOST_CHECK_EQUAL(stats[five].runs, 30u);
+   BOOST_CHECK_EQUAL(stats[five].rejections, 6u);
+   BOOST_CHECK_EQUAL(stats[three].runs, 24u);
+   BOOST_CHECK_EQUAL(stats[three].rejections, 8u);
+   BOOST_CHECK_EQUAL(stats[two].runs, 16u);
+   BOOST_CHECK_EQUAL(stats[two].rejections, 8u);
+
+   cascade.resetStats();
+   BOOST_CHECK_EQUAL(cascade.stats()[five].runs, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(reorders_by_measured_rejections)
+{
+   // declared as rarely rejecting, but rejects everything
+   Cascade<int> measured("test.measured");
+   int rare = measured.addStage(
+      "rare", boost::bind(slowNotMultipleOf, 1, _1), 10, 0.1);
+   int common = measured.addStage(
+      "common", boost::bind(slowNotMultipleOf, 2, _1), 10, 0.5);
+   BOOST_CHECK_EQUAL(measured.stageOrder()[0], common);
+
+   // both have to run enough to be measured
+   for (int i = 0; i < 2 * CASCADE_MIN_SAMPLES; ++i) {
+      measured.run(i);
+   }
+   BOOST_REQUIRE(measured.stats()[rare].runs >= CASCADE_MIN_SAMPLES);
+   measured.order(true);
+   BOOST_CHECK_EQUAL(measured.stageOrder()[0], rare);
+   BOOST_CHECK_CLOSE(measured.stats()[rare].rejection, 1.0f, 0.01);
+
+   // common now never runs, so it keeps what it was measured at rather than
+   // going back to its declared figures
+   const float commonCost = measured.stats()[common].cost;
+   BOOST_CHECK_GT(commonCost, 10.0f);
+   measured.resetStats();
+   for (int i = 0; i < 2 * CASCADE_MIN_SAMPLES; ++i) {
+      measured.run(i);
+   }
+   BOOST_REQUIRE_EQUAL(measured.stats()[common].runs, 0u);
+   measured.order(true);
+   BOOST_CHECK_EQUAL(measured.stageOrder()[0], rare);
+   BOOST_CHECK_EQUAL(measured.stats()[common].cost, commonCost);
+   BOOST_CHECK_CLOSE(measured.stats()[common].rejection, 0.5f, 0.01);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
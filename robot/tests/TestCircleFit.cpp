@@ -0,0 +1,235 @@
+#define BOOST_TEST_DYN_LINK
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "perception/vision/other/CircleFit.hpp"
+#include "utils/Timer.hpp"
+#include "tests/TestData.hpp"
+
+#define BENCHMARK_REGIONS 200
+
+/* A ball detector region's candidate points, and the ball in it if known */
+struct CircleRegion {
+   int cols, rows;
+   std::vector<Point> points;
+   RANSACCircle ball;
+};
+
+/* Candidate points around most of a circle, a pixel or so off it, and some
+ * stray ones */
+static void makeRegion(CircleRegion &region, int cols, int rows,
+                       PointF centre, float radius)
+{
+   region.cols = cols;
+   region.rows = rows;
+   region.ball = RANSACCircle(centre, radius);
+   region.points.clear();
+   const int steps = 2 * M_PI * radius;
+   for (int a = 0; a < steps; ++a) {
+      if (rand() % 5 == 0) {
+         continue;
+      }
+      float theta = 2 * M_PI * a / steps;
+      float r = radius + (rand() % 3 - 1) * 0.5f;
+      Point p(centre.x() + r * cos(theta) + 0.5f,
+              centre.y() + r * sin(theta) + 0.5f);
+      if (p.x() >= 0 && p.x() < cols && p.y() >= 0 && p.y() < rows) {
+         region.points.push_back(p);
+      }
+   }
+   for (int i = 0; i < steps / 4; ++i) {
+      region.points.push_back(Point(rand() % cols, rand() % rows));
+   }
+}
+
+/* The regions in $RUNSWIFT_TEST_CIRCLE_REGIONS, a line of "cols rows"
+ * followed by the points' "x y" each, or else balls of radius 6 to 14 in
+ * regions up to the given times their size */
+static void loadRegions(std::vector<CircleRegion> &regions, float slack)
+{
+   regions.clear();
+   const std::vector<std::string> lines =
+      readRecordedLines("RUNSWIFT_TEST_CIRCLE_REGIONS");
+   for (unsigned int l = 0; l < lines.size(); ++l) {
+      std::istringstream fields(lines[l]);
+      CircleRegion region;
+      int x, y;
+      if (!(fields >> region.cols >> region.rows)) {
+         continue;
+      }
+      region.ball = RANSACCircle(PointF(0, 0), 0);
+      while (fields >> x >> y) {
+         region.points.push_back(Point(x, y));
+      }
+      regions.push_back(region);
+   }
+   if (!regions.empty()) {
+      return;
+   }
+
+   srand(42);
+   regions.resize(BENCHMARK_REGIONS);
+   for (unsigned int i = 0; i < regions.size(); ++i) {
+      float radius = 6 + rand() % 9;
+      int cols = 2 * radius * (1 + slack * (rand() % 100) / 100) + 1;
+      int rows = 2 * radius * (1 + slack * (rand() % 100) / 100) + 1;
+      PointF centre(radius + (rand() % 100) / 100.0f * (cols - 2 * radius),
+                    radius + (rand() % 100) / 100.0f * (rows - 2 * radius));
+      makeRegion(regions[i], cols, rows, centre, radius);
+   }
+}
+
+/* Whether two circles are within tolerance pixels of each other */
+static bool agree(const RANSACCircle &a, const RANSACCircle &b,
+                  float tolerance)
+{
+   return (a.centre - b.centre).norm() <= tolerance &&
+          fabsf(a.radius - b.radius) <= tolerance;
+}
+
+BOOST_AUTO_TEST_SUITE(circle_fit)
+
+BOOST_AUTO_TEST_CASE(hough_finds_clean_circle)
+{
+   CircleRegion region;
+   srand(7);
+   makeRegion(region, 60, 50, PointF(23.5f, 27.0f), 11);
+   region.points.resize(region.points.size() * 4 / 5);
+
+   RANSACCircle exhaustive, hough;
+   BOOST_REQUIRE(CircleFit::findBest(region.points, region.cols, region.rows,
+      13, 2, 20, 0.7, 2, BALL_SIDE_TOTAL, CircleFit::EXHAUSTIVE, exhaustive));
+   BOOST_REQUIRE(CircleFit::findBest(region.points, region.cols, region.rows,
+      13, 2, 20, 0.7, 2, BALL_SIDE_TOTAL, CircleFit::HOUGH, hough));
+   BOOST_CHECK_LT((hough.centre - region.ball.centre).norm(), 1);
+   BOOST_CHECK_LT(fabsf(hough.radius - region.ball.radius), 1);
+   BOOST_CHECK(agree(hough, exhaustive, 2));
+   BOOST_CHECK_LE(hough.var, exhaustive.var);
+
+   // No circle is left alone
+   RANSACCircle none(PointF(1, 2), 3);
+   std::vector<Point> stray(region.points.end() - 10, region.points.end());
+   BOOST_CHECK(!CircleFit::findBest(stray, region.cols, region.rows, 13, 2,
+      20, 0.7, 2, BALL_SIDE_TOTAL, CircleFit::HOUGH, none));
+   BOOST_CHECK_EQUAL(none.radius, 3);
+}
+
+BOOST_AUTO_TEST_CASE(best_benchmark)
+{
+   std::vector<CircleRegion> regions;
+   loadRegions(regions, 1.5);
+
+   const CircleFit::Method methods[] = {CircleFit::EXHAUSTIVE,
+                                        CircleFit::HOUGH};
+   const char *names[] = {"exhaustive", "hough"};
+   std::vector<RANSACCircle> fits[2];
+   std::vector<bool> found[2];
+   int counts[2] = {0, 0};
+   float errors[2] = {0, 0};
+   for (int m = 0; m < 2; ++m) {
+      fits[m].resize(regions.size());
+      found[m].resize(regions.size());
+      int iterations = 0;
+      Timer timer;
+      for (unsigned int i = 0; i < regions.size(); ++i) {
+         const CircleRegion &region = regions[i];
+         float radius = region.ball.radius > 0 ? region.ball.radius + 2
+            : std::min(region.cols, region.rows) * 0.5f;
+         found[m][i] = CircleFit::findBest(region.points, region.cols,
+            region.rows, radius, 2, 1.5 * radius, 0.6, 2, BALL_SIDE_TOTAL,
+            methods[m], fits[m][i], &iterations);
+         if (found[m][i]) {
+            ++counts[m];
+            errors[m] += (fits[m][i].centre - region.ball.centre).norm();
+         }
+      }
+      uint32_t time = timer.elapsed_us();
+      BENCHMARK_MESSAGE("Best circle, " << names[m] << ": "
+         << (float)time / regions.size() << "us and "
+         << iterations / regions.size() << " circles scored per region, found "
+         << counts[m] << "/" << regions.size() << ", mean centre error "
+         << errors[m] / std::max(counts[m], 1) << "px");
+   }
+
+   // Exhaustive centres are a step apart, so agreeing is being within a
+   // step and a pixel
+   int agreed = 0;
+   for (unsigned int i = 0; i < regions.size(); ++i) {
+      agreed += found[0][i] && found[1][i] &&
+                agree(fits[0][i], fits[1][i], 3);
+   }
+   BENCHMARK_MESSAGE("Best circle: hough agrees with exhaustive on "
+      << agreed << "/" << counts[0]);
+
+   BOOST_CHECK_GE(counts[1], counts[0] * 9 / 10);
+   if (regions[0].ball.radius > 0) {
+      BOOST_CHECK_LE(errors[1] / std::max(counts[1], 1),
+                     errors[0] / std::max(counts[0], 1) + 1);
+   } else {
+      BOOST_CHECK_GE(agreed, counts[0] / 2);
+   }
+}
+
+BOOST_AUTO_TEST_CASE(largest_benchmark)
+{
+   std::vector<CircleRegion> regions;
+   loadRegions(regions, 0.3);
+
+   const CircleFit::Method methods[] = {CircleFit::EXHAUSTIVE,
+                                        CircleFit::HOUGH};
+   const char *names[] = {"exhaustive", "hough"};
+   std::vector<RANSACCircle> fits[2];
+   std::vector<bool> found[2];
+   int counts[2] = {0, 0};
+   float errors[2] = {0, 0};
+   for (int m = 0; m < 2; ++m) {
+      fits[m].resize(regions.size());
+      found[m].resize(regions.size());
+      int iterations = 0;
+      Timer timer;
+      for (unsigned int i = 0; i < regions.size(); ++i) {
+         const CircleRegion &region = regions[i];
+         float radius = std::min(region.cols, region.rows) * 0.5f;
+         float step = std::max((int)(radius * 0.05), 3);
+         found[m][i] = CircleFit::findLargest(region.points, region.cols,
+            region.rows, radius, 2, 0.8, step, BALL_SIDE_TOTAL, methods[m],
+            fits[m][i], &iterations);
+         if (found[m][i]) {
+            ++counts[m];
+            errors[m] += (fits[m][i].centre - region.ball.centre).norm();
+         }
+      }
+      uint32_t time = timer.elapsed_us();
+      BENCHMARK_MESSAGE("Largest circle, " << names[m] << ": "
+         << (float)time / regions.size() << "us and "
+         << iterations / regions.size() << " circles scored per region, found "
+         << counts[m] << "/" << regions.size() << ", mean centre error "
+         << errors[m] / std::max(counts[m], 1) << "px");
+   }
+
+   int agreed = 0;
+   for (unsigned int i = 0; i < regions.size(); ++i) {
+      agreed += found[0][i] && found[1][i] &&
+                agree(fits[0][i], fits[1][i], 3);
+   }
+   BENCHMARK_MESSAGE("Largest circle: hough agrees with exhaustive on "
+      << agreed << "/" << counts[0]);
+
+   BOOST_CHECK_GE(counts[1], counts[0] * 4 / 5);
+   if (regions[0].ball.radius > 0) {
+      BOOST_CHECK_LE(errors[1] / std::max(counts[1], 1),
+                     errors[0] / std::max(counts[0], 1) + 1);
+   } else {
+      BOOST_CHECK_GE(agreed, counts[0] / 2);
+   }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
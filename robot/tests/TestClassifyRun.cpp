@@ -0,0 +1,109 @@
+#define BOOST_TEST_DYN_LINK
+#include <stdlib.h>
+
+#include <vector>
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int.hpp>
+#include <boost/random/variate_generator.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include "perception/vision/colour/ClassifyRun.hpp"
+#include "utils/Timer.hpp"
+#include "tests/TestData.hpp"
+
+#define NNMC_SIZE (128 * 128 * 128)
+#define FRAME_BYTES (TOP_IMAGE_ROWS * TOP_IMAGE_COLS * 2)
+#define BENCHMARK_REPEATS 20
+
+/* Random lookup table, and a frame that is either random or the raw YUV422
+ * top camera frame named by $RUNSWIFT_TEST_FRAME (e.g. one written by
+ * offnao or a v4l2 capture) */
+struct ClassifyRunFixture {
+   ClassifyRunFixture() : nnmc(NNMC_SIZE), frame(FRAME_BYTES) {
+      boost::mt19937 gen(42);
+      boost::uniform_int<> dist(0, 255);
+      boost::variate_generator<boost::mt19937&, boost::uniform_int<> >
+         byte(gen, dist);
+
+      for (int i = 0; i < NNMC_SIZE; ++i) {
+         nnmc[i] = byte() % cNUM_COLOURS;
+      }
+
+      if (!readRecordedBytes("RUNSWIFT_TEST_FRAME", frame)) {
+         for (int i = 0; i < FRAME_BYTES; ++i) {
+            frame[i] = byte();
+         }
+      }
+   }
+
+   std::vector<uint8_t> nnmc;
+   std::vector<uint8_t> frame;
+};
+
+BOOST_FIXTURE_TEST_SUITE(classify_run, ClassifyRunFixture)
+
+#ifdef __SSE2__
+
+BOOST_AUTO_TEST_CASE(sse2_matches_scalar)
+{
+   std::vector<Colour> expected(TOP_IMAGE_COLS);
+   std::vector<Colour> actual(TOP_IMAGE_COLS);
+
+   for (int density = 1; density <= 8; ++density) {
+      const int step = density * 2;
+      // Both Y positions within a macropixel, and runs with and without a
+      // scalar tail
+      for (int start = 0; start <= 2; start += 2) {
+         for (int n = 0; n * step + start + 4 <= TOP_IMAGE_COLS * 2;
+              n += (n < 40) ? 1 : 37) {
+            for (int row = 0; row < TOP_IMAGE_ROWS; row += 97) {
+               const uint8_t *raw = &frame[row * TOP_IMAGE_COLS * 2 + start];
+               classifyRunScalar(&nnmc[0], raw, step, &expected[0], n);
+               classifyRunSSE2(&nnmc[0], raw, step, &actual[0], n);
+               BOOST_REQUIRE(std::equal(expected.begin(),
+                                        expected.begin() + n,
+                                        actual.begin()));
+            }
+         }
+      }
+   }
+}
+
+BOOST_AUTO_TEST_CASE(sse2_benchmark)
+{
+   const int repeats = benchmarkRepeats(BENCHMARK_REPEATS);
+   const int step = TOP_SALIENCY_DENSITY * 2;
+   std::vector<Colour> expected(TOP_SALIENCY_ROWS * TOP_SALIENCY_COLS);
+   std::vector<Colour> actual(TOP_SALIENCY_ROWS * TOP_SALIENCY_COLS);
+
+   Timer timer;
+   for (int repeat = 0; repeat < repeats; ++repeat) {
+      for (int row = 0; row < TOP_SALIENCY_ROWS; ++row) {
+         classifyRunScalar(&nnmc[0],
+            &frame[row * TOP_SALIENCY_DENSITY * TOP_IMAGE_COLS * 2], step,
+            &expected[row * TOP_SALIENCY_COLS], TOP_SALIENCY_COLS);
+      }
+   }
+   uint32_t scalarTime = timer.elapsed_us();
+
+   timer.restart();
+   for (int repeat = 0; repeat < repeats; ++repeat) {
+      for (int row = 0; row < TOP_SALIENCY_ROWS; ++row) {
+         classifyRunSSE2(&nnmc[0],
+            &frame[row * TOP_SALIENCY_DENSITY * TOP_IMAGE_COLS * 2], step,
+            &actual[row * TOP_SALIENCY_COLS], TOP_SALIENCY_COLS);
+      }
+   }
+   uint32_t sse2Time = timer.elapsed_us();
+
+   BENCHMARK_MESSAGE("Top saliency classification per frame: scalar "
+      << scalarTime / repeats << "us, SSE2 "
+      << sse2Time / repeats << "us");
+   BOOST_CHECK(expected == actual);
+}
+
+#endif // __SSE2__
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,128 @@
+#define BOOST_TEST_DYN_LINK
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "perception/vision/ColourRuns.hpp"
+#include "perception/vision/VisionDefinitions.hpp"
+#include "utils/Timer.hpp"
+#include "tests/TestData.hpp"
+
+#define BENCHMARK_REPEATS 20
+
+/* A top camera saliency image of a field, with lines, a circle and a robot's
+ * feet, and speckle */
+struct FieldFixture {
+   FieldFixture() : image(TOP_SALIENCY_COLS * TOP_SALIENCY_ROWS, cGREEN) {
+      srand(42);
+      fill(0, 0, TOP_SALIENCY_COLS, 40, cBACKGROUND);
+      fill(0, 150, TOP_SALIENCY_COLS, 154, cWHITE);
+      fill(40, 60, 44, TOP_SALIENCY_ROWS, cWHITE);
+      for (int a = 0; a < 720; ++a) {
+         float theta = a * M_PI / 360;
+         int x = 160 + 60 * cos(theta);
+         int y = 190 + 30 * sin(theta);
+         fill(x, y, x + 2, y + 2, cWHITE);
+      }
+      fill(220, 80, 250, 140, cBLACK);
+      fill(0, 220, 60, TOP_SALIENCY_ROWS, cBODY_PART);
+      for (unsigned int i = 0; i < image.size() / 100; ++i) {
+         image[rand() % image.size()] = (Colour)(rand() % cNUM_COLOURS);
+      }
+   }
+
+   void fill(int x0, int y0, int x1, int y1, Colour colour) {
+      for (int y = std::max(y0, 0); y < std::min(y1, TOP_SALIENCY_ROWS); ++y) {
+         for (int x = std::max(x0, 0); x < std::min(x1, TOP_SALIENCY_COLS);
+              ++x) {
+            image[x + y * TOP_SALIENCY_COLS] = colour;
+         }
+      }
+   }
+
+   std::vector<Colour> image;
+};
+
+BOOST_FIXTURE_TEST_SUITE(colour_runs, FieldFixture)
+
+BOOST_AUTO_TEST_CASE(runs_cover_every_row)
+{
+   ColourRuns runs;
+   runs.encode(&image[0], TOP_SALIENCY_COLS, TOP_SALIENCY_ROWS);
+   for (int y = 0; y < TOP_SALIENCY_ROWS; ++y) {
+      int x = 0;
+      for (const ColourRun *run = runs.rowBegin(y); run != runs.rowEnd(y);
+           ++run) {
+         BOOST_REQUIRE_EQUAL(run->x0, x);
+         BOOST_REQUIRE_GT(run->x1, run->x0);
+         for (; x < run->x1; ++x) {
+            BOOST_REQUIRE_EQUAL(image[x + y * TOP_SALIENCY_COLS], run->colour);
+         }
+      }
+      BOOST_REQUIRE_EQUAL(x, TOP_SALIENCY_COLS);
+   }
+
+   std::vector<Colour> decoded(image.size(), cNUM_COLOURS);
+   runs.decode(&decoded[0]);
+   BOOST_CHECK(decoded == image);
+}
+
+BOOST_AUTO_TEST_CASE(packing_round_trips)
+{
+   ColourRuns runs;
+   runs.encode(&image[0], TOP_SALIENCY_COLS, TOP_SALIENCY_ROWS);
+   std::vector<uint8_t> packed;
+   runs.pack(packed);
+
+   ColourRuns unpacked;
+   BOOST_REQUIRE(unpacked.unpack(&packed[0], packed.size(), TOP_SALIENCY_COLS,
+                                 TOP_SALIENCY_ROWS));
+   BOOST_CHECK_EQUAL(unpacked.getNumRuns(), runs.getNumRuns());
+   std::vector<Colour> decoded(image.size(), cNUM_COLOURS);
+   unpacked.decode(&decoded[0]);
+   BOOST_CHECK(decoded == image);
+
+   // short, long and otherwise corrupt bytes are rejected
+   BOOST_CHECK(!unpacked.unpack(&packed[0], packed.size() - 1,
+                                TOP_SALIENCY_COLS, TOP_SALIENCY_ROWS));
+   packed.push_back(cGREEN);
+   BOOST_CHECK(!unpacked.unpack(&packed[0], packed.size(), TOP_SALIENCY_COLS,
+                                TOP_SALIENCY_ROWS));
+   packed.pop_back();
+   packed[0] = cNUM_COLOURS;
+   BOOST_CHECK(!unpacked.unpack(&packed[0], packed.size(), TOP_SALIENCY_COLS,
+                                TOP_SALIENCY_ROWS));
+}
+
+BOOST_AUTO_TEST_CASE(benchmark)
+{
+   const int repeats = benchmarkRepeats(BENCHMARK_REPEATS);
+   ColourRuns runs;
+   std::vector<uint8_t> packed;
+   Timer timer;
+   for (int repeat = 0; repeat < repeats; ++repeat) {
+      runs.encode(&image[0], TOP_SALIENCY_COLS, TOP_SALIENCY_ROWS);
+   }
+   uint32_t encodeTime = timer.elapsed_us();
+
+   timer.restart();
+   for (int repeat = 0; repeat < repeats; ++repeat) {
+      packed.clear();
+      runs.pack(packed);
+   }
+   uint32_t packTime = timer.elapsed_us();
+
+   BENCHMARK_MESSAGE("Top saliency: " << runs.getNumRuns() << " runs, "
+      << packed.size() << " bytes packed from "
+      << image.size() * sizeof(Colour) << ", encode "
+      << encodeTime / repeats << "us, pack "
+      << packTime / repeats << "us");
+   BOOST_CHECK_LT(packed.size(), image.size());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,352 @@
+#define BOOST_TEST_DYN_LINK
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "perception/vision/VisionDefinitions.hpp"
+#include "utils/ConnectedComponents.hpp"
+#include "utils/Timer.hpp"
+#include "tests/TestData.hpp"
+
+#define TEST_COLS TOP_SALIENCY_COLS
+#define TEST_ROWS TOP_SALIENCY_ROWS
+#define TEST_CUT_SIZE 16
+#define BENCHMARK_REPEATS 20
+
+/* Reads a mask from an image of colours, one byte per pixel */
+class WhiteMask {
+   public:
+      explicit WhiteMask(const std::vector<uint8_t> &image) : image(image) {}
+
+      inline void row(int y, int cols, uint8_t *mask) const {
+         const uint8_t *colour = &image[y * cols];
+         for (int x = 0; x < cols; ++x) {
+            mask[x] = colour[x] == cWHITE;
+         }
+      }
+
+   private:
+      const std::vector<uint8_t> &image;
+};
+
+/* Labels by flood fill, for checking against */
+static std::vector<CCABoxStats> floodFill(const std::vector<uint8_t> &image,
+                                          int cutSize) {
+   std::vector<int> labels(TEST_COLS * TEST_ROWS, -1);
+   std::vector<CCABoxStats> components;
+   std::vector<int> stack;
+   for (int start = 0; start < TEST_COLS * TEST_ROWS; ++start) {
+      if (image[start] != cWHITE || labels[start] >= 0) {
+         continue;
+      }
+      CCABoxStats stats;
+      stats.count = 0;
+      stats.low_x = stats.low_y = INT_MAX;
+      stats.high_x = stats.high_y = -1;
+      labels[start] = components.size();
+      stack.push_back(start);
+      while (!stack.empty()) {
+         int pixel = stack.back();
+         stack.pop_back();
+         int x = pixel % TEST_COLS;
+         int y = pixel / TEST_COLS;
+         ++stats.count;
+         stats.low_x = std::min(stats.low_x, x);
+         stats.high_x = std::max(stats.high_x, x);
+         stats.low_y = std::min(stats.low_y, y);
+         stats.high_y = std::max(stats.high_y, y);
+
+         // left, right, up and down, unless across a cut
+         int neighbours[4] = {-1, -1, -1, -1};
+         if (x > 0 && (cutSize == 0 || x % cutSize != 0)) {
+            neighbours[0] = pixel - 1;
+         }
+         if (x + 1 < TEST_COLS && (cutSize == 0 || (x + 1) % cutSize != 0)) {
+            neighbours[1] = pixel + 1;
+         }
+         if (y > 0 && (cutSize == 0 || y % cutSize != 0)) {
+            neighbours[2] = pixel - TEST_COLS;
+         }
+         if (y + 1 < TEST_ROWS && (cutSize == 0 || (y + 1) % cutSize != 0)) {
+            neighbours[3] = pixel + TEST_COLS;
+         }
+         for (int n = 0; n < 4; ++n) {
+            int next = neighbours[n];
+            if (next >= 0 && image[next] == cWHITE && labels[next] < 0) {
+               labels[next] = labels[start];
+               stack.push_back(next);
+            }
+         }
+      }
+      components.push_back(stats);
+   }
+   return components;
+}
+
+/* The link table the per-pixel labelling used, less its logging */
+struct LegacyGroupLinks {
+   enum { maxGroups = 4000, maxLinks = 400 };
+
+   LegacyGroupLinks() : numGroups(0), links(maxGroups * maxLinks),
+                        linked(maxGroups * maxGroups, false),
+                        amounts(maxGroups) {}
+
+   bool newGroup() {
+      if (numGroups >= maxGroups) {
+         return false;
+      }
+      amounts[numGroups] = 1;
+      links[numGroups * maxLinks] = numGroups;
+      linked[numGroups * maxGroups + numGroups] = true;
+      ++numGroups;
+      return true;
+   }
+
+   int *begin(int group) { return &links[group * maxLinks]; }
+   int *end(int group) { return &links[group * maxLinks + amounts[group]]; }
+
+   bool addLink(int group, int value) {
+      if (linked[group * maxGroups + value] || amounts[group] >= maxLinks) {
+         return false;
+      }
+      links[group * maxLinks + amounts[group]] = value;
+      linked[group * maxGroups + value] = true;
+      ++amounts[group];
+      return true;
+   }
+
+   int get(int group, int link) { return links[group * maxLinks + link]; }
+
+   void clearHigh(int group) {
+      for (int link = 1; link < amounts[group]; ++link) {
+         linked[group * maxGroups + links[group * maxLinks + link]] = false;
+      }
+      amounts[group] = 1;
+   }
+
+   void fullReset() {
+      for (int group = 0; group < numGroups; ++group) {
+         for (int link = 0; link < amounts[group]; ++link) {
+            linked[group * maxGroups + links[group * maxLinks + link]] = false;
+         }
+      }
+      numGroups = 0;
+   }
+
+   int numGroups;
+   std::vector<int> links;
+   std::vector<bool> linked;
+   std::vector<int> amounts;
+};
+
+/* Links a pixel to the lower of its labelled neighbours, noting the other */
+static void linkNeighbours(LegacyGroupLinks &links, uint16_t *group,
+                           uint16_t low, uint16_t high) {
+   *group = low;
+   if (high != USHRT_MAX && links.addLink(high, low)) {
+      std::push_heap(links.begin(high), links.end(high),
+                     std::greater<int>());
+   }
+}
+
+/* The per-pixel labelling ColourROI and BallDetector each had before,
+ * returning the components in the same order */
+static std::vector<CCABoxStats> legacyLabel(const std::vector<uint8_t> &image,
+                                            LegacyGroupLinks &links,
+                                            std::vector<uint16_t> &groups) {
+   std::vector<CCABoxStats> stats;
+   links.fullReset();
+   for (int y = 0; y < TEST_ROWS; ++y) {
+      for (int x = 0; x < TEST_COLS; ++x) {
+         int pixel = x + y * TEST_COLS;
+         if (image[pixel] != cWHITE) {
+            continue;
+         }
+         uint16_t left = USHRT_MAX;
+         uint16_t top = USHRT_MAX;
+         if (x % TEST_CUT_SIZE != 0 && image[pixel - 1] == cWHITE) {
+            left = groups[pixel - 1];
+         }
+         if (y % TEST_CUT_SIZE != 0 && image[pixel - TEST_COLS] == cWHITE) {
+            top = groups[pixel - TEST_COLS];
+         }
+         if (left == USHRT_MAX && top == USHRT_MAX) {
+            if (!links.newGroup()) {
+               return stats;
+            }
+            groups[pixel] = links.numGroups - 1;
+            CCABoxStats group;
+            group.start(x, x + 1, y);
+            stats.push_back(group);
+            continue;
+         }
+         if (top < left) {
+            linkNeighbours(links, &groups[pixel], top, left);
+         } else {
+            linkNeighbours(links, &groups[pixel], left, top);
+         }
+         stats[groups[pixel]].add(x, x + 1, y);
+      }
+   }
+
+   bool changed = true;
+   while (changed) {
+      changed = false;
+      for (int group = 0; group < links.numGroups; ++group) {
+         for (int owner = 1; owner < links.amounts[group]; ++owner) {
+            changed = true;
+            int linked = links.get(group, owner);
+            if (linked != group && links.addLink(linked, links.get(group, 0))) {
+               std::push_heap(links.begin(linked), links.end(linked),
+                              std::greater<int>());
+            }
+         }
+         links.clearHigh(group);
+      }
+   }
+   for (int group = links.numGroups - 1; group >= 0; --group) {
+      int owner = links.get(group, 0);
+      if (owner != group) {
+         stats[owner].merge(stats[group]);
+         stats[group].count = 0;
+      }
+   }
+
+   std::vector<CCABoxStats> components;
+   for (unsigned int group = 0; group < stats.size(); ++group) {
+      if (stats[group].count > 0) {
+         components.push_back(stats[group]);
+      }
+   }
+   return components;
+}
+
+static bool sameComponents(const std::vector<CCABoxStats> &a,
+                           const std::vector<CCABoxStats> &b) {
+   if (a.size() != b.size()) {
+      return false;
+   }
+   for (unsigned int i = 0; i < a.size(); ++i) {
+      if (a[i].count != b[i].count || a[i].low_x != b[i].low_x ||
+          a[i].high_x != b[i].high_x || a[i].low_y != b[i].low_y ||
+          a[i].high_y != b[i].high_y) {
+         return false;
+      }
+   }
+   return true;
+}
+
+/* Marks a filled rectangle white */
+static void fill(std::vector<uint8_t> &image, int x0, int y0, int x1,
+                 int y1) {
+   for (int y = std::max(y0, 0); y < std::min(y1, TEST_ROWS); ++y) {
+      for (int x = std::max(x0, 0); x < std::min(x1, TEST_COLS); ++x) {
+         image[x + y * TEST_COLS] = cWHITE;
+      }
+   }
+}
+
+/* A top camera saliency image, either the one named by
+ * $RUNSWIFT_TEST_SALIENCY (TEST_COLS x TEST_ROWS colours, a byte each) or a
+ * field with lines, a circle, a ball and speckle */
+struct SaliencyFixture {
+   SaliencyFixture() : image(TEST_COLS * TEST_ROWS, cGREEN) {
+      if (readRecordedBytes("RUNSWIFT_TEST_SALIENCY", image)) {
+         return;
+      }
+
+      srand(42);
+      fill(image, 0, 150, TEST_COLS, 154);
+      fill(image, 40, 60, 44, TEST_ROWS);
+      for (int y = 60; y < TEST_ROWS; ++y) {
+         int x = 200 + (y - 60) / 2;
+         fill(image, x, y, x + 3, y + 1);
+      }
+      for (int a = 0; a < 720; ++a) {
+         float theta = a * M_PI / 360;
+         int x = 160 + 60 * cos(theta);
+         int y = 190 + 30 * sin(theta);
+         fill(image, x, y, x + 2, y + 2);
+      }
+      fill(image, 100, 100, 112, 112);
+      for (int i = 0; i < TEST_COLS * TEST_ROWS / 100; ++i) {
+         image[rand() % image.size()] = cWHITE;
+      }
+   }
+
+   std::vector<uint8_t> image;
+};
+
+BOOST_AUTO_TEST_SUITE(connected_components)
+
+BOOST_AUTO_TEST_CASE(matches_flood_fill)
+{
+   std::vector<uint8_t> image(TEST_COLS * TEST_ROWS);
+   ConnectedComponents<CCABoxStats> components;
+   srand(7);
+   for (int density = 10; density <= 70; density += 30) {
+      for (unsigned int i = 0; i < image.size(); ++i) {
+         image[i] = (rand() % 100 < density) ? cWHITE : cGREEN;
+      }
+      for (int cut = 0; cut <= TEST_CUT_SIZE; cut += TEST_CUT_SIZE) {
+         components.label(WhiteMask(image), TEST_COLS, TEST_ROWS, cut);
+         BOOST_CHECK(sameComponents(components.stats(),
+                                    floodFill(image, cut)));
+      }
+   }
+}
+
+BOOST_AUTO_TEST_CASE(empty_and_full)
+{
+   std::vector<uint8_t> image(TEST_COLS * TEST_ROWS, cGREEN);
+   ConnectedComponents<CCABoxStats> components;
+   components.label(WhiteMask(image), TEST_COLS, TEST_ROWS);
+   BOOST_CHECK_EQUAL(components.size(), 0);
+
+   std::fill(image.begin(), image.end(), cWHITE);
+   components.label(WhiteMask(image), TEST_COLS, TEST_ROWS);
+   BOOST_REQUIRE_EQUAL(components.size(), 1);
+   BOOST_CHECK_EQUAL(components[0].count, TEST_COLS * TEST_ROWS);
+   BOOST_CHECK_EQUAL(components[0].high_x, TEST_COLS - 1);
+   BOOST_CHECK_EQUAL(components[0].high_y, TEST_ROWS - 1);
+
+   components.label(WhiteMask(image), TEST_COLS, TEST_ROWS, TEST_CUT_SIZE);
+   BOOST_CHECK_EQUAL(components.size(),
+                     (TEST_COLS / TEST_CUT_SIZE) * (TEST_ROWS / TEST_CUT_SIZE));
+}
+
+BOOST_FIXTURE_TEST_CASE(benchmark, SaliencyFixture)
+{
+   const int repeats = benchmarkRepeats(BENCHMARK_REPEATS);
+   LegacyGroupLinks links;
+   std::vector<uint16_t> groups(TEST_COLS * TEST_ROWS);
+   ConnectedComponents<CCABoxStats> components;
+   std::vector<CCABoxStats> legacy;
+
+   Timer timer;
+   for (int repeat = 0; repeat < repeats; ++repeat) {
+      legacy = legacyLabel(image, links, groups);
+   }
+   uint32_t legacyTime = timer.elapsed_us();
+
+   timer.restart();
+   for (int repeat = 0; repeat < repeats; ++repeat) {
+      components.label(WhiteMask(image), TEST_COLS, TEST_ROWS, TEST_CUT_SIZE);
+   }
+   uint32_t runTime = timer.elapsed_us();
+
+   BENCHMARK_MESSAGE("Top saliency CCA, mean per frame: old pixel labeller "
+      << legacyTime / repeats << "us/frame, run labeller "
+      << runTime / repeats << "us/frame, " << components.size()
+      << " groups");
+   BOOST_CHECK(sameComponents(components.stats(), legacy));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+/* Tests run on data recorded from a robot when an environment variable
+ * names a file of it, and on synthetic data otherwise. Benchmarks run their
+ * checks once in the default run, and only repeat and report timings when
+ * $RUNSWIFT_TEST_BENCHMARK is set. */
+
+/* Fill bytes from the binary file named by $variable
+ * @return whether the file was named and held at least bytes.size() bytes,
+ *         if not bytes is left as it was */
+inline bool readRecordedBytes(const char *variable,
+                              std::vector<uint8_t> &bytes)
+{
+   const char *path = getenv(variable);
+   if (path == NULL || bytes.empty()) {
+      return false;
+   }
+   std::vector<uint8_t> recorded(bytes.size());
+   std::ifstream in(path, std::ios::binary);
+   if (!in.read((char *)&recorded[0], recorded.size()).good()) {
+      return false;
+   }
+   bytes.swap(recorded);
+   return true;
+}
+
+/* The lines of the text file named by $variable, none if it isn't named */
+inline std::vector<std::string> readRecordedLines(const char *variable)
+{
+   std::vector<std::string> lines;
+   const char *path = getenv(variable);
+   if (path != NULL) {
+      std::ifstream in(path);
+      std::string line;
+      while (std::getline(in, line)) {
+         lines.push_back(line);
+      }
+   }
+   return lines;
+}
+
+/* Whether benchmarks should time and report themselves */
+inline bool benchmarking()
+{
+   return getenv("RUNSWIFT_TEST_BENCHMARK") != NULL;
+}
+
+/* How many times a benchmark should repeat its work */
+inline int benchmarkRepeats(int repeats)
+{
+   return benchmarking() ? repeats : 1;
+}
+
+/* Report a benchmark's timings when benchmarking */
+#define BENCHMARK_MESSAGE(M) \
+   do { \
+      if (benchmarking()) { \
+         BOOST_TEST_MESSAGE(M); \
+      } \
+   } while (0)
@@ -0,0 +1,124 @@
+#define BOOST_TEST_DYN_LINK
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "perception/vision/middleinfoprocessor/FieldBoundaryScan.hpp"
+#include "utils/Timer.hpp"
+#include "tests/TestData.hpp"
+
+#define TEST_COLS TOP_SALIENCY_COLS
+#define TEST_ROWS TOP_SALIENCY_ROWS
+#define TEST_GREEN 2
+#define BENCHMARK_REPEATS 200
+
+/* A top camera saliency image, either the one named by
+ * $RUNSWIFT_TEST_SALIENCY (TEST_COLS x TEST_ROWS colours, a byte each) or
+ * background above a sloping field boundary and speckled field below it,
+ * with columns scanned from a sloping horizon to the bottom */
+struct BoundaryFixture {
+   BoundaryFixture() : image(TEST_COLS * TEST_ROWS, cGREEN),
+                       start(TEST_COLS), end(TEST_COLS, TEST_ROWS) {
+      srand(42);
+      std::vector<uint8_t> bytes(image.size());
+      const bool recorded = readRecordedBytes("RUNSWIFT_TEST_SALIENCY", bytes);
+      if (recorded) {
+         for (unsigned int i = 0; i < bytes.size(); ++i) {
+            image[i] = (Colour)bytes[i];
+         }
+      }
+      for (int x = 0; x < TEST_COLS; ++x) {
+         start[x] = std::max(0, 10 - x / 20);
+         int boundary = TEST_ROWS / 4 + x / 8;
+         for (int y = 0; !recorded && y < TEST_ROWS; ++y) {
+            Colour &c = image[x + y * TEST_COLS];
+            if (y < boundary) {
+               c = (rand() % 4) ? cBACKGROUND : (Colour)(rand() % 5);
+            } else if (rand() % 6 == 0) {
+               c = (rand() % 2) ? cWHITE : (Colour)(rand() % 5);
+            }
+         }
+      }
+   }
+
+   std::vector<Colour> image;
+   std::vector<int> start;
+   std::vector<int> end;
+};
+
+BOOST_FIXTURE_TEST_SUITE(field_boundary_scan, BoundaryFixture)
+
+#ifdef __SSE2__
+
+BOOST_AUTO_TEST_CASE(sse2_matches_scalar)
+{
+   std::vector<int> expected(TEST_COLS);
+   std::vector<int> actual(TEST_COLS);
+
+   fieldBoundaryScanScalar(&image[0], TEST_COLS, TEST_COLS, &start[0],
+                           &end[0], TEST_GREEN, &expected[0]);
+   fieldBoundaryScanSSE2(&image[0], TEST_COLS, TEST_COLS, &start[0],
+                         &end[0], TEST_GREEN, &actual[0]);
+   BOOST_CHECK(expected == actual);
+
+   // Any colours, ranges of rows including empty ones, a column count
+   // leaving a scalar tail, and longer runs
+   for (int trial = 0; trial < 50; ++trial) {
+      for (unsigned int i = 0; i < image.size(); ++i) {
+         int r = rand() % 8;
+         image[i] = r < 3 ? cGREEN : r < 5 ? cWHITE : (Colour)(rand() % 5);
+      }
+      for (int x = 0; x < TEST_COLS; ++x) {
+         start[x] = rand() % TEST_ROWS;
+         end[x] = rand() % (TEST_ROWS + 1);
+      }
+      const int cols = TEST_COLS - trial % 17;
+      const int green = 1 + trial % 4;
+      fieldBoundaryScanScalar(&image[0], TEST_COLS, cols, &start[0],
+                              &end[0], green, &expected[0]);
+      fieldBoundaryScanSSE2(&image[0], TEST_COLS, cols, &start[0], &end[0],
+                            green, &actual[0]);
+      BOOST_REQUIRE(std::equal(expected.begin(), expected.begin() + cols,
+                               actual.begin()));
+   }
+}
+
+BOOST_AUTO_TEST_CASE(sse2_benchmark)
+{
+   const int repeats = benchmarkRepeats(BENCHMARK_REPEATS);
+   std::vector<int> expected(TEST_COLS);
+   std::vector<int> actual(TEST_COLS);
+
+   Timer timer;
+   for (int repeat = 0; repeat < repeats; ++repeat) {
+      fieldBoundaryScanScalar(&image[0], TEST_COLS, TEST_COLS, &start[0],
+                              &end[0], TEST_GREEN, &expected[0]);
+   }
+   uint32_t scalarTime = timer.elapsed_us();
+
+   timer.restart();
+   for (int repeat = 0; repeat < repeats; ++repeat) {
+      fieldBoundaryScanSSE2(&image[0], TEST_COLS, TEST_COLS, &start[0],
+                            &end[0], TEST_GREEN, &actual[0]);
+   }
+   uint32_t sse2Time = timer.elapsed_us();
+
+   int found = 0;
+   for (int x = 0; x < TEST_COLS; ++x) {
+      found += expected[x] >= 0;
+   }
+   BENCHMARK_MESSAGE("Top field boundary scan: scalar "
+      << (float)scalarTime / repeats << "us, SSE2 "
+      << (float)sse2Time / repeats << "us, boundary in "
+      << found << "/" << TEST_COLS << " columns");
+   BOOST_CHECK(expected == actual);
+}
+
+#endif // __SSE2__
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,105 @@
+#define BOOST_TEST_DYN_LINK
+#include <stdint.h>
+#include <string.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include "utils/FrameArena.hpp"
+
+#define TEST_ARENA_SIZE 1024
+
+/* Whether p is aligned for SSE loads and stores */
+static bool aligned(const void *p)
+{
+   return ((uintptr_t)p & (FRAME_ARENA_ALIGNMENT - 1)) == 0;
+}
+
+BOOST_AUTO_TEST_SUITE(frame_arena)
+
+BOOST_AUTO_TEST_CASE(allocations_are_aligned)
+{
+   FrameArena arena(TEST_ARENA_SIZE);
+   // Odd sizes leave every possible remainder before the next allocation
+   for (size_t bytes = 1; bytes <= 40; ++bytes) {
+      uint8_t *p = static_cast<uint8_t *>(arena.allocate(bytes));
+      BOOST_CHECK(aligned(p));
+      memset(p, 0xAB, bytes);
+   }
+   double *d = arena.allocate<double>(3);
+   BOOST_CHECK(aligned(d));
+}
+
+BOOST_AUTO_TEST_CASE(allocations_do_not_overlap)
+{
+   FrameArena arena(TEST_ARENA_SIZE);
+   uint8_t *a = static_cast<uint8_t *>(arena.allocate(17));
+   uint8_t *b = static_cast<uint8_t *>(arena.allocate(17));
+   memset(a, 1, 17);
+   memset(b, 2, 17);
+   BOOST_CHECK(b >= a + 17);
+   BOOST_CHECK_EQUAL(a[16], 1);
+   BOOST_CHECK_EQUAL(b[0], 2);
+}
+
+BOOST_AUTO_TEST_CASE(counts_each_frame)
+{
+   FrameArena arena(TEST_ARENA_SIZE);
+   arena.allocate(10);
+   arena.allocate<int>(5);
+   arena.allocate(1);
+   BOOST_CHECK_EQUAL(arena.bytesAllocated(), 10 + 5 * sizeof(int) + 1);
+   BOOST_CHECK_EQUAL(arena.allocations(), 3u);
+
+   arena.reset();
+   BOOST_CHECK_EQUAL(arena.bytesAllocated(), 0u);
+   BOOST_CHECK_EQUAL(arena.allocations(), 0u);
+   BOOST_CHECK_EQUAL(arena.blockAllocations(), 0u);
+
+   arena.allocate(100);
+   BOOST_CHECK_EQUAL(arena.bytesAllocated(), 100u);
+   BOOST_CHECK_EQUAL(arena.allocations(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(reset_reuses_memory)
+{
+   FrameArena arena(TEST_ARENA_SIZE);
+   void *first = arena.allocate(64);
+   arena.allocate(64);
+   arena.reset();
+   BOOST_CHECK(arena.allocate(64) == first);
+   BOOST_CHECK_EQUAL(arena.capacity(), (size_t)TEST_ARENA_SIZE);
+}
+
+BOOST_AUTO_TEST_CASE(grows_when_full)
+{
+   FrameArena arena(TEST_ARENA_SIZE);
+   arena.reset();
+
+   // A frame needing more than the block gets another one
+   uint8_t *a = static_cast<uint8_t *>(arena.allocate(TEST_ARENA_SIZE - 8));
+   uint8_t *b = static_cast<uint8_t *>(arena.allocate(64));
+   BOOST_CHECK(aligned(b));
+   BOOST_CHECK(b < a || b >= a + TEST_ARENA_SIZE - 8);
+   BOOST_CHECK_EQUAL(arena.blockAllocations(), 1u);
+   BOOST_CHECK_EQUAL(arena.capacity(), 3u * TEST_ARENA_SIZE);
+
+   // An allocation bigger than a doubled block gets a block of its own size
+   uint8_t *c = static_cast<uint8_t *>(arena.allocate(8 * TEST_ARENA_SIZE));
+   memset(c, 0, 8 * TEST_ARENA_SIZE);
+   BOOST_CHECK_EQUAL(arena.blockAllocations(), 2u);
+   BOOST_CHECK_EQUAL(arena.capacity(), 11u * TEST_ARENA_SIZE);
+
+   // The next frame merges them into one block, and the same frame then
+   // fits without touching the heap
+   arena.reset();
+   BOOST_CHECK_EQUAL(arena.blockAllocations(), 1u);
+   BOOST_CHECK_EQUAL(arena.capacity(), 11u * TEST_ARENA_SIZE);
+   arena.reset();
+   arena.allocate(TEST_ARENA_SIZE - 8);
+   arena.allocate(64);
+   arena.allocate(8 * TEST_ARENA_SIZE);
+   BOOST_CHECK_EQUAL(arena.blockAllocations(), 0u);
+   BOOST_CHECK_EQUAL(arena.capacity(), 11u * TEST_ARENA_SIZE);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,191 @@
+#define BOOST_TEST_DYN_LINK
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "perception/vision/camera/FileCaptureDevice.hpp"
+#include "perception/vision/camera/FrameRing.hpp"
+
+#define TEST_FRAME_BYTES 64
+#define TEST_NUM_FRAMES 10
+#define TEST_NUM_BUFFERS 4
+
+/* A FileCaptureDevice that counts the buffers given back to it, and says
+ * when it has been deleted */
+class CountingCaptureDevice : public FileCaptureDevice {
+   public:
+      CountingCaptureDevice(const std::string &filename, bool *deleted)
+         : FileCaptureDevice(filename, TEST_FRAME_BYTES, TEST_NUM_BUFFERS),
+           enqueued(0), deleted(deleted) {}
+      ~CountingCaptureDevice() {
+         *deleted = true;
+      }
+
+      void enqueue(unsigned int index) {
+         ++enqueued;
+         FileCaptureDevice::enqueue(index);
+      }
+
+      int enqueued;
+
+   private:
+      bool *deleted;
+};
+
+/* A recording of TEST_NUM_FRAMES frames, each filled with its own number,
+ * played through a ring of TEST_NUM_BUFFERS buffers */
+struct FrameRingFixture {
+   FrameRingFixture() {
+      char name[] = "/tmp/TestFrameRingXXXXXX";
+      int fd = mkstemp(name);
+      BOOST_REQUIRE(fd >= 0);
+      filename = name;
+      for (int i = 0; i < TEST_NUM_FRAMES; ++i) {
+         std::vector<uint8_t> frame(TEST_FRAME_BYTES, i);
+         BOOST_REQUIRE(write(fd, &frame[0], TEST_FRAME_BYTES) ==
+                       TEST_FRAME_BYTES);
+      }
+      close(fd);
+
+      device = new FileCaptureDevice(filename, TEST_FRAME_BYTES,
+                                     TEST_NUM_BUFFERS);
+      ring = new FrameRing(device);
+   }
+
+   ~FrameRingFixture() {
+      ring->release();
+      unlink(filename.c_str());
+   }
+
+   std::string filename;
+   FileCaptureDevice *device;
+   FrameRing *ring;
+};
+
+BOOST_FIXTURE_TEST_SUITE(frame_ring, FrameRingFixture)
+
+BOOST_AUTO_TEST_CASE(plays_recording_in_order)
+{
+   for (int i = 0; i < 2 * TEST_NUM_FRAMES; ++i) {
+      FrameHandle frame = ring->acquire();
+      BOOST_REQUIRE(frame.valid());
+      BOOST_CHECK_EQUAL(frame.sequence(), (uint32_t)i);
+      BOOST_CHECK_EQUAL(frame.timestamp(),
+                        (int64_t)i * FILE_CAPTURE_FRAME_PERIOD_US);
+      BOOST_CHECK_EQUAL(frame.data()[0], i % TEST_NUM_FRAMES);
+      BOOST_CHECK_EQUAL(frame.length(), (size_t)TEST_FRAME_BYTES);
+      BOOST_CHECK_EQUAL(frame.data()[TEST_FRAME_BYTES - 1],
+                        i % TEST_NUM_FRAMES);
+   }
+   BOOST_CHECK_EQUAL(ring->captured(), (uint32_t)(2 * TEST_NUM_FRAMES));
+   BOOST_CHECK_EQUAL(ring->dropped(), 0u);
+   BOOST_CHECK_EQUAL(ring->held(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(held_frame_survives_next_acquire)
+{
+   FrameHandle current = ring->acquire();
+   for (int i = 1; i < 2 * TEST_NUM_FRAMES; ++i) {
+      // as NaoCamera::get does: dequeue the next frame, then let go
+      FrameHandle next = ring->acquire();
+      BOOST_REQUIRE(next.valid());
+      BOOST_CHECK_EQUAL(current.data()[0], (i - 1) % TEST_NUM_FRAMES);
+      BOOST_CHECK(next.data() != current.data());
+      BOOST_CHECK_EQUAL(ring->held(), 2u);
+      current = next;
+   }
+   current.reset();
+   BOOST_CHECK_EQUAL(ring->held(), 0u);
+   BOOST_CHECK_EQUAL(ring->dropped(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(copies_share_a_buffer)
+{
+   FrameHandle a = ring->acquire();
+   FrameHandle b(a);
+   FrameHandle c;
+   c = b;
+   c = c;
+   BOOST_CHECK_EQUAL(ring->held(), 1u);
+   a.reset();
+   b.reset();
+   BOOST_CHECK_EQUAL(ring->held(), 1u);
+   BOOST_CHECK_EQUAL(c.data()[0], 0);
+   c.reset();
+   BOOST_CHECK(!c.valid());
+   BOOST_CHECK_EQUAL(c.length(), 0u);
+   BOOST_CHECK_EQUAL(ring->held(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(counts_frames_dropped_while_all_buffers_held)
+{
+   std::vector<FrameHandle> held;
+   for (int i = 0; i < TEST_NUM_BUFFERS; ++i) {
+      held.push_back(ring->acquire());
+   }
+   BOOST_CHECK_EQUAL(ring->held(), (unsigned int)TEST_NUM_BUFFERS);
+
+   // nothing to capture into, like the driver when processing falls behind
+   BOOST_CHECK(!ring->acquire().valid());
+   device->elapse(2);
+   held.clear();
+
+   FrameHandle frame = ring->acquire();
+   BOOST_REQUIRE(frame.valid());
+   BOOST_CHECK_EQUAL(frame.sequence(), (uint32_t)TEST_NUM_BUFFERS + 3);
+   BOOST_CHECK_EQUAL(frame.data()[0], TEST_NUM_BUFFERS + 3);
+   BOOST_CHECK_EQUAL(ring->dropped(), 3u);
+}
+
+BOOST_AUTO_TEST_CASE(slow_consumer_gets_oldest_frames_first)
+{
+   // with every buffer queued, frames wait in the buffers rather than drop
+   device->elapse(TEST_NUM_BUFFERS);
+   for (int i = 0; i < TEST_NUM_BUFFERS; ++i) {
+      FrameHandle frame = ring->acquire();
+      BOOST_CHECK_EQUAL(frame.sequence(), (uint32_t)i);
+   }
+   BOOST_CHECK_EQUAL(ring->dropped(), 0u);
+
+   // one period more than there are buffers loses a frame
+   device->elapse(TEST_NUM_BUFFERS + 1);
+   for (int i = 0; i < TEST_NUM_BUFFERS; ++i) {
+      ring->acquire();
+   }
+   BOOST_CHECK_EQUAL(ring->acquire().sequence(),
+                     (uint32_t)(2 * TEST_NUM_BUFFERS + 1));
+   BOOST_CHECK_EQUAL(ring->dropped(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(held_frame_outlives_released_ring)
+{
+   bool deleted = false;
+   CountingCaptureDevice *counting =
+      new CountingCaptureDevice(filename, &deleted);
+   FrameRing *owned = new FrameRing(counting);
+   FrameHandle first = owned->acquire();
+   FrameHandle second = owned->acquire();
+   first.reset();
+   BOOST_CHECK_EQUAL(counting->enqueued, 1);
+
+   // like a frame still queued for the pipeline when the camera stops
+   owned->release();
+   BOOST_CHECK(!deleted);
+   BOOST_CHECK_EQUAL(second.data()[0], 1);
+   BOOST_CHECK_EQUAL(second.length(), (size_t)TEST_FRAME_BYTES);
+   FrameHandle copy(second);
+   second.reset();
+   BOOST_CHECK(!deleted);
+
+   // the owner takes the buffers back itself once it has released the ring
+   BOOST_CHECK_EQUAL(counting->enqueued, 1);
+   copy.reset();
+   BOOST_CHECK(deleted);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
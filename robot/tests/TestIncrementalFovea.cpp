@@ -0,0 +1,142 @@
+#define BOOST_TEST_DYN_LINK
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "perception/vision/Fovea.hpp"
+#include "perception/vision/colour/ColourClassifierInterface.hpp"
+#include "types/CombinedFrame.hpp"
+
+#define FRAME_BYTES (TOP_IMAGE_ROWS * TOP_IMAGE_COLS * 2)
+
+/* Classifies by Y alone, so changes to any byte but U and V still change
+ * the colour image */
+class BrightnessClassifier : public ColourClassifier {
+   public:
+      Colour classifyTop(const uint8_t *pixel) const {
+         return classify(pixel);
+      }
+      Colour classifyBot(const uint8_t *pixel) const {
+         return classify(pixel);
+      }
+      void sampleImageScanLines(const uint8_t *image, bool top, int n_rows,
+         int n_cols, const VisionInfoIn &info_in, int stepsize) {}
+      void loadNnmc(std::string filename) {}
+      void updateColours() {}
+      void saveClassification() {}
+      void saveNnmc(std::string filename) {}
+      void resetNnmc() {}
+      void fillPoints(bool isGreen) {}
+
+   private:
+      static Colour classify(const uint8_t *pixel) {
+         if (pixel[0] < 64) return cBLACK;
+         if (pixel[0] > 192) return cWHITE;
+         return (pixel[1] < 128) ? cGREEN : cBACKGROUND;
+      }
+};
+
+/* A frame of blocks of colour with some noise, and a still robot */
+struct IncrementalFoveaFixture {
+   IncrementalFoveaFixture() : frame(FRAME_BYTES) {
+      srand(42);
+      for (int y = 0; y < TOP_IMAGE_ROWS; ++y) {
+         for (int x = 0; x < TOP_IMAGE_COLS * 2; ++x) {
+            const int block = (y / 37) * 7 + (x / 53);
+            frame[y * TOP_IMAGE_COLS * 2 + x] =
+               (block * 97 + rand() % 5) % 256;
+         }
+      }
+      cameraToRR.moving_ = false;
+   }
+
+   /* Add amount to every byte of rows y0 to y1 and bytes x0 to x1 */
+   void change(std::vector<uint8_t> &changed, int x0, int y0, int x1,
+               int y1, int amount) {
+      for (int y = y0; y < y1; ++y) {
+         for (int x = x0; x < x1; ++x) {
+            uint8_t &byte = changed[y * TOP_IMAGE_COLS * 2 + x];
+            byte = (byte + amount) % 256;
+         }
+      }
+   }
+
+   /* Check a fovea kept up to date incrementally from first to second has
+    * the same images as one made from second alone */
+   void checkMatchesFull(const std::vector<uint8_t> &first,
+                         const std::vector<uint8_t> &second, int density,
+                         float minRecomputed, float maxRecomputed) {
+      const BBox bb(Point(0, 0), Point(TOP_IMAGE_COLS / density,
+                                       TOP_IMAGE_ROWS / density));
+      Fovea incremental(bb, density, true, true, true, true);
+      Fovea full(bb, density, true, true, true, true);
+      incremental.setIncremental(true);
+
+      incremental.generate(CombinedFrame(&first[0], NULL, cameraToRR,
+         boost::shared_ptr<CombinedFrame>()), classifier);
+      incremental.generate(CombinedFrame(&second[0], NULL, cameraToRR,
+         boost::shared_ptr<CombinedFrame>()), classifier);
+      full.generate(CombinedFrame(&second[0], NULL, cameraToRR,
+         boost::shared_ptr<CombinedFrame>()), classifier);
+
+      const int pixels = bb.width() * bb.height();
+      BOOST_CHECK_GE(incremental.getRecomputedFraction(), minRecomputed);
+      BOOST_CHECK_LE(incremental.getRecomputedFraction(), maxRecomputed);
+      BOOST_CHECK(memcmp(incremental._colour, full._colour,
+                         pixels * sizeof(Colour)) == 0);
+      BOOST_CHECK(memcmp(incremental._grey, full._grey,
+                         pixels * sizeof(int16_t)) == 0);
+      BOOST_CHECK(memcmp(incremental._edgeX, full._edgeX,
+                         pixels * sizeof(int16_t)) == 0);
+      BOOST_CHECK(memcmp(incremental._edgeY, full._edgeY,
+                         pixels * sizeof(int16_t)) == 0);
+   }
+
+   std::vector<uint8_t> frame;
+   CameraToRR cameraToRR;
+   BrightnessClassifier classifier;
+};
+
+BOOST_FIXTURE_TEST_SUITE(incremental_fovea, IncrementalFoveaFixture)
+
+BOOST_AUTO_TEST_CASE(unchanged_frame_matches_full)
+{
+   for (int density = 1; density <= TOP_SALIENCY_DENSITY; density *= 2) {
+      checkMatchesFull(frame, frame, density, 0.0f, 0.0f);
+   }
+}
+
+BOOST_AUTO_TEST_CASE(changed_regions_match_full)
+{
+   // Patches in the middle, across tile boundaries and on the image edges,
+   // all changed by more than the tile threshold
+   std::vector<uint8_t> changed = frame;
+   change(changed, 100, 50, 180, 90, 40);
+   change(changed, 0, 200, 64, 260, 100);
+   change(changed, TOP_IMAGE_COLS * 2 - 36, TOP_IMAGE_ROWS - 20,
+          TOP_IMAGE_COLS * 2, TOP_IMAGE_ROWS, 200);
+   change(changed, 700, 301, 701, 302, 128);
+   for (int density = 1; density <= TOP_SALIENCY_DENSITY; density *= 2) {
+      checkMatchesFull(frame, changed, density, 0.001f, 0.5f);
+   }
+}
+
+BOOST_AUTO_TEST_CASE(unsampled_bytes_are_ignored)
+{
+   // With an even density every sampled pixel is the first of its
+   // macropixel, so its second Y is never classified or blurred, and
+   // changing only those leaves every tile as it was
+   std::vector<uint8_t> changed = frame;
+   for (int i = 2; i < FRAME_BYTES; i += 4) {
+      changed[i] += 100;
+   }
+   for (int density = 2; density <= TOP_SALIENCY_DENSITY; density *= 2) {
+      checkMatchesFull(frame, changed, density, 0.0f, 0.0f);
+   }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
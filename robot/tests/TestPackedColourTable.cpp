@@ -0,0 +1,219 @@
+#define BOOST_TEST_DYN_LINK
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include <vector>
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int.hpp>
+#include <boost/random/variate_generator.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include "perception/vision/colour/ClassifyRun.hpp"
+#include "perception/vision/colour/PackedColourTable.hpp"
+#include "utils/Timer.hpp"
+#include "tests/TestData.hpp"
+
+#define NNMC_SIZE (128 * 128 * 128)
+#define FRAME_BYTES (TOP_IMAGE_ROWS * TOP_IMAGE_COLS * 2)
+#define BENCHMARK_REPEATS 20
+
+/* Counts last level cache misses of this thread, if the CPU has a counter
+ * for them and the kernel allows it */
+class CacheMissCounter {
+   public:
+      CacheMissCounter() : error(0) {
+         // Some PMUs only provide the generic event as the cache event
+         fd = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+         if (fd < 0) {
+            fd = openEvent(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL |
+                      (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+         }
+         if (fd < 0) {
+            error = errno;
+         }
+      }
+
+      ~CacheMissCounter() {
+         if (fd >= 0) {
+            close(fd);
+         }
+      }
+
+      void start() {
+         if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+         }
+      }
+
+      /* @return misses since start, or -1 if unavailable */
+      long long stop() {
+         long long count;
+         if (fd < 0) {
+            return -1;
+         }
+         ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+         if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+            return -1;
+         }
+         return count;
+      }
+
+      /* @return why misses can't be counted, or NULL if they can */
+      const char *unavailable() const {
+         return fd < 0 ? strerror(error) : NULL;
+      }
+
+   private:
+      static int openEvent(uint32_t type, uint64_t config) {
+         struct perf_event_attr attr;
+         memset(&attr, 0, sizeof(attr));
+         attr.type = type;
+         attr.size = sizeof(attr);
+         attr.config = config;
+         attr.disabled = 1;
+         attr.exclude_kernel = 1;
+         attr.exclude_hv = 1;
+         return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+      }
+
+      int fd;
+      int error;
+};
+
+/* A lookup table shaped like a real calibration (a green blob, white at
+ * high Y, black at low Y, background elsewhere, with some noisy entries on
+ * the boundaries), and a frame that is either random or the raw YUV422 top
+ * camera frame named by $RUNSWIFT_TEST_FRAME */
+struct PackedColourTableFixture {
+   PackedColourTableFixture() : nnmc(NNMC_SIZE), frame(FRAME_BYTES) {
+      boost::mt19937 gen(42);
+      boost::uniform_int<> dist(0, 255);
+      boost::variate_generator<boost::mt19937&, boost::uniform_int<> >
+         byte(gen, dist);
+
+      for (int v = 0; v < 128; ++v) {
+         for (int u = 0; u < 128; ++u) {
+            for (int y = 0; y < 128; ++y) {
+               Colour colour = cBACKGROUND;
+               if (y < 12) {
+                  colour = cBLACK;
+               } else if (y > 100 && abs(u - 64) < 10 && abs(v - 64) < 10) {
+                  colour = cWHITE;
+               } else if (y > 20 && y < 90 && u < 60 && v < 60 &&
+                          (u - 30) * (u - 30) + (v - 30) * (v - 30) < 600) {
+                  colour = cGREEN;
+                  if (u > 45 && byte() < 64) {
+                     colour = cBACKGROUND;
+                  }
+               }
+               nnmc[(v << 14) | (u << 7) | y] = colour;
+            }
+         }
+      }
+      packed.build(&nnmc[0]);
+
+      if (!readRecordedBytes("RUNSWIFT_TEST_FRAME", frame)) {
+         for (int i = 0; i < FRAME_BYTES; ++i) {
+            frame[i] = byte();
+         }
+      }
+   }
+
+   std::vector<uint8_t> nnmc;
+   std::vector<uint8_t> frame;
+   PackedColourTable packed;
+};
+
+BOOST_FIXTURE_TEST_SUITE(packed_colour_table, PackedColourTableFixture)
+
+BOOST_AUTO_TEST_CASE(matches_dense_table)
+{
+   for (int v = 0; v < 256; v += 2) {
+      for (int u = 0; u < 256; u += 2) {
+         for (int y = 0; y < 256; y += 2) {
+            BOOST_REQUIRE_EQUAL(packed.lookup(y, u, v),
+               nnmc[((v >> 1) << 14) | ((u >> 1) << 7) | (y >> 1)]);
+         }
+      }
+   }
+   BOOST_CHECK(packed.numLeaves() > 0);
+   BOOST_CHECK(packed.size() < NNMC_SIZE / 4);
+}
+
+BOOST_AUTO_TEST_CASE(run_matches_dense_run)
+{
+   std::vector<Colour> expected(TOP_IMAGE_COLS);
+   std::vector<Colour> actual(TOP_IMAGE_COLS);
+
+   for (int density = 1; density <= 8; density *= 2) {
+      const int step = density * 2;
+      const int n = TOP_IMAGE_COLS / density - 2;
+      for (int row = 0; row < TOP_IMAGE_ROWS; row += 37) {
+         const uint8_t *raw = &frame[row * TOP_IMAGE_COLS * 2];
+         classifyRunScalar(&nnmc[0], raw, step, &expected[0], n);
+         packed.classifyRun(raw, step, &actual[0], n);
+         BOOST_REQUIRE(std::equal(expected.begin(), expected.begin() + n,
+                                  actual.begin()));
+      }
+   }
+}
+
+BOOST_AUTO_TEST_CASE(benchmark)
+{
+   const int repeats = benchmarkRepeats(BENCHMARK_REPEATS);
+   const int step = TOP_SALIENCY_DENSITY * 2;
+   std::vector<Colour> expected(TOP_SALIENCY_ROWS * TOP_SALIENCY_COLS);
+   std::vector<Colour> actual(TOP_SALIENCY_ROWS * TOP_SALIENCY_COLS);
+   CacheMissCounter misses;
+
+   Timer timer;
+   misses.start();
+   for (int repeat = 0; repeat < repeats; ++repeat) {
+      for (int row = 0; row < TOP_SALIENCY_ROWS; ++row) {
+         classifyRun(&nnmc[0],
+            &frame[row * TOP_SALIENCY_DENSITY * TOP_IMAGE_COLS * 2], step,
+            &expected[row * TOP_SALIENCY_COLS], TOP_SALIENCY_COLS);
+      }
+   }
+   long long denseMisses = misses.stop();
+   uint32_t denseTime = timer.elapsed_us();
+
+   timer.restart();
+   misses.start();
+   for (int repeat = 0; repeat < repeats; ++repeat) {
+      for (int row = 0; row < TOP_SALIENCY_ROWS; ++row) {
+         packed.classifyRun(
+            &frame[row * TOP_SALIENCY_DENSITY * TOP_IMAGE_COLS * 2], step,
+            &actual[row * TOP_SALIENCY_COLS], TOP_SALIENCY_COLS);
+      }
+   }
+   long long packedMisses = misses.stop();
+   uint32_t packedTime = timer.elapsed_us();
+
+   BENCHMARK_MESSAGE("Packed table: " << packed.size() << " bytes, "
+      << packed.numLeaves() << " leaves, dense table " << NNMC_SIZE
+      << " bytes");
+   BENCHMARK_MESSAGE("Top saliency classification per frame: dense "
+      << denseTime / repeats << "us, packed "
+      << packedTime / repeats << "us");
+   if (denseMisses >= 0 && packedMisses >= 0) {
+      BENCHMARK_MESSAGE("Cache misses per frame: dense "
+         << denseMisses / repeats << ", packed "
+         << packedMisses / repeats);
+   } else {
+      BENCHMARK_MESSAGE("Cache misses per frame: can't count them here ("
+         << misses.unavailable() << ")");
+   }
+   BOOST_CHECK(expected == actual);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
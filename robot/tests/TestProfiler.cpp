@@ -0,0 +1,132 @@
+#define BOOST_TEST_DYN_LINK
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include "utils/Profiler.hpp"
+#include "utils/Timer.hpp"
+
+#define BENCHMARK_ZONES 1000000
+
+/* the stats for the zone called name, or an empty one */
+static ProfileZoneStats findZone(const std::vector<ProfileZoneStats> &stats,
+                                 const std::string &name) {
+   for (unsigned int i = 0; i < stats.size(); ++i) {
+      if (stats[i].name == name) {
+         return stats[i];
+      }
+   }
+   return ProfileZoneStats();
+}
+
+static void recordRange(int zone, uint32_t from, uint32_t to) {
+   for (uint32_t us = from; us < to; ++us) {
+      Profiler::record(zone, us);
+   }
+}
+
+BOOST_AUTO_TEST_SUITE(profiler)
+
+BOOST_AUTO_TEST_CASE(zone_ids_are_stable)
+{
+   int a = Profiler::zoneId("test.a");
+   int b = Profiler::zoneId("test.b");
+   BOOST_CHECK(a != b);
+   BOOST_CHECK_EQUAL(Profiler::zoneId("test.a"), a);
+}
+
+BOOST_AUTO_TEST_CASE(percentiles_within_a_bucket)
+{
+   int zone = Profiler::zoneId("test.percentiles");
+   Profiler::stats(true);
+
+   // 1..1000us once each
+   recordRange(zone, 1, 1001);
+   Profiler::collect();
+   ProfileZoneStats stats = findZone(Profiler::stats(true), "test.percentiles");
+
+   BOOST_CHECK_EQUAL(stats.count, 1000u);
+   BOOST_CHECK_EQUAL(stats.max, 1000u);
+   // percentiles round up by at most an eighth
+   BOOST_CHECK(stats.p50 >= 500 && stats.p50 <= 500 * 9 / 8);
+   BOOST_CHECK(stats.p95 >= 950 && stats.p95 <= 1000);
+   BOOST_CHECK(stats.p99 >= 990 && stats.p99 <= 1000);
+
+   // the window was reset
+   BOOST_CHECK_EQUAL(findZone(Profiler::stats(false),
+                              "test.percentiles").count, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(tail_is_not_averaged_away)
+{
+   int zone = Profiler::zoneId("test.spike");
+   Profiler::stats(true);
+
+   // a 10ms tick with a 50ms spike every 50 ticks
+   for (int i = 0; i < 1000; ++i) {
+      Profiler::record(zone, i % 50 == 49 ? 50000 : 10000);
+   }
+   Profiler::collect();
+   ProfileZoneStats stats = findZone(Profiler::stats(true), "test.spike");
+
+   BOOST_CHECK(stats.p50 >= 10000 && stats.p50 < 12000);
+   BOOST_CHECK(stats.p99 >= 50000);
+   BOOST_CHECK_EQUAL(stats.max, 50000u);
+}
+
+BOOST_AUTO_TEST_CASE(collects_every_thread)
+{
+   int zone = Profiler::zoneId("test.threads");
+   Profiler::stats(true);
+
+   boost::thread_group threads;
+   for (int t = 0; t < 4; ++t) {
+      threads.create_thread(boost::bind(recordRange, zone, 1, 1001));
+   }
+   threads.join_all();
+   Profiler::collect();
+
+   BOOST_CHECK_EQUAL(findZone(Profiler::stats(true), "test.threads").count,
+                     4000u);
+}
+
+BOOST_AUTO_TEST_CASE(full_ring_drops_samples)
+{
+   int zone = Profiler::zoneId("test.full");
+   Profiler::collect();
+   Profiler::stats(true);
+   uint32_t dropped = Profiler::dropped();
+
+   recordRange(zone, 0, PROFILER_RING_SIZE + 10);
+   Profiler::collect();
+
+   BOOST_CHECK_EQUAL(findZone(Profiler::stats(true), "test.full").count,
+                     (uint32_t)PROFILER_RING_SIZE);
+   BOOST_CHECK_EQUAL(Profiler::dropped() - dropped, 10u);
+}
+
+BOOST_AUTO_TEST_CASE(benchmark)
+{
+   Profiler::collect();
+   Profiler::stats(true);
+
+   Timer timer;
+   for (int i = 0; i < BENCHMARK_ZONES; ++i) {
+      PROFILE_ZONE(zone, "test.benchmark");
+      // collect as often as the rings would need in a real tick
+      if ((i & (PROFILER_RING_SIZE / 2 - 1)) == 0) {
+         Profiler::collect();
+      }
+   }
+   uint32_t elapsed = timer.elapsed_us();
+   Profiler::collect();
+
+   float perZone = (float)elapsed / BENCHMARK_ZONES;
+   BOOST_TEST_MESSAGE("Profiler zone cost: " << perZone * 1000 << "ns");
+   BOOST_CHECK_EQUAL(findZone(Profiler::stats(true), "test.benchmark").count,
+                     (uint32_t)BENCHMARK_ZONES);
+   BOOST_CHECK(perZone < 1.0f);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -7,14 +7,18 @@
 
 #include <boost/random/mersenne_twister.hpp>
 #include <boost/random/normal_distribution.hpp>
+#include <boost/random/uniform_real.hpp>
 #include <boost/random/variate_generator.hpp>
 
 #include <boost/test/unit_test.hpp>
 
-#include "perception/vision/Ransac.hpp"
+#include "perception/vision/other/Ransac.hpp"
 #include "types/RansacTypes.hpp"
+#include "utils/Timer.hpp"
+#include "tests/TestData.hpp"
 
 #define N_POINTS 16
+#define BENCHMARK_SCENES 200
 
 /* With -fno-access-control unititialized warnings are raised */
 #pragma GCC diagnostic ignored "-Wuninitialized"
@@ -104,5 +108,379 @@ BOOST_AUTO_TEST_CASE(circle_noise)
    }
 }
 
-BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_CASE(adaptive_iterations)
+{
+   // log(0.01) / log(1 - 0.5^2) = 16.008
+   BOOST_CHECK_EQUAL(RANSAC::adaptiveIterations(0.99, 50, 100, 2, 100), 17u);
+   BOOST_CHECK_EQUAL(RANSAC::adaptiveIterations(0.99, 50, 100, 2, 10), 10u);
+   BOOST_CHECK_EQUAL(RANSAC::adaptiveIterations(0.99, 100, 100, 3, 10), 1u);
+   BOOST_CHECK_EQUAL(RANSAC::adaptiveIterations(0.99, 0, 100, 2, 10), 10u);
+   BOOST_CHECK_EQUAL(RANSAC::adaptiveIterations(0, 50, 100, 2, 100), 100u);
+}
+
+BOOST_AUTO_TEST_CASE(consensus_bits)
+{
+   RANSAC::Consensus cons;
+   cons.resize(70);
+   for (int i = 0; i < 70; ++ i) {
+      cons.set(i, i % 3 == 0);
+   }
+   std::vector<bool> out;
+   cons.copyTo(out, 70);
+   BOOST_REQUIRE_EQUAL(out.size(), 70u);
+   for (int i = 0; i < 70; ++ i) {
+      BOOST_CHECK_EQUAL(out[i], i % 3 == 0);
+      BOOST_CHECK_EQUAL(cons[i], i % 3 == 0);
+   }
+}
+
+/**
+ * findLine as it was before adaptive termination, packed consensus sets and
+ * vectorised scoring, to compare against.
+ */
+static bool legacyFindLine(const std::vector<Point> &points,
+                           std::vector<bool> **cons, RANSACLine &result,
+                           unsigned int k, float e, unsigned int n,
+                           std::vector<bool> cons_buf[2], unsigned int *seed)
+{
+   if (points.size() < n || n < 2) {
+      return false;
+   }
+   float minerr = std::numeric_limits<float>::max();
+   std::vector<bool> *best_concensus = &cons_buf[0];
+   std::vector<bool> *this_concensus;
+   for (unsigned int i = 0; i < k; ++ i) {
+      unsigned int p1 = rand_r(seed) % points.size();
+      unsigned int p2;
+      do {
+         p2 = rand_r(seed) % points.size();
+      } while (p1 == p2);
+
+      RANSACLine l(points[p1], points[p2]);
+      const float denom = sqrt(l.t1*l.t1 + l.t2*l.t2);
+      const float newe  = e*denom;
+      this_concensus = (best_concensus == &cons_buf[0]) ? &cons_buf[1]
+                                                        : &cons_buf[0];
+      unsigned int n_concensus_points = 0;
+      for (unsigned int j = 0; j != points.size(); ++ j) {
+         const Point &p = points[j];
+         float dist = (l.t1 * p.x() + l.t2 * p.y() + l.t3);
+         if (dist < 0) {
+            dist = -dist;
+         }
+         if (dist < newe) {
+            l.var += dist;
+            ++ n_concensus_points;
+            (*this_concensus)[j] = true;
+         } else {
+            (*this_concensus)[j] = false;
+         }
+      }
+      l.var /= denom;
+      l.var = (0.2f * l.var) - n_concensus_points;
+      if (l.var < minerr && n_concensus_points >= n) {
+         minerr = l.var;
+         l.var  = l.var / (points.size() * e);
+         result = l;
+         best_concensus = this_concensus;
+      }
+   }
+   if (minerr < std::numeric_limits<float>::max()) {
+      *cons = best_concensus;
+      return true;
+   }
+   return false;
+}
+
+/**
+ * findCircleOfRadius3P as it was before adaptive termination, packed
+ * consensus sets and vectorised scoring, to compare against.
+ */
+static bool legacyFindCircleOfRadius3P(const std::vector<Point> &points,
+                                       float radius, float radius_e,
+                                       std::vector<bool> **cons,
+                                       RANSACCircle &result, unsigned int k,
+                                       float e, unsigned int n,
+                                       std::vector<bool> cons_buf[2],
+                                       unsigned int *seed)
+{
+   if (points.size() < n || n < 3) {
+      return false;
+   }
+   const int e2 = e * e;
+   float minerr = std::numeric_limits<float>::max();
+   std::vector<bool> *best_concensus = &cons_buf[0];
+   std::vector<bool> *this_concensus;
+   float pos_var[4], neg_var[4];
+   RANSACCircle c;
+   for (unsigned int i = 0; i < k; ++ i) {
+      int radius_fails = 0;
+      while (radius_fails < 20) {
+         unsigned int p1 = rand_r(seed) % points.size();
+         unsigned int p2, p3;
+         do {
+            p2 = rand_r(seed) % points.size();
+         } while (p1 == p2);
+         do {
+            p3 = rand_r(seed) % points.size();
+         } while (p1 == p3 || p2 == p3);
+
+         RANSACCircle tmp(points[p1], points[p2], points[p3]);
+         if (! isnan(tmp.radius) && fabsf(tmp.radius - radius) <= radius_e) {
+            c = tmp;
+            break;
+         }
+         ++ radius_fails;
+      }
+      if (radius_fails == 20) {
+         return false;
+      }
+
+      this_concensus = (best_concensus == &cons_buf[0]) ? &cons_buf[1]
+                                                        : &cons_buf[0];
+      for (unsigned int j = 0; j < 4; ++ j) {
+         pos_var[j] = neg_var[j] = 0;
+      }
+      unsigned int n_concensus_points = 0;
+      for (unsigned int j = 0; j != points.size(); ++ j) {
+         const PointF &p = points[j].cast<float>();
+         const PointF &d = c.centre - p;
+         float dist = d.norm() - c.radius;
+         float dist2 = dist * dist;
+         if (dist2 < e2) {
+            int quadrant = (d.x() > 0) ? ((d.y() > 0) ? 0 : 3)
+                                       : ((d.y() > 0) ? 1 : 2);
+            if (dist > 0) {
+               pos_var[quadrant] += dist2;
+            } else {
+               neg_var[quadrant] += dist2;
+            }
+            ++ n_concensus_points;
+            (*this_concensus)[j] = true;
+         } else {
+            (*this_concensus)[j] = false;
+         }
+      }
+
+      c.var = 0;
+      for (unsigned int j = 0; j < 4; ++ j) {
+         float diff_var = pos_var[j] - neg_var[j];
+         c.var += pos_var[j] + neg_var[j] + diff_var * diff_var;
+      }
+      c.var = (0.2f * c.var) - n_concensus_points;
+      if (c.var < minerr && n_concensus_points >= n) {
+         minerr = c.var;
+         c.var  = c.var / (points.size() * e);
+         result = c;
+         best_concensus = this_concensus;
+      }
+   }
+   if (minerr < std::numeric_limits<float>::max()) {
+      *cons = best_concensus;
+      return true;
+   }
+   return false;
+}
+
+/* Scenes of points around a line, or a circle, among uniform outliers */
+struct SceneFixture {
+   SceneFixture() : gen(42), noise(gen, boost::normal_distribution<>(0, 1)),
+                    uniform(gen, boost::uniform_real<>(0, 1)) {}
+
+   /* Makes inliers points within a pixel or so of the line through a and
+    * b, and outliers points anywhere in a 640x480 image */
+   void lineScene(std::vector<Point> &points, PointF &a, PointF &b,
+                  int inliers, int outliers) {
+      a = PointF(uniform() * 640, uniform() * 480);
+      b = PointF(uniform() * 640, uniform() * 480);
+      points.clear();
+      for (int i = 0; i < inliers; ++ i) {
+         PointF p = a + (b - a) * uniform();
+         points.push_back(Point(p.x() + noise(), p.y() + noise()));
+      }
+      addOutliers(points, outliers);
+   }
+
+   void circleScene(std::vector<Point> &points, PointF &centre,
+                    float radius, int inliers, int outliers) {
+      centre = PointF(100 + uniform() * 440, 100 + uniform() * 280);
+      points.clear();
+      for (int i = 0; i < inliers; ++ i) {
+         float theta = uniform() * 2 * M_PI;
+         float r = radius + noise();
+         points.push_back(Point(centre.x() + r * cos(theta),
+                                centre.y() + r * sin(theta)));
+      }
+      addOutliers(points, outliers);
+   }
+
+   void addOutliers(std::vector<Point> &points, int outliers) {
+      for (int i = 0; i < outliers; ++ i) {
+         points.push_back(Point(uniform() * 640, uniform() * 480));
+      }
+      std::random_shuffle(points.begin(), points.end());
+   }
+
+   boost::mt19937 gen;
+   boost::variate_generator<boost::mt19937&, boost::normal_distribution<> >
+      noise;
+   boost::variate_generator<boost::mt19937&, boost::uniform_real<> >
+      uniform;
+};
+
+/* With the default options a search must do exactly what the legacy one
+ * did. The other options are opt in, and must still find every model the
+ * legacy search did, to within maxError. */
+static void checkAgainstLegacy(int variant, int found, float error,
+                               int legacyFound, float legacyError,
+                               float maxError)
+{
+   BOOST_CHECK_GE(found, legacyFound);
+   if (variant == 1) {
+      BOOST_CHECK_EQUAL(found, legacyFound);
+      BOOST_CHECK_CLOSE(error, legacyError, 0.01);
+   } else {
+      BOOST_CHECK_LT(error, maxError);
+   }
+}
+
+/* The largest distance of the ends of the segment a to b from line */
+static float lineError(const RANSACLine &line, PointF a, PointF b)
+{
+   const float denom = sqrt((float)(line.t1 * line.t1 + line.t2 * line.t2));
+   return std::max(fabsf(line.t1 * a.x() + line.t2 * a.y() + line.t3),
+                   fabsf(line.t1 * b.x() + line.t2 * b.y() + line.t3)) / denom;
+}
+
+BOOST_FIXTURE_TEST_CASE(line_benchmark, SceneFixture)
+{
+   const unsigned int k = 200;
+   const float e = 3;
+   const unsigned int n = 20;
+
+   std::vector<std::vector<Point> > scenes(BENCHMARK_SCENES);
+   std::vector<std::pair<PointF, PointF> > truths(BENCHMARK_SCENES);
+   for (int s = 0; s < BENCHMARK_SCENES; ++ s) {
+      // lines are short next to their end points' errors, so keep them long
+      do {
+         lineScene(scenes[s], truths[s].first, truths[s].second, 100, 150);
+      } while ((truths[s].first - truths[s].second).norm() < 200);
+   }
 
+   RANSAC::Options adaptive;
+   adaptive.confidence = 0.99f;
+   adaptive.localOptimisation = true;
+   RANSAC::Options preemptive;
+   preemptive.preemptive = 1;
+
+   int legacyFound = 0;
+   float legacyError = 0;
+   const char *names[] = {"legacy", "fixed k", "adaptive LO", "T(1,1)"};
+   for (int variant = 0; variant < 4; ++ variant) {
+      std::vector<bool> cons_buf[2];
+      std::vector<bool> *cons;
+      float error = 0;
+      int found = 0;
+      Timer timer;
+      for (int s = 0; s < BENCHMARK_SCENES; ++ s) {
+         unsigned int seed = s;
+         RANSACLine line;
+         cons_buf[0].assign(scenes[s].size(), false);
+         cons_buf[1].assign(scenes[s].size(), false);
+         bool ok;
+         if (variant == 0) {
+            ok = legacyFindLine(scenes[s], &cons, line, k, e, n, cons_buf,
+                                &seed);
+         } else {
+            ok = RANSAC::findLine(scenes[s], &cons, line, k, e, n, cons_buf,
+                                  &seed, variant == 1 ? RANSAC::Options()
+                                  : variant == 2 ? adaptive : preemptive);
+         }
+         if (ok) {
+            ++ found;
+            error += lineError(line, truths[s].first, truths[s].second);
+         }
+      }
+      uint32_t time = timer.elapsed_us();
+      error /= std::max(found, 1);
+      BENCHMARK_MESSAGE("Line, " << names[variant] << ": "
+         << (float)time / BENCHMARK_SCENES << "us per search, found "
+         << found << "/" << BENCHMARK_SCENES << ", mean end error "
+         << error << "px");
+
+      if (variant == 0) {
+         legacyFound = found;
+         legacyError = error;
+      } else {
+         checkAgainstLegacy(variant, found, error, legacyFound, legacyError,
+                            3 * e);
+      }
+   }
+}
+
+BOOST_FIXTURE_TEST_CASE(circle_benchmark, SceneFixture)
+{
+   const unsigned int k = 100;
+   const float radius = 60;
+   const float radius_e = radius / 4;
+   const float e = 3;
+   const unsigned int n = 20;
+
+   std::vector<std::vector<Point> > scenes(BENCHMARK_SCENES);
+   std::vector<PointF> truths(BENCHMARK_SCENES);
+   for (int s = 0; s < BENCHMARK_SCENES; ++ s) {
+      circleScene(scenes[s], truths[s], radius, 60, 20);
+   }
+
+   RANSAC::Options adaptive;
+   adaptive.confidence = 0.99f;
+   adaptive.localOptimisation = true;
+   RANSAC::Options preemptive;
+   preemptive.preemptive = 1;
+
+   int legacyFound = 0;
+   float legacyError = 0;
+   const char *names[] = {"legacy", "fixed k", "adaptive LO", "T(1,1)"};
+   for (int variant = 0; variant < 4; ++ variant) {
+      std::vector<bool> cons_buf[2];
+      std::vector<bool> *cons;
+      float error = 0;
+      int found = 0;
+      Timer timer;
+      for (int s = 0; s < BENCHMARK_SCENES; ++ s) {
+         unsigned int seed = s;
+         RANSACCircle circle;
+         cons_buf[0].assign(scenes[s].size(), false);
+         cons_buf[1].assign(scenes[s].size(), false);
+         bool ok;
+         if (variant == 0) {
+            ok = legacyFindCircleOfRadius3P(scenes[s], radius, radius_e,
+                  &cons, circle, k, e, n, cons_buf, &seed);
+         } else {
+            ok = RANSAC::findCircleOfRadius3P(scenes[s], radius, radius_e,
+                  &cons, circle, k, e, n, cons_buf, &seed, variant == 1
+                  ? RANSAC::Options() : variant == 2 ? adaptive : preemptive);
+         }
+         if (ok) {
+            ++ found;
+            error += (circle.centre - truths[s]).norm();
+         }
+      }
+      uint32_t time = timer.elapsed_us();
+      error /= std::max(found, 1);
+      BENCHMARK_MESSAGE("Circle 3P, " << names[variant] << ": "
+         << (float)time / BENCHMARK_SCENES << "us per search, found "
+         << found << "/" << BENCHMARK_SCENES << ", mean centre error "
+         << error << "px");
+
+      if (variant == 0) {
+         legacyFound = found;
+         legacyError = error;
+      } else {
+         checkAgainstLegacy(variant, found, error, legacyFound, legacyError,
+                            e);
+      }
+   }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,109 @@
+#define BOOST_TEST_DYN_LINK
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "utils/SummedAreaTable.hpp"
+
+#define TEST_WIDTH 37
+#define TEST_HEIGHT 23
+#define TEST_CLASSES 5
+#define TEST_RECTS 500
+
+/* A random image of grey values like the fovea's, and one of classes */
+struct ImageFixture {
+   ImageFixture() : grey(TEST_WIDTH * TEST_HEIGHT),
+                    classes(TEST_WIDTH * TEST_HEIGHT) {
+      srand(42);
+      for (int i = 0; i < TEST_WIDTH * TEST_HEIGHT; ++i) {
+         grey[i] = rand() % (16 * 255 + 1);
+         classes[i] = rand() % TEST_CLASSES;
+      }
+   }
+
+   /* Picks a random rectangle, possibly empty */
+   void randomRect(int *x0, int *y0, int *x1, int *y1) {
+      *x0 = rand() % (TEST_WIDTH + 1);
+      *x1 = *x0 + rand() % (TEST_WIDTH + 1 - *x0);
+      *y0 = rand() % (TEST_HEIGHT + 1);
+      *y1 = *y0 + rand() % (TEST_HEIGHT + 1 - *y0);
+   }
+
+   std::vector<int16_t> grey;
+   std::vector<uint8_t> classes;
+};
+
+static const int entries = (TEST_WIDTH + 1) * (TEST_HEIGHT + 1);
+
+BOOST_FIXTURE_TEST_SUITE(summed_area_table, ImageFixture)
+
+BOOST_AUTO_TEST_CASE(sums_match_every_pixel)
+{
+   std::vector<uint32_t> sums(entries);
+   std::vector<uint64_t> squares(entries);
+   buildSummedArea(&grey[0], TEST_WIDTH, TEST_HEIGHT, &sums[0]);
+   buildSummedSquares(&grey[0], TEST_WIDTH, TEST_HEIGHT, &squares[0]);
+
+   for (int r = 0; r < TEST_RECTS; ++r) {
+      int x0, y0, x1, y1;
+      randomRect(&x0, &y0, &x1, &y1);
+      uint32_t sum = 0;
+      uint64_t square = 0;
+      for (int y = y0; y < y1; ++y) {
+         for (int x = x0; x < x1; ++x) {
+            int pixel = grey[x + y * TEST_WIDTH];
+            sum += pixel;
+            square += pixel * pixel;
+         }
+      }
+      BOOST_CHECK_EQUAL(sumRect(&sums[0], TEST_WIDTH, x0, y0, x1, y1), sum);
+      BOOST_CHECK_EQUAL(sumRect(&squares[0], TEST_WIDTH, x0, y0, x1, y1),
+                        square);
+   }
+}
+
+BOOST_AUTO_TEST_CASE(counts_match_every_pixel)
+{
+   std::vector<uint32_t> counts(entries * TEST_CLASSES);
+   buildClassCounts(&classes[0], TEST_WIDTH, TEST_HEIGHT, TEST_CLASSES,
+                    &counts[0]);
+
+   for (int r = 0; r < TEST_RECTS; ++r) {
+      int x0, y0, x1, y1;
+      randomRect(&x0, &y0, &x1, &y1);
+      uint32_t count[TEST_CLASSES] = {0};
+      for (int y = y0; y < y1; ++y) {
+         for (int x = x0; x < x1; ++x) {
+            ++count[classes[x + y * TEST_WIDTH]];
+         }
+      }
+      for (int c = 0; c < TEST_CLASSES; ++c) {
+         BOOST_CHECK_EQUAL(sumRect(&counts[0], TEST_WIDTH, x0, y0, x1, y1,
+                                   TEST_CLASSES, c), count[c]);
+      }
+   }
+}
+
+BOOST_AUTO_TEST_CASE(small_sums_survive_wrapping)
+{
+   // the whole image's sum overflows 16 bits, but a 3x3 window's doesn't
+   std::vector<uint16_t> sums(entries);
+   buildSummedArea(&grey[0], TEST_WIDTH, TEST_HEIGHT, &sums[0]);
+   for (int y = 0; y + 3 <= TEST_HEIGHT; ++y) {
+      for (int x = 0; x + 3 <= TEST_WIDTH; ++x) {
+         uint16_t sum = 0;
+         for (int j = y; j < y + 3; ++j) {
+            for (int i = x; i < x + 3; ++i) {
+               sum += grey[i + j * TEST_WIDTH];
+            }
+         }
+         BOOST_CHECK_EQUAL((uint16_t)sumRect(&sums[0], TEST_WIDTH, x, y,
+                                             x + 3, y + 3), sum);
+      }
+   }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
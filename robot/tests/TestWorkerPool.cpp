@@ -0,0 +1,142 @@
+#define BOOST_TEST_DYN_LINK
+#include <unistd.h>
+
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "utils/Logger.hpp"
+#include "utils/WorkerPool.hpp"
+
+#define TEST_NUM_WORKERS 4
+#define TEST_NUM_TASKS 100
+
+/* Records which worker ran each task, and how many times it ran */
+struct TaskLog {
+   TaskLog() : runs(TEST_NUM_TASKS, 0), workers(TEST_NUM_TASKS, 0) {}
+
+   void run(unsigned int task, unsigned int worker) {
+      __sync_fetch_and_add(&runs[task], 1);
+      workers[task] = worker;
+   }
+
+   std::vector<int> runs;
+   std::vector<unsigned int> workers;
+};
+
+/* The first task is slow, so whoever it was dealt to falls behind */
+static void slowFirstTask(TaskLog *log, unsigned int task,
+                          unsigned int worker) {
+   if (task == 0) {
+      usleep(50000);
+   }
+   log->run(task, worker);
+}
+
+/* Logs which worker ran each task, the caller slowly, so the pool's threads
+ * run most of them */
+static void logTask(unsigned int task, unsigned int worker) {
+   if (worker == 0) {
+      usleep(1000);
+   }
+   llog(ERROR) << "task " << task << " worker " << worker << std::endl;
+}
+
+static void throwOnTask(unsigned int failing, unsigned int task,
+                        unsigned int worker) {
+   if (task == failing) {
+      throw std::runtime_error("task failed");
+   }
+}
+
+BOOST_AUTO_TEST_SUITE(worker_pool)
+
+BOOST_AUTO_TEST_CASE(runs_every_task_once)
+{
+   WorkerPool pool(TEST_NUM_WORKERS);
+   BOOST_CHECK_EQUAL(pool.size(), (unsigned int)TEST_NUM_WORKERS);
+
+   // again, to check the threads pick up each batch
+   for (int batch = 0; batch < 3; ++batch) {
+      TaskLog log;
+      pool.run(TEST_NUM_TASKS, boost::bind(&TaskLog::run, &log, _1, _2));
+      for (int i = 0; i < TEST_NUM_TASKS; ++i) {
+         BOOST_CHECK_EQUAL(log.runs[i], 1);
+         BOOST_CHECK(log.workers[i] < (unsigned int)TEST_NUM_WORKERS);
+      }
+   }
+}
+
+BOOST_AUTO_TEST_CASE(idle_workers_steal)
+{
+   WorkerPool pool(TEST_NUM_WORKERS);
+   TaskLog log;
+   pool.run(TEST_NUM_TASKS, boost::bind(slowFirstTask, &log, _1, _2));
+
+   // task 0 was dealt to the caller along with every fourth task, but
+   // the others took those while it was busy
+   int stolen = 0;
+   for (int i = TEST_NUM_WORKERS; i < TEST_NUM_TASKS; i += TEST_NUM_WORKERS) {
+      BOOST_CHECK_EQUAL(log.runs[i], 1);
+      stolen += log.workers[i] != 0;
+   }
+   BOOST_CHECK(stolen > 0);
+}
+
+BOOST_AUTO_TEST_CASE(single_worker_runs_in_order)
+{
+   WorkerPool pool(1);
+   TaskLog log;
+   pool.run(TEST_NUM_TASKS, boost::bind(&TaskLog::run, &log, _1, _2));
+   for (int i = 0; i < TEST_NUM_TASKS; ++i) {
+      BOOST_CHECK_EQUAL(log.runs[i], 1);
+      BOOST_CHECK_EQUAL(log.workers[i], 0u);
+   }
+}
+
+BOOST_AUTO_TEST_CASE(task_errors_reach_the_caller)
+{
+   WorkerPool pool(TEST_NUM_WORKERS);
+   // one on the caller's share and one on another worker's
+   BOOST_CHECK_THROW(pool.run(TEST_NUM_TASKS,
+                              boost::bind(throwOnTask, 0u, _1, _2)),
+                     std::runtime_error);
+   BOOST_CHECK_THROW(pool.run(TEST_NUM_TASKS,
+                              boost::bind(throwOnTask, 1u, _1, _2)),
+                     std::runtime_error);
+
+   // and the pool still works afterwards
+   TaskLog log;
+   pool.run(TEST_NUM_TASKS, boost::bind(&TaskLog::run, &log, _1, _2));
+   BOOST_CHECK_EQUAL(log.runs[TEST_NUM_TASKS - 1], 1);
+}
+
+BOOST_AUTO_TEST_CASE(pool_threads_log_to_the_caller)
+{
+   std::ostringstream out;
+   Logger::logTo(&out);
+   WorkerPool pool(TEST_NUM_WORKERS);
+   pool.run(TEST_NUM_TASKS, boost::bind(logTask, _1, _2));
+   Logger::logTo(&std::cerr);
+
+   std::vector<int> logged(TEST_NUM_TASKS, 0);
+   int fromPool = 0;
+   std::istringstream lines(out.str());
+   std::string word;
+   unsigned int task, worker;
+   while (lines >> word >> task >> word >> worker) {
+      BOOST_REQUIRE(task < (unsigned int)TEST_NUM_TASKS);
+      ++logged[task];
+      fromPool += worker != 0;
+   }
+   for (int i = 0; i < TEST_NUM_TASKS; ++i) {
+      BOOST_CHECK_EQUAL(logged[i], 1);
+   }
+   BOOST_CHECK(fromPool > 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,170 @@
+#define BOOST_TEST_DYN_LINK
+#include <math.h>
+#define __STDC_LIMIT_MACROS
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "perception/localisation/ICP.hpp"
+#include "utils/Logger.hpp"
+#include "utils/SPLDefs.hpp"
+#include "utils/Timer.hpp"
+#include "tests/TestData.hpp"
+
+#define TEST_FRAMES 500
+#define BENCHMARK_REPEATS 10
+
+/* What a robot sees in a frame: pieces of the field lines near it, in its
+ * own coordinates, and the pose it thought it was at */
+struct ICPFrame {
+   AbsCoord start;
+   std::vector<FieldFeatureInfo> features;
+};
+
+/* A field point as the robot at pose sees it */
+static Point toRobot(const Point &p, const AbsCoord &pose)
+{
+   const float dx = p.x() - pose.x();
+   const float dy = p.y() - pose.y();
+   const float c = cosf(pose.theta());
+   const float s = sinf(pose.theta());
+   return Point(c * dx + s * dy, -s * dx + c * dy);
+}
+
+/* Frames of one to three pieces of field lines seen from random poses on
+ * the field, starting from a pose up to 300mm and 0.2 radians out */
+static void makeFrames(std::vector<ICPFrame> &frames)
+{
+   const std::vector<LineInfo> &lines = ICPSolver::getAllFieldLines();
+   srand(42);
+   frames.resize(TEST_FRAMES);
+   for (unsigned int i = 0; i < frames.size(); ++i) {
+      AbsCoord pose(rand() % FIELD_LENGTH - FIELD_LENGTH / 2,
+                    rand() % FIELD_WIDTH - FIELD_WIDTH / 2,
+                    (rand() % 628) / 100.0f - M_PI);
+      frames[i].start = AbsCoord(pose.x() + rand() % 601 - 300,
+                                 pose.y() + rand() % 601 - 300,
+                                 pose.theta() + (rand() % 41 - 20) / 100.0f);
+      int seen = 1 + rand() % 3;
+      for (int l = 0; l < seen; ++l) {
+         const LineInfo &line = lines[rand() % lines.size()];
+         float a = (rand() % 50) / 100.0f;
+         float b = a + 0.2f + (rand() % 30) / 100.0f;
+         Point p1 = line.p1 + ((line.p2 - line.p1).cast<float>() * a).cast<int>();
+         Point p2 = line.p1 + ((line.p2 - line.p1).cast<float>() * b).cast<int>();
+         LineInfo seenLine(toRobot(p1, pose), toRobot(p2, pose));
+         frames[i].features.push_back(FieldFeatureInfo(RRCoord(0, 0), seenLine));
+      }
+   }
+}
+
+struct ICPFixture {
+   ICPFixture() {
+      // ICP logs through llog, which needs the logging framework up
+      if (!Logger::initialised) {
+         Logger::init("/tmp", "SILENT", false);
+      }
+      makeFrames(frames);
+   }
+
+   std::vector<ICPFrame> frames;
+   std::vector<PostInfo> posts;
+   std::vector<FieldBoundaryInfo> boundaries;
+};
+
+BOOST_FIXTURE_TEST_SUITE(icp, ICPFixture)
+
+BOOST_AUTO_TEST_CASE(batch_matches_localise)
+{
+   // Each frame from its own starting pose, one further out, and the
+   // other end of the field, sharing one solver across the batches
+   ICPSolver batchSolver;
+   ICPSolver solver;
+   std::vector<int> results;
+   std::vector<AbsCoord> combinedObs;
+   int localised = 0;
+   for (unsigned int i = 0; i < frames.size(); ++i) {
+      const AbsCoord &start = frames[i].start;
+      std::vector<AbsCoord> poses;
+      poses.push_back(start);
+      poses.push_back(AbsCoord(start.x() + 200, start.y() - 200,
+                               start.theta() + 0.1f));
+      poses.push_back(AbsCoord(-start.x(), -start.y(),
+                               normaliseTheta(start.theta() + M_PI)));
+      batchSolver.localiseBatch(poses, frames[i].features, posts, 0.5f, 0,
+            boundaries, AbsCoord(), false, results, combinedObs);
+      BOOST_REQUIRE_EQUAL(results.size(), poses.size());
+      BOOST_REQUIRE_EQUAL(combinedObs.size(), poses.size());
+
+      for (unsigned int p = 0; p < poses.size(); ++p) {
+         const int expected = solver.localise(poses[p], frames[i].features,
+               posts, 0.5f, 0, boundaries, AbsCoord(), false);
+         BOOST_REQUIRE_EQUAL(results[p], expected);
+         const AbsCoord a = solver.getCombinedObs();
+         BOOST_REQUIRE_EQUAL(combinedObs[p].x(), a.x());
+         BOOST_REQUIRE_EQUAL(combinedObs[p].y(), a.y());
+         BOOST_REQUIRE_EQUAL(combinedObs[p].theta(), a.theta());
+         BOOST_REQUIRE(combinedObs[p].var == a.var);
+         localised += expected > 0;
+      }
+   }
+   BOOST_CHECK_GT(localised, 0);
+}
+
+BOOST_AUTO_TEST_CASE(localises_field_lines)
+{
+   ICPSolver solver;
+   int localised = 0;
+   for (unsigned int i = 0; i < frames.size(); ++i) {
+      const int result = solver.localise(frames[i].start, frames[i].features,
+            posts, 0.5f, 0, boundaries, AbsCoord(), false);
+      if (result > 0) {
+         const AbsCoord obs = solver.getCombinedObs();
+         BOOST_CHECK(!isnan(obs.x()) && !isnan(obs.y()) && !isnan(obs.theta()));
+         ++localised;
+      }
+   }
+   BOOST_TEST_MESSAGE("ICP: localised " << localised << "/" << frames.size()
+      << " frames of field lines");
+   BOOST_CHECK_GT(localised, (int)frames.size() / 2);
+}
+
+BOOST_AUTO_TEST_CASE(icp_benchmark)
+{
+   const int repeats = benchmarkRepeats(BENCHMARK_REPEATS);
+   // Takes the fastest pass over the frames, first associating the
+   // features from the starting pose alone and then solving
+   ICPSolver solver;
+   uint32_t associate = UINT32_MAX;
+   uint32_t solve = UINT32_MAX;
+   int iterations = 0;
+   for (int repeat = 0; repeat < repeats; ++repeat) {
+      Timer timer;
+      for (unsigned int i = 0; i < frames.size(); ++i) {
+         solver.preprocessFeatures(frames[i].features, posts, boundaries);
+         solver.combinedObs = frames[i].start;
+         solver.associateFeatures(1);
+      }
+      associate = std::min(associate, timer.elapsed_us());
+
+      iterations = 0;
+      timer.restart();
+      for (unsigned int i = 0; i < frames.size(); ++i) {
+         solver.localise(frames[i].start, frames[i].features, posts, 0.5f, 0,
+               boundaries, AbsCoord(), false);
+         iterations += solver.iteration;
+      }
+      solve = std::min(solve, timer.elapsed_us());
+   }
+   BENCHMARK_MESSAGE("ICP: "
+      << (float)associate / frames.size() << "us per association, "
+      << (float)solve / frames.size() << "us per solve, "
+      << iterations * 1e6f / solve << " iterations per second");
+   BOOST_CHECK_GT(iterations, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,396 @@
+#define BOOST_TEST_DYN_LINK
+#include <math.h>
+#define __STDC_LIMIT_MACROS
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "Eigen/LU"
+#include "perception/localisation/KalmanUpdate.hpp"
+#include "perception/localisation/SimpleGaussian.hpp"
+#include "utils/SPLDefs.hpp"
+#include "utils/Timer.hpp"
+#include "tests/TestData.hpp"
+
+#define BENCHMARK_UPDATES 2000
+#define BENCHMARK_FRAMES 200
+#define BENCHMARK_MODES 4
+
+/* A Kalman update as SimpleGaussian::performTrimmedKalmanUpdate did it on
+ * dynamically sized matrices, with sparseMultiplication's loops, an inverted
+ * innovation covariance and the (I - KH) P covariance update, to check
+ * kalmanUpdate against */
+static double legacyKalmanUpdate(Eigen::MatrixXd &mean,
+                                 Eigen::MatrixXd &covariance,
+                                 int observationDim,
+                                 const Eigen::MatrixXd &innovationIn,
+                                 const Eigen::MatrixXd &jacobianIn,
+                                 const Eigen::MatrixXd &observationVarianceIn,
+                                 bool sparse)
+{
+   const int dim = mean.rows();
+   const Eigen::MatrixXd innovation =
+      innovationIn.block(0, 0, observationDim, 1);
+   const Eigen::MatrixXd jacobian =
+      jacobianIn.block(0, 0, observationDim, dim);
+   const Eigen::MatrixXd observationVariance =
+      observationVarianceIn.block(0, 0, observationDim, observationDim);
+   const Eigen::MatrixXd identity = Eigen::MatrixXd::Identity(dim, dim);
+   const Eigen::MatrixXd jacobianT = jacobian.transpose();
+
+   Eigen::MatrixXd cjt;
+   Eigen::MatrixXd combinedCovariance;
+   if (sparse) {
+      cjt.setZero(dim, jacobianT.cols());
+      for (int i = 0; i < dim; i++) {
+         for (int j = 0; j < 5; j++) {
+            for (int k = 0; k < jacobianT.cols(); k++) {
+               cjt(i, k) += covariance(i, j) * jacobianT(j, k);
+            }
+         }
+      }
+      Eigen::MatrixXd jcjt;
+      jcjt.setZero(jacobian.rows(), cjt.cols());
+      for (int i = 0; i < jacobian.rows(); i++) {
+         for (int j = 0; j < 5; j++) {
+            for (int k = 0; k < cjt.cols(); k++) {
+               jcjt(i, k) += jacobian(i, j) * cjt(j, k);
+            }
+         }
+      }
+      combinedCovariance = jcjt + observationVariance;
+   } else {
+      cjt = covariance * jacobianT;
+      combinedCovariance = ((jacobian * cjt) + observationVariance);
+   }
+
+   const Eigen::MatrixXd combinedCovarianceInv = combinedCovariance.inverse();
+   const Eigen::MatrixXd kalman = cjt * combinedCovarianceInv;
+   mean = mean + kalman * innovation;
+
+   Eigen::MatrixXd kj;
+   if (sparse) {
+      kj.setZero(kalman.rows(), jacobian.cols());
+      for (int i = 0; i < kalman.rows(); i++) {
+         for (int j = 0; j < jacobian.rows(); j++) {
+            for (int k = 0; k < 5; k++) {
+               kj(i, k) += kalman(i, j) * jacobian(j, k);
+            }
+         }
+      }
+   } else {
+      kj = kalman * jacobian;
+   }
+   covariance = (identity - kj) * covariance;
+
+   const Eigen::MatrixXd weightUpdateMatrix =
+      innovation.transpose() * combinedCovarianceInv * innovation;
+   return weightUpdateMatrix(0, 0);
+}
+
+static double uniform(double range)
+{
+   return range * (2.0 * rand() / RAND_MAX - 1.0);
+}
+
+/* A state of positions in mm and headings in radians, its covariance a
+ * random positive definite one, and a measurement of observationDim rows
+ * observing only the robot pose and ball position if sparse */
+struct KalmanCase {
+   KalmanCase(int dim, int observationDim, bool sparse) :
+         observationDim(observationDim), sparse(sparse),
+         mean(dim, 1), covariance(dim, dim),
+         innovation(MAX_MEASUREMENT_DIM, 1),
+         jacobian(MAX_MEASUREMENT_DIM, dim),
+         observationVariance(MAX_MEASUREMENT_DIM, MAX_MEASUREMENT_DIM) {
+      Eigen::MatrixXd root(dim, dim);
+      for (int i = 0; i < dim; i++) {
+         mean(i, 0) = uniform(3000.0);
+         for (int j = 0; j < dim; j++) {
+            root(i, j) = uniform(100.0);
+         }
+      }
+      covariance = root * root.transpose();
+      for (int i = 0; i < dim; i++) {
+         covariance(i, i) += 1000.0;
+      }
+
+      innovation.setZero();
+      jacobian.setZero();
+      observationVariance.setZero();
+      const int observed = sparse ? KALMAN_SPARSE_DIM : dim;
+      for (int i = 0; i < observationDim; i++) {
+         innovation(i, 0) = uniform(200.0);
+         for (int j = 0; j < observed; j++) {
+            jacobian(i, j) = uniform(1.0);
+         }
+         observationVariance(i, i) = 100.0 + fabs(uniform(10000.0));
+      }
+   }
+
+   int observationDim;
+   bool sparse;
+   Eigen::MatrixXd mean;
+   Eigen::MatrixXd covariance;
+   Eigen::MatrixXd innovation;
+   Eigen::MatrixXd jacobian;
+   Eigen::MatrixXd observationVariance;
+};
+
+/* The largest difference between two matrices relative to the largest
+ * magnitude in the first */
+static double relativeError(const Eigen::MatrixXd &expected,
+                            const Eigen::MatrixXd &actual)
+{
+   double scale = 0;
+   double error = 0;
+   for (int i = 0; i < expected.rows(); i++) {
+      for (int j = 0; j < expected.cols(); j++) {
+         scale = std::max(scale, fabs(expected(i, j)));
+         error = std::max(error, fabs(expected(i, j) - actual(i, j)));
+      }
+   }
+   return scale > 0 ? error / scale : error;
+}
+
+template <int DIM>
+static void checkMatchesLegacy(bool sparse)
+{
+   double worst = 0;
+   for (int observationDim = 1; observationDim <= MAX_MEASUREMENT_DIM;
+        observationDim++) {
+      for (int trial = 0; trial < 4; trial++) {
+         KalmanCase c(DIM, observationDim, sparse);
+         Eigen::MatrixXd expectedMean = c.mean;
+         Eigen::MatrixXd expectedCovariance = c.covariance;
+         const double expected = legacyKalmanUpdate(expectedMean,
+            expectedCovariance, observationDim, c.innovation, c.jacobian,
+            c.observationVariance, sparse);
+         const double actual = kalmanUpdate<DIM>(c.mean, c.covariance,
+            observationDim, c.innovation, c.jacobian, c.observationVariance,
+            sparse);
+
+         worst = std::max(worst, relativeError(expectedMean, c.mean));
+         worst = std::max(worst,
+            relativeError(expectedCovariance, c.covariance));
+         BOOST_CHECK_CLOSE(expected, actual, 1e-6);
+      }
+   }
+   BOOST_TEST_MESSAGE("Kalman update, " << DIM << " dimensions, "
+      << (sparse ? "sparse" : "dense") << ": largest relative difference "
+      << worst);
+   BOOST_CHECK_LT(worst, 1e-9);
+}
+
+template <int DIM>
+static void benchmark(bool sparse, int observationDim)
+{
+   const int updates = benchmarkRepeats(BENCHMARK_UPDATES);
+   std::vector<KalmanCase> cases;
+   for (int i = 0; i < 16; i++) {
+      cases.push_back(KalmanCase(DIM, observationDim, sparse));
+   }
+
+   double total = 0;
+   Timer timer;
+   for (int i = 0; i < updates; i++) {
+      KalmanCase &c = cases[i % cases.size()];
+      Eigen::MatrixXd mean = c.mean;
+      Eigen::MatrixXd covariance = c.covariance;
+      total += legacyKalmanUpdate(mean, covariance, observationDim,
+         c.innovation, c.jacobian, c.observationVariance, sparse);
+   }
+   uint32_t legacyTime = timer.elapsed_us();
+
+   timer.restart();
+   for (int i = 0; i < updates; i++) {
+      KalmanCase &c = cases[i % cases.size()];
+      Eigen::MatrixXd mean = c.mean;
+      Eigen::MatrixXd covariance = c.covariance;
+      total -= kalmanUpdate<DIM>(mean, covariance, observationDim,
+         c.innovation, c.jacobian, c.observationVariance, sparse);
+   }
+   uint32_t fixedTime = timer.elapsed_us();
+
+   BENCHMARK_MESSAGE("Kalman update, " << DIM << " dimensions, "
+      << observationDim << " measurements, "
+      << (sparse ? "sparse" : "dense") << ": dynamic with inverse "
+      << (float)legacyTime / updates << "us, fixed size with LDLT "
+      << (float)fixedTime / updates << "us");
+   BOOST_CHECK_SMALL(total, 1e-3);
+}
+
+/* The field point p as the robot at pose sees it */
+static RRCoord toRobot(const AbsCoord &p, const AbsCoord &pose)
+{
+   const float dx = p.x() - pose.x();
+   const float dy = p.y() - pose.y();
+   return RRCoord(sqrtf(dx * dx + dy * dy),
+                  normaliseTheta(atan2f(dy, dx) - pose.theta()));
+}
+
+/* What a robot in the attacking half facing the away goal sees in a frame:
+ * the ball and, if seeAll, both away goal posts and the penalty spot.
+ * Field lines alone don't move the modes, as visionUpdate doesn't run ICP */
+static VisionUpdateBundle visionFrame(const AbsCoord &pose, bool seeAll)
+{
+   VisionUpdateBundle bundle;
+   bundle.isHeadingReliable = true;
+   bundle.isDistanceReliable = true;
+   bundle.awayGoalProb = 0.5f;
+
+   BallInfo ball;
+   ball.rr = toRobot(AbsCoord(pose.x() + 300 + rand() % 1000,
+                              pose.y() + rand() % 1000 - 500, 0), pose);
+   bundle.visibleBalls.push_back(ball);
+
+   if (seeAll) {
+      bundle.posts.push_back(PostInfo(
+         toRobot(AbsCoord(FIELD_LENGTH / 2, GOAL_WIDTH / 2, 0), pose),
+         PostInfo::pLeft, BBox(), 0, 0, true, PostInfo::pUnknown));
+      bundle.posts.push_back(PostInfo(
+         toRobot(AbsCoord(FIELD_LENGTH / 2, -GOAL_WIDTH / 2, 0), pose),
+         PostInfo::pRight, BBox(), 0, 0, true, PostInfo::pUnknown));
+
+      bundle.fieldFeatures.push_back(FieldFeatureInfo(
+         toRobot(AbsCoord(MARKER_CENTER_X, 0, 0), pose), PenaltySpotInfo()));
+   }
+   return bundle;
+}
+
+/* Times SimpleGaussian::visionUpdate on BENCHMARK_MODES modes a frame, each
+ * up to 300mm and 0.2 radians from where the robot is, and checks every mode
+ * it leaves is valid */
+static void visionUpdateBenchmark(bool seeAll)
+{
+   const int repeats = benchmarkRepeats(20);
+   // The mean is the robot's pose, the ball's position and velocity, then
+   // the teammates' poses
+   Eigen::MatrixXd diagonalVariance(MAIN_DIM, 1);
+   diagonalVariance.setConstant(1e6);
+   diagonalVariance(2, 0) = 0.1;
+
+   uint32_t best = UINT32_MAX;
+   unsigned int moved = 0;
+   for (int repeat = 0; repeat < repeats; repeat++) {
+      srand(42);
+      std::vector<VisionUpdateBundle> frames;
+      std::vector<SimpleGaussian *> modes;
+      std::vector<AbsCoord> starts;
+      std::vector<AbsCoord> balls;
+      for (int f = 0; f < BENCHMARK_FRAMES; f++) {
+         const AbsCoord pose(FIELD_LENGTH / 5 + 300 + rand() % 1500,
+                             rand() % 3000 - 1500,
+                             (rand() % 100) / 100.0f - 0.5f);
+         frames.push_back(visionFrame(pose, seeAll));
+         for (int m = 0; m < BENCHMARK_MODES; m++) {
+            Eigen::MatrixXd mean(MAIN_DIM, 1);
+            mean.setZero();
+            mean(0, 0) = pose.x() + rand() % 601 - 300;
+            mean(1, 0) = pose.y() + rand() % 601 - 300;
+            mean(2, 0) = pose.theta() + (rand() % 41 - 20) / 100.0;
+            mean(3, 0) = pose.x() + 1000;
+            mean(4, 0) = pose.y();
+            modes.push_back(new SimpleGaussian(MAIN_DIM, 1.0 / BENCHMARK_MODES,
+                                               mean, diagonalVariance));
+            starts.push_back(modes.back()->getRobotPose());
+            balls.push_back(modes.back()->getBallPosition());
+         }
+      }
+
+      std::vector<SimpleGaussian *> newModes;
+      Timer timer;
+      for (unsigned int i = 0; i < modes.size(); i++) {
+         std::vector<SimpleGaussian *> split =
+            modes[i]->visionUpdate(frames[i / BENCHMARK_MODES]);
+         newModes.insert(newModes.end(), split.begin(), split.end());
+      }
+      best = std::min(best, timer.elapsed_us());
+
+      // The ball updates each mode in place, and the rest of the frame the
+      // one mode each splits into
+      BOOST_REQUIRE_EQUAL(newModes.size(), modes.size());
+      moved = 0;
+      for (unsigned int i = 0; i < newModes.size(); i++) {
+         const AbsCoord ball = modes[i]->getBallPosition();
+         const AbsCoord pose = newModes[i]->getRobotPose();
+         moved += ball.x() != balls[i].x() &&
+            (!seeAll || pose.x() != starts[i].x() || pose.y() != starts[i].y());
+      }
+      modes.insert(modes.end(), newModes.begin(), newModes.end());
+      for (unsigned int i = 0; i < modes.size(); i++) {
+         const Eigen::MatrixXd covariance = modes[i]->getCovariance();
+         BOOST_CHECK(modes[i]->isStateValid());
+         BOOST_CHECK(covariance.isApprox(covariance.transpose()));
+         delete modes[i];
+      }
+   }
+
+   BENCHMARK_MESSAGE("Vision update, " << (seeAll
+      ? "ball, posts and penalty spot" : "ball") << ": "
+      << (float)best / (BENCHMARK_FRAMES * BENCHMARK_MODES)
+      << "us per mode, " << moved << "/"
+      << BENCHMARK_FRAMES * BENCHMARK_MODES << " modes moved");
+   BOOST_CHECK_GT(moved, BENCHMARK_FRAMES * BENCHMARK_MODES / 2u);
+}
+
+BOOST_AUTO_TEST_SUITE(kalman_update)
+
+BOOST_AUTO_TEST_CASE(matches_dynamic_update)
+{
+   srand(42);
+   checkMatchesLegacy<MAIN_DIM>(true);
+   checkMatchesLegacy<MAIN_DIM>(false);
+   checkMatchesLegacy<SHARED_DIM>(true);
+   checkMatchesLegacy<SHARED_DIM>(false);
+}
+
+BOOST_AUTO_TEST_CASE(keeps_covariance_positive_definite)
+{
+   // Many near exact observations of the robot pose shrink its variance to
+   // little more than rounding, where (I - KH) P drifts from symmetric
+   srand(7);
+   KalmanCase c(MAIN_DIM, 3, true);
+   for (int i = 0; i < 3; i++) {
+      c.observationVariance(i, i) = 1e-6;
+   }
+   for (int update = 0; update < 200; update++) {
+      for (int i = 0; i < 3; i++) {
+         c.innovation(i, 0) = uniform(1e-3);
+      }
+      kalmanUpdate<MAIN_DIM>(c.mean, c.covariance, 3, c.innovation,
+         c.jacobian, c.observationVariance, true);
+   }
+
+   MeasurementCovariance ld = c.covariance;
+   BOOST_CHECK(ldltFactorise(ld));
+   for (int i = 0; i < MAIN_DIM; i++) {
+      BOOST_CHECK_GT(c.covariance(i, i), 0);
+      for (int j = 0; j < i; j++) {
+         BOOST_REQUIRE_EQUAL(c.covariance(i, j), c.covariance(j, i));
+      }
+   }
+}
+
+BOOST_AUTO_TEST_CASE(kalman_update_benchmark)
+{
+   srand(42);
+   // A vision update of a few features, one of many, and a team mate's
+   // shared update
+   benchmark<MAIN_DIM>(true, 6);
+   benchmark<MAIN_DIM>(true, MAX_MEASUREMENT_DIM);
+   benchmark<MAIN_DIM>(false, SHARED_DIM);
+   benchmark<SHARED_DIM>(true, 6);
+}
+
+BOOST_AUTO_TEST_CASE(vision_update_benchmark)
+{
+   visionUpdateBenchmark(false);
+   visionUpdateBenchmark(true);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -9,6 +9,7 @@
 #include <utils/speech.hpp>
 #include <utils/ConcurrentMap.hpp>
 #include <utils/Timer.hpp>
+#include <utils/Profiler.hpp>
 #include <blackboard/Blackboard.hpp>
 
 #define ALL_SIGNALS -1  // for indicating that we should register
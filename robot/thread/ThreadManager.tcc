@@ -56,12 +56,12 @@ void ThreadManager::safelyRun(Blackboard *bb) {
          // register jump point for where to resume if we crash
          if (!setjmp(*jumpPoints[threadID])) {
             T t(bb);
-            Timer timer;
+            const int tickZone = Profiler::zoneId(name + ".tick");
             int32_t elapsed = 0.0;
             while (!attemptingShutdown) {
-               timer.restart();
-
                if (cycleTime != -1) {
+                  ProfileZone zone(tickZone);
+
                   // set watchdog timer to alert us about stuck threads
                   if (name == "Perception") {
                      struct itimerval itval5;
@@ -85,9 +85,7 @@ void ThreadManager::safelyRun(Blackboard *bb) {
                      setitimer(ITIMER_REAL, &itval0, NULL);
                   }
 
-                  elapsed = timer.elapsed_us();
-                  llog(INFO) << "Thread '" << name << "' took "
-                             << elapsed << " us." << std::endl;
+                  elapsed = zone.stop();
                   if (elapsed < cycleTime) {
                      usleep(cycleTime - elapsed);
                   } else if (((name != "Motion") && (name != "Perception")) || ((name == "Perception") && (elapsed >= 50000))){
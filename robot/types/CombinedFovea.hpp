@@ -13,6 +13,10 @@ public:
         top_->generate(this_frame, colour_classifier_top);
         bot_->generate(this_frame, colour_classifier_bot);
     }
+    void releaseChildFovea() {
+        top_->releaseChildFovea();
+        bot_->releaseChildFovea();
+    }
     Fovea* top_;
     Fovea* bot_;
 };
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+#include <boost/serialization/string.hpp>
+
+/**
+ * How long one profiler zone took over the last profiling window, in
+ * microseconds. Percentiles are rounded up to the profiler's histogram
+ * bucket, so are at most 1/8 over; max is exact.
+ */
+struct ProfileZoneStats {
+   std::string name;
+   uint32_t count;
+   uint32_t p50;
+   uint32_t p95;
+   uint32_t p99;
+   uint32_t max;
+
+   ProfileZoneStats() : count(0), p50(0), p95(0), p99(0), max(0) {}
+
+   template<class Archive>
+   void serialize(Archive &ar, const unsigned int file_version) {
+      ar & name;
+      ar & count;
+      ar & p50;
+      ar & p95;
+      ar & p99;
+      ar & max;
+   }
+};
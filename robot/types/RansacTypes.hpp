@@ -1,6 +1,7 @@
 #pragma once
 
 #include <math.h>
+#include <algorithm>
 #include <boost/serialization/version.hpp>
 #include <limits>
 
@@ -202,11 +203,14 @@ struct RANSACCircle
         float centreEdge = sqrt(pow(p1.x()-p2.x(), 2) + pow(p1.y()-p2.y(), 2))
                                                                             / 2;
 
-        // The "height" of the triangle p1, p2, centre.
-        float height = sqrt(pow(centreEdge, 2) + pow(radius, 2));
+        // The "height" of the triangle p1, p2, centre, whose other edges are
+        // the radius. Points further apart than the diameter get the circle
+        // half way between them.
+        float height = sqrt(std::max(radius*radius - centreEdge*centreEdge,
+                                     0.0f));
 
         // The unit vector in the direction from p1 to p2.
-        PointF betweenVector = (p1-p2).cast<float>().normalized();
+        PointF betweenVector = (p2-p1).cast<float>().normalized();
 
         // The vector perpendicular to betweenPoints in the counterclockwise
         // direction, of the length required to reach centre from half way
@@ -222,7 +226,7 @@ struct RANSACCircle
 
         // Find the two potential circles.
         this->centre = betweenPoint + perpendicularVector;
-        this->secondaryCentre = betweenPoint + perpendicularVector;
+        this->secondaryCentre = betweenPoint - perpendicularVector;
     }
 
    RANSACCircle() {};
@@ -29,6 +29,9 @@ struct VisionInfoIn {
 
    // Store the latest action command for use in colour calibration
    ActionCommand::All active_action;
+
+   // The ball's velocity from localisation, robot relative cartesian (mm/s)
+   AbsCoord ball_vel_rrc;
 };
 
 #endif
@@ -5,8 +5,11 @@
 #include "perception/vision/Region.hpp"
 #include "perception/vision/colour/ColourClassifierInterface.hpp"
 #include "types/CombinedFrame.hpp"
+#include "utils/FrameArena.hpp"
 
 struct VisionInfoMiddle {
+    VisionInfoMiddle() : arena(NULL) {}
+
     std::vector<RegionI> full_regions;
     std::vector<RegionI> roi;
 
@@ -14,6 +17,10 @@ struct VisionInfoMiddle {
 	ColourClassifier* colour_classifier_bot_;
 
     const CombinedFrame* this_frame;
+
+    // Per frame scratch memory, reset at the start of each frame. May be NULL
+    // outside of Vision::processFrame (e.g. vatnao).
+    FrameArena* arena;
 };
 
 #endif
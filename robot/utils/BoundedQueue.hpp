@@ -0,0 +1,40 @@
+#pragma once
+
+#include <deque>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+/* A blocking, fixed capacity FIFO for handing work between threads
+ * Producers block while the queue is full and consumers block while it is
+ * empty, so a fast stage can never run more than capacity items ahead of a
+ * slow one. Closing the queue wakes everyone up so threads can shut down. */
+template <class T>
+class BoundedQueue {
+   public:
+      /* @param capacity the maximum number of items held at once */
+      explicit BoundedQueue(unsigned int capacity);
+
+      /* Add an item, waiting for space if the queue is full
+       * @return false if the queue was closed and the item was not added */
+      bool push(const T &item);
+
+      /* Remove the oldest item, waiting for one if the queue is empty
+       * @return false if the queue was closed and is empty */
+      bool pop(T &item);
+
+      /* Wake all waiting threads and refuse any further pushes */
+      void close();
+
+      /* @return the number of items currently queued */
+      unsigned int size() const;
+
+   private:
+      std::deque<T> items;
+      const unsigned int capacity;
+      bool closed;
+      mutable boost::mutex lock;
+      boost::condition_variable notEmpty;
+      boost::condition_variable notFull;
+};
+
+#include "utils/BoundedQueue.tcc"
@@ -0,0 +1,46 @@
+template <class T>
+BoundedQueue<T>::BoundedQueue(unsigned int capacity)
+   : capacity(capacity), closed(false) {}
+
+template <class T>
+bool BoundedQueue<T>::push(const T &item) {
+   boost::mutex::scoped_lock scopedLock(lock);
+   while (!closed && items.size() >= capacity) {
+      notFull.wait(scopedLock);
+   }
+   if (closed) {
+      return false;
+   }
+   items.push_back(item);
+   notEmpty.notify_one();
+   return true;
+}
+
+template <class T>
+bool BoundedQueue<T>::pop(T &item) {
+   boost::mutex::scoped_lock scopedLock(lock);
+   while (!closed && items.empty()) {
+      notEmpty.wait(scopedLock);
+   }
+   if (items.empty()) {
+      return false;
+   }
+   item = items.front();
+   items.pop_front();
+   notFull.notify_one();
+   return true;
+}
+
+template <class T>
+void BoundedQueue<T>::close() {
+   boost::mutex::scoped_lock scopedLock(lock);
+   closed = true;
+   notEmpty.notify_all();
+   notFull.notify_all();
+}
+
+template <class T>
+unsigned int BoundedQueue<T>::size() const {
+   boost::mutex::scoped_lock scopedLock(lock);
+   return items.size();
+}
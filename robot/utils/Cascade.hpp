@@ -0,0 +1,121 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <boost/function.hpp>
+
+// enough for any detector, and small enough to search every order
+#define CASCADE_MAX_STAGES 16
+
+// runs a stage needs before its measured cost and rejection rate replace
+// the declared ones when ordering
+#define CASCADE_MIN_SAMPLES 50
+
+/* How one cascade stage has done since its statistics were last reset */
+struct CascadeStageStats {
+   std::string name;
+   /* Candidates the stage ran on, and how many of those it rejected */
+   uint32_t runs;
+   uint32_t rejections;
+   /* Total time spent in the stage, in microseconds */
+   uint32_t us;
+   /* Cost (us) and rejection rate the stage is being ordered by */
+   float cost;
+   float rejection;
+};
+
+/**
+ * A chain of tests a candidate must all pass, run cheapest-rejection-first.
+ *
+ * Each stage declares a cost and the fraction of candidates it rejects, and
+ * which stages it needs the results of. order() picks the order that
+ * minimises the expected cost per candidate, treating rejections as
+ * independent, and run() stops at the first stage that rejects. Since a
+ * candidate is accepted only if every stage passes it, the order never
+ * changes which candidates are accepted.
+ *
+ * Stages are also timed into the profiler as "<name>.<stage>".
+ */
+template <class Candidate>
+class Cascade {
+   public:
+      /* A stage: computes its features and returns whether the candidate
+       * may still be accepted */
+      typedef boost::function<bool (Candidate &)> Test;
+
+      /* @param name prefix for the stages' profiler zones */
+      explicit Cascade(const std::string &name);
+
+      /**
+       * Adds a stage, to run after any stages it is made to depend on.
+       *
+       * @param cost the expected time the stage takes, in microseconds
+       * @param rejection the expected fraction of candidates it rejects
+       * @return the stage's id, for depend()
+       * @throw std::runtime_error if there are already CASCADE_MAX_STAGES
+       */
+      int addStage(const std::string &name, const Test &test, float cost,
+                   float rejection);
+
+      /* Makes stage run after first, which it uses the results of
+       * @throw std::runtime_error if stages now depend on each other */
+      void depend(int stage, int first);
+
+      /**
+       * Chooses the order to run stages in.
+       *
+       * @param measured whether to use the costs and rejection rates seen
+       * since the last reset, for stages that have run enough, instead of
+       * the declared ones. Stages that haven't keep the figures they were
+       * last ordered by, so a stage that rarely gets a candidate isn't put
+       * back where its declared figures would have it.
+       */
+      void order(bool measured);
+
+      /**
+       * Runs the stages in order until one rejects the candidate. Stages
+       * may run for different candidates on several threads at once, but
+       * not while the cascade is being changed or reordered.
+       *
+       * @return whether every stage passed the candidate
+       */
+      bool run(Candidate &candidate);
+
+      /* @return the stages' ids in the order they run */
+      const std::vector<int> &stageOrder() const;
+
+      /* @return how each stage has done, by id */
+      std::vector<CascadeStageStats> stats() const;
+
+      /* Clear what each stage has seen, starting a new window */
+      void resetStats();
+
+      /* @return the expected time per candidate, in microseconds, of the
+       * current order by the costs and rejection rates ordered by */
+      float expectedCost() const;
+
+   private:
+      struct Stage {
+         std::string name;
+         Test test;
+         int zone;
+         /* bitmask of stage ids that must run first */
+         uint32_t after;
+         float declaredCost;
+         float declaredRejection;
+         float cost;
+         float rejection;
+         volatile uint32_t runs;
+         volatile uint32_t rejections;
+         volatile uint32_t us;
+      };
+
+      std::string name;
+      std::vector<Stage> stages;
+      std::vector<int> runOrder;
+};
+
+#include "utils/Cascade.tcc"
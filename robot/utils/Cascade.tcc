@@ -0,0 +1,151 @@
+#include <limits>
+#include <stdexcept>
+
+#include "utils/Profiler.hpp"
+
+template <class Candidate>
+Cascade<Candidate>::Cascade(const std::string &name) : name(name) {}
+
+template <class Candidate>
+int Cascade<Candidate>::addStage(const std::string &stageName,
+                                 const Test &test, float cost,
+                                 float rejection) {
+   if (stages.size() == CASCADE_MAX_STAGES) {
+      throw std::runtime_error("Cascade " + name + " has too many stages");
+   }
+   Stage stage;
+   stage.name = stageName;
+   stage.test = test;
+   stage.zone = Profiler::zoneId(name + "." + stageName);
+   stage.after = 0;
+   stage.declaredCost = cost;
+   stage.declaredRejection = rejection;
+   stage.runs = 0;
+   stage.rejections = 0;
+   stage.us = 0;
+   stages.push_back(stage);
+   order(false);
+   return stages.size() - 1;
+}
+
+template <class Candidate>
+void Cascade<Candidate>::depend(int stage, int first) {
+   stages[stage].after |= 1u << first;
+   order(false);
+}
+
+template <class Candidate>
+void Cascade<Candidate>::order(bool measured) {
+   int n = stages.size();
+   for (int i = 0; i < n; ++i) {
+      Stage &stage = stages[i];
+      if (measured) {
+         if (stage.runs >= CASCADE_MIN_SAMPLES) {
+            stage.cost = (float)stage.us / stage.runs;
+            stage.rejection = (float)stage.rejections / stage.runs;
+         }
+      } else {
+         stage.cost = stage.declaredCost;
+         stage.rejection = stage.declaredRejection;
+      }
+   }
+
+   // Whichever stages have run so far, the chance a candidate got past all
+   // of them is the same, so the cheapest way to run a set of stages is the
+   // cheapest way to run all but one of them plus the cost of the last
+   // scaled by that chance. Build that up over every set of stages.
+   uint32_t sets = 1u << n;
+   std::vector<float> best(sets, std::numeric_limits<float>::infinity());
+   std::vector<float> passed(sets, 1.0f);
+   std::vector<int> last(sets, -1);
+   best[0] = 0;
+   for (uint32_t set = 1; set < sets; ++set) {
+      int lowest = __builtin_ctz(set);
+      passed[set] = passed[set & (set - 1)] *
+                    (1 - stages[lowest].rejection);
+   }
+   for (uint32_t set = 0; set < sets; ++set) {
+      if (best[set] == std::numeric_limits<float>::infinity()) {
+         continue;
+      }
+      for (int i = 0; i < n; ++i) {
+         uint32_t with = set | (1u << i);
+         if (with == set || (stages[i].after & ~set) != 0) {
+            continue;
+         }
+         float cost = best[set] + stages[i].cost * passed[set];
+         if (cost < best[with]) {
+            best[with] = cost;
+            last[with] = i;
+         }
+      }
+   }
+   if (best[sets - 1] == std::numeric_limits<float>::infinity()) {
+      throw std::runtime_error("Cascade " + name +
+                               " stages depend on each other");
+   }
+
+   runOrder.resize(n);
+   uint32_t set = sets - 1;
+   for (int k = n - 1; k >= 0; --k) {
+      runOrder[k] = last[set];
+      set &= ~(1u << last[set]);
+   }
+}
+
+template <class Candidate>
+bool Cascade<Candidate>::run(Candidate &candidate) {
+   for (unsigned int k = 0; k < runOrder.size(); ++k) {
+      Stage &stage = stages[runOrder[k]];
+      ProfileZone zone(stage.zone);
+      bool pass = stage.test(candidate);
+      uint32_t us = zone.stop();
+      __sync_fetch_and_add(&stage.runs, 1);
+      __sync_fetch_and_add(&stage.us, us);
+      if (!pass) {
+         __sync_fetch_and_add(&stage.rejections, 1);
+         return false;
+      }
+   }
+   return true;
+}
+
+template <class Candidate>
+const std::vector<int> &Cascade<Candidate>::stageOrder() const {
+   return runOrder;
+}
+
+template <class Candidate>
+std::vector<CascadeStageStats> Cascade<Candidate>::stats() const {
+   std::vector<CascadeStageStats> result(stages.size());
+   for (unsigned int i = 0; i < stages.size(); ++i) {
+      result[i].name = stages[i].name;
+      result[i].runs = stages[i].runs;
+      result[i].rejections = stages[i].rejections;
+      result[i].us = stages[i].us;
+      result[i].cost = stages[i].cost;
+      result[i].rejection = stages[i].rejection;
+   }
+   return result;
+}
+
+template <class Candidate>
+void Cascade<Candidate>::resetStats() {
+   for (unsigned int i = 0; i < stages.size(); ++i) {
+      stages[i].runs = 0;
+      stages[i].rejections = 0;
+      stages[i].us = 0;
+   }
+}
+
+template <class Candidate>
+float Cascade<Candidate>::expectedCost() const {
+   float cost = 0;
+   float passed = 1;
+   for (unsigned int k = 0; k < runOrder.size(); ++k) {
+      const Stage &stage = stages[runOrder[k]];
+      cost += stage.cost * passed;
+      passed *= 1 - stage.rejection;
+   }
+   return cost;
+}
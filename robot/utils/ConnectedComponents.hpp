@@ -0,0 +1,129 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+/* A horizontal run of foreground pixels in a row, from x0 up to but not
+ * including x1, and the label it was given */
+struct CCARun {
+   int x0;
+   int x1;
+   int label;
+};
+
+/* The pixel count and inclusive bounding box of a component, which is all
+ * most users of connected components need */
+struct CCABoxStats {
+   int count;
+   int low_x;
+   int high_x;
+   int low_y;
+   int high_y;
+
+   /* Starts a component with its first run */
+   inline void start(int x0, int x1, int y) {
+      count = x1 - x0;
+      low_x = x0;
+      high_x = x1 - 1;
+      low_y = y;
+      high_y = y;
+   }
+
+   /* Adds a later run to the component */
+   inline void add(int x0, int x1, int y) {
+      count += x1 - x0;
+      if (x0 < low_x) {
+         low_x = x0;
+      }
+      if (x1 - 1 > high_x) {
+         high_x = x1 - 1;
+      }
+      high_y = y;
+   }
+
+   /* Adds a component that started after this one */
+   inline void merge(const CCABoxStats &other) {
+      count += other.count;
+      if (other.low_x < low_x) {
+         low_x = other.low_x;
+      }
+      if (other.high_x > high_x) {
+         high_x = other.high_x;
+      }
+      if (other.high_y > high_y) {
+         high_y = other.high_y;
+      }
+   }
+};
+
+/**
+ * Labels the 4-connected components of a binary image, one row of runs at
+ * a time, and accumulates statistics over each.
+ *
+ * The image is given by a Mask policy with
+ *
+ *    void row(int y, int cols, uint8_t *mask) const;
+ *
+ * filling mask[x] with nonzero for each foreground pixel of row y. Rows are
+ * asked for top to bottom, so the policy can keep per-row state, and the
+ * loop is simple enough for the compiler to vectorise. The foreground of each
+ * row is collected into runs, skipping background eight pixels at a time,
+ * and each run is joined to the runs it touches in the row above with a
+ * union-find whose roots are always the first label of their component.
+ *
+ * Stats is accumulated per component, with start(x0, x1, y) for its first
+ * run, add(x0, x1, y) for each later run in raster order, and merge(other)
+ * for another part of the component that started later. Components are
+ * listed in raster order of their first pixel.
+ *
+ * Both are template parameters so each use compiles to its own loop, with
+ * the pixel test and accumulation inlined.
+ */
+template <class Stats>
+class ConnectedComponents {
+   public:
+      ConnectedComponents() {}
+
+      /**
+       * Labels the foreground of a cols x rows image.
+       *
+       * @param cutSize if nonzero, pixels either side of a column or row that
+       * is a multiple of cutSize are not connected, which keeps long lines
+       * in separate pieces
+       */
+      template <class Mask>
+      void label(const Mask &mask, int cols, int rows, int cutSize = 0);
+
+      /* @return the number of components found by the last label() */
+      int size() const { return components.size(); }
+
+      /* @return the statistics of the ith component */
+      const Stats &operator[](int i) const { return components[i]; }
+
+      /* @return the statistics of every component */
+      const std::vector<Stats> &stats() const { return components; }
+
+   private:
+      /* Collects row's foreground into runs */
+      void findRuns_(int cols, int cutSize);
+
+      /* @return the root label of label's component */
+      inline int find_(int label);
+
+      /* Joins two labels' components */
+      inline void unite_(int a, int b);
+
+      /* The current row's mask, and the runs of it and of the row above */
+      std::vector<uint8_t> row;
+      std::vector<CCARun> runs;
+      std::vector<CCARun> above;
+
+      /* The union-find parent and accumulated statistics of each label */
+      std::vector<int> parent;
+      std::vector<Stats> labelStats;
+
+      std::vector<Stats> components;
+};
+
+#include "utils/ConnectedComponents.tcc"
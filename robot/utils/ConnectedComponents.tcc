@@ -0,0 +1,129 @@
+#include <string.h>
+
+#include <algorithm>
+
+template <class Stats>
+template <class Mask>
+void ConnectedComponents<Stats>::label(const Mask &mask, int cols, int rows,
+                                       int cutSize) {
+   row.resize(cols + 1);
+   runs.clear();
+   above.clear();
+   parent.clear();
+   labelStats.clear();
+   components.clear();
+
+   for (int y = 0; y < rows; ++y) {
+      above.swap(runs);
+      mask.row(y, cols, &row[0]);
+      findRuns_(cols, cutSize);
+
+      // Rows on a cut start afresh
+      if (cutSize != 0 && y % cutSize == 0) {
+         above.clear();
+      }
+
+      // Both rows' runs are in order, so the runs above that touch each run
+      // start at or after those that touched the previous one
+      unsigned int first = 0;
+      for (unsigned int r = 0; r < runs.size(); ++r) {
+         CCARun &run = runs[r];
+         run.label = -1;
+         while (first < above.size() && above[first].x1 <= run.x0) {
+            ++first;
+         }
+         for (unsigned int a = first;
+              a < above.size() && above[a].x0 < run.x1; ++a) {
+            if (run.label < 0) {
+               run.label = above[a].label;
+            } else {
+               unite_(run.label, above[a].label);
+            }
+         }
+
+         if (run.label < 0) {
+            run.label = parent.size();
+            parent.push_back(run.label);
+            labelStats.push_back(Stats());
+            labelStats.back().start(run.x0, run.x1, y);
+         } else {
+            labelStats[run.label].add(run.x0, run.x1, y);
+         }
+      }
+   }
+
+   // A root is the first label of its component, so every other label
+   // started after it
+   for (unsigned int label = 0; label < parent.size(); ++label) {
+      int root = find_(label);
+      if (root != (int)label) {
+         labelStats[root].merge(labelStats[label]);
+      }
+   }
+   for (unsigned int label = 0; label < parent.size(); ++label) {
+      if (parent[label] == (int)label) {
+         components.push_back(labelStats[label]);
+      }
+   }
+}
+
+template <class Stats>
+void ConnectedComponents<Stats>::findRuns_(int cols, int cutSize) {
+   runs.clear();
+   const uint8_t *mask = &row[0];
+   int x = 0;
+   while (x < cols) {
+      // Skip background a word at a time
+      while (x + 8 <= cols) {
+         uint64_t word;
+         memcpy(&word, mask + x, sizeof(word));
+         if (word != 0) {
+            break;
+         }
+         x += 8;
+      }
+      while (x < cols && mask[x] == 0) {
+         ++x;
+      }
+      if (x == cols) {
+         break;
+      }
+
+      CCARun run;
+      run.x0 = x;
+      int end = cols;
+      if (cutSize != 0) {
+         end = std::min(cols, (x / cutSize + 1) * cutSize);
+      }
+      while (x < end && mask[x] != 0) {
+         ++x;
+      }
+      run.x1 = x;
+      runs.push_back(run);
+   }
+}
+
+template <class Stats>
+inline int ConnectedComponents<Stats>::find_(int label) {
+   int root = label;
+   while (parent[root] != root) {
+      root = parent[root];
+   }
+   while (parent[label] != root) {
+      int next = parent[label];
+      parent[label] = root;
+      label = next;
+   }
+   return root;
+}
+
+template <class Stats>
+inline void ConnectedComponents<Stats>::unite_(int a, int b) {
+   a = find_(a);
+   b = find_(b);
+   if (a < b) {
+      parent[b] = a;
+   } else if (b < a) {
+      parent[a] = b;
+   }
+}
@@ -0,0 +1,82 @@
+#include "utils/FrameArena.hpp"
+
+#include <stdlib.h>
+#include <algorithm>
+#include <new>
+
+FrameArena::FrameArena(size_t initialSize)
+   : used(0), bytes(0), numAllocations(0), numBlockAllocations(0) {
+   blocks.reserve(8);
+   addBlock(initialSize);
+}
+
+FrameArena::~FrameArena() {
+   for (size_t i = 0; i < blocks.size(); ++i) {
+      free(blocks[i].data);
+   }
+}
+
+void *FrameArena::allocate(size_t size) {
+   size_t offset = (used + FRAME_ARENA_ALIGNMENT - 1) &
+                   ~(size_t)(FRAME_ARENA_ALIGNMENT - 1);
+   if (offset + size > blocks.back().size) {
+      addBlock(size);
+      offset = 0;
+   }
+
+   used = offset + size;
+   bytes += size;
+   ++numAllocations;
+   return blocks.back().data + offset;
+}
+
+void FrameArena::reset() {
+   numBlockAllocations = 0;
+   if (blocks.size() > 1) {
+      // merge into one block so next frame fits without growing
+      size_t total = capacity();
+      for (size_t i = 0; i < blocks.size(); ++i) {
+         free(blocks[i].data);
+      }
+      blocks.clear();
+      addBlock(total);
+   }
+
+   used = 0;
+   bytes = 0;
+   numAllocations = 0;
+}
+
+size_t FrameArena::bytesAllocated() const {
+   return bytes;
+}
+
+uint32_t FrameArena::allocations() const {
+   return numAllocations;
+}
+
+uint32_t FrameArena::blockAllocations() const {
+   return numBlockAllocations;
+}
+
+size_t FrameArena::capacity() const {
+   size_t total = 0;
+   for (size_t i = 0; i < blocks.size(); ++i) {
+      total += blocks[i].size;
+   }
+   return total;
+}
+
+void FrameArena::addBlock(size_t minSize) {
+   Block block;
+   block.size = blocks.empty() ? minSize : std::max(minSize,
+                                                    2 * blocks.back().size);
+   // malloc only guarantees 8 byte alignment on 32 bit targets
+   if (posix_memalign((void **)&block.data, FRAME_ARENA_ALIGNMENT,
+                      block.size) != 0) {
+      throw std::bad_alloc();
+   }
+   blocks.push_back(block);
+   used = 0;
+   ++numBlockAllocations;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/* Size of the first block a FrameArena allocates. A full frame of child
+ * foveas and ball regions is usually well under this. */
+#define FRAME_ARENA_INITIAL_SIZE (1 << 20)
+
+/* Every allocation is aligned to this, enough for SSE loads and stores */
+#define FRAME_ARENA_ALIGNMENT 16
+
+/* A bump allocator for data that only lives for one frame
+ *
+ * Allocation just advances a pointer through a block of memory, and nothing
+ * is freed individually; reset() makes the whole arena available again at
+ * the start of the next frame. Destructors are not run, so anything needing
+ * one must be destroyed explicitly before reset().
+ *
+ * If a frame needs more than the current block another is added, and the
+ * next reset() replaces all blocks with one big enough for the whole frame,
+ * so after a few frames the arena stops touching the heap entirely. */
+class FrameArena {
+   public:
+      explicit FrameArena(size_t initialSize = FRAME_ARENA_INITIAL_SIZE);
+      ~FrameArena();
+
+      /* @return uninitialised memory for bytes bytes, valid until reset() */
+      void *allocate(size_t bytes);
+
+      /* @return uninitialised memory for n objects of type T */
+      template <class T>
+      T *allocate(size_t n = 1) {
+         return static_cast<T *>(allocate(n * sizeof(T)));
+      }
+
+      /* Release everything allocated since the last reset and start
+       * counting a new frame */
+      void reset();
+
+      /* @return bytes handed out since the last reset */
+      size_t bytesAllocated() const;
+
+      /* @return calls to allocate() since the last reset */
+      uint32_t allocations() const;
+
+      /* @return heap blocks the arena itself allocated since the last reset,
+       * including any made by reset(); zero once in steady state */
+      uint32_t blockAllocations() const;
+
+      /* @return total size of the arena's blocks */
+      size_t capacity() const;
+
+   private:
+      /* Append a block of at least minSize bytes and make it current */
+      void addBlock(size_t minSize);
+
+      struct Block {
+         uint8_t *data;
+         size_t size;
+      };
+
+      std::vector<Block> blocks;
+      size_t used;
+      size_t bytes;
+      uint32_t numAllocations;
+      uint32_t numBlockAllocations;
+
+      // not copyable
+      FrameArena(const FrameArena &);
+      FrameArena &operator=(const FrameArena &);
+};
@@ -11,7 +11,7 @@
 #include "thread/Thread.hpp"
 #include "utils/basic_onullstream.hpp"
 
-Logger::Logger(const char *name) {
+Logger::Logger(const char *name) : indentLevel(0), ownsStream(true) {
    if (!initialised) {
       throw std::runtime_error("Logging framework not initialized.");
    } else {
@@ -20,6 +20,7 @@ Logger::Logger(const char *name) {
       // get wiped, so noone gets confused.
       if (name == NULL) {
          logStream = &std::cerr;
+         ownsStream = false;
       } else if (!motion && (strcmp(name, "Motion") == 0)) {
          logStream = new onullstream;
       } else {
@@ -28,8 +29,11 @@ Logger::Logger(const char *name) {
    }
 }
 
+Logger::Logger() : indentLevel(0), ownsStream(false), logStream(NULL) {
+}
+
 Logger::~Logger() {
-   if (logStream != std::cerr) {
+   if (ownsStream) {
       delete logStream;
    }
    logStream = NULL;
@@ -72,6 +76,16 @@ Logger *Logger::instance() {
    return logger;
 }
 
+void Logger::logTo(std::ostream *stream) {
+   delete logger;
+   logger = new Logger();
+   logger->logStream = stream;
+}
+
+void Logger::write(const std::string &text) {
+   *logStream << text << std::flush;
+}
+
 std::ostream &Logger::realLlog(int logLevel_) {
    if (logLevel >= logLevel_) {
       return *logStream;
@@ -94,6 +108,5 @@ std::ostream &Logger::realLlog(int logLevel_, int indentInc_) {
 __thread Logger *Logger::logger = NULL;
 bool Logger::initialised = false;
 bool Logger::motion;
-int Logger::indentLevel = 0;
 std::string Logger::logPath;
 enum LogLevel Logger::logLevel;
@@ -48,8 +48,22 @@ class Logger {
       std::ostream &realLlog(int logLevel, int indentInc);
       static void readOptions(const boost::program_options::variables_map &config);
 
+      /**
+       * Log this thread to stream, which stays the caller's, instead of a
+       * file of its own. For threads without a name, such as a WorkerPool's,
+       * whose logs are copied into their owner's.
+       */
+      static void logTo(std::ostream *stream);
+
+      /* Write text, already filtered by level, straight to the log */
+      void write(const std::string &text);
+
    private:
-      static int indentLevel;
+      Logger();
+      /* Per logger, as each thread's llog_open and llog_close nest alone */
+      int indentLevel;
+      /* Whether logStream is ours to delete */
+      bool ownsStream;
       static void init(std::string logLevel, bool motion);
       static __thread Logger *logger;
       static enum LogLevel logLevel;
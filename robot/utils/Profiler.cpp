@@ -0,0 +1,176 @@
+#include "utils/Profiler.hpp"
+
+#include <cstring>
+
+#include <boost/thread/mutex.hpp>
+
+namespace {
+
+struct ProfileSample {
+   int zone;
+   uint32_t us;
+};
+
+/**
+ * Samples from one thread. Single producer (the owning thread), single
+ * consumer (the collecting thread); head and tail only ever increase.
+ */
+struct ProfileRing {
+   ProfileSample samples[PROFILER_RING_SIZE];
+   volatile uint32_t head;
+   volatile uint32_t tail;
+   volatile uint32_t dropped;
+};
+
+boost::mutex registryLock;
+std::vector<std::string> zoneNames;
+std::vector<ProfileRing *> rings;
+__thread ProfileRing *threadRing = NULL;
+
+// only touched by the collecting thread
+uint32_t histograms[PROFILER_MAX_ZONES][PROFILER_NUM_BUCKETS];
+uint32_t counts[PROFILER_MAX_ZONES];
+uint32_t maxima[PROFILER_MAX_ZONES];
+
+inline int bucketOf(uint32_t us) {
+   if (us < 16) {
+      return us;
+   }
+   int octave = 31 - __builtin_clz(us);
+   int sub = (us >> (octave - 3)) & 7;
+   return 16 + (octave - 4) * 8 + sub;
+}
+
+/* the largest value that falls in bucket */
+inline uint32_t bucketTop(int bucket) {
+   if (bucket < 16) {
+      return bucket;
+   }
+   int octave = (bucket - 16) / 8 + 4;
+   int sub = (bucket - 16) % 8;
+   uint64_t width = (uint64_t)1 << (octave - 3);
+   uint64_t top = (8 + sub) * width + width - 1;
+   return top > 0xFFFFFFFFull ? 0xFFFFFFFF : (uint32_t)top;
+}
+
+uint32_t percentile(int zone, float fraction) {
+   uint32_t rank = (uint32_t)(fraction * counts[zone] + 0.999f);
+   if (rank < 1) {
+      rank = 1;
+   }
+   uint32_t seen = 0;
+   for (int bucket = 0; bucket < PROFILER_NUM_BUCKETS; ++bucket) {
+      seen += histograms[zone][bucket];
+      if (seen >= rank) {
+         uint32_t top = bucketTop(bucket);
+         return top < maxima[zone] ? top : maxima[zone];
+      }
+   }
+   return maxima[zone];
+}
+
+ProfileRing *createRing() {
+   ProfileRing *ring = new ProfileRing;
+   ring->head = 0;
+   ring->tail = 0;
+   ring->dropped = 0;
+   // threads restart in place after a crash, so rings are never freed
+   boost::mutex::scoped_lock lock(registryLock);
+   rings.push_back(ring);
+   return ring;
+}
+
+}
+
+int Profiler::zoneId(const std::string &name) {
+   boost::mutex::scoped_lock lock(registryLock);
+   for (unsigned int i = 0; i < zoneNames.size(); ++i) {
+      if (zoneNames[i] == name) {
+         return i;
+      }
+   }
+   if (zoneNames.size() == PROFILER_MAX_ZONES - 1) {
+      zoneNames.push_back("other");
+   }
+   if (zoneNames.size() == PROFILER_MAX_ZONES) {
+      return PROFILER_MAX_ZONES - 1;
+   }
+   zoneNames.push_back(name);
+   return zoneNames.size() - 1;
+}
+
+void Profiler::record(int zone, uint32_t us) {
+   ProfileRing *ring = threadRing;
+   if (ring == NULL) {
+      ring = threadRing = createRing();
+   }
+   uint32_t head = ring->head;
+   if (head - ring->tail >= PROFILER_RING_SIZE) {
+      ++ring->dropped;
+      return;
+   }
+   ProfileSample &sample = ring->samples[head & (PROFILER_RING_SIZE - 1)];
+   sample.zone = zone;
+   sample.us = us;
+   // the sample must be visible before the collector sees the new head
+   __sync_synchronize();
+   ring->head = head + 1;
+}
+
+void Profiler::collect() {
+   std::vector<ProfileRing *> current;
+   {
+      boost::mutex::scoped_lock lock(registryLock);
+      current = rings;
+   }
+   for (unsigned int r = 0; r < current.size(); ++r) {
+      ProfileRing *ring = current[r];
+      uint32_t head = ring->head;
+      __sync_synchronize();
+      for (uint32_t i = ring->tail; i != head; ++i) {
+         const ProfileSample &sample =
+            ring->samples[i & (PROFILER_RING_SIZE - 1)];
+         ++histograms[sample.zone][bucketOf(sample.us)];
+         ++counts[sample.zone];
+         if (sample.us > maxima[sample.zone]) {
+            maxima[sample.zone] = sample.us;
+         }
+      }
+      // finish reading the samples before the producer may reuse them
+      __sync_synchronize();
+      ring->tail = head;
+   }
+}
+
+std::vector<ProfileZoneStats> Profiler::stats(bool reset) {
+   std::vector<ProfileZoneStats> result;
+   boost::mutex::scoped_lock lock(registryLock);
+   for (unsigned int zone = 0; zone < zoneNames.size(); ++zone) {
+      if (counts[zone] == 0) {
+         continue;
+      }
+      ProfileZoneStats zoneStats;
+      zoneStats.name = zoneNames[zone];
+      zoneStats.count = counts[zone];
+      zoneStats.p50 = percentile(zone, 0.50f);
+      zoneStats.p95 = percentile(zone, 0.95f);
+      zoneStats.p99 = percentile(zone, 0.99f);
+      zoneStats.max = maxima[zone];
+      result.push_back(zoneStats);
+   }
+   if (reset) {
+      memset(histograms, 0, sizeof(histograms));
+      memset(counts, 0, sizeof(counts));
+      memset(maxima, 0, sizeof(maxima));
+   }
+   return result;
+}
+
+uint32_t Profiler::dropped() {
+   uint32_t total = 0;
+   boost::mutex::scoped_lock lock(registryLock);
+   for (unsigned int r = 0; r < rings.size(); ++r) {
+      total += rings[r]->dropped;
+   }
+   return total;
+}
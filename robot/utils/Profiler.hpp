@@ -0,0 +1,108 @@
+#pragma once
+
+#include <sys/time.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "types/ProfileZoneStats.hpp"
+
+// zones beyond this are all recorded under the last one, "other"
+#define PROFILER_MAX_ZONES 128
+
+// samples each thread can record between collections, a power of two
+#define PROFILER_RING_SIZE 4096
+
+// exact below 16us, then 8 buckets per power of two up to 2^32us
+#define PROFILER_NUM_BUCKETS 240
+
+/**
+ * A lightweight profiler for code that runs every tick. Each thread records
+ * the duration of its zones into its own lock-free ring, and one thread
+ * (Perception) periodically collects the rings into per-zone histograms, so
+ * the tail latency that running averages hide shows up as p95/p99/max.
+ *
+ *    PROFILE_ZONE(zone, "vision.fovea");
+ *    generateFovea();
+ *    // recorded when zone goes out of scope, or by zone.stop()
+ */
+class Profiler {
+   public:
+      /**
+       * The id of the zone called name, registering it if it is new. This
+       * takes a lock, so look ids up once (PROFILE_ZONE does) rather than
+       * every tick.
+       */
+      static int zoneId(const std::string &name);
+
+      /**
+       * Records that zone took us microseconds, in the calling thread's
+       * ring. Lock free; if the ring is full the sample is dropped.
+       */
+      static void record(int zone, uint32_t us);
+
+      /**
+       * Empties every thread's ring into the zone histograms. Only one
+       * thread may collect.
+       */
+      static void collect();
+
+      /**
+       * Summarises every zone with samples since the last reset, in the
+       * order zones were registered. Call from the collecting thread.
+       *
+       * @param reset whether to clear the histograms, starting a new window
+       */
+      static std::vector<ProfileZoneStats> stats(bool reset);
+
+      /* samples dropped because a thread's ring was full */
+      static uint32_t dropped();
+};
+
+/**
+ * Times a zone from construction until stop() or destruction.
+ */
+class ProfileZone {
+   public:
+      explicit ProfileZone(int zone) : zone_(zone) {
+         gettimeofday(&start_, NULL);
+      }
+
+      ~ProfileZone() {
+         if (zone_ >= 0) {
+            stop();
+         }
+      }
+
+      /**
+       * Records the zone now rather than at the end of the scope.
+       *
+       * @return the time spent in the zone, in microseconds
+       */
+      uint32_t stop() {
+         timeval now;
+         gettimeofday(&now, NULL);
+         int64_t us = (int64_t)(now.tv_sec - start_.tv_sec) * 1000000 +
+                      (now.tv_usec - start_.tv_usec);
+         // wall clock, so it can step backwards
+         uint32_t elapsed = us > 0 ? (uint32_t)us : 0;
+         if (zone_ >= 0) {
+            Profiler::record(zone_, elapsed);
+            zone_ = -1;
+         }
+         return elapsed;
+      }
+
+   private:
+      int zone_;
+      timeval start_;
+};
+
+/**
+ * Declares a ProfileZone called var timing the zone called name, which is
+ * only looked up the first time the line runs.
+ */
+#define PROFILE_ZONE(var, name) \
+   static const int var##ProfileId_ = Profiler::zoneId(name); \
+   ProfileZone var(var##ProfileId_)
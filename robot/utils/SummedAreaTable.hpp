@@ -0,0 +1,46 @@
+#pragma once
+
+/* Summed area tables, for the sum of any rectangle of an image in four lookups
+ *
+ * A table for a width x height image has (width + 1) x (height + 1) entries,
+ * entry x + y * (width + 1) holding the sum of every pixel above and to the
+ * left of x, y. The first row and column are zero, so rectangles touching
+ * the image's edges need no special cases.
+ *
+ * Sums are unsigned and wrap, so a rectangle's sum is still right as long as
+ * it fits in Sum, even if the whole image's doesn't. */
+
+/* Fills table with the sums of image, a width x height image of pixels */
+template <class Sum, class Pixel>
+void buildSummedArea(const Pixel *image, int width, int height, Sum *table);
+
+/* As buildSummedArea, but summing the square of each pixel */
+template <class Sum, class Pixel>
+void buildSummedSquares(const Pixel *image, int width, int height,
+                        Sum *table);
+
+/**
+ * Fills table with the number of pixels of each class, numClasses counts to
+ * an entry, so the count of class c is at (x + y * (width + 1)) * numClasses
+ * + c. Every pixel must be a class below numClasses.
+ */
+template <class Sum, class Pixel>
+void buildClassCounts(const Pixel *image, int width, int height,
+                      int numClasses, Sum *table);
+
+/**
+ * The sum over the rectangle from x0, y0 up to but not including x1, y1, of
+ * a table built for an image width pixels wide. Class count tables pass
+ * their number of classes as stride and the class as offset.
+ */
+template <class Sum>
+inline Sum sumRect(const Sum *table, int width, int x0, int y0, int x1,
+                   int y1, int stride = 1, int offset = 0) {
+   const int row = (width + 1) * stride;
+   const Sum *top = table + y0 * row + offset;
+   const Sum *bottom = table + y1 * row + offset;
+   return bottom[x1 * stride] - bottom[x0 * stride] -
+          top[x1 * stride] + top[x0 * stride];
+}
+
+#include "utils/SummedAreaTable.tcc"
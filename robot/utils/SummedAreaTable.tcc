@@ -0,0 +1,60 @@
+#include <algorithm>
+#include <vector>
+
+template <class Sum, class Pixel>
+void buildSummedArea(const Pixel *image, int width, int height, Sum *table) {
+   const int stride = width + 1;
+   std::fill(table, table + stride, Sum(0));
+   for (int y = 0; y < height; ++y) {
+      const Pixel *pixel = image + y * width;
+      const Sum *above = table + y * stride;
+      Sum *row = table + (y + 1) * stride;
+      Sum run = 0;
+      row[0] = 0;
+      for (int x = 0; x < width; ++x) {
+         run += pixel[x];
+         row[x + 1] = above[x + 1] + run;
+      }
+   }
+}
+
+template <class Sum, class Pixel>
+void buildSummedSquares(const Pixel *image, int width, int height,
+                        Sum *table) {
+   const int stride = width + 1;
+   std::fill(table, table + stride, Sum(0));
+   for (int y = 0; y < height; ++y) {
+      const Pixel *pixel = image + y * width;
+      const Sum *above = table + y * stride;
+      Sum *row = table + (y + 1) * stride;
+      Sum run = 0;
+      row[0] = 0;
+      for (int x = 0; x < width; ++x) {
+         run += Sum(pixel[x]) * Sum(pixel[x]);
+         row[x + 1] = above[x + 1] + run;
+      }
+   }
+}
+
+template <class Sum, class Pixel>
+void buildClassCounts(const Pixel *image, int width, int height,
+                      int numClasses, Sum *table) {
+   const int stride = (width + 1) * numClasses;
+   std::fill(table, table + stride, Sum(0));
+   // the running count of each class along the row, as in buildSummedArea
+   std::vector<Sum> run(numClasses);
+   for (int y = 0; y < height; ++y) {
+      const Pixel *pixel = image + y * width;
+      const Sum *above = table + y * stride;
+      Sum *row = table + (y + 1) * stride;
+      std::fill(run.begin(), run.end(), Sum(0));
+      std::fill(row, row + numClasses, Sum(0));
+      for (int x = 0; x < width; ++x) {
+         ++run[pixel[x]];
+         const int entry = (x + 1) * numClasses;
+         for (int c = 0; c < numClasses; ++c) {
+            row[entry + c] = above[entry + c] + run[c];
+         }
+      }
+   }
+}
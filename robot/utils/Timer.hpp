@@ -85,13 +85,17 @@ class Timer {
       uint32_t elapsed_ms() {
          timeval tmp;
          gettimeofday(&tmp, NULL);
-         return msec(tmp) - msec(timeStamp);
+         return ((int64_t)(tmp.tv_sec - timeStamp.tv_sec) * 1000000 +
+                 (tmp.tv_usec - timeStamp.tv_usec)) / 1000;
       }
 
       uint32_t elapsed_us() {
          timeval tmp;
          gettimeofday(&tmp, NULL);
-         return usec(tmp) - usec(timeStamp);
+         // difference the fields first, absolute times in microseconds
+         // overflow a 32 bit time_t and lose precision as a float
+         return (int64_t)(tmp.tv_sec - timeStamp.tv_sec) * 1000000 +
+                (tmp.tv_usec - timeStamp.tv_usec);
       }
 
       /* return estimated maximum value for elapsed() */
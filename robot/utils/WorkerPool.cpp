@@ -0,0 +1,155 @@
+#include "utils/WorkerPool.hpp"
+
+#include <stdexcept>
+#include <boost/bind.hpp>
+
+#include "utils/Logger.hpp"
+
+WorkerPool::WorkerPool(unsigned int numWorkers)
+   : current(NULL), batch(0), busy(0), stopping(false) {
+   if (numWorkers == 0) {
+      numWorkers = boost::thread::hardware_concurrency();
+   }
+   if (numWorkers == 0) {
+      numWorkers = 1;
+   }
+   for (unsigned int i = 0; i < numWorkers; ++i) {
+      shares.push_back(new Share());
+   }
+   // worker 0 is whoever calls run()
+   for (unsigned int i = 1; i < numWorkers; ++i) {
+      threads.create_thread(boost::bind(&WorkerPool::workerLoop, this, i));
+   }
+}
+
+WorkerPool::~WorkerPool() {
+   {
+      boost::mutex::scoped_lock scopedLock(lock);
+      stopping = true;
+      started.notify_all();
+   }
+   threads.join_all();
+   for (unsigned int i = 0; i < shares.size(); ++i) {
+      delete shares[i];
+   }
+}
+
+unsigned int WorkerPool::size() const {
+   return shares.size();
+}
+
+void WorkerPool::run(unsigned int numTasks, const Task &task) {
+   if (numTasks == 0) {
+      return;
+   }
+   if (shares.size() == 1 || numTasks == 1) {
+      for (unsigned int i = 0; i < numTasks; ++i) {
+         task(i, 0);
+      }
+      return;
+   }
+
+   for (unsigned int i = 0; i < numTasks; ++i) {
+      shares[i % shares.size()]->tasks.push_back(i);
+   }
+   {
+      boost::mutex::scoped_lock scopedLock(lock);
+      current = &task;
+      error.clear();
+      busy = shares.size() - 1;
+      ++batch;
+      started.notify_all();
+   }
+
+   std::string callerError;
+   try {
+      work(0);
+   } catch (const std::exception &e) {
+      callerError = e.what();
+   }
+
+   // the pool's threads may still be running tasks that use our caller's
+   // stack, so wait for them even if a task threw
+   boost::mutex::scoped_lock scopedLock(lock);
+   while (busy > 0) {
+      finished.wait(scopedLock);
+   }
+   current = NULL;
+   flushLogs();
+   if (!callerError.empty() || !error.empty()) {
+      throw std::runtime_error("WorkerPool task failed: " +
+                               (callerError.empty() ? error : callerError));
+   }
+}
+
+void WorkerPool::workerLoop(unsigned int worker) {
+   Logger::logTo(&shares[worker]->log);
+   unsigned int seen = 0;
+   while (true) {
+      {
+         boost::mutex::scoped_lock scopedLock(lock);
+         while (!stopping && batch == seen) {
+            started.wait(scopedLock);
+         }
+         if (stopping) {
+            return;
+         }
+         seen = batch;
+      }
+
+      std::string taskError;
+      try {
+         work(worker);
+      } catch (const std::exception &e) {
+         taskError = e.what();
+      }
+
+      boost::mutex::scoped_lock scopedLock(lock);
+      if (!taskError.empty() && error.empty()) {
+         error = taskError;
+      }
+      if (--busy == 0) {
+         finished.notify_one();
+      }
+   }
+}
+
+void WorkerPool::work(unsigned int worker) {
+   unsigned int task;
+   while (take(worker, &task)) {
+      (*current)(task, worker);
+   }
+}
+
+void WorkerPool::flushLogs() {
+   for (unsigned int i = 1; i < shares.size(); ++i) {
+      std::ostringstream &log = shares[i]->log;
+      if (log.tellp() > 0) {
+         Logger::instance()->write(log.str());
+         log.str("");
+      }
+   }
+}
+
+bool WorkerPool::take(unsigned int worker, unsigned int *task) {
+   {
+      Share &own = *shares[worker];
+      boost::mutex::scoped_lock scopedLock(own.lock);
+      if (!own.tasks.empty()) {
+         *task = own.tasks.front();
+         own.tasks.pop_front();
+         return true;
+      }
+   }
+   // nothing left of our own, so help whoever is next along
+   for (unsigned int i = 1; i < shares.size(); ++i) {
+      Share &victim = *shares[(worker + i) % shares.size()];
+      boost::mutex::scoped_lock scopedLock(victim.lock);
+      if (!victim.tasks.empty()) {
+         *task = victim.tasks.back();
+         victim.tasks.pop_back();
+         return true;
+      }
+   }
+   return false;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <deque>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+/* A small, fixed set of threads for splitting one tick's work into tasks
+ *
+ * run() deals tasks 0..n-1 out round robin between the calling thread and
+ * the pool's threads, then every one of them works through its own share
+ * from the front. One that runs out steals from the back of another's share,
+ * so a few slow tasks do not leave the rest of the pool idle. run() returns
+ * once every task has finished, so tasks may use the caller's stack.
+ *
+ * The pool's threads log into their share rather than a file of their own;
+ * run() copies what they logged into the caller's log before it returns. */
+class WorkerPool {
+   public:
+      /* A task, and which worker is running it (0 is the calling thread),
+       * so tasks can use per worker scratch without locking */
+      typedef boost::function<void(unsigned int task, unsigned int worker)>
+         Task;
+
+      /* @param numWorkers workers including the calling thread; 0 means
+       * one per core */
+      explicit WorkerPool(unsigned int numWorkers);
+
+      /* Stops and joins the pool's threads */
+      ~WorkerPool();
+
+      /* @return the number of workers including the calling thread */
+      unsigned int size() const;
+
+      /* Run task for 0..numTasks-1 across the pool and wait for all of
+       * them. Not reentrant; only one thread may run() at a time.
+       * @throw std::runtime_error if any task threw */
+      void run(unsigned int numTasks, const Task &task);
+
+   private:
+      /* The tasks dealt to one worker. The owner takes from the front and
+       * thieves from the back. */
+      struct Share {
+         boost::mutex lock;
+         std::deque<unsigned int> tasks;
+         /* What this share's pool thread logged during the current run() */
+         std::ostringstream log;
+      };
+
+      /* Body of the pool's threads */
+      void workerLoop(unsigned int worker);
+
+      /* Run tasks from worker's share, then stolen ones, until none are
+       * left anywhere */
+      void work(unsigned int worker);
+
+      /* @return whether a task was taken from worker's share or stolen */
+      bool take(unsigned int worker, unsigned int *task);
+
+      /* Copy what the pool's threads logged into the caller's log */
+      void flushLogs();
+
+      std::vector<Share *> shares;
+      boost::thread_group threads;
+
+      /* Guards everything below */
+      boost::mutex lock;
+      boost::condition_variable started;
+      boost::condition_variable finished;
+      const Task *current;
+      /* Incremented for every run() so threads see each batch once */
+      unsigned int batch;
+      /* Pool threads still working on the current batch */
+      unsigned int busy;
+      bool stopping;
+      /* The first exception a pool thread's task threw this batch */
+      std::string error;
+
+      // not copyable
+      WorkerPool(const WorkerPool &);
+      WorkerPool &operator=(const WorkerPool &);
+};
@@ -75,6 +75,9 @@ void populate_options(po::options_description &config_file_options) {
       "enable OffNaoTransmitter thread")
       ("debug.perception,P", po::value<bool>()->default_value(true),
       "enable Perception thread")
+      ("debug.perception_pipelined", po::value<bool>()->default_value(false),
+      "process the next frame's vision while localisation and behaviour "
+      "finish the current one")
       ("debug.vision,V", po::value<bool>()->default_value(true),
       "enable Vision module")
       ("debug.behaviour,B", po::value<bool>()->default_value(true),
@@ -205,9 +208,41 @@ void populate_options(po::options_description &config_file_options) {
       ("vision.run_colour_calibration", po::value<bool>()->default_value(false),
       "runs a calibration")
       ("vision.load_nnmc", po::value<bool>()->default_value(true),
-      "loads /home/nao/data/green_yuv_classifier.nnmc to nnmc_")
+      "loads /home/nao/data/green_yuv_classifier.nnmc as the colour table")
       ("vision.save_nnmc", po::value<bool>()->default_value(false),
-      "saves our calibration to an nnmc file");
+      "saves our calibration to an nnmc file")
+      ("vision.packed_lut", po::value<bool>()->default_value(false),
+      "classify with a compact copy of the nnmc that fits in cache; only "
+      "faster on the robot's Atom, whose cache the full nnmc overflows")
+      ("vision.incremental_fovea", po::value<bool>()->default_value(false),
+      "only regenerate the parts of the fovea that changed while still")
+      ("vision.ball_threads", po::value<int>()->default_value(1),
+      "threads evaluating ball candidates, 0 for one per core")
+      ("vision.ball_extra_stages", po::value<string>()->default_value(""),
+      "comma separated ball checks to add: hog, pattern, sphereCheck, "
+      "whiteDensity")
+      ("vision.integral_fovea", po::value<bool>()->default_value(false),
+      "build summed area tables for constant time window counts and sums")
+      ("vision.run_length_fovea", po::value<bool>()->default_value(false),
+      "encode the colour fovea as runs so scans can skip runs of green")
+      ("vision.ball_hough_circle_fit", po::value<bool>()->default_value(false),
+      "fit ball circles by hough voting and least squares, not every circle")
+      ("vision.ball_tracking", po::value<bool>()->default_value(false),
+      "look for the ball where it should be from the last frame first")
+      ("vision.ransac_confidence", po::value<float>()->default_value(0.0f),
+      "stop a field line or centre circle search once this sure of an all "
+      "inlier sample, 0 to always draw every model")
+      ("vision.ransac_preemptive", po::value<int>()->default_value(0),
+      "random points a field line or centre circle must fit before the rest "
+      "are scored, 0 to score every point")
+      ("vision.ransac_local_optimisation", po::value<bool>()->default_value(false),
+      "refit each new best field line or centre circle to its inliers");
+
+   po::options_description localisation_config("Localisation options");
+   localisation_config.add_options()
+      ("localisation.mode_threads", po::value<int>()->default_value(1),
+      "threads updating the distribution's modes with vision, 0 for one per "
+      "core");
 
    po::options_description camera_config("Camera options");
    camera_config.add_options()
@@ -344,7 +379,8 @@ void populate_options(po::options_description &config_file_options) {
 
    config_file_options.add(game_config).add(player_config)
    .add(gamecontroller_config).add(debug_config).add(behaviour_config)
-   .add(motion_config).add(vision_config).add(camera_config).add(kinematics_config)
+   .add(motion_config).add(vision_config).add(localisation_config)
+   .add(camera_config).add(kinematics_config)
    .add(transmitter_config).add(network_config).add(touch_config);
 }
 
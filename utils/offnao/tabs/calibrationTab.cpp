@@ -601,10 +601,7 @@ void CalibrationTab::drawOverlays(QImage *image) {
 
       uint8_t *ptr = reinterpret_cast<uint8_t*>(getCurrentClassifier()->getNnmcPointer());
 
-      for (int i = 0; i < 2097152; i++) {
-         ((GreenYUVClassifier *) vision->colour_classifier_top_)->nnmc_[i] = ptr[i];
-         ((GreenYUVClassifier *) vision->colour_classifier_bot_)->nnmc_[i] = ptr[i];
-      }
+      vision->setNnmc(ptr);
 
       VisionInfoOut info_out = vision->processFrame(CombinedFrame(topFrame, botFrame), info_in);
 
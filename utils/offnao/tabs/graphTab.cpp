@@ -161,7 +161,7 @@ void GraphTab::newNaoData(NaoData *naoData) {
                emptyS.sensors[i] = 0.0f;
          for (int i = new_frame - PLOT_SIZE + 1; i <= new_frame; ++i) {
             if (i >= 0) {
-               s.push_back(naoData->getFrame(i).blackboard->motion.sensors);
+               s.push_back(naoData->getFrame(i).blackboard->motion.sensors.read());
                o.push_back(naoData->getFrame(i).blackboard->motion.odometry);
             } else {
                s.push_back(emptyS);
@@ -180,7 +180,7 @@ void GraphTab::newNaoData(NaoData *naoData) {
                 emptyS.sensors[i] = 0.0f;
           for (int i = new_frame - PLOT_SIZE + 1; i <= new_frame; ++i) {
              if (i >= 0) {
-                s.push_back(naoData->getFrame(i).blackboard->motion.sensors);
+                s.push_back(naoData->getFrame(i).blackboard->motion.sensors.read());
                 o.push_back(naoData->getFrame(i).blackboard->motion.odometry);
              } else {
                 s.push_back(emptyS);
@@ -194,7 +194,7 @@ void GraphTab::newNaoData(NaoData *naoData) {
          std::vector<SensorValues> s;
          std::vector<Odometry> o;
          for (int i = last_frame + 1; i <= new_frame; ++i) {
-            s.push_back(naoData->getFrame(i).blackboard->motion.sensors);
+            s.push_back(naoData->getFrame(i).blackboard->motion.sensors.read());
             o.push_back(naoData->getFrame(i).blackboard->motion.odometry);
          }
          updatePlots(s, o);
@@ -59,6 +59,11 @@ VariableView::VariableView() {
          QStringList(QString("Behaviour time: ")), 1);
    perceptionTotalTime = new QTreeWidgetItem(perceptionHeading,
          QStringList(QString("Total time: ")), 1);
+   perceptionFrameAge = new QTreeWidgetItem(perceptionHeading,
+         QStringList(QString("Frame age: ")), 1);
+
+   profileHeading = new QTreeWidgetItem(this,
+         QStringList(QString("Profile (us, p50/p95/p99/max)")), 1);
 
    visionHeading = new QTreeWidgetItem(this, QStringList(QString("Vision")), 1);
    visionHeading->setExpanded(true);
@@ -291,6 +296,7 @@ void VariableView::redraw(NaoData *naoData) {
 
    updateVision(naoData);
    updateBehaviour(naoData);
+   updateProfile(naoData);
    stringstream steam;
    steam << "gamecontroller.team_red = " << readFrom(gameController, team_red) << endl;
    gameControllerTeam->setText(0, steam.str().c_str());
@@ -303,6 +309,28 @@ const char* VariableView::createSufPref(string pref, T t, string suff) {
    return s.str().c_str();
 }
 
+void VariableView::updateProfile(NaoData *naoData) {
+   Blackboard *blackboard = (naoData->getCurrentFrame().blackboard);
+   if (!blackboard) return;
+
+   const std::vector<ProfileZoneStats> &profile = readFrom(perception, profile);
+   while (profileZones.size() < profile.size()) {
+      profileZones.push_back(new QTreeWidgetItem(profileHeading,
+            QStringList(QString("")), 1));
+   }
+   while (profileZones.size() > profile.size()) {
+      delete profileZones.back();
+      profileZones.pop_back();
+   }
+   for (unsigned int i = 0; i < profile.size(); ++i) {
+      stringstream s;
+      s << profile[i].name << ": " << profile[i].p50 << " / "
+        << profile[i].p95 << " / " << profile[i].p99 << " / "
+        << profile[i].max << " (" << profile[i].count << " ticks)";
+      profileZones[i]->setText(0, s.str().c_str());
+   }
+}
+
 void VariableView::updateBehaviour(NaoData *naoData) {
    Blackboard *blackboard = (naoData->getCurrentFrame().blackboard);
    if (!blackboard) return;
@@ -367,6 +395,7 @@ void VariableView::updateVision(NaoData *naoData) {
    perceptionLocalisationTime->setText(0, createSufPref("Localisation time: ", readFrom(perception, localisation), ""));
    perceptionBehaviourTime->setText(0, createSufPref("Behaviour time: ", readFrom(perception, behaviour), ""));
    perceptionTotalTime->setText(0, createSufPref("Total time: ", total, ""));
+   perceptionFrameAge->setText(0, createSufPref("Frame age: ", readFrom(perception, frameAge), ""));
 
    visionTimestamp->setText(0, createSufPref("Timestamp: ", readFrom(vision, timestamp), ""));
    visionFrames->setText(0, createSufPref("Surf missed frames: ", readFrom(vision, missedFrames), ""));
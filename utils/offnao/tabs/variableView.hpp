@@ -35,6 +35,7 @@ Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 #include <QTreeWidgetItem>
 #include <deque>
 #include <string>
+#include <vector>
 
 #include "naoData.hpp"
 #include "perception/vision/other/YUV.hpp"
@@ -65,6 +66,11 @@ class VariableView : public QTreeWidget {
       QTreeWidgetItem *perceptionLocalisationTime;
       QTreeWidgetItem *perceptionBehaviourTime;
       QTreeWidgetItem *perceptionTotalTime;
+      QTreeWidgetItem *perceptionFrameAge;
+
+      QTreeWidgetItem *profileHeading;
+      /* One item per profiler zone, in the order the robot sent them */
+      std::vector<QTreeWidgetItem *> profileZones;
 
 
       QTreeWidgetItem *visionTimestamp;
@@ -134,5 +140,6 @@ class VariableView : public QTreeWidget {
       std::deque<int> times;
       void updateVision(NaoData *naoData);
       void updateBehaviour(NaoData *naoData);
+      void updateProfile(NaoData *naoData);
 
 };